@@ -0,0 +1,313 @@
+/*
+ * Copyright 2021 Xilinx, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Edge preserving denoise of phantom CT slices: the windowed xf::cv::bilateralFilter at 3x3, 5x5 and 7x7
+ * against xf::cv::bilateralGrid with 8, 16 and 32 pixel cells in C-sim on 8-bit soft tissue windowed
+ * 512x512 slices, the CPU medimg::BilateralGrid on the 8-bit and on 12-bit raw slices at 512x512 and
+ * 3840x2160 on one and on all hardware threads, and OpenCV's bilateralFilter for reference. Besides the
+ * time every filter reports the RMS error against the same slice generated without acquisition noise,
+ * in grey levels for 8-bit and in HU for 12-bit. C-sim grid results have to match the CPU ones exactly.
+ * First the C-sim grid with 8 and 16 pixel cells and the CPU grid, 8 and 12-bit, run on small random,
+ * constant, step edge and phantom images against splatting, blurring and slicing one whole grid directly.
+ *
+ * Build (the bench directory is not part of the Vitis host build):
+ *   g++ -std=c++14 -O3 -pthread -I../src -I../libs/xf_opencv/L1/include -I$XILINX_VIVADO_HLS/include \
+ *       bench_bilateral_grid.cpp -o bench_bilateral_grid `pkg-config --cflags --libs opencv4`
+ * Add -DMEDIMG_BENCH_NO_OPENCV to leave out the OpenCV reference.
+ * Usage:
+ *   ./bench_bilateral_grid [slices]
+ */
+
+#include "common/xf_common.hpp"
+#include "common/xf_utility.hpp"
+#include "imgproc/xf_bilateral_filter.hpp"
+#include "imgproc/xf_bilateral_grid.hpp"
+#include "medimg_bench.h"
+#include "medimg_bilateral_grid.h"
+#ifndef MEDIMG_BENCH_NO_OPENCV
+#include "opencv2/opencv.hpp"
+#endif
+
+#include <algorithm>
+#include <iostream>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+#define BENCH_HEIGHT 2160
+#define BENCH_WIDTH 3840
+#define BENCH_CSIM_SIZE 512
+#define BENCH_RANGE_SHIFT_8 4  // sigma_color ~14 grey levels, ~22 HU in the soft tissue window
+#define BENCH_RANGE_SHIFT_12 5 // sigma_color ~28 HU
+#define BENCH_SIGMA_COLOR 14.0f
+
+typedef xf::cv::Mat<XF_8UC1, BENCH_CSIM_SIZE, BENCH_CSIM_SIZE, XF_NPPC1> mat8_t;
+
+using medimg::bench::now_ms;
+using medimg::bench::rms;
+using medimg::bench::sumSquares;
+
+static void report(const char* name, int rows, int cols, int slices, double ms, double err) {
+    medimg::bench::report(name, rows, cols, slices, ms, ", RMS error %6.2f", err);
+}
+
+/* The whole (rows + s) / s by (cols + s) / s by in_max / r grid splatted, blurred with [1 2 1] along all
+ * three axes (cells outside the grid empty) and sliced trilinearly, rounding the quotient */
+template <typename T>
+static std::vector<T> directGrid(const std::vector<T>& img, int rows, int cols, int ss, int rs, int in_bits) {
+    const int s = 1 << ss, half = s / 2, r = 1 << rs;
+    const uint32_t in_max = (1u << in_bits) - 1;
+    const int gy_n = ((rows - 1) >> ss) + 2, gx_n = ((cols - 1) >> ss) + 2, gz = (int)(in_max >> rs) + 2;
+    const size_t cells = (size_t)gy_n * gx_n * gz;
+    std::vector<uint64_t> v(cells), w(cells), bv(cells), bw(cells);
+    for (int y = 0; y < rows; y++) {
+        for (int x = 0; x < cols; x++) {
+            const uint32_t p = std::min<uint32_t>(img[(size_t)y * cols + x], in_max);
+            const size_t c = ((size_t)((y + half) >> ss) * gx_n + ((x + half) >> ss)) * gz + ((p + r / 2) >> rs);
+            v[c] += p;
+            w[c]++;
+        }
+    }
+    for (int gy = 0; gy < gy_n; gy++) {
+        for (int gx = 0; gx < gx_n; gx++) {
+            for (int z = 0; z < gz; z++) {
+                const size_t c = ((size_t)gy * gx_n + gx) * gz + z;
+                for (int dy = -1; dy <= 1; dy++) {
+                    for (int dx = -1; dx <= 1; dx++) {
+                        for (int dz = -1; dz <= 1; dz++) {
+                            if (gy + dy < 0 || gy + dy >= gy_n || gx + dx < 0 || gx + dx >= gx_n || z + dz < 0 ||
+                                z + dz >= gz)
+                                continue;
+                            const size_t d = ((size_t)(gy + dy) * gx_n + gx + dx) * gz + z + dz;
+                            const uint64_t k = (uint64_t)(2 - (dy != 0)) * (2 - (dx != 0)) * (2 - (dz != 0));
+                            bv[c] += k * v[d];
+                            bw[c] += k * w[d];
+                        }
+                    }
+                }
+            }
+        }
+    }
+    std::vector<T> out(img.size());
+    for (int y = 0; y < rows; y++) {
+        for (int x = 0; x < cols; x++) {
+            const uint32_t q = std::min<uint32_t>(img[(size_t)y * cols + x], in_max);
+            const uint64_t wy[2] = {(uint64_t)(s - (y & (s - 1))), (uint64_t)(y & (s - 1))};
+            const uint64_t wx[2] = {(uint64_t)(s - (x & (s - 1))), (uint64_t)(x & (s - 1))};
+            const uint64_t wz[2] = {(uint64_t)(r - (q & (r - 1))), (uint64_t)(q & (r - 1))};
+            uint64_t num = 0, den = 0;
+            for (int i = 0; i < 8; i++) {
+                const size_t c = ((size_t)((y >> ss) + (i >> 2)) * gx_n + (x >> ss) + ((i >> 1) & 1)) * gz +
+                                 (q >> rs) + (i & 1);
+                const uint64_t k = wy[i >> 2] * wx[(i >> 1) & 1] * wz[i & 1];
+                num += k * bv[c];
+                den += k * bw[c];
+            }
+            out[(size_t)y * cols + x] = (T)((num + den / 2) / den);
+        }
+    }
+    return out;
+}
+
+template <int SPACE_SHIFT>
+static size_t checkCsim(const std::vector<uint8_t>& img, int rows, int cols) {
+    std::vector<uint8_t> out(img.size());
+    mat8_t src(rows, cols), dst(rows, cols);
+    src.copyTo((void*)img.data());
+    xf::cv::bilateralGrid<XF_8UC1, BENCH_CSIM_SIZE, BENCH_CSIM_SIZE, XF_NPPC1, SPACE_SHIFT, BENCH_RANGE_SHIFT_8>(src,
+                                                                                                               dst);
+    dst.copyFrom(out.data());
+    return out != directGrid(img, rows, cols, SPACE_SHIFT, BENCH_RANGE_SHIFT_8, 8);
+}
+
+template <typename T>
+static size_t checkCpu(const std::vector<T>& img, int rows, int cols, int range_shift, int in_bits) {
+    std::vector<T> out(img.size());
+    size_t failures = 0;
+    for (int space_shift = 1; space_shift <= 5; space_shift++) {
+        medimg::BilateralGridParams params(space_shift, range_shift, in_bits);
+        params.threads = 3;
+        medimg::BilateralGrid(params).apply(img.data(), out.data(), rows, cols);
+        failures += (out != directGrid(img, rows, cols, space_shift, range_shift, in_bits));
+    }
+    return failures;
+}
+
+static bool check() {
+    const int rows = 37, cols = 53;
+    medimg::bench::Random rnd(7);
+    std::vector<uint8_t> img((size_t)rows * cols);
+    std::vector<uint16_t> img12(img.size());
+    medimg::bench::PhantomSlices phantom(rows, cols, 1);
+    size_t failures = 0, constant = 0;
+    for (int kind = 0; kind < 4; kind++) {
+        for (size_t i = 0; i < img.size(); i++) {
+            const int x = (int)(i % cols);
+            switch (kind) {
+                case 0: // values above 12 bits count as 4095
+                    img12[i] = (uint16_t)rnd.uniform(0, 4500);
+                    break;
+                case 1:
+                    img12[i] = 1234;
+                    break;
+                case 2: // step edge off the cell borders, with some noise
+                    img12[i] = (uint16_t)((x < 21 ? 800 : 3000) + rnd.uniform(-40, 40));
+                    break;
+                default:
+                    img12[i] = phantom.raw[0][i];
+                    break;
+            }
+            img[i] = (kind == 3) ? phantom.soft[0][i] : (uint8_t)(std::min<int>(img12[i], 4095) >> 4);
+        }
+        failures += checkCsim<3>(img, rows, cols) + checkCsim<4>(img, rows, cols);
+        failures += checkCpu(img, rows, cols, BENCH_RANGE_SHIFT_8, 8);
+        failures += checkCpu(img12, rows, cols, BENCH_RANGE_SHIFT_12, 12);
+        if (kind == 1) constant += (directGrid(img12, rows, cols, 4, BENCH_RANGE_SHIFT_12, 12) != img12);
+    }
+    printf("%dx%d, 4 images, 2 to 32 px cells\n", cols, rows);
+    bool ok = medimg::bench::verdict("Constant image kept", constant, "differing outputs");
+    return medimg::bench::verdict("C-sim and CPU vs direct grid", failures, "differing outputs") && ok;
+}
+
+template <int WINDOW>
+static void csimBilateral(const medimg::bench::PhantomSlices& in, const medimg::bench::PhantomSlices& clean) {
+    const int slices = (int)in.soft.size(), rows = in.rows, cols = in.cols;
+    std::vector<uint8_t> out(in.pixels());
+    double ms = 0, err = 0;
+    for (int z = 0; z < slices; z++) {
+        mat8_t src(rows, cols), dst(rows, cols);
+        src.copyTo((void*)in.soft[z].data());
+        double start = now_ms();
+        xf::cv::bilateralFilter<WINDOW, XF_BORDER_REPLICATE, XF_8UC1, BENCH_CSIM_SIZE, BENCH_CSIM_SIZE>(
+            src, dst, BENCH_SIGMA_COLOR, WINDOW / 2.0f);
+        ms += now_ms() - start;
+        dst.copyFrom(out.data());
+        err += sumSquares(out, clean.soft[z]);
+    }
+    char name[64];
+    snprintf(name, sizeof(name), "C-sim bilateralFilter %dx%d", WINDOW, WINDOW);
+    report(name, rows, cols, slices, ms, rms(err, slices, out.size()));
+}
+
+template <int SPACE_SHIFT>
+static size_t csimGrid(const medimg::bench::PhantomSlices& in, const medimg::bench::PhantomSlices& clean) {
+    const int slices = (int)in.soft.size(), rows = in.rows, cols = in.cols;
+    std::vector<uint8_t> out(in.pixels()), ref(in.pixels());
+    medimg::BilateralGrid cpu(medimg::BilateralGridParams(SPACE_SHIFT, BENCH_RANGE_SHIFT_8, 8));
+    size_t mismatches = 0;
+    double ms = 0, err = 0;
+    for (int z = 0; z < slices; z++) {
+        mat8_t src(rows, cols), dst(rows, cols);
+        src.copyTo((void*)in.soft[z].data());
+        double start = now_ms();
+        xf::cv::bilateralGrid<XF_8UC1, BENCH_CSIM_SIZE, BENCH_CSIM_SIZE, XF_NPPC1, SPACE_SHIFT, BENCH_RANGE_SHIFT_8>(
+            src, dst);
+        ms += now_ms() - start;
+        dst.copyFrom(out.data());
+        err += sumSquares(out, clean.soft[z]);
+        cpu.apply(in.soft[z].data(), ref.data(), rows, cols);
+        mismatches += (out != ref);
+    }
+    char name[64];
+    snprintf(name, sizeof(name), "C-sim bilateralGrid, %d px cells", 1 << SPACE_SHIFT);
+    report(name, rows, cols, slices, ms, rms(err, slices, out.size()));
+    return mismatches;
+}
+
+template <typename T>
+static void cpuGrid(const char* depth,
+                    const std::vector<std::vector<T> >& src,
+                    const std::vector<std::vector<T> >& clean,
+                    int rows,
+                    int cols,
+                    int range_shift,
+                    int in_bits) {
+    std::vector<T> out(src[0].size());
+    for (int space_shift = 3; space_shift <= 5; space_shift++) {
+        for (int threads = 1; threads >= 0; threads--) {
+            medimg::BilateralGridParams params(space_shift, range_shift, in_bits);
+            params.threads = threads;
+            medimg::BilateralGrid cpu(params);
+            double ms = 0, err = 0;
+            for (size_t z = 0; z < src.size(); z++) {
+                double start = now_ms();
+                cpu.apply(src[z].data(), out.data(), rows, cols);
+                ms += now_ms() - start;
+                err += sumSquares(out, clean[z]);
+            }
+            char name[64];
+            snprintf(name, sizeof(name), "CPU %s, %d px cells, %s", depth, 1 << space_shift,
+                     threads ? "1 thread" : "all threads");
+            report(name, rows, cols, (int)src.size(), ms, rms(err, (int)src.size(), out.size()));
+        }
+    }
+}
+
+static bool bench(int rows, int cols, int slices) {
+    medimg::PhantomParams quiet(cols, rows, slices);
+    quiet.noiseHU = 0.0f;
+    medimg::bench::PhantomSlices in(rows, cols, slices), clean(quiet);
+    const size_t n = in.pixels();
+    double noise8 = 0, noise12 = 0;
+    for (int z = 0; z < slices; z++) {
+        noise8 += sumSquares(in.soft[z], clean.soft[z]);
+        noise12 += sumSquares(in.raw[z], clean.raw[z]);
+    }
+    printf("%dx%d, %d slices, RMS noise %.2f grey levels windowed, %.2f HU raw\n", cols, rows, slices,
+           rms(noise8, slices, n), rms(noise12, slices, n));
+
+    size_t mismatches = 0;
+    if (rows <= BENCH_CSIM_SIZE && cols <= BENCH_CSIM_SIZE) {
+        csimBilateral<3>(in, clean);
+        csimBilateral<5>(in, clean);
+        csimBilateral<7>(in, clean);
+        mismatches += csimGrid<3>(in, clean);
+        mismatches += csimGrid<4>(in, clean);
+        mismatches += csimGrid<5>(in, clean);
+    }
+    cpuGrid("8-bit", in.soft, clean.soft, rows, cols, BENCH_RANGE_SHIFT_8, 8);
+    cpuGrid("12-bit", in.raw, clean.raw, rows, cols, BENCH_RANGE_SHIFT_12, 12);
+
+#ifndef MEDIMG_BENCH_NO_OPENCV
+    // Spatial sigma and support of the 16 pixel grid
+    {
+        std::vector<uint8_t> out(n);
+        double ms = 0, err = 0;
+        for (int z = 0; z < slices; z++) {
+            cv::Mat src(rows, cols, CV_8UC1, in.soft[z].data()), dst(rows, cols, CV_8UC1, out.data());
+            double start = now_ms();
+            cv::bilateralFilter(src, dst, 33, BENCH_SIGMA_COLOR, 14.0);
+            ms += now_ms() - start;
+            err += sumSquares(out, clean.soft[z]);
+        }
+        report("OpenCV bilateralFilter 33x33", rows, cols, slices, ms, rms(err, slices, n));
+    }
+#endif
+    return medimg::bench::verdict("C-sim grid vs CPU", mismatches, "differing slices");
+}
+
+int main(int argc, char** argv) {
+    int slices = (argc > 1) ? atoi(argv[1]) : 2;
+    if (slices <= 0) {
+        fprintf(stderr, "Invalid number of slices\nUsage:\n<Executable Name> [slices]\n");
+        return -1;
+    }
+    bool ok = check();
+    ok = bench(BENCH_CSIM_SIZE, BENCH_CSIM_SIZE, slices) && ok;
+    ok = bench(BENCH_HEIGHT, BENCH_WIDTH, slices) && ok;
+    return ok ? 0 : 1;
+}
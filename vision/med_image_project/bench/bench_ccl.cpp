@@ -0,0 +1,310 @@
+/*
+ * Copyright 2021 Xilinx, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Connected component labeling of thresholded phantom CT slices at 512x512 and 3840x2160: the two-pass
+ * xf::cv::ccaCustom (DDR temporaries, defect mask only) and the single pass
+ * xf::cv::connectedComponentsWithStats with and without the label image in C-sim, the CPU
+ * medimg::ConnectedComponents, and OpenCV's connectedComponentsWithStats for reference. Statistics and
+ * remapped labels of C-sim have to match the CPU exactly; areas and boxes have to match OpenCV.
+ * First both run on small random masks of several densities and on combs, nested rings, staircases
+ * and diagonals that merge labels in many orders, against a brute-force flood fill.
+ *
+ * Build (the bench directory is not part of the Vitis host build):
+ *   g++ -std=c++14 -O3 -pthread -I../src -I../libs/xf_opencv/L1/include -I$XILINX_VIVADO_HLS/include \
+ *       bench_ccl.cpp -o bench_ccl `pkg-config --cflags --libs opencv4`
+ * Add -DMEDIMG_BENCH_NO_OPENCV to leave out the OpenCV reference.
+ * Usage:
+ *   ./bench_ccl [slices] [threshold_HU]
+ */
+
+#include "common/xf_common.hpp"
+#include "common/xf_utility.hpp"
+#include "imgproc/xf_cca_custom.hpp"
+#include "imgproc/xf_connected_components.hpp"
+#include "medimg_bench.h"
+#include "medimg_ccl.h"
+#ifndef MEDIMG_BENCH_NO_OPENCV
+#include "opencv2/opencv.hpp"
+#endif
+
+#include <iostream>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+#define BENCH_HEIGHT 2160
+#define BENCH_WIDTH 3840
+#define BENCH_MAX_LABELS 16384
+
+typedef xf::cv::Mat<XF_8UC1, BENCH_HEIGHT, BENCH_WIDTH, XF_NPPC1> mask_t;
+typedef xf::cv::Mat<XF_16UC1, BENCH_HEIGHT, BENCH_WIDTH, XF_NPPC1> label_t;
+
+static xf::cv::ccl_stats_t g_stats[BENCH_MAX_LABELS];
+static unsigned short g_remap[BENCH_MAX_LABELS];
+
+using medimg::bench::now_ms;
+
+static void report(const char* name, int rows, int cols, int slices, double ms, int ddr_bytes) {
+    medimg::bench::report(name, rows, cols, slices, ms, ", %2d DDR bytes/pixel", ddr_bytes);
+}
+
+template <typename S>
+static bool same(const S& a, const medimg::ComponentStats& b) {
+    return a.area == b.area && a.left == b.left && a.top == b.top && a.right == b.right && a.bottom == b.bottom &&
+           a.cx == b.cx && a.cy == b.cy;
+}
+
+/* 8-connected flood fill from every unlabelled pixel in raster order; entry 0 gathers the zero pixels */
+static void floodFill(const std::vector<uint8_t>& mask,
+                      int rows,
+                      int cols,
+                      std::vector<uint32_t>& labels,
+                      std::vector<medimg::ComponentStats>& stats) {
+    std::vector<uint64_t> sum_x(1, 0), sum_y(1, 0);
+    std::vector<int> stack;
+    medimg::ComponentStats empty = {0, 0xffff, 0xffff, 0, 0, 0.f, 0.f};
+    stats.assign(1, empty);
+    labels.assign(mask.size(), 0);
+    for (size_t i = 0; i < mask.size(); i++) {
+        if (mask[i] == 0 || labels[i] != 0) continue;
+        const uint32_t l = (uint32_t)stats.size();
+        stats.push_back(empty);
+        sum_x.push_back(0);
+        sum_y.push_back(0);
+        labels[i] = l;
+        stack.push_back((int)i);
+        while (!stack.empty()) {
+            const int p = stack.back(), y = p / cols, x = p % cols;
+            stack.pop_back();
+            for (int v = std::max(y - 1, 0); v <= std::min(y + 1, rows - 1); v++)
+                for (int u = std::max(x - 1, 0); u <= std::min(x + 1, cols - 1); u++) {
+                    const size_t q = (size_t)v * cols + u;
+                    if (mask[q] != 0 && labels[q] == 0) {
+                        labels[q] = l;
+                        stack.push_back((int)q);
+                    }
+                }
+        }
+    }
+    for (size_t i = 0; i < mask.size(); i++) {
+        const uint32_t l = labels[i];
+        const uint16_t y = (uint16_t)(i / cols), x = (uint16_t)(i % cols);
+        medimg::ComponentStats& s = stats[l];
+        s.area++;
+        s.left = std::min(s.left, x);
+        s.top = std::min(s.top, y);
+        s.right = std::max(s.right, x);
+        s.bottom = std::max(s.bottom, y);
+        sum_x[l] += x;
+        sum_y[l] += y;
+    }
+    for (size_t l = 0; l < stats.size(); l++) {
+        if (stats[l].area == 0) continue;
+        stats[l].cx = (float)sum_x[l] / (float)stats[l].area;
+        stats[l].cy = (float)sum_y[l] / (float)stats[l].area;
+    }
+}
+
+static size_t checkMask(const std::vector<uint8_t>& mask, int rows, int cols) {
+    const size_t n = mask.size();
+    std::vector<uint32_t> expect_labels, cpu_labels(n);
+    std::vector<medimg::ComponentStats> expect, cpu_stats;
+    floodFill(mask, rows, cols, expect_labels, expect);
+    const int components = (int)expect.size();
+    // Entry 0 of an image without zero pixels only has to be empty
+    const int first = (expect[0].area == 0) ? 1 : 0;
+
+    size_t failures = 0;
+    medimg::ConnectedComponents cpu;
+    failures += (cpu.apply(mask.data(), rows, cols, cpu_stats, cpu_labels.data()) != components);
+    failures += (cpu_labels != expect_labels) || (cpu_stats[0].area != expect[0].area);
+    for (int l = first; l < components && l < (int)cpu_stats.size(); l++) failures += !same(cpu_stats[l], expect[l]);
+
+    mask_t in(rows, cols);
+    label_t lbl(rows, cols);
+    std::vector<uint16_t> labels(n);
+    bool overflow;
+    in.copyTo((void*)mask.data());
+    for (int with_labels = 0; with_labels < 2; with_labels++) {
+        int count;
+        if (with_labels) {
+            count = xf::cv::connectedComponentsWithStats<XF_8UC1, XF_16UC1, BENCH_HEIGHT, BENCH_WIDTH,
+                                                         BENCH_MAX_LABELS>(in, lbl, g_stats, g_remap, overflow);
+            lbl.copyFrom(labels.data());
+            for (size_t i = 0; i < n; i++) failures += (g_remap[labels[i]] != expect_labels[i]);
+        } else {
+            count = xf::cv::connectedComponentsWithStats<XF_8UC1, BENCH_HEIGHT, BENCH_WIDTH, BENCH_MAX_LABELS>(
+                in, g_stats, g_remap, overflow);
+        }
+        failures += (count != components) || overflow || (g_stats[0].area != expect[0].area);
+        for (int l = first; l < components && l < count; l++) failures += !same(g_stats[l], expect[l]);
+    }
+    return failures;
+}
+
+/* Masks that merge labels in many orders: combs, nested rings with gaps, staircases and diagonals */
+static uint8_t pattern(int kind, int y, int x, int rows, int cols) {
+    switch (kind) {
+        case 0:
+            return (y == 0) || (x % 4 == 0 && y < rows - 1);
+        case 1: {
+            const int d = std::min(std::min(x, y), std::min(cols - 1 - x, rows - 1 - y));
+            return (d % 2 == 0) && !(x == d + 1 && y == d && d % 4 == 0) &&
+                   !(x == cols - 2 - d && y == rows - 1 - d && d % 4 == 2);
+        }
+        case 2:
+            return (x % 2 == 0 && (y + x / 2) % 5 != 0) || (y % 5 == 4 && x % 3 == 0);
+        default:
+            return ((x * 7 + y * 3) % 11) < 5;
+    }
+}
+
+static bool check() {
+    const int sizes[][2] = {{1, 1}, {1, 9}, {9, 1}, {17, 40}, {97, 130}};
+    medimg::bench::Random rnd(3);
+    size_t failures = 0, masks = 0;
+    for (const auto& size : sizes) {
+        const int rows = size[0], cols = size[1];
+        std::vector<uint8_t> mask((size_t)rows * cols);
+        // Around 1 in 2, the percolation threshold of 8-connected sites, components branch the most
+        for (int density : {100, 400, 500, 600, 900}) {
+            for (size_t i = 0; i < mask.size(); i++) mask[i] = (rnd.uniform(0, 999) < density) ? 255 : 0;
+            failures += checkMask(mask, rows, cols);
+            masks++;
+        }
+        for (int kind = 0; kind < 4; kind++) {
+            for (int y = 0; y < rows; y++)
+                for (int x = 0; x < cols; x++) mask[(size_t)y * cols + x] = pattern(kind, y, x, rows, cols) ? 255 : 0;
+            failures += checkMask(mask, rows, cols);
+            masks++;
+        }
+    }
+    printf("%zu random and structured masks, 1x1 to 130x97\n", masks);
+    return medimg::bench::verdict("C-sim and CPU vs brute force", failures, "mismatches");
+}
+
+static bool bench(int rows, int cols, int slices, int threshold_hu) {
+    medimg::bench::PhantomSlices phantom(rows, cols, slices, false);
+    const size_t n = phantom.pixels();
+    const uint16_t level = (uint16_t)(threshold_hu + medimg::Phantom::RAW_OFFSET);
+    std::vector<std::vector<uint8_t> > masks(slices, std::vector<uint8_t>(n));
+    for (int z = 0; z < slices; z++) {
+        for (size_t i = 0; i < n; i++) masks[z][i] = (phantom.raw[z][i] > level) ? 255 : 0;
+    }
+
+    std::vector<std::vector<medimg::ComponentStats> > ref(slices);
+    std::vector<std::vector<uint32_t> > ref_labels(slices, std::vector<uint32_t>(n));
+    double start = now_ms();
+    medimg::ConnectedComponents cpu;
+    for (int z = 0; z < slices; z++) cpu.apply(masks[z].data(), rows, cols, ref[z]);
+    double cpu_ms = now_ms() - start;
+    start = now_ms();
+    for (int z = 0; z < slices; z++) cpu.apply(masks[z].data(), rows, cols, ref[z], ref_labels[z].data());
+    double cpu_labels_ms = now_ms() - start;
+    printf("%dx%d, %d slices, mask HU > %d, %zu components in slice 0\n", cols, rows, slices, threshold_hu,
+           ref[0].size() - 1);
+    report("CPU, statistics", rows, cols, slices, cpu_ms, 0);
+    report("CPU, statistics and labels", rows, cols, slices, cpu_labels_ms, 0);
+
+    // ccaCustom reads the mask twice and writes and reads two temporaries
+    {
+        std::vector<uint8_t> tmp1(n), tmp2(n), out(n);
+        double ms = 0;
+        for (int z = 0; z < slices; z++) {
+            int obj_pix = 0, def_pix = 0;
+            start = now_ms();
+            xf::cv::ccaCustom<BENCH_HEIGHT, BENCH_WIDTH>(masks[z].data(), masks[z].data(), tmp1.data(), tmp2.data(),
+                                                         out.data(), obj_pix, def_pix, rows, cols);
+            ms += now_ms() - start;
+        }
+        report("C-sim ccaCustom", rows, cols, slices, ms, 1 + 1 + 1 + 1 + 1 + 1 + 1);
+    }
+
+    size_t mismatches = 0;
+    bool overflow_any = false;
+    double ms = 0, ms_labels = 0;
+    std::vector<uint16_t> labels(n);
+    for (int z = 0; z < slices; z++) {
+        mask_t in(rows, cols);
+        label_t lbl(rows, cols);
+        in.copyTo(masks[z].data());
+        bool overflow;
+        start = now_ms();
+        int count = xf::cv::connectedComponentsWithStats<XF_8UC1, BENCH_HEIGHT, BENCH_WIDTH, BENCH_MAX_LABELS>(
+            in, g_stats, g_remap, overflow);
+        ms += now_ms() - start;
+        overflow_any |= overflow;
+        mismatches += (count != (int)ref[z].size());
+        for (int i = 0; i < count && i < (int)ref[z].size(); i++) mismatches += !same(g_stats[i], ref[z][i]);
+
+        start = now_ms();
+        count = xf::cv::connectedComponentsWithStats<XF_8UC1, XF_16UC1, BENCH_HEIGHT, BENCH_WIDTH, BENCH_MAX_LABELS>(
+            in, lbl, g_stats, g_remap, overflow);
+        ms_labels += now_ms() - start;
+        lbl.copyFrom(labels.data());
+        for (size_t i = 0; i < n; i++) mismatches += (g_remap[labels[i]] != ref_labels[z][i]);
+    }
+    report("C-sim single pass, statistics", rows, cols, slices, ms, 1);
+    report("C-sim single pass, labels", rows, cols, slices, ms_labels, 1 + 2);
+
+#ifndef MEDIMG_BENCH_NO_OPENCV
+    size_t ocv_mismatches = 0;
+    double ocv_centroid_err = 0;
+    {
+        cv::Mat ocv_labels, ocv_stats, ocv_centroids;
+        double ms = 0;
+        for (int z = 0; z < slices; z++) {
+            start = now_ms();
+            int count = cv::connectedComponentsWithStats(cv::Mat(rows, cols, CV_8UC1, masks[z].data()), ocv_labels,
+                                                         ocv_stats, ocv_centroids, 8, CV_32S);
+            ms += now_ms() - start;
+            ocv_mismatches += (count != (int)ref[z].size());
+            for (int i = 1; i < count && i < (int)ref[z].size(); i++) {
+                const medimg::ComponentStats& s = ref[z][i];
+                ocv_mismatches += (ocv_stats.at<int>(i, cv::CC_STAT_AREA) != (int)s.area) ||
+                                  (ocv_stats.at<int>(i, cv::CC_STAT_LEFT) != s.left) ||
+                                  (ocv_stats.at<int>(i, cv::CC_STAT_TOP) != s.top) ||
+                                  (ocv_stats.at<int>(i, cv::CC_STAT_WIDTH) != s.right - s.left + 1) ||
+                                  (ocv_stats.at<int>(i, cv::CC_STAT_HEIGHT) != s.bottom - s.top + 1);
+                ocv_centroid_err = std::max(ocv_centroid_err, fabs(ocv_centroids.at<double>(i, 0) - s.cx));
+                ocv_centroid_err = std::max(ocv_centroid_err, fabs(ocv_centroids.at<double>(i, 1) - s.cy));
+            }
+        }
+        report("OpenCV, statistics and labels", rows, cols, slices, ms, 0);
+    }
+    bool cv_ok = medimg::bench::verdict("CPU vs OpenCV", ocv_mismatches, "components");
+    printf("  %-40s: %g\n", "CPU vs OpenCV, centroid error", ocv_centroid_err);
+#else
+    bool cv_ok = true;
+#endif
+    if (overflow_any) printf("  %-40s: label overflow\n", "C-sim");
+    return medimg::bench::verdict("C-sim vs CPU", mismatches, "mismatches") && cv_ok && !overflow_any;
+}
+
+int main(int argc, char** argv) {
+    int slices = (argc > 1) ? atoi(argv[1]) : 2;
+    int threshold_hu = (argc > 2) ? atoi(argv[2]) : 150;
+    if (slices <= 0) {
+        fprintf(stderr, "Invalid number of slices\nUsage:\n<Executable Name> [slices] [threshold_HU]\n");
+        return -1;
+    }
+    bool ok = check();
+    ok = bench(512, 512, slices, threshold_hu) && ok;
+    ok = bench(BENCH_HEIGHT, BENCH_WIDTH, slices, threshold_hu) && ok;
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,202 @@
+/*
+ * Copyright 2021 Xilinx, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * 12-bit CLAHE with 1024 bin tile histograms on phantom CT slices at 512x512 and 3840x2160:
+ * xf::cv::clahe::CLAHEBinnedImpl in C-sim (XF_16UC1, NPPC1, LUT ping-pong across slices), the CPU
+ * medimg::ClaheBinned on one and on all hardware threads, same slice and streaming, and OpenCV's CLAHE
+ * on CV_16UC1 (65536 bins) for reference. The C-sim output of every slice is compared with the
+ * streaming CPU output, which has to match exactly. Before that both run on small random and phantom
+ * images with 4x4 tiles and no clipping against a brute-force CLAHE that recounts every tile per pixel.
+ *
+ * Build (the bench directory is not part of the Vitis host build):
+ *   g++ -std=c++14 -O3 -pthread -I../src -I../libs/xf_opencv/L1/include -I$XILINX_VIVADO_HLS/include \
+ *       bench_clahe16.cpp -o bench_clahe16 `pkg-config --cflags --libs opencv4`
+ * Add -DMEDIMG_BENCH_NO_OPENCV to leave out the OpenCV reference.
+ * Usage:
+ *   ./bench_clahe16 [slices]
+ */
+
+#include "common/xf_common.hpp"
+#include "common/xf_utility.hpp"
+#include "imgproc/xf_clahe_binned.hpp"
+#include "medimg_bench.h"
+#include "medimg_clahe.h"
+#ifndef MEDIMG_BENCH_NO_OPENCV
+#include "opencv2/opencv.hpp"
+#endif
+
+#include <iostream>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+#define BENCH_HEIGHT 2160
+#define BENCH_WIDTH 3840
+#define BENCH_TILES 8
+#define BENCH_CLIPLIMIT 32
+#define BENCH_CLIP 4
+#define BENCH_BIN_BITS 10
+#define BENCH_IN_BITS 12
+#define BENCH_CHECK_TILES 4 // the kernel's TILES_Y_MIN and TILES_X_MIN
+
+typedef xf::cv::clahe::CLAHEBinnedImpl<XF_16UC1, BENCH_HEIGHT, BENCH_WIDTH, XF_NPPC1, BENCH_CLIPLIMIT, BENCH_TILES,
+                                       BENCH_TILES, BENCH_BIN_BITS, BENCH_IN_BITS>
+    clahe_hls_t;
+typedef xf::cv::Mat<XF_16UC1, BENCH_HEIGHT, BENCH_WIDTH, XF_NPPC1> mat16_t;
+
+// Two LUT sets for the ping-pong, as BRAM on the device
+static clahe_hls_t::lut_t g_lut[2][BENCH_TILES][BENCH_TILES][2][1 << BENCH_BIN_BITS];
+static ap_uint<clahe_hls_t::CLIP_COUNTER_BITS> g_clip_counter[BENCH_TILES][BENCH_TILES];
+
+using medimg::bench::now_ms;
+using medimg::bench::report;
+
+/* Mapping of bin b in tile (ty, tx) without clipping: the share of the tile's pixels in bin b or below */
+static uint64_t tileMap(const std::vector<uint16_t>& img, int cols, int th, int tw, int ty, int tx, int b) {
+    const int shift = BENCH_IN_BITS - BENCH_BIN_BITS, out_max = (1 << BENCH_IN_BITS) - 1;
+    uint64_t below = 0;
+    for (int y = ty * th; y < (ty + 1) * th; y++)
+        for (int x = tx * tw; x < (tx + 1) * tw; x++)
+            below += (std::min<int>(img[(size_t)y * cols + x], out_max) >> shift) <= b;
+    return std::min<uint64_t>(below * out_max / ((uint64_t)th * tw), out_max);
+}
+
+/* BENCH_CHECK_TILES x BENCH_CHECK_TILES tiles with a clip limit no bin reaches, every pixel interpolated between
+ * the maps of its four nearest tile centers, each counted from scratch */
+static size_t checkUnclipped(clahe_hls_t& clahe, const std::vector<uint16_t>& img, int rows, int cols) {
+    const int tiles = BENCH_CHECK_TILES, th = rows / tiles, tw = cols / tiles;
+    const int shift = BENCH_IN_BITS - BENCH_BIN_BITS, out_max = (1 << BENCH_IN_BITS) - 1;
+    std::vector<uint16_t> expect(img.size()), out(img.size()), cpu_out(img.size());
+    for (int y = 0; y < rows; y++) {
+        const int hy = (y + th / 2) / th - 1, ty1 = std::max(hy, 0), ty2 = std::min(hy + 1, tiles - 1);
+        const uint64_t wy = (y + th / 2) % th;
+        for (int x = 0; x < cols; x++) {
+            const int hx = (x + tw / 2) / tw - 1, tx1 = std::max(hx, 0), tx2 = std::min(hx + 1, tiles - 1);
+            const uint64_t wx = (x + tw / 2) % tw;
+            const int b = std::min<int>(img[(size_t)y * cols + x], out_max) >> shift;
+            const uint64_t top = tileMap(img, cols, th, tw, ty1, tx1, b) * (tw - wx) +
+                                 tileMap(img, cols, th, tw, ty1, tx2, b) * wx;
+            const uint64_t bottom = tileMap(img, cols, th, tw, ty2, tx1, b) * (tw - wx) +
+                                    tileMap(img, cols, th, tw, ty2, tx2, b) * wx;
+            expect[(size_t)y * cols + x] = (uint16_t)std::min<uint64_t>(
+                (top * (th - wy) + bottom * wy) / ((uint64_t)th * tw), out_max);
+        }
+    }
+
+    // The first call only fills g_lut[0] with the image's LUTs
+    const int clip = 1 << BENCH_BIN_BITS;
+    mat16_t in(rows, cols), dst(rows, cols);
+    in.copyTo((void*)img.data());
+    for (int pass = 0; pass < 2; pass++)
+        clahe.process(dst, in, g_lut[pass], g_lut[pass ^ 1], g_clip_counter, rows, cols, clip, tiles, tiles);
+    dst.copyFrom(out.data());
+    medimg::ClaheParams params(BENCH_IN_BITS, BENCH_BIN_BITS, clip, tiles, tiles);
+    params.threads = 1;
+    medimg::ClaheBinned(params).apply(img.data(), cpu_out.data(), rows, cols);
+    return (out != expect) + (cpu_out != expect);
+}
+
+static bool check() {
+    const int rows = 48, cols = 64;
+    clahe_hls_t clahe;
+    medimg::bench::Random rnd(42);
+    std::vector<uint16_t> img((size_t)rows * cols);
+    size_t failures = 0;
+    // Values beyond IN_BITS fall into the last bin
+    for (size_t i = 0; i < img.size(); i++) img[i] = (uint16_t)rnd.uniform(0, 5000);
+    failures += checkUnclipped(clahe, img, rows, cols);
+    for (size_t i = 0; i < img.size(); i++) img[i] = (uint16_t)rnd.uniform(1000, 1100);
+    failures += checkUnclipped(clahe, img, rows, cols);
+    medimg::bench::PhantomSlices phantom(rows, cols, 1, false);
+    failures += checkUnclipped(clahe, phantom.raw[0], rows, cols);
+    printf("%dx%d, %dx%d unclipped tiles\n", cols, rows, BENCH_CHECK_TILES, BENCH_CHECK_TILES);
+    return medimg::bench::verdict("C-sim and CPU vs brute force", failures, "differing images");
+}
+
+static bool bench(int rows, int cols, int slices) {
+    medimg::bench::PhantomSlices in(rows, cols, slices + 1, false);
+    std::vector<std::vector<uint16_t> >& raw = in.raw;
+    std::vector<uint16_t> out(in.pixels()), ref(in.pixels());
+    printf("%dx%d, %d slices of 12-bit raw data, %dx%d tiles, %d bins, clip %d\n", cols, rows, slices, BENCH_TILES,
+           BENCH_TILES, 1 << BENCH_BIN_BITS, BENCH_CLIP);
+
+    // C-sim: slice 0 only fills the LUTs, the timed slices are interpolated with those of their predecessor
+    medimg::ClaheParams params(BENCH_IN_BITS, BENCH_BIN_BITS, BENCH_CLIP, BENCH_TILES, BENCH_TILES);
+    params.threads = 1;
+    medimg::ClaheBinned check(params);
+    check.applyStreaming(raw[0].data(), ref.data(), rows, cols);
+    clahe_hls_t clahe;
+    {
+        mat16_t in(rows, cols), dst(rows, cols);
+        in.copyTo(raw[0].data());
+        clahe.process(dst, in, g_lut[0], g_lut[1], g_clip_counter, rows, cols, BENCH_CLIP, BENCH_TILES, BENCH_TILES);
+    }
+    double csim_ms = 0;
+    size_t mismatches = 0;
+    for (int z = 1; z <= slices; z++) {
+        double start = now_ms();
+        mat16_t in(rows, cols), dst(rows, cols);
+        in.copyTo(raw[z].data());
+        clahe.process(dst, in, g_lut[z & 1], g_lut[(z & 1) ^ 1], g_clip_counter, rows, cols, BENCH_CLIP, BENCH_TILES,
+                      BENCH_TILES);
+        dst.copyFrom(out.data());
+        csim_ms += now_ms() - start;
+
+        check.applyStreaming(raw[z].data(), ref.data(), rows, cols);
+        for (size_t i = 0; i < out.size(); i++) mismatches += (out[i] != ref[i]);
+    }
+    report("C-sim NPPC1, streaming", rows, cols, slices, csim_ms);
+
+    // CPU, one thread and all of them
+    for (int threads = 1; threads >= 0; threads--) {
+        params.threads = threads;
+        medimg::ClaheBinned cpu(params);
+        double start = now_ms();
+        for (int z = 1; z <= slices; z++) cpu.apply(raw[z].data(), out.data(), rows, cols);
+        report(threads ? "CPU 1 thread, same slice" : "CPU all threads, same slice", rows, cols, slices,
+               now_ms() - start);
+
+        medimg::ClaheBinned cpu_stream(params);
+        cpu_stream.applyStreaming(raw[0].data(), out.data(), rows, cols);
+        start = now_ms();
+        for (int z = 1; z <= slices; z++) cpu_stream.applyStreaming(raw[z].data(), out.data(), rows, cols);
+        report(threads ? "CPU 1 thread, streaming" : "CPU all threads, streaming", rows, cols, slices,
+               now_ms() - start);
+    }
+
+#ifndef MEDIMG_BENCH_NO_OPENCV
+    cv::Ptr<cv::CLAHE> ocv = cv::createCLAHE(BENCH_CLIP, cv::Size(BENCH_TILES, BENCH_TILES));
+    cv::Mat dst;
+    double start = now_ms();
+    for (int z = 1; z <= slices; z++) ocv->apply(cv::Mat(rows, cols, CV_16UC1, raw[z].data()), dst);
+    report("OpenCV CV_16UC1, same slice", rows, cols, slices, now_ms() - start);
+#endif
+
+    return medimg::bench::verdict("C-sim vs CPU streaming", mismatches, "differing pixels");
+}
+
+int main(int argc, char** argv) {
+    int slices = (argc > 1) ? atoi(argv[1]) : 4;
+    if (slices <= 0) {
+        fprintf(stderr, "Invalid number of slices\nUsage:\n<Executable Name> [slices]\n");
+        return -1;
+    }
+    bool ok = check();
+    ok = bench(512, 512, slices) && ok;
+    ok = bench(BENCH_HEIGHT, BENCH_WIDTH, slices) && ok;
+    return ok ? 0 : 1;
+}
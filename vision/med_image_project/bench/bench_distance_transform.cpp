@@ -0,0 +1,239 @@
+/*
+ * Copyright 2021 Xilinx, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Distance transform of thresholded phantom CT slices at 512x512 and 3840x2160: the two-pass chamfer
+ * xf::cv::distanceTransform (DDR forward-pass buffer) and the streaming xf::cv::distanceTransformStrip
+ * with float and fixed point output in C-sim, the CPU medimg::DistanceTransform, and OpenCV's precise
+ * DIST_L2 transform for reference. Both C-sim outputs are compared with the CPU ones, which have to
+ * match exactly, and with OpenCV saturated at MAX_DIST; the chamfer error is printed for comparison.
+ * First the strip kernel and the CPU transform run on small random masks of several densities, taller
+ * than two strips, against a brute-force search for the nearest zero pixel.
+ *
+ * Build (the bench directory is not part of the Vitis host build):
+ *   g++ -std=c++14 -O3 -pthread -I../src -I../libs/xf_opencv/L1/include -I$XILINX_VIVADO_HLS/include \
+ *       bench_distance_transform.cpp -o bench_distance_transform `pkg-config --cflags --libs opencv4`
+ * Add -DMEDIMG_BENCH_NO_OPENCV to leave out the OpenCV reference.
+ * Usage:
+ *   ./bench_distance_transform [slices] [threshold_HU]
+ */
+
+#include "common/xf_common.hpp"
+#include "common/xf_utility.hpp"
+#include "imgproc/xf_distancetransform.hpp"
+#include "imgproc/xf_distancetransform_strip.hpp"
+#include "medimg_bench.h"
+#include "medimg_distance.h"
+#ifndef MEDIMG_BENCH_NO_OPENCV
+#include "opencv2/opencv.hpp"
+#endif
+
+#include <iostream>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#define BENCH_HEIGHT 2160
+#define BENCH_WIDTH 3840
+#define BENCH_MAX_DIST 32
+#define BENCH_STRIP 64
+#define BENCH_FRAC_BITS 8
+
+typedef xf::cv::Mat<XF_8UC1, BENCH_HEIGHT, BENCH_WIDTH, XF_NPPC1> mask_t;
+typedef xf::cv::Mat<XF_32FC1, BENCH_HEIGHT, BENCH_WIDTH, XF_NPPC1> distf_t;
+typedef xf::cv::Mat<XF_16UC1, BENCH_HEIGHT, BENCH_WIDTH, XF_NPPC1> distq_t;
+
+using medimg::bench::now_ms;
+
+static void report(const char* name, int rows, int cols, int slices, double ms, int ddr_bytes) {
+    medimg::bench::report(name, rows, cols, slices, ms, ", %2d DDR bytes/pixel", ddr_bytes);
+}
+
+static double max_error(const std::vector<float>& a, const std::vector<float>& ref, float sat) {
+    double err = 0;
+    for (size_t i = 0; i < a.size(); i++) {
+        err = std::max(err, (double)fabsf(std::min(a[i], sat) - std::min(ref[i], sat)));
+    }
+    return err;
+}
+
+/* Squared distance to the nearest zero within MAX_DIST rows and columns, farther ones saturate anyway */
+static uint32_t nearestZero(const std::vector<uint8_t>& mask, int rows, int cols, int y, int x) {
+    uint32_t best = BENCH_MAX_DIST * BENCH_MAX_DIST;
+    for (int v = std::max(y - BENCH_MAX_DIST, 0); v <= std::min(y + BENCH_MAX_DIST, rows - 1); v++)
+        for (int u = std::max(x - BENCH_MAX_DIST, 0); u <= std::min(x + BENCH_MAX_DIST, cols - 1); u++)
+            if (mask[(size_t)v * cols + u] == 0)
+                best = std::min(best, (uint32_t)((v - y) * (v - y) + (u - x) * (u - x)));
+    return best;
+}
+
+static size_t checkMask(const std::vector<uint8_t>& mask, int rows, int cols) {
+    const size_t n = mask.size();
+    std::vector<float> expect(n), out(n), cpu_out(n);
+    std::vector<uint16_t> expect_q(n), out_q(n), cpu_out_q(n);
+    for (int y = 0; y < rows; y++) {
+        for (int x = 0; x < cols; x++) {
+            const size_t i = (size_t)y * cols + x;
+            expect[i] = sqrtf((float)nearestZero(mask, rows, cols, y, x));
+            expect_q[i] = (uint16_t)(unsigned int)(expect[i] * (float)(1 << BENCH_FRAC_BITS) + 0.5f);
+        }
+    }
+
+    mask_t in(rows, cols);
+    distf_t dst(rows, cols);
+    distq_t dst_q(rows, cols);
+    in.copyTo((void*)mask.data());
+    xf::cv::distanceTransformStrip<XF_8UC1, XF_32FC1, BENCH_HEIGHT, BENCH_WIDTH, BENCH_MAX_DIST, BENCH_STRIP>(in,
+                                                                                                             dst);
+    xf::cv::distanceTransformStrip<XF_8UC1, XF_16UC1, BENCH_HEIGHT, BENCH_WIDTH, BENCH_MAX_DIST, BENCH_STRIP,
+                                   BENCH_FRAC_BITS>(in, dst_q);
+    dst.copyFrom(out.data());
+    dst_q.copyFrom(out_q.data());
+    medimg::DistanceTransform cpu(BENCH_MAX_DIST, BENCH_FRAC_BITS);
+    cpu.apply(mask.data(), cpu_out.data(), rows, cols);
+    cpu.applyFixed(mask.data(), cpu_out_q.data(), rows, cols);
+    return (out != expect) + (out_q != expect_q) + (cpu_out != expect) + (cpu_out_q != expect_q);
+}
+
+static bool check() {
+    // More than two strips high, and columns no power of two
+    const int rows = 2 * BENCH_STRIP + 22, cols = 70;
+    medimg::bench::Random rnd(7);
+    std::vector<uint8_t> mask((size_t)rows * cols);
+    size_t failures = 0;
+    // Zeros at 1 in 1000 leave most pixels saturated, at 1 in 2 none
+    const int zero_per_mille[] = {0, 1, 10, 100, 500, 1000};
+    for (int density : zero_per_mille) {
+        for (size_t i = 0; i < mask.size(); i++) mask[i] = (rnd.uniform(0, 999) < density) ? 0 : 255;
+        failures += checkMask(mask, rows, cols);
+    }
+    std::fill(mask.begin(), mask.end(), 255);
+    mask[(size_t)(rows - 1) * cols + cols / 2] = 0;
+    failures += checkMask(mask, rows, cols);
+    printf("%dx%d random masks, MAX_DIST %d, STRIP %d\n", cols, rows, BENCH_MAX_DIST, BENCH_STRIP);
+    return medimg::bench::verdict("C-sim strip and CPU vs brute force", failures, "differing outputs");
+}
+
+static bool bench(int rows, int cols, int slices, int threshold_hu) {
+    medimg::bench::PhantomSlices phantom(rows, cols, slices, false);
+    const size_t n = phantom.pixels();
+    const uint16_t level = (uint16_t)(threshold_hu + medimg::Phantom::RAW_OFFSET);
+    std::vector<std::vector<uint8_t> > masks(slices, std::vector<uint8_t>(n));
+    for (int z = 0; z < slices; z++) {
+        for (size_t i = 0; i < n; i++) masks[z][i] = (phantom.raw[z][i] > level) ? 255 : 0;
+    }
+    printf("%dx%d, %d slices, mask HU > %d, MAX_DIST %d, STRIP %d\n", cols, rows, slices, threshold_hu,
+           BENCH_MAX_DIST, BENCH_STRIP);
+
+    std::vector<std::vector<float> > ref(slices, std::vector<float>(n));
+    std::vector<std::vector<uint16_t> > ref_q(slices, std::vector<uint16_t>(n));
+    std::vector<float> out(n);
+    std::vector<uint16_t> out_q(n);
+    medimg::DistanceTransform cpu(BENCH_MAX_DIST, BENCH_FRAC_BITS);
+
+    double start = now_ms();
+    for (int z = 0; z < slices; z++) cpu.apply(masks[z].data(), ref[z].data(), rows, cols);
+    report("CPU float", rows, cols, slices, now_ms() - start, 0);
+    start = now_ms();
+    for (int z = 0; z < slices; z++) cpu.applyFixed(masks[z].data(), ref_q[z].data(), rows, cols);
+    report("CPU fixed point", rows, cols, slices, now_ms() - start, 0);
+
+    // Chamfer 3x3 with the forward pass through DDR: mask in, fw_pass out and back in, float out
+    double chamfer_err = 0;
+    {
+        std::vector<ap_uint<8> > src(n);
+        std::vector<ap_uint<32> > fw(n);
+        double ms = 0;
+        for (int z = 0; z < slices; z++) {
+            for (size_t i = 0; i < n; i++) src[i] = masks[z][i];
+            start = now_ms();
+            xf::cv::distanceTransform<8, 32, BENCH_HEIGHT, BENCH_WIDTH, 0>(src.data(), out.data(), fw.data(), rows,
+                                                                           cols);
+            ms += now_ms() - start;
+            chamfer_err = std::max(chamfer_err, max_error(out, ref[z], BENCH_MAX_DIST));
+        }
+        report("C-sim chamfer, DDR fw pass", rows, cols, slices, ms, 1 + 4 + 4 + 4);
+    }
+
+    size_t mismatches = 0, mismatches_q = 0;
+    {
+        double ms = 0, ms_q = 0;
+        for (int z = 0; z < slices; z++) {
+            mask_t in(rows, cols);
+            distf_t dst(rows, cols);
+            distq_t dst_q(rows, cols);
+            in.copyTo(masks[z].data());
+            start = now_ms();
+            xf::cv::distanceTransformStrip<XF_8UC1, XF_32FC1, BENCH_HEIGHT, BENCH_WIDTH, BENCH_MAX_DIST, BENCH_STRIP>(
+                in, dst);
+            ms += now_ms() - start;
+            start = now_ms();
+            xf::cv::distanceTransformStrip<XF_8UC1, XF_16UC1, BENCH_HEIGHT, BENCH_WIDTH, BENCH_MAX_DIST, BENCH_STRIP,
+                                           BENCH_FRAC_BITS>(in, dst_q);
+            ms_q += now_ms() - start;
+
+            dst.copyFrom(out.data());
+            dst_q.copyFrom(out_q.data());
+            mismatches += (memcmp(out.data(), ref[z].data(), n * sizeof(float)) != 0) ? 1 : 0;
+            for (size_t i = 0; i < n; i++) mismatches_q += (out_q[i] != ref_q[z][i]);
+            for (size_t i = 0; i < n && mismatches; i++) {
+                if (out[i] != ref[z][i]) {
+                    printf("  first float mismatch at (%zu, %zu): %f, CPU %f\n", i / cols, i % cols, out[i],
+                           ref[z][i]);
+                    break;
+                }
+            }
+        }
+        report("C-sim strip, float", rows, cols, slices, ms, 1 + 4);
+        report("C-sim strip, fixed point", rows, cols, slices, ms_q, 1 + 2);
+    }
+
+#ifndef MEDIMG_BENCH_NO_OPENCV
+    double ocv_err = 0;
+    {
+        cv::Mat dst;
+        double ms = 0;
+        for (int z = 0; z < slices; z++) {
+            start = now_ms();
+            cv::distanceTransform(cv::Mat(rows, cols, CV_8UC1, masks[z].data()), dst, cv::DIST_L2,
+                                  cv::DIST_MASK_PRECISE, CV_32F);
+            ms += now_ms() - start;
+            std::vector<float> ocv((float*)dst.data, (float*)dst.data + n);
+            ocv_err = std::max(ocv_err, max_error(ref[z], ocv, BENCH_MAX_DIST));
+        }
+        report("OpenCV DIST_MASK_PRECISE", rows, cols, slices, ms, 0);
+    }
+    printf("  %-40s: max error %g\n", "CPU vs OpenCV, saturated", ocv_err);
+#endif
+    printf("  %-40s: max error %g\n", "chamfer vs exact, saturated", chamfer_err);
+    bool ok = medimg::bench::verdict("C-sim float vs CPU", mismatches, "differing slices");
+    return medimg::bench::verdict("C-sim fixed point vs CPU", mismatches_q, "differing pixels") && ok;
+}
+
+int main(int argc, char** argv) {
+    int slices = (argc > 1) ? atoi(argv[1]) : 1;
+    int threshold_hu = (argc > 2) ? atoi(argv[2]) : 150;
+    if (slices <= 0) {
+        fprintf(stderr, "Invalid number of slices\nUsage:\n<Executable Name> [slices] [threshold_HU]\n");
+        return -1;
+    }
+    bool ok = check();
+    ok = bench(512, 512, slices, threshold_hu) && ok;
+    ok = bench(BENCH_HEIGHT, BENCH_WIDTH, slices, threshold_hu) && ok;
+    return ok ? 0 : 1;
+}
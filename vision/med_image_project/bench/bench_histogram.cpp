@@ -0,0 +1,193 @@
+/*
+ * Copyright 2021 Xilinx, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * 4096 bin histograms of 12-bit phantom CT slices at 512x512 and 3840x2160: xf::cv::calcHistBinned in
+ * C-sim at XF_NPPC1, 8 and 16, the 256 bin xf::cv::calcHist on the soft tissue window for comparison,
+ * the CPU medimg::Histogram on one and on all hardware threads, and OpenCV's calcHist on CV_16UC1.
+ * Every histogram is compared with the single threaded CPU one, which has to match exactly. First
+ * the kernel at every NPC and the CPU count small random, constant, alternating, run and ramp images
+ * into 4096 and 256 bins, checked against counting pixel by pixel.
+ *
+ * Build (the bench directory is not part of the Vitis host build):
+ *   g++ -std=c++14 -O3 -pthread -I../src -I../libs/xf_opencv/L1/include -I$XILINX_VIVADO_HLS/include \
+ *       bench_histogram.cpp -o bench_histogram `pkg-config --cflags --libs opencv4`
+ * Add -DMEDIMG_BENCH_NO_OPENCV to leave out the OpenCV reference.
+ * Usage:
+ *   ./bench_histogram [slices]
+ */
+
+#include "common/xf_common.hpp"
+#include "common/xf_utility.hpp"
+#include "imgproc/xf_histogram.hpp"
+#include "medimg_bench.h"
+#include "medimg_histogram.h"
+#ifndef MEDIMG_BENCH_NO_OPENCV
+#include "opencv2/opencv.hpp"
+#endif
+
+#include <iostream>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+#define BENCH_HEIGHT 2160
+#define BENCH_WIDTH 3840
+#define BENCH_IN_BITS 12
+#define BENCH_BINS 4096
+
+using medimg::bench::now_ms;
+using medimg::bench::report;
+
+template <int NPC, int BINS>
+static bool csimMatches(const std::vector<uint16_t>& img, int rows, int cols, const std::vector<uint32_t>& expect) {
+    std::vector<uint32_t> hist(BINS);
+    xf::cv::Mat<XF_16UC1, BENCH_HEIGHT, BENCH_WIDTH, NPC> in(rows, cols);
+    in.copyTo((void*)img.data());
+    xf::cv::calcHistBinned<XF_16UC1, BENCH_HEIGHT, BENCH_WIDTH, NPC, BINS, BENCH_IN_BITS>(in, hist.data());
+    return hist == expect;
+}
+
+template <int BINS>
+static size_t checkImage(const std::vector<uint16_t>& img, int rows, int cols) {
+    const int shift = BENCH_IN_BITS - xf::cv::log2<BINS>::fvalue;
+    std::vector<uint32_t> expect(BINS, 0);
+    for (uint16_t v : img) expect[std::min<int>(v, (1 << BENCH_IN_BITS) - 1) >> shift]++;
+    medimg::Histogram cpu(BENCH_IN_BITS, xf::cv::log2<BINS>::fvalue, 1);
+    return (cpu.compute(img.data(), rows, cols) != expect) + !csimMatches<XF_NPPC1, BINS>(img, rows, cols, expect) +
+           !csimMatches<XF_NPPC8, BINS>(img, rows, cols, expect) +
+           !csimMatches<XF_NPPC16, BINS>(img, rows, cols, expect);
+}
+
+static bool check() {
+    const int rows = 24, cols = 48;
+    medimg::bench::Random rnd(5);
+    std::vector<uint16_t> img((size_t)rows * cols);
+    size_t failures = 0, images = 0;
+    for (int kind = 0; kind < 5; kind++) {
+        for (size_t i = 0; i < img.size(); i++) {
+            switch (kind) {
+                case 0: // a quarter above the 12-bit range, into the last bin
+                    img[i] = (uint16_t)rnd.uniform(0, (1 << BENCH_IN_BITS) * 4 / 3);
+                    break;
+                case 1: // every pixel onto one counter
+                    img[i] = 1000;
+                    break;
+                case 2: // two counters in turn
+                    img[i] = (i & 1) ? 17 : 4095;
+                    break;
+                case 3: // runs of random length
+                    img[i] = (i == 0 || rnd.uniform(0, 7) == 0) ? (uint16_t)rnd.uniform(0, 4095) : img[i - 1];
+                    break;
+                default:
+                    img[i] = (uint16_t)(i * 4);
+                    break;
+            }
+        }
+        failures += checkImage<BENCH_BINS>(img, rows, cols) + checkImage<256>(img, rows, cols);
+        images++;
+    }
+    printf("%dx%d, %zu images into %d and 256 bins\n", cols, rows, images, BENCH_BINS);
+    return medimg::bench::verdict("C-sim and CPU vs brute force", failures, "differing histograms");
+}
+
+template <int NPC>
+static size_t csim(const char* name, const std::vector<std::vector<uint16_t> >& raw,
+                   const std::vector<std::vector<uint32_t> >& ref, int rows, int cols) {
+    std::vector<uint32_t> hist(BENCH_BINS);
+    size_t mismatches = 0;
+    double ms = 0;
+    for (size_t z = 0; z < raw.size(); z++) {
+        xf::cv::Mat<XF_16UC1, BENCH_HEIGHT, BENCH_WIDTH, NPC> in(rows, cols);
+        in.copyTo((void*)raw[z].data());
+        double start = now_ms();
+        xf::cv::calcHistBinned<XF_16UC1, BENCH_HEIGHT, BENCH_WIDTH, NPC, BENCH_BINS, BENCH_IN_BITS>(in, hist.data());
+        ms += now_ms() - start;
+        mismatches += (hist != ref[z]);
+    }
+    report(name, rows, cols, (int)raw.size(), ms);
+    return mismatches;
+}
+
+static bool bench(int rows, int cols, int slices) {
+    medimg::bench::PhantomSlices phantom(rows, cols, slices);
+    std::vector<std::vector<uint16_t> >& raw = phantom.raw;
+    printf("%dx%d, %d slices of 12-bit raw data, %d bins\n", cols, rows, slices, BENCH_BINS);
+
+    std::vector<std::vector<uint32_t> > ref(slices);
+    size_t mismatches = 0;
+    for (int threads = 1; threads >= 0; threads--) {
+        medimg::Histogram cpu(BENCH_IN_BITS, 12, threads);
+        double start = now_ms();
+        for (int z = 0; z < slices; z++) {
+            const std::vector<uint32_t>& h = cpu.compute(raw[z].data(), rows, cols);
+            if (threads == 1)
+                ref[z] = h;
+            else
+                mismatches += (h != ref[z]);
+        }
+        report(threads ? "CPU 1 thread" : "CPU all threads", rows, cols, slices, now_ms() - start);
+    }
+
+    // The 256 bin histogram on the 8-bit windowed slice, for comparison
+    {
+        std::vector<uint32_t> hist(256);
+        double ms = 0;
+        for (int z = 0; z < slices; z++) {
+            xf::cv::Mat<XF_8UC1, BENCH_HEIGHT, BENCH_WIDTH, XF_NPPC8> in(rows, cols);
+            in.copyTo(phantom.soft[z].data());
+            double start = now_ms();
+            xf::cv::calcHist<XF_8UC1, BENCH_HEIGHT, BENCH_WIDTH, XF_NPPC8>(in, hist.data());
+            ms += now_ms() - start;
+        }
+        report("C-sim calcHist 256, NPPC8", rows, cols, slices, ms);
+    }
+
+    mismatches += csim<XF_NPPC1>("C-sim binned, NPPC1", raw, ref, rows, cols);
+    mismatches += csim<XF_NPPC8>("C-sim binned, NPPC8", raw, ref, rows, cols);
+    mismatches += csim<XF_NPPC16>("C-sim binned, NPPC16", raw, ref, rows, cols);
+
+#ifndef MEDIMG_BENCH_NO_OPENCV
+    {
+        int channels[] = {0}, hist_size[] = {BENCH_BINS};
+        float range[] = {0, (float)BENCH_BINS};
+        const float* ranges[] = {range};
+        cv::Mat hist;
+        double ms = 0;
+        for (int z = 0; z < slices; z++) {
+            cv::Mat in(rows, cols, CV_16UC1, raw[z].data());
+            double start = now_ms();
+            cv::calcHist(&in, 1, channels, cv::Mat(), hist, 1, hist_size, ranges);
+            ms += now_ms() - start;
+            for (int i = 0; i < BENCH_BINS; i++) mismatches += ((uint32_t)hist.at<float>(i) != ref[z][i]);
+        }
+        report("OpenCV calcHist CV_16UC1", rows, cols, slices, ms);
+    }
+#endif
+    return medimg::bench::verdict("all vs CPU 1 thread", mismatches, "mismatches");
+}
+
+int main(int argc, char** argv) {
+    int slices = (argc > 1) ? atoi(argv[1]) : 4;
+    if (slices <= 0) {
+        fprintf(stderr, "Invalid number of slices\nUsage:\n<Executable Name> [slices]\n");
+        return -1;
+    }
+    bool ok = check();
+    ok = bench(512, 512, slices) && ok;
+    ok = bench(BENCH_HEIGHT, BENCH_WIDTH, slices) && ok;
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,285 @@
+/*
+ * Copyright 2021 Xilinx, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Adaptive thresholding of phantom CT slices, windowed to 8-bit soft tissue: xf::cv::Threshold and
+ * xf::cv::localThreshold with Bradley, Niblack and Sauvola at XF_NPPC1 and XF_NPPC8 in C-sim on 512x512
+ * slices, the CPU medimg::LocalThreshold at windows of 15, 31 and 63 on 512x512 and 3840x2160 on one
+ * and on all hardware threads, and OpenCV's adaptiveThreshold with a box mean for reference. Every
+ * method reports the share of foreground pixels. C-sim results have to match the CPU ones exactly; the
+ * time per slice of the CPU version should not grow with the window. First the C-sim kernel at 3x3 and
+ * 31x31, NPPC1 and NPPC8, and the CPU version at 3x3 to 63x63 run all three methods on small random,
+ * constant, blocky and phantom images against summing every window directly.
+ *
+ * Build (the bench directory is not part of the Vitis host build):
+ *   g++ -std=c++14 -O3 -pthread -I../src -I../libs/xf_opencv/L1/include -I$XILINX_VIVADO_HLS/include \
+ *       bench_local_threshold.cpp -o bench_local_threshold `pkg-config --cflags --libs opencv4`
+ * Add -DMEDIMG_BENCH_NO_OPENCV to leave out the OpenCV reference.
+ * Usage:
+ *   ./bench_local_threshold [slices]
+ */
+
+#include "common/xf_common.hpp"
+#include "common/xf_utility.hpp"
+#include "imgproc/xf_local_threshold.hpp"
+#include "imgproc/xf_threshold.hpp"
+#include "medimg_bench.h"
+#include "medimg_local_threshold.h"
+#ifndef MEDIMG_BENCH_NO_OPENCV
+#include "opencv2/opencv.hpp"
+#endif
+
+#include <algorithm>
+#include <iostream>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+#define BENCH_HEIGHT 2160
+#define BENCH_WIDTH 3840
+#define BENCH_CSIM_SIZE 512
+#define BENCH_CSIM_WIN 31
+#define BENCH_THRESH 20
+#define BENCH_MAXVAL 255
+
+static const char* const kMethods[] = {"Bradley", "Niblack", "Sauvola"};
+static const int kK[] = {38, -51, 64}; // 0.15, -0.2 and 0.25 in Q.8
+static const int kWindows[] = {15, 31, 63};
+
+using medimg::bench::now_ms;
+
+static double foreground(const std::vector<uint8_t>& mask) {
+    size_t on = 0;
+    for (uint8_t m : mask) on += (m != 0);
+    return 100.0 * on / mask.size();
+}
+
+static void report(const char* name, int rows, int cols, int slices, double ms, double fg) {
+    medimg::bench::report(name, rows, cols, slices, ms, ", %5.1f%% foreground", fg);
+}
+
+/* floor(sqrt(v)) */
+static int64_t exactSqrt(int64_t v) {
+    int64_t r = (int64_t)sqrt((double)v);
+    while (r * r > v) r--;
+    while ((r + 1) * (r + 1) <= v) r++;
+    return r;
+}
+
+/* Every window clipped at the borders and summed directly, then p > m (1 - k), p > m + k s and
+ * p > m (1 + k (s / 128 - 1)) with k in Q.8, multiplied out over the pixel count n and 256 * 128 */
+static std::vector<uint8_t> directThreshold(const std::vector<uint8_t>& img, int rows, int cols, int method,
+                                            int window) {
+    const int h = window / 2;
+    const int64_t k = kK[method];
+    std::vector<uint8_t> out(img.size());
+    for (int y = 0; y < rows; y++) {
+        for (int x = 0; x < cols; x++) {
+            int64_t n = 0, s = 0, q = 0;
+            for (int v = std::max(y - h, 0); v <= std::min(y + h, rows - 1); v++) {
+                for (int u = std::max(x - h, 0); u <= std::min(x + h, cols - 1); u++) {
+                    const int64_t p = img[(size_t)v * cols + u];
+                    n++, s += p, q += p * p;
+                }
+            }
+            const int64_t p = img[(size_t)y * cols + x], sd = exactSqrt(n * q - s * s); // n times the deviation
+            bool above;
+            if (method == XF_LOCAL_THRESH_BRADLEY)
+                above = 256 * n * p > (256 - k) * s;
+            else if (method == XF_LOCAL_THRESH_NIBLACK)
+                above = 256 * n * p > 256 * s + k * sd;
+            else
+                above = 256 * 128 * n * n * p > 256 * 128 * n * s + k * s * (sd - 128 * n);
+            out[(size_t)y * cols + x] = (p > BENCH_THRESH && above) ? BENCH_MAXVAL : 0;
+        }
+    }
+    return out;
+}
+
+template <int METHOD, int NPC, int WIN>
+static size_t checkCsim(const std::vector<uint8_t>& img, int rows, int cols) {
+    std::vector<uint8_t> out(img.size());
+    xf::cv::Mat<XF_8UC1, BENCH_CSIM_SIZE, BENCH_CSIM_SIZE, NPC> src(rows, cols), dst(rows, cols);
+    src.copyTo((void*)img.data());
+    xf::cv::localThreshold<METHOD, XF_8UC1, BENCH_CSIM_SIZE, BENCH_CSIM_SIZE, NPC, WIN>(src, dst, BENCH_THRESH,
+                                                                                        BENCH_MAXVAL, kK[METHOD]);
+    dst.copyFrom(out.data());
+    return out != directThreshold(img, rows, cols, METHOD, WIN);
+}
+
+template <int NPC, int WIN>
+static size_t checkCsim(const std::vector<uint8_t>& img, int rows, int cols) {
+    return checkCsim<XF_LOCAL_THRESH_BRADLEY, NPC, WIN>(img, rows, cols) +
+           checkCsim<XF_LOCAL_THRESH_NIBLACK, NPC, WIN>(img, rows, cols) +
+           checkCsim<XF_LOCAL_THRESH_SAUVOLA, NPC, WIN>(img, rows, cols);
+}
+
+static bool check() {
+    const int rows = 37, cols = 56; // whole NPPC8 words
+    medimg::bench::Random rnd(3);
+    std::vector<uint8_t> img((size_t)rows * cols), out(img.size());
+    medimg::bench::PhantomSlices phantom(rows, cols, 1);
+    size_t failures = 0;
+    for (int kind = 0; kind < 4; kind++) {
+        for (size_t i = 0; i < img.size(); i++) {
+            const int x = (int)(i % cols), y = (int)(i / cols);
+            switch (kind) {
+                case 0:
+                    img[i] = (uint8_t)rnd.uniform(0, 255);
+                    break;
+                case 1:
+                    img[i] = 90;
+                    break;
+                case 2: // blocks of two levels with a little noise, the dark ones right at thresh
+                    img[i] = (uint8_t)((((x / 7) + (y / 5)) % 2 ? 160 : BENCH_THRESH) + rnd.uniform(0, 3));
+                    break;
+                default:
+                    img[i] = phantom.soft[0][i];
+                    break;
+            }
+        }
+        failures += checkCsim<XF_NPPC1, 3>(img, rows, cols) + checkCsim<XF_NPPC8, 3>(img, rows, cols);
+        failures += checkCsim<XF_NPPC1, BENCH_CSIM_WIN>(img, rows, cols) +
+                    checkCsim<XF_NPPC8, BENCH_CSIM_WIN>(img, rows, cols);
+        for (int method = 0; method < 3; method++) {
+            for (int window : {3, 15, 31, 63}) {
+                medimg::LocalThresholdParams params((medimg::LocalThresholdParams::Method)method, window, kK[method]);
+                params.threads = 3;
+                medimg::LocalThreshold(params).apply(img.data(), out.data(), rows, cols, BENCH_THRESH, BENCH_MAXVAL);
+                failures += (out != directThreshold(img, rows, cols, method, window));
+            }
+        }
+    }
+    printf("%dx%d, 4 images, 3x3 to 63x63\n", cols, rows);
+    return medimg::bench::verdict("C-sim and CPU vs direct windows", failures, "differing outputs");
+}
+
+template <int NPC>
+static void csimThreshold(const std::vector<std::vector<uint8_t> >& in8, int rows, int cols) {
+    const int slices = (int)in8.size();
+    std::vector<uint8_t> out(in8[0].size());
+    double ms = 0, fg = 0;
+    for (int z = 0; z < slices; z++) {
+        xf::cv::Mat<XF_8UC1, BENCH_CSIM_SIZE, BENCH_CSIM_SIZE, NPC> src(rows, cols), dst(rows, cols);
+        src.copyTo((void*)in8[z].data());
+        double start = now_ms();
+        xf::cv::Threshold<XF_THRESHOLD_TYPE_BINARY, XF_8UC1, BENCH_CSIM_SIZE, BENCH_CSIM_SIZE, NPC>(
+            src, dst, BENCH_THRESH, BENCH_MAXVAL);
+        ms += now_ms() - start;
+        dst.copyFrom(out.data());
+        fg += foreground(out);
+    }
+    char name[64];
+    snprintf(name, sizeof(name), "C-sim Threshold, NPPC%d", XF_NPIXPERCYCLE(NPC));
+    report(name, rows, cols, slices, ms, fg / slices);
+}
+
+template <int METHOD, int NPC>
+static size_t csimLocal(const std::vector<std::vector<uint8_t> >& in8, int rows, int cols) {
+    const int slices = (int)in8.size();
+    std::vector<uint8_t> out(in8[0].size()), ref(in8[0].size());
+    medimg::LocalThreshold cpu(
+        medimg::LocalThresholdParams((medimg::LocalThresholdParams::Method)METHOD, BENCH_CSIM_WIN, kK[METHOD]));
+    size_t mismatches = 0;
+    double ms = 0, fg = 0;
+    for (int z = 0; z < slices; z++) {
+        xf::cv::Mat<XF_8UC1, BENCH_CSIM_SIZE, BENCH_CSIM_SIZE, NPC> src(rows, cols), dst(rows, cols);
+        src.copyTo((void*)in8[z].data());
+        double start = now_ms();
+        xf::cv::localThreshold<METHOD, XF_8UC1, BENCH_CSIM_SIZE, BENCH_CSIM_SIZE, NPC, BENCH_CSIM_WIN>(
+            src, dst, BENCH_THRESH, BENCH_MAXVAL, kK[METHOD]);
+        ms += now_ms() - start;
+        dst.copyFrom(out.data());
+        fg += foreground(out);
+        cpu.apply(in8[z].data(), ref.data(), rows, cols, BENCH_THRESH, BENCH_MAXVAL);
+        mismatches += (out != ref);
+    }
+    char name[64];
+    snprintf(name, sizeof(name), "C-sim %s %d, NPPC%d", kMethods[METHOD], BENCH_CSIM_WIN, XF_NPIXPERCYCLE(NPC));
+    report(name, rows, cols, slices, ms, fg / slices);
+    return mismatches;
+}
+
+static void cpuLocal(const std::vector<std::vector<uint8_t> >& in8, int rows, int cols, int method, int window) {
+    std::vector<uint8_t> out(in8[0].size());
+    for (int threads = 1; threads >= 0; threads--) {
+        medimg::LocalThresholdParams params((medimg::LocalThresholdParams::Method)method, window, kK[method]);
+        params.threads = threads;
+        medimg::LocalThreshold cpu(params);
+        double ms = 0, fg = 0;
+        for (size_t z = 0; z < in8.size(); z++) {
+            double start = now_ms();
+            cpu.apply(in8[z].data(), out.data(), rows, cols, BENCH_THRESH, BENCH_MAXVAL);
+            ms += now_ms() - start;
+            fg += foreground(out);
+        }
+        char name[64];
+        snprintf(name, sizeof(name), "CPU %s %d, %s", kMethods[method], window, threads ? "1 thread" : "all threads");
+        report(name, rows, cols, (int)in8.size(), ms, fg / in8.size());
+    }
+}
+
+static bool bench(int rows, int cols, int slices) {
+    medimg::bench::PhantomSlices in(rows, cols, slices);
+    const size_t n = in.pixels();
+    std::vector<std::vector<uint8_t> >& in8 = in.soft;
+    printf("%dx%d, %d slices\n", cols, rows, slices);
+
+    size_t mismatches = 0;
+    if (rows <= BENCH_CSIM_SIZE && cols <= BENCH_CSIM_SIZE) {
+        csimThreshold<XF_NPPC1>(in8, rows, cols);
+        csimThreshold<XF_NPPC8>(in8, rows, cols);
+        mismatches += csimLocal<XF_LOCAL_THRESH_BRADLEY, XF_NPPC1>(in8, rows, cols);
+        mismatches += csimLocal<XF_LOCAL_THRESH_BRADLEY, XF_NPPC8>(in8, rows, cols);
+        mismatches += csimLocal<XF_LOCAL_THRESH_NIBLACK, XF_NPPC1>(in8, rows, cols);
+        mismatches += csimLocal<XF_LOCAL_THRESH_NIBLACK, XF_NPPC8>(in8, rows, cols);
+        mismatches += csimLocal<XF_LOCAL_THRESH_SAUVOLA, XF_NPPC1>(in8, rows, cols);
+        mismatches += csimLocal<XF_LOCAL_THRESH_SAUVOLA, XF_NPPC8>(in8, rows, cols);
+    }
+    for (int method = 0; method < 3; method++)
+        for (int window : kWindows) cpuLocal(in8, rows, cols, method, window);
+
+#ifndef MEDIMG_BENCH_NO_OPENCV
+    for (int window : kWindows) {
+        double ms = 0, fg = 0;
+        std::vector<uint8_t> out(n);
+        for (int z = 0; z < slices; z++) {
+            cv::Mat src(rows, cols, CV_8UC1, in8[z].data()), dst(rows, cols, CV_8UC1, out.data());
+            double start = now_ms();
+            cv::adaptiveThreshold(src, dst, BENCH_MAXVAL, cv::ADAPTIVE_THRESH_MEAN_C, cv::THRESH_BINARY, window, 0);
+            ms += now_ms() - start;
+            fg += foreground(out);
+        }
+        char name[64];
+        snprintf(name, sizeof(name), "OpenCV adaptiveThreshold mean %d", window);
+        report(name, rows, cols, slices, ms, fg / slices);
+    }
+#endif
+    return medimg::bench::verdict("C-sim vs CPU", mismatches, "differing slices");
+}
+
+int main(int argc, char** argv) {
+    int slices = (argc > 1) ? atoi(argv[1]) : 2;
+    if (slices <= 0) {
+        fprintf(stderr, "Invalid number of slices\nUsage:\n<Executable Name> [slices]\n");
+        return -1;
+    }
+    bool ok = check();
+    ok = bench(BENCH_CSIM_SIZE, BENCH_CSIM_SIZE, slices) && ok;
+    ok = bench(BENCH_HEIGHT, BENCH_WIDTH, slices) && ok;
+    return ok ? 0 : 1;
+}
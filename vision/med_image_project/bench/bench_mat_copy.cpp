@@ -0,0 +1,82 @@
+/*
+ * Copyright 2021 Xilinx, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * 4K host <-> xf::cv::Mat round trip benchmark: copyTo()/copyFrom(void*) against the per channel
+ * copyToPerChannel()/copyFromPerChannel() paths they replace.
+ *
+ * Build (the bench directory is not part of the Vitis host build):
+ *   g++ -std=c++14 -O3 -I../libs/xf_opencv/L1/include -I$XILINX_VIVADO_HLS/include \
+ *       bench_mat_copy.cpp -o bench_mat_copy
+ * Usage:
+ *   ./bench_mat_copy [iterations]
+ */
+
+#include "common/xf_common.hpp"
+#include <chrono>
+#include <string.h>
+#include <iostream>
+#include <vector>
+
+#define BENCH_HEIGHT 2160
+#define BENCH_WIDTH 3840
+
+template <int TYPE, int NPC>
+static void bench_round_trip(const char* name, int iterations) {
+    typedef xf::cv::Mat<TYPE, BENCH_HEIGHT, BENCH_WIDTH, NPC> mat_t;
+    mat_t mat(BENCH_HEIGHT, BENCH_WIDTH);
+
+    size_t bytes = (size_t)BENCH_HEIGHT * BENCH_WIDTH * (XF_PIXELWIDTH(TYPE, NPC) / 8);
+    std::vector<unsigned char> src(bytes), dst(bytes);
+    for (size_t i = 0; i < bytes; i++) src[i] = (unsigned char)(i * 131 + 7);
+
+    auto t0 = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < iterations; i++) {
+        mat.copyToPerChannel(src.data());
+        mat.copyFromPerChannel(dst.data());
+    }
+    auto t1 = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < iterations; i++) {
+        mat.copyTo(src.data());
+        mat.copyFrom(dst.data());
+    }
+    auto t2 = std::chrono::high_resolution_clock::now();
+
+    double before_ms = std::chrono::duration<double, std::milli>(t1 - t0).count() / iterations;
+    double after_ms = std::chrono::duration<double, std::milli>(t2 - t1).count() / iterations;
+    bool match = (memcmp(src.data(), dst.data(), bytes) == 0);
+
+    std::cout << name << ": per-channel " << before_ms << "ms, fast " << after_ms << "ms ("
+              << (mat_t::isMemcpyCompatible() ? "memcpy" : (mat_t::isBytePacked() ? "byte-packed" : "per-channel"))
+              << "), speedup " << (before_ms / after_ms) << "x" << (match ? "" : " MISMATCH") << std::endl;
+}
+
+int main(int argc, char** argv) {
+    int iterations = (argc > 1) ? atoi(argv[1]) : 5;
+    if (iterations <= 0) {
+        fprintf(stderr, "Invalid number of iterations\nUsage:\n<Executable Name> [iterations]\n");
+        return -1;
+    }
+
+    std::cout << "Round trip of one " << BENCH_WIDTH << "x" << BENCH_HEIGHT << " frame, averaged over " << iterations
+              << " iterations" << std::endl;
+    bench_round_trip<XF_8UC1, XF_NPPC1>("XF_8UC1  NPPC1", iterations);
+    bench_round_trip<XF_8UC1, XF_NPPC8>("XF_8UC1  NPPC8", iterations);
+    bench_round_trip<XF_16UC1, XF_NPPC8>("XF_16UC1 NPPC8", iterations);
+    bench_round_trip<XF_8UC3, XF_NPPC1>("XF_8UC3  NPPC1", iterations);
+
+    return 0;
+}
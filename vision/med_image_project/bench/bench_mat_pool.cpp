@@ -0,0 +1,85 @@
+/*
+ * Copyright 2021 Xilinx, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Frame buffer allocation benchmark for xf::cv::Mat with and without an xf::cv::MatPool.
+ *
+ * Every iteration allocates the four frame buffers the medimg pipeline uses (input, threshold, morph and
+ * output), touches every page of them and releases them again, like a C-sim regression does per frame.
+ *
+ * Build (the bench directory is not part of the Vitis host build):
+ *   g++ -std=c++14 -O3 -I../libs/xf_opencv/L1/include -I$XILINX_VIVADO_HLS/include \
+ *       bench_mat_pool.cpp -o bench_mat_pool
+ * Usage:
+ *   ./bench_mat_pool [frames]
+ */
+
+#include "common/xf_common.hpp"
+#include <chrono>
+#include <string.h>
+#include <iostream>
+
+#define BENCH_HEIGHT 2160
+#define BENCH_WIDTH 3840
+
+typedef xf::cv::Mat<XF_8UC1, BENCH_HEIGHT, BENCH_WIDTH, XF_NPPC8> bench_mat_t;
+
+static double run_frames(int frames) {
+    auto start = std::chrono::high_resolution_clock::now();
+    for (int f = 0; f < frames; f++) {
+        bench_mat_t in_mat(BENCH_HEIGHT, BENCH_WIDTH), threshold_out(BENCH_HEIGHT, BENCH_WIDTH);
+        bench_mat_t morph_out(BENCH_HEIGHT, BENCH_WIDTH), out_mat(BENCH_HEIGHT, BENCH_WIDTH);
+
+        size_t bytes = in_mat.size * sizeof(bench_mat_t::DATATYPE);
+        memset((void*)in_mat.data, f, bytes);
+        memset((void*)threshold_out.data, f, bytes);
+        memset((void*)morph_out.data, f, bytes);
+        memset((void*)out_mat.data, f, bytes);
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+int main(int argc, char** argv) {
+    int frames = (argc > 1) ? atoi(argv[1]) : 100;
+    if (frames <= 0) {
+        fprintf(stderr, "Invalid number of frames\nUsage:\n<Executable Name> [frames]\n");
+        return -1;
+    }
+
+    uint64_t unpooled_before = xf::cv::MatPool::unpooledAllocs();
+    double malloc_ms = run_frames(frames);
+    uint64_t unpooled = xf::cv::MatPool::unpooledAllocs() - unpooled_before;
+
+    xf::cv::MatPool pool;
+    double pool_ms;
+    {
+        xf::cv::MatPoolScope scope(pool);
+        pool_ms = run_frames(frames);
+    }
+    xf::cv::MatPoolStats st = pool.stats();
+
+    std::cout << "Frames: " << frames << " (" << BENCH_WIDTH << "x" << BENCH_HEIGHT << ", 4 Mats per frame)" << std::endl;
+    std::cout << "malloc : " << malloc_ms << "ms total, " << (malloc_ms / frames) << "ms/frame, " << unpooled
+              << " system allocations" << std::endl;
+    std::cout << "MatPool: " << pool_ms << "ms total, " << (pool_ms / frames) << "ms/frame, " << st.misses
+              << " system allocations" << std::endl;
+    std::cout << "MatPool stats: allocs=" << st.allocs << " frees=" << st.frees << " hits=" << st.hits
+              << " misses=" << st.misses << " peak_bytes=" << st.peakBytesInUse << " cached_bytes=" << st.bytesCached
+              << std::endl;
+
+    return 0;
+}
@@ -0,0 +1,227 @@
+/*
+ * Copyright 2021 Xilinx, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Median filters of 7x7, 11x11 and 15x15 on phantom CT slices: the sorting xf::cv::medianBlur and the
+ * sliding histogram xf::cv::medianBlurHist in C-sim on 8-bit soft tissue windowed 512x512 slices, and
+ * the CPU medimg::MedianHist on 12-bit raw data at 512x512 and 3840x2160 on one and on all hardware
+ * threads, with OpenCV's medianBlur on the 8-bit slices for reference. C-sim results have to match the
+ * CPU ones exactly; the time per slice of the histogram filters should not grow with the window.
+ * First both kernels and the CPU filter, 8 and 12-bit, run at 3x3, 7x7 and 15x15 on small random, salt
+ * and pepper, low contrast and phantom images against sorting every replicated window.
+ *
+ * Build (the bench directory is not part of the Vitis host build):
+ *   g++ -std=c++14 -O3 -pthread -I../src -I../libs/xf_opencv/L1/include -I$XILINX_VIVADO_HLS/include \
+ *       bench_median.cpp -o bench_median `pkg-config --cflags --libs opencv4`
+ * Add -DMEDIMG_BENCH_NO_OPENCV to leave out the OpenCV reference.
+ * Usage:
+ *   ./bench_median [slices]
+ */
+
+#include "common/xf_common.hpp"
+#include "common/xf_utility.hpp"
+#include "imgproc/xf_median_blur.hpp"
+#include "imgproc/xf_median_blur_hist.hpp"
+#include "medimg_bench.h"
+#include "medimg_median.h"
+#ifndef MEDIMG_BENCH_NO_OPENCV
+#include "opencv2/opencv.hpp"
+#endif
+
+#include <iostream>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#define BENCH_HEIGHT 2160
+#define BENCH_WIDTH 3840
+#define BENCH_CSIM_SIZE 512
+
+typedef xf::cv::Mat<XF_8UC1, BENCH_CSIM_SIZE, BENCH_CSIM_SIZE, XF_NPPC1> mat8_t;
+
+using medimg::bench::now_ms;
+
+static void report(const char* name, int k, int rows, int cols, int slices, double ms) {
+    char label[64];
+    snprintf(label, sizeof(label), "%s, %dx%d", name, k, k);
+    medimg::bench::report(label, rows, cols, slices, ms);
+}
+
+/* Median of every k x k window, rows and columns outside the image replicated */
+template <typename T>
+static std::vector<T> sortedMedian(const std::vector<T>& img, int rows, int cols, int k) {
+    std::vector<T> out(img.size()), window;
+    for (int y = 0; y < rows; y++) {
+        for (int x = 0; x < cols; x++) {
+            window.clear();
+            for (int v = y - k / 2; v <= y + k / 2; v++)
+                for (int u = x - k / 2; u <= x + k / 2; u++)
+                    window.push_back(img[(size_t)std::min(std::max(v, 0), rows - 1) * cols +
+                                         std::min(std::max(u, 0), cols - 1)]);
+            std::sort(window.begin(), window.end());
+            out[(size_t)y * cols + x] = window[window.size() / 2];
+        }
+    }
+    return out;
+}
+
+template <int K>
+static size_t checkImage(const std::vector<uint8_t>& img, int rows, int cols) {
+    const std::vector<uint8_t> expect = sortedMedian(img, rows, cols, K);
+    std::vector<uint8_t> out(img.size());
+    size_t failures = 0;
+    mat8_t src(rows, cols), dst(rows, cols);
+    src.copyTo((void*)img.data());
+    xf::cv::medianBlur<K, XF_BORDER_REPLICATE, XF_8UC1, BENCH_CSIM_SIZE, BENCH_CSIM_SIZE>(src, dst);
+    dst.copyFrom(out.data());
+    failures += (out != expect);
+    xf::cv::medianBlurHist<K, XF_BORDER_REPLICATE, XF_8UC1, BENCH_CSIM_SIZE, BENCH_CSIM_SIZE>(src, dst);
+    dst.copyFrom(out.data());
+    failures += (out != expect);
+    medimg::MedianParams params(K, 8, 8);
+    params.threads = 1;
+    medimg::MedianHist(params).apply(img.data(), out.data(), rows, cols);
+    failures += (out != expect);
+
+    // The same image spread over 12 bits, with the low bits set apart from the 8-bit median
+    std::vector<uint16_t> img12(img.size()), out12(img.size());
+    for (size_t i = 0; i < img.size(); i++) img12[i] = (uint16_t)((img[i] << 4) | (i % 16));
+    params.inBits = params.binBits = 12;
+    medimg::MedianHist(params).apply(img12.data(), out12.data(), rows, cols);
+    failures += (out12 != sortedMedian(img12, rows, cols, K));
+    return failures;
+}
+
+static bool check() {
+    const int rows = 40, cols = 45;
+    medimg::bench::Random rnd(11);
+    std::vector<uint8_t> img((size_t)rows * cols);
+    medimg::bench::PhantomSlices phantom(rows, cols, 1);
+    size_t failures = 0;
+    for (int kind = 0; kind < 4; kind++) {
+        for (size_t i = 0; i < img.size(); i++) {
+            const int r = rnd.uniform(0, 255);
+            switch (kind) {
+                case 0:
+                    img[i] = (uint8_t)r;
+                    break;
+                case 1: // salt and pepper on a flat background
+                    img[i] = (r < 20) ? 0 : ((r > 235) ? 255 : 128);
+                    break;
+                case 2: // many ties
+                    img[i] = (uint8_t)(100 + r % 3);
+                    break;
+                default:
+                    img[i] = phantom.soft[0][i];
+                    break;
+            }
+        }
+        failures += checkImage<3>(img, rows, cols) + checkImage<7>(img, rows, cols) + checkImage<15>(img, rows, cols);
+    }
+    printf("%dx%d, 4 images, 3x3 to 15x15\n", cols, rows);
+    return medimg::bench::verdict("C-sim and CPU vs sorted windows", failures, "differing outputs");
+}
+
+/* C-sim of both kernels on the 8-bit slices, checked against the CPU filter */
+template <int K>
+static size_t csim(const std::vector<std::vector<uint8_t> >& in8, int rows, int cols) {
+    const int slices = (int)in8.size();
+    std::vector<uint8_t> out(in8[0].size()), ref(in8[0].size());
+    medimg::MedianHist cpu(medimg::MedianParams(K, 8, 8));
+    size_t mismatches = 0;
+    double ms_sort = 0, ms_hist = 0;
+    for (int z = 0; z < slices; z++) {
+        mat8_t src(rows, cols), dst(rows, cols);
+        src.copyTo((void*)in8[z].data());
+        cpu.apply(in8[z].data(), ref.data(), rows, cols);
+
+        double start = now_ms();
+        xf::cv::medianBlur<K, XF_BORDER_REPLICATE, XF_8UC1, BENCH_CSIM_SIZE, BENCH_CSIM_SIZE>(src, dst);
+        ms_sort += now_ms() - start;
+        dst.copyFrom(out.data());
+        mismatches += (out != ref);
+
+        start = now_ms();
+        xf::cv::medianBlurHist<K, XF_BORDER_REPLICATE, XF_8UC1, BENCH_CSIM_SIZE, BENCH_CSIM_SIZE>(src, dst);
+        ms_hist += now_ms() - start;
+        dst.copyFrom(out.data());
+        mismatches += (out != ref);
+    }
+    report("C-sim medianBlur 8-bit", K, rows, cols, slices, ms_sort);
+    report("C-sim medianBlurHist 8-bit", K, rows, cols, slices, ms_hist);
+    return mismatches;
+}
+
+static void cpu12(const std::vector<std::vector<uint16_t> >& raw, int rows, int cols, int k) {
+    std::vector<uint16_t> out(raw[0].size());
+    for (int threads = 1; threads >= 0; threads--) {
+        medimg::MedianParams params(k, 12, 12);
+        params.threads = threads;
+        medimg::MedianHist cpu(params);
+        double start = now_ms();
+        for (size_t z = 0; z < raw.size(); z++) cpu.apply(raw[z].data(), out.data(), rows, cols);
+        report(threads ? "CPU 12-bit, 1 thread" : "CPU 12-bit, all threads", k, rows, cols, (int)raw.size(),
+               now_ms() - start);
+    }
+}
+
+static bool bench(int rows, int cols, int slices) {
+    medimg::bench::PhantomSlices phantom(rows, cols, slices);
+    const size_t n = phantom.pixels();
+    std::vector<std::vector<uint16_t> >& raw = phantom.raw;
+    std::vector<std::vector<uint8_t> >& in8 = phantom.soft;
+    printf("%dx%d, %d slices\n", cols, rows, slices);
+
+    size_t mismatches = 0;
+    if (rows <= BENCH_CSIM_SIZE && cols <= BENCH_CSIM_SIZE) {
+        mismatches += csim<7>(in8, rows, cols);
+        mismatches += csim<11>(in8, rows, cols);
+        mismatches += csim<15>(in8, rows, cols);
+    }
+    for (int k = 7; k <= 15; k += 4) cpu12(raw, rows, cols, k);
+
+#ifndef MEDIMG_BENCH_NO_OPENCV
+    for (int k = 7; k <= 15; k += 4) {
+        medimg::MedianHist cpu(medimg::MedianParams(k, 8, 8));
+        std::vector<uint8_t> ref(n);
+        cv::Mat dst;
+        double ms = 0;
+        for (int z = 0; z < slices; z++) {
+            cv::Mat src(rows, cols, CV_8UC1, in8[z].data());
+            double start = now_ms();
+            cv::medianBlur(src, dst, k);
+            ms += now_ms() - start;
+            cpu.apply(in8[z].data(), ref.data(), rows, cols);
+            mismatches += (memcmp(dst.data, ref.data(), n) != 0);
+        }
+        report("OpenCV medianBlur 8-bit", k, rows, cols, slices, ms);
+    }
+#endif
+    return medimg::bench::verdict("results", mismatches, "differing slices");
+}
+
+int main(int argc, char** argv) {
+    int slices = (argc > 1) ? atoi(argv[1]) : 2;
+    if (slices <= 0) {
+        fprintf(stderr, "Invalid number of slices\nUsage:\n<Executable Name> [slices]\n");
+        return -1;
+    }
+    bool ok = check();
+    ok = bench(BENCH_CSIM_SIZE, BENCH_CSIM_SIZE, slices) && ok;
+    ok = bench(BENCH_HEIGHT, BENCH_WIDTH, slices) && ok;
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,116 @@
+/*
+ * Copyright 2021 Xilinx, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Streams a synthetic CT volume (src/medimg_phantom.h) slice by slice through the medimg_accel kernel in
+ * C-sim, without any file I/O, and reports generator and pipeline throughput.
+ *
+ * Build (the bench directory is not part of the Vitis host build):
+ *   KSRC=../../med_image_project_kernels/src
+ *   g++ -std=c++14 -O3 -I../src -I../libs/xf_opencv/L1/include -I$KSRC -I$KSRC/build \
+ *       -I$XILINX_VIVADO_HLS/include bench_phantom.cpp $KSRC/medimg_accel.cpp -o bench_phantom
+ * Usage:
+ *   ./bench_phantom [WIDTHxHEIGHTxDEPTH] [seed] [slice.pgm]
+ * The default volume is 512x512x16. When a .pgm path is given, the windowed middle slice is written there
+ * for a visual check.
+ */
+
+#include "medimg_config.h"
+#include "medimg_phantom.h"
+#include <chrono>
+#include <iostream>
+#include <stdio.h>
+#include <vector>
+
+static double now_ms() {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+int main(int argc, char** argv) {
+    int width = 512, height = 512, depth = 16;
+    if (argc > 1 && sscanf(argv[1], "%dx%dx%d", &width, &height, &depth) != 3) depth = 0;
+    if (width <= 0 || width > WIDTH || height <= 0 || height > HEIGHT || depth <= 0) {
+        fprintf(stderr, "Invalid volume size, at most %dx%d per slice\nUsage:\n", WIDTH, HEIGHT);
+        fprintf(stderr, "<Executable Name> [WIDTHxHEIGHTxDEPTH] [seed] [slice.pgm]\n");
+        return -1;
+    }
+    medimg::PhantomParams params(width, height, depth, (argc > 2) ? (uint32_t)atoi(argv[2]) : 1);
+    medimg::Phantom phantom(params);
+
+    const size_t pixels = (size_t)width * height;
+    const int in_words = (int)((pixels * 8 + INPUT_PTR_WIDTH - 1) / INPUT_PTR_WIDTH);
+    const int out_words = (int)((pixels * 8 + OUTPUT_PTR_WIDTH - 1) / OUTPUT_PTR_WIDTH);
+    std::vector<uint16_t> raw(pixels);
+    std::vector<ap_uint<INPUT_PTR_WIDTH> > img_inp(in_words);
+    std::vector<ap_uint<OUTPUT_PTR_WIDTH> > img_out(out_words);
+    std::vector<unsigned char> frame(in_words * (INPUT_PTR_WIDTH / 8));
+
+    unsigned char shape[FILTER_SIZE * FILTER_SIZE];
+    for (int i = 0; i < FILTER_SIZE * FILTER_SIZE; i++) shape[i] = 1;
+
+#if EQUALIZE
+    // Every slice is equalized with the histogram of the one before, the first with none
+    std::vector<unsigned int> hist(256, 0);
+#endif
+
+    double gen_ms = 0, accel_ms = 0;
+    unsigned long long foreground = 0;
+    for (int z = 0; z < depth; z++) {
+        double t0 = now_ms();
+        phantom.slice(z, raw.data());
+        medimg::Phantom::window(raw.data(), frame.data(), pixels, medimg::Phantom::SOFT_TISSUE_CENTER,
+                                medimg::Phantom::SOFT_TISSUE_WIDTH);
+        double t1 = now_ms();
+
+        for (int i = 0; i < in_words; i++) {
+            for (int b = 0; b < INPUT_PTR_WIDTH / 8; b++) {
+                img_inp[i].range(b * 8 + 7, b * 8) = frame[(size_t)i * (INPUT_PTR_WIDTH / 8) + b];
+            }
+        }
+        double t2 = now_ms();
+        medimg_accel(img_inp.data(), shape, img_out.data(), height, width, 128, 255
+#if EQUALIZE
+                     , hist.data()
+#endif
+                     );
+        double t3 = now_ms();
+
+        for (int i = 0; i < out_words; i++) {
+            for (int b = 0; b < OUTPUT_PTR_WIDTH; b += 8) foreground += (img_out[i].range(b + 7, b) != 0);
+        }
+        gen_ms += t1 - t0;
+        accel_ms += t3 - t2;
+
+        if (argc > 3 && z == depth / 2) {
+            FILE* f = fopen(argv[3], "wb");
+            if (f == NULL) {
+                fprintf(stderr, "Cannot open %s\n", argv[3]);
+                return -1;
+            }
+            fprintf(f, "P5\n%d %d\n255\n", width, height);
+            fwrite(frame.data(), 1, pixels, f);
+            fclose(f);
+        }
+    }
+
+    double voxels = (double)pixels * depth;
+    std::cout << "Phantom " << width << "x" << height << "x" << depth << " seed " << params.seed << std::endl;
+    std::cout << "generator    : " << gen_ms << " ms, " << voxels / (gen_ms * 1e3) << " Mvoxel/s" << std::endl;
+    std::cout << "medimg_accel : " << accel_ms << " ms, " << voxels / (accel_ms * 1e3) << " Mvoxel/s (C-sim)"
+              << std::endl;
+    std::cout << "foreground   : " << foreground << " voxels" << std::endl;
+    return 0;
+}
@@ -0,0 +1,277 @@
+/*
+ * Copyright 2021 Xilinx, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Gaussian blur of phantom CT slices at sigma 1 to 64: xf::cv::GaussianBlur at 3x3, 5x5 and 7x7 and
+ * xf::cv::recursiveGaussian up to sigma BENCH_HALO / 8 in C-sim on 8-bit soft tissue windowed 512x512
+ * slices, the CPU medimg::RecursiveGaussian over whole columns on 12-bit raw slices at 512x512 and
+ * 3840x2160 on one and on all hardware threads, and OpenCV's GaussianBlur for reference. At 512x512
+ * every recursive filter also reports its RMS error against convolution with the sampled Gaussian in
+ * double precision, in grey levels for 8-bit and in HU for 12-bit. C-sim results have to match the CPU
+ * ones with the kernel's strips exactly; the time per slice of the recursive filters should not grow
+ * with sigma. First the C-sim kernel and the CPU filter over whole columns, 8 and 12-bit, run at sigma
+ * 0.5 to 16 on small random, constant, step edge and phantom images: a constant image has to come out
+ * unchanged and no pixel may be further off the sampled Gaussian than the recursion's own approximation
+ * error, largest at small sigma, allows.
+ *
+ * Build (the bench directory is not part of the Vitis host build):
+ *   g++ -std=c++14 -O3 -pthread -I../src -I../libs/xf_opencv/L1/include -I$XILINX_VIVADO_HLS/include \
+ *       bench_recursive_gaussian.cpp -o bench_recursive_gaussian `pkg-config --cflags --libs opencv4`
+ * Add -DMEDIMG_BENCH_NO_OPENCV to leave out the OpenCV reference.
+ * Usage:
+ *   ./bench_recursive_gaussian [slices]
+ */
+
+#include "common/xf_common.hpp"
+#include "common/xf_utility.hpp"
+#include "imgproc/xf_gaussian_filter.hpp"
+#include "imgproc/xf_recursive_gaussian.hpp"
+#include "medimg_bench.h"
+#include "medimg_recursive_gaussian.h"
+#ifndef MEDIMG_BENCH_NO_OPENCV
+#include "opencv2/opencv.hpp"
+#endif
+
+#include <algorithm>
+#include <iostream>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+#define BENCH_HEIGHT 2160
+#define BENCH_WIDTH 3840
+#define BENCH_CSIM_SIZE 512
+#define BENCH_STRIP 16
+#define BENCH_HALO 128 // 8 sigma at sigma 16, the largest sigma the C-sim strips are run at
+
+typedef xf::cv::Mat<XF_8UC1, BENCH_CSIM_SIZE, BENCH_CSIM_SIZE, XF_NPPC1> mat8_t;
+
+static const float kSigmas[] = {1.0f, 4.0f, 16.0f, 64.0f};
+
+// Largest error against the sampled Gaussian as a fraction of the input range, a quarter above what the
+// recursion gives on the check images; a 5% error in sigma exceeds it from sigma 2 on
+static const struct {
+    float sigma;
+    double error;
+} kChecks[] = {{0.5f, 0.08}, {1.0f, 0.065}, {2.0f, 0.035}, {4.0f, 0.024}, {8.0f, 0.018}, {16.0f, 0.011}};
+
+using medimg::bench::now_ms;
+using medimg::bench::rms;
+using medimg::bench::sumSquares;
+
+/* err below 0 when the run is not compared */
+static void report(const char* name, int rows, int cols, int slices, double ms, double err) {
+    if (err >= 0)
+        medimg::bench::report(name, rows, cols, slices, ms, ", RMS error %6.2f", err);
+    else
+        medimg::bench::report(name, rows, cols, slices, ms);
+}
+
+/* Separable convolution with the Gaussian sampled out to 4 sigma, replicated borders */
+template <typename T>
+static std::vector<double> exactBlur(const std::vector<T>& src, int rows, int cols, double sigma) {
+    const int radius = (int)ceil(4.0 * sigma);
+    std::vector<double> taps(2 * radius + 1), tmp(src.size()), out(src.size());
+    double sum = 0;
+    for (int i = -radius; i <= radius; i++) sum += taps[i + radius] = exp(-0.5 * i * i / (sigma * sigma));
+    for (double& t : taps) t /= sum;
+    for (int y = 0; y < rows; y++)
+        for (int x = 0; x < cols; x++) {
+            double v = 0;
+            for (int i = -radius; i <= radius; i++)
+                v += taps[i + radius] * src[(size_t)y * cols + std::min(std::max(x + i, 0), cols - 1)];
+            tmp[(size_t)y * cols + x] = v;
+        }
+    for (int y = 0; y < rows; y++)
+        for (int x = 0; x < cols; x++) {
+            double v = 0;
+            for (int i = -radius; i <= radius; i++)
+                v += taps[i + radius] * tmp[(size_t)std::min(std::max(y + i, 0), rows - 1) * cols + x];
+            out[(size_t)y * cols + x] = v;
+        }
+    return out;
+}
+
+/* Failures of one output: a constant input changed at all, or a pixel too far off the sampled Gaussian */
+template <typename T>
+static size_t compare(const std::vector<T>& img, const std::vector<T>& out, int rows, int cols, float sigma,
+                      double error, int in_max, bool constant, double& worst) {
+    if (constant) return out != img;
+    const std::vector<double> ref = exactBlur(img, rows, cols, sigma);
+    double err = 0;
+    for (size_t i = 0; i < out.size(); i++) err = std::max(err, fabs(out[i] - ref[i]));
+    worst = std::max(worst, err / in_max);
+    return err > error * in_max + 1.0; // and the output's rounding
+}
+
+static bool check() {
+    const int rows = 60, cols = 75;
+    medimg::bench::Random rnd(5);
+    std::vector<uint8_t> img((size_t)rows * cols), out(img.size());
+    std::vector<uint16_t> img12(img.size()), out12(img.size());
+    medimg::bench::PhantomSlices phantom(rows, cols, 1);
+    size_t failures = 0;
+    double worst = 0;
+    for (int kind = 0; kind < 4; kind++) {
+        for (size_t i = 0; i < img.size(); i++) {
+            const int x = (int)(i % cols), y = (int)(i / cols);
+            switch (kind) {
+                case 0:
+                    img12[i] = (uint16_t)rnd.uniform(0, 4095);
+                    break;
+                case 1:
+                    img12[i] = 2345;
+                    break;
+                case 2: // steps across and down the strips
+                    img12[i] = (uint16_t)((x < 30) == (y < 23) ? 300 : 3800);
+                    break;
+                default:
+                    img12[i] = phantom.raw[0][i];
+                    break;
+            }
+            img[i] = (kind == 3) ? phantom.soft[0][i] : (uint8_t)(img12[i] >> 4);
+        }
+        for (const auto& c : kChecks) {
+            const float sigma = c.sigma;
+            if (8.0f * sigma <= BENCH_HALO) {
+                mat8_t src(rows, cols), dst(rows, cols);
+                src.copyTo((void*)img.data());
+                xf::cv::recursiveGaussian<XF_8UC1, BENCH_CSIM_SIZE, BENCH_CSIM_SIZE, XF_NPPC1, BENCH_STRIP,
+                                          BENCH_HALO>(src, dst, sigma);
+                dst.copyFrom(out.data());
+                failures += compare(img, out, rows, cols, sigma, c.error, 255, kind == 1, worst);
+            }
+            medimg::RecursiveGaussianParams params(sigma);
+            params.threads = 2;
+            medimg::RecursiveGaussian cpu(params);
+            cpu.apply(img.data(), out.data(), rows, cols);
+            failures += compare(img, out, rows, cols, sigma, c.error, 255, kind == 1, worst);
+            cpu.apply(img12.data(), out12.data(), rows, cols);
+            failures += compare(img12, out12, rows, cols, sigma, c.error, 4095, kind == 1, worst);
+        }
+    }
+    printf("%dx%d, 4 images, sigma 0.5 to 16, largest error %.1f%% of the range\n", cols, rows, 100 * worst);
+    return medimg::bench::verdict("C-sim and CPU vs sampled Gaussian", failures, "differing outputs");
+}
+
+template <int K>
+static void csimGaussian(const std::vector<std::vector<uint8_t> >& in8, int rows, int cols) {
+    const int slices = (int)in8.size();
+    double ms = 0;
+    for (int z = 0; z < slices; z++) {
+        mat8_t src(rows, cols), dst(rows, cols);
+        src.copyTo((void*)in8[z].data());
+        double start = now_ms();
+        xf::cv::GaussianBlur<K, XF_BORDER_CONSTANT, XF_8UC1, BENCH_CSIM_SIZE, BENCH_CSIM_SIZE>(src, dst,
+                                                                                              K / 6.0f + 0.3f);
+        ms += now_ms() - start;
+    }
+    char name[64];
+    snprintf(name, sizeof(name), "C-sim GaussianBlur %dx%d", K, K);
+    report(name, rows, cols, slices, ms, -1);
+}
+
+static size_t csimRecursive(const std::vector<std::vector<uint8_t> >& in8, int rows, int cols, float sigma) {
+    const int slices = (int)in8.size();
+    std::vector<uint8_t> out(in8[0].size()), ref(in8[0].size());
+    medimg::RecursiveGaussian cpu(medimg::RecursiveGaussianParams(sigma, BENCH_STRIP, BENCH_HALO));
+    size_t mismatches = 0;
+    double ms = 0, err = 0;
+    for (int z = 0; z < slices; z++) {
+        mat8_t src(rows, cols), dst(rows, cols);
+        src.copyTo((void*)in8[z].data());
+        double start = now_ms();
+        xf::cv::recursiveGaussian<XF_8UC1, BENCH_CSIM_SIZE, BENCH_CSIM_SIZE, XF_NPPC1, BENCH_STRIP, BENCH_HALO>(
+            src, dst, sigma);
+        ms += now_ms() - start;
+        dst.copyFrom(out.data());
+        err += sumSquares(out, exactBlur(in8[z], rows, cols, sigma));
+        cpu.apply(in8[z].data(), ref.data(), rows, cols);
+        mismatches += (out != ref);
+    }
+    char name[64];
+    snprintf(name, sizeof(name), "C-sim recursiveGaussian, sigma %g", sigma);
+    report(name, rows, cols, slices, ms, rms(err, slices, out.size()));
+    return mismatches;
+}
+
+static void cpu12(const std::vector<std::vector<uint16_t> >& raw, int rows, int cols, float sigma, bool accuracy) {
+    std::vector<uint16_t> out(raw[0].size());
+    for (int threads = 1; threads >= 0; threads--) {
+        medimg::RecursiveGaussianParams params(sigma);
+        params.threads = threads;
+        medimg::RecursiveGaussian cpu(params);
+        double ms = 0, err = 0;
+        for (size_t z = 0; z < raw.size(); z++) {
+            double start = now_ms();
+            cpu.apply(raw[z].data(), out.data(), rows, cols);
+            ms += now_ms() - start;
+            if (accuracy && threads) err += sumSquares(out, exactBlur(raw[z], rows, cols, sigma));
+        }
+        char name[64];
+        snprintf(name, sizeof(name), "CPU 12-bit, sigma %g, %s", sigma, threads ? "1 thread" : "all threads");
+        report(name, rows, cols, (int)raw.size(), ms,
+               (accuracy && threads) ? rms(err, (int)raw.size(), out.size()) : -1);
+    }
+}
+
+static bool bench(int rows, int cols, int slices) {
+    medimg::bench::PhantomSlices in(rows, cols, slices);
+    std::vector<std::vector<uint16_t> >& raw = in.raw;
+    const std::vector<std::vector<uint8_t> >& in8 = in.soft;
+    printf("%dx%d, %d slices\n", cols, rows, slices);
+
+    const bool small = (rows <= BENCH_CSIM_SIZE && cols <= BENCH_CSIM_SIZE);
+    size_t mismatches = 0;
+    if (small) {
+        csimGaussian<3>(in8, rows, cols);
+        csimGaussian<5>(in8, rows, cols);
+        csimGaussian<7>(in8, rows, cols);
+        for (float sigma : kSigmas)
+            if (8.0f * sigma <= BENCH_HALO) mismatches += csimRecursive(in8, rows, cols, sigma);
+    }
+    for (float sigma : kSigmas) cpu12(raw, rows, cols, sigma, small);
+
+#ifndef MEDIMG_BENCH_NO_OPENCV
+    for (float sigma : kSigmas) {
+        double ms = 0;
+        cv::Mat dst;
+        for (int z = 0; z < slices; z++) {
+            cv::Mat src(rows, cols, CV_16UC1, raw[z].data());
+            double start = now_ms();
+            cv::GaussianBlur(src, dst, cv::Size(0, 0), sigma, sigma, cv::BORDER_REPLICATE);
+            ms += now_ms() - start;
+        }
+        char name[64];
+        snprintf(name, sizeof(name), "OpenCV GaussianBlur 12-bit, sigma %g", sigma);
+        report(name, rows, cols, slices, ms, -1);
+    }
+#endif
+    return medimg::bench::verdict("C-sim vs CPU", mismatches, "differing slices");
+}
+
+int main(int argc, char** argv) {
+    int slices = (argc > 1) ? atoi(argv[1]) : 2;
+    if (slices <= 0) {
+        fprintf(stderr, "Invalid number of slices\nUsage:\n<Executable Name> [slices]\n");
+        return -1;
+    }
+    bool ok = check();
+    ok = bench(BENCH_CSIM_SIZE, BENCH_CSIM_SIZE, slices) && ok;
+    ok = bench(BENCH_HEIGHT, BENCH_WIDTH, slices) && ok;
+    return ok ? 0 : 1;
+}
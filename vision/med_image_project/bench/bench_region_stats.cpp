@@ -0,0 +1,313 @@
+/*
+ * Copyright 2021 Xilinx, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Per region statistics of 12-bit phantom CT slices: the slice is thresholded into a mask of 0 and 1
+ * and the mask labelled with medimg::ConnectedComponents, then count, sum, sum of squares, minimum and
+ * maximum are taken per mask region and per component by xf::cv::regionStats in C-sim on 512x512
+ * slices and by the CPU medimg::RegionStats at 512x512 and 3840x2160 on one and on all hardware
+ * threads. For reference OpenCV's meanStdDev and minMaxLoc run once per region with the region's mask,
+ * the second pass per ROI the one pass tables replace. C-sim tables have to match the CPU ones exactly,
+ * the means, deviations and extremes of the CPU have to match OpenCV's. First the C-sim kernel with 8
+ * and 16-bit labels and the CPU version run on small random, tied and phantom intensities under random,
+ * run and block labels, some of them past the table, against adding up every pixel directly.
+ *
+ * Build (the bench directory is not part of the Vitis host build):
+ *   g++ -std=c++14 -O3 -pthread -I../src -I../libs/xf_opencv/L1/include -I$XILINX_VIVADO_HLS/include \
+ *       bench_region_stats.cpp -o bench_region_stats `pkg-config --cflags --libs opencv4`
+ * Add -DMEDIMG_BENCH_NO_OPENCV to leave out the OpenCV reference.
+ * Usage:
+ *   ./bench_region_stats [slices] [threshold_HU]
+ */
+
+#include "common/xf_common.hpp"
+#include "common/xf_utility.hpp"
+#include "core/xf_region_stats.hpp"
+#include "medimg_bench.h"
+#include "medimg_ccl.h"
+#include "medimg_region_stats.h"
+#ifndef MEDIMG_BENCH_NO_OPENCV
+#include "opencv2/opencv.hpp"
+#endif
+
+#include <algorithm>
+#include <iostream>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+#define BENCH_HEIGHT 2160
+#define BENCH_WIDTH 3840
+#define BENCH_CSIM_SIZE 512
+#define BENCH_MAX_REGIONS 1024
+
+typedef xf::cv::Mat<XF_16UC1, BENCH_CSIM_SIZE, BENCH_CSIM_SIZE, XF_NPPC1> raw_t;
+typedef xf::cv::Mat<XF_8UC1, BENCH_CSIM_SIZE, BENCH_CSIM_SIZE, XF_NPPC1> mask_t;
+typedef xf::cv::Mat<XF_16UC1, BENCH_CSIM_SIZE, BENCH_CSIM_SIZE, XF_NPPC1> label_t;
+
+static xf::cv::region_stats_t g_stats[BENCH_MAX_REGIONS];
+
+struct Slice {
+    std::vector<uint16_t> raw;
+    std::vector<uint8_t> mask;    // 0 and 1
+    std::vector<uint16_t> labels; // component ids
+    int components;
+};
+
+using medimg::bench::now_ms;
+using medimg::bench::report;
+
+template <typename S>
+static bool same(const S* a, const std::vector<medimg::RegionStatistics>& b, int n) {
+    for (int r = 0; r < n; r++) {
+        if (a[r].count != b[r].count || a[r].sum != b[r].sum || a[r].sum_sq != b[r].sum_sq || a[r].min != b[r].min ||
+            a[r].max != b[r].max || a[r].min_x != b[r].min_x || a[r].min_y != b[r].min_y ||
+            a[r].max_x != b[r].max_x || a[r].max_y != b[r].max_y)
+            return false;
+    }
+    return true;
+}
+
+/* Every pixel added to its label's entry in raster order, a new minimum or maximum only when strictly
+ * beyond the last one; returns the pixels of labels from regions on */
+template <typename L>
+static uint32_t directStats(const std::vector<uint16_t>& raw, const std::vector<L>& labels, int rows, int cols,
+                            int regions, std::vector<medimg::RegionStatistics>& stats) {
+    medimg::RegionStatistics empty = {};
+    stats.assign(regions, empty);
+    uint32_t outside = 0;
+    for (int y = 0; y < rows; y++) {
+        for (int x = 0; x < cols; x++) {
+            const size_t i = (size_t)y * cols + x;
+            if (labels[i] >= regions) {
+                outside++;
+                continue;
+            }
+            medimg::RegionStatistics& s = stats[labels[i]];
+            const uint16_t p = raw[i];
+            if (s.count == 0 || p < s.min) s.min = p, s.min_x = (uint16_t)x, s.min_y = (uint16_t)y;
+            if (s.count == 0 || p > s.max) s.max = p, s.max_x = (uint16_t)x, s.max_y = (uint16_t)y;
+            s.count++;
+            s.sum += p;
+            s.sum_sq += (uint64_t)p * p;
+        }
+    }
+    return outside;
+}
+
+template <int LBL_T, typename MAT, typename L, int MAX_REGIONS>
+static size_t checkCsim(const std::vector<uint16_t>& raw, const std::vector<L>& labels, int rows, int cols) {
+    std::vector<medimg::RegionStatistics> ref;
+    const uint32_t ref_outside = directStats(raw, labels, rows, cols, MAX_REGIONS, ref);
+    raw_t src(rows, cols);
+    MAT lbl(rows, cols);
+    src.copyTo((void*)raw.data());
+    lbl.copyTo((void*)labels.data());
+    unsigned int outside =
+        xf::cv::regionStats<XF_16UC1, LBL_T, BENCH_CSIM_SIZE, BENCH_CSIM_SIZE, MAX_REGIONS>(src, lbl, g_stats);
+    return (outside != ref_outside) || !same(g_stats, ref, MAX_REGIONS);
+}
+
+template <typename L>
+static size_t checkCpu(const std::vector<uint16_t>& raw, const std::vector<L>& labels, int rows, int cols,
+                       int regions) {
+    std::vector<medimg::RegionStatistics> ref, stats;
+    const uint32_t ref_outside = directStats(raw, labels, rows, cols, regions, ref);
+    medimg::RegionStatsParams params(regions);
+    params.threads = 3;
+    const uint32_t outside = medimg::RegionStats(params).apply(raw.data(), labels.data(), rows, cols, stats);
+    return (outside != ref_outside) || !same(stats.data(), ref, regions);
+}
+
+static bool check() {
+    const int rows = 41, cols = 67, regions = 64;
+    medimg::bench::Random rnd(9);
+    std::vector<uint16_t> raw((size_t)rows * cols), labels(raw.size());
+    std::vector<uint8_t> labels8(raw.size());
+    medimg::bench::PhantomSlices phantom(rows, cols, 1, false);
+    size_t failures = 0;
+    for (int values = 0; values < 3; values++) {
+        for (int kind = 0; kind < 3; kind++) {
+            int run = 0, label = 0;
+            for (size_t i = 0; i < raw.size(); i++) {
+                const int x = (int)(i % cols), y = (int)(i / cols);
+                if (values == 0)
+                    raw[i] = (uint16_t)rnd.uniform(0, 4095);
+                else if (values == 1) // few values, so that minima and maxima repeat
+                    raw[i] = (uint16_t)(1000 + 100 * rnd.uniform(0, 4));
+                else
+                    raw[i] = phantom.raw[0][i];
+                if (kind == 0) {
+                    label = rnd.uniform(0, regions + 15);
+                } else if (kind == 1) { // runs across row ends
+                    if (run-- == 0) run = rnd.uniform(0, 20), label = rnd.uniform(0, regions + 15);
+                } else {
+                    label = (y / 6) * 12 + x / 6;
+                }
+                labels[i] = (uint16_t)label;
+                labels8[i] = (uint8_t)(label % 4); // the mask's 0 and 1, and 2 and 3 outside its table
+            }
+            failures += checkCsim<XF_16UC1, label_t, uint16_t, 64>(raw, labels, rows, cols);
+            failures += checkCsim<XF_8UC1, mask_t, uint8_t, 2>(raw, labels8, rows, cols);
+            failures += checkCpu(raw, labels, rows, cols, regions) + checkCpu(raw, labels8, rows, cols, 2);
+        }
+    }
+    printf("%dx%d, 9 images, 2 and %d regions\n", cols, rows, regions);
+    return medimg::bench::verdict("C-sim and CPU vs direct sums", failures, "differing tables");
+}
+
+template <int LBL_T, typename MAT, typename L, int MAX_REGIONS>
+static size_t csimStats(const std::vector<Slice>& slices, int rows, int cols, const char* what,
+                        const std::vector<L> Slice::*labels) {
+    std::vector<medimg::RegionStatistics> ref;
+    medimg::RegionStats cpu{medimg::RegionStatsParams(MAX_REGIONS)};
+    size_t mismatches = 0;
+    double ms = 0;
+    for (const Slice& s : slices) {
+        raw_t src(rows, cols);
+        MAT lbl(rows, cols);
+        src.copyTo((void*)s.raw.data());
+        lbl.copyTo((void*)(s.*labels).data());
+        double start = now_ms();
+        unsigned int outside =
+            xf::cv::regionStats<XF_16UC1, LBL_T, BENCH_CSIM_SIZE, BENCH_CSIM_SIZE, MAX_REGIONS>(src, lbl, g_stats);
+        ms += now_ms() - start;
+        uint32_t ref_outside = cpu.apply(s.raw.data(), (s.*labels).data(), rows, cols, ref);
+        mismatches += (outside != ref_outside) || !same(g_stats, ref, MAX_REGIONS);
+    }
+    char name[64];
+    snprintf(name, sizeof(name), "C-sim regionStats, %s", what);
+    report(name, rows, cols, (int)slices.size(), ms);
+    return mismatches;
+}
+
+template <typename L>
+static std::vector<medimg::RegionStatistics> cpuStats(const std::vector<Slice>& slices, int rows, int cols,
+                                                      const char* what, const std::vector<L> Slice::*labels,
+                                                      int regions) {
+    std::vector<medimg::RegionStatistics> stats;
+    for (int threads = 1; threads >= 0; threads--) {
+        medimg::RegionStatsParams params(regions);
+        params.threads = threads;
+        medimg::RegionStats cpu(params);
+        double ms = 0;
+        for (const Slice& s : slices) {
+            double start = now_ms();
+            cpu.apply(s.raw.data(), (s.*labels).data(), rows, cols, stats);
+            ms += now_ms() - start;
+        }
+        char name[64];
+        snprintf(name, sizeof(name), "CPU RegionStats, %s, %s", what, threads ? "1 thread" : "all threads");
+        report(name, rows, cols, (int)slices.size(), ms);
+    }
+    return stats; // of the last slice
+}
+
+#ifndef MEDIMG_BENCH_NO_OPENCV
+/* One masked meanStdDev and minMaxLoc per region of the last slice's labels, checked against stats */
+template <typename L>
+static bool opencvStats(const std::vector<Slice>& slices,
+                        int rows,
+                        int cols,
+                        const char* what,
+                        const std::vector<L> Slice::*labels,
+                        int regions,
+                        const std::vector<medimg::RegionStatistics>& stats) {
+    bool ok = true;
+    double ms = 0;
+    for (size_t z = 0; z < slices.size(); z++) {
+        const Slice& s = slices[z];
+        cv::Mat src(rows, cols, CV_16UC1, (void*)s.raw.data());
+        cv::Mat lbl(rows, cols, (sizeof(L) == 1) ? CV_8UC1 : CV_16UC1, (void*)(s.*labels).data());
+        cv::Mat roi;
+        double start = now_ms();
+        for (int r = 0; r < regions; r++) {
+            cv::Scalar mean, sd;
+            double lo, hi;
+            roi = (lbl == r);
+            cv::meanStdDev(src, mean, sd, roi);
+            cv::minMaxLoc(src, &lo, &hi, NULL, NULL, roi);
+            if (z + 1 == slices.size() && stats[r].count != 0)
+                ok = ok && fabs(mean[0] - stats[r].mean()) < 1e-6 && fabs(sd[0] - stats[r].stddev()) < 1e-4 &&
+                     lo == stats[r].min && hi == stats[r].max;
+        }
+        ms += now_ms() - start;
+    }
+    char name[64];
+    snprintf(name, sizeof(name), "OpenCV per region, %s", what);
+    report(name, rows, cols, (int)slices.size(), ms);
+    return ok;
+}
+#endif
+
+static bool bench(int rows, int cols, int slices, int threshold_hu) {
+    medimg::bench::PhantomSlices phantom(rows, cols, slices, false);
+    const size_t n = phantom.pixels();
+    const uint16_t threshold_raw = (uint16_t)(threshold_hu + medimg::Phantom::RAW_OFFSET);
+    std::vector<Slice> data(slices);
+    medimg::ConnectedComponents ccl;
+    std::vector<medimg::ComponentStats> components;
+    std::vector<uint32_t> ids(n);
+    int regions = 0;
+    for (int z = 0; z < slices; z++) {
+        Slice& s = data[z];
+        s.raw.swap(phantom.raw[z]);
+        s.mask.resize(n);
+        s.labels.resize(n);
+        for (size_t i = 0; i < n; i++) s.mask[i] = (s.raw[i] > threshold_raw);
+        s.components = ccl.apply(s.mask.data(), rows, cols, components, ids.data());
+        for (size_t i = 0; i < n; i++) s.labels[i] = (uint16_t)std::min<uint32_t>(ids[i], 0xffff);
+        regions = std::max(regions, std::min(s.components, BENCH_MAX_REGIONS));
+    }
+    printf("%dx%d, %d slices, above %d HU, up to %d components\n", cols, rows, slices, threshold_hu, regions - 1);
+
+    size_t mismatches = 0;
+    if (rows <= BENCH_CSIM_SIZE && cols <= BENCH_CSIM_SIZE) {
+        mismatches += csimStats<XF_8UC1, mask_t, uint8_t, 2>(data, rows, cols, "mask", &Slice::mask);
+        mismatches += csimStats<XF_16UC1, label_t, uint16_t, BENCH_MAX_REGIONS>(data, rows, cols, "components",
+                                                                               &Slice::labels);
+    }
+    std::vector<medimg::RegionStatistics> mask_stats = cpuStats(data, rows, cols, "mask", &Slice::mask, 2);
+    std::vector<medimg::RegionStatistics> label_stats =
+        cpuStats(data, rows, cols, "components", &Slice::labels, regions);
+    const medimg::RegionStatistics& fg = mask_stats[1];
+    printf("  %-40s: %u pixels, %.1f +- %.1f HU, %d .. %d HU\n", "Foreground of the last slice", fg.count,
+           fg.mean() - medimg::Phantom::RAW_OFFSET, fg.stddev(), fg.min - medimg::Phantom::RAW_OFFSET,
+           fg.max - medimg::Phantom::RAW_OFFSET);
+
+    bool ok = (mismatches == 0);
+#ifndef MEDIMG_BENCH_NO_OPENCV
+    bool cv_ok = opencvStats(data, rows, cols, "mask", &Slice::mask, 2, mask_stats);
+    cv_ok = opencvStats(data, rows, cols, "components", &Slice::labels, regions, label_stats) && cv_ok;
+    printf("  %-40s: %s\n", "CPU vs OpenCV", cv_ok ? "match" : "DIFFER");
+    ok = ok && cv_ok;
+#endif
+    return medimg::bench::verdict("C-sim vs CPU", mismatches, "differing tables") && ok;
+}
+
+int main(int argc, char** argv) {
+    int slices = (argc > 1) ? atoi(argv[1]) : 2;
+    int threshold_hu = (argc > 2) ? atoi(argv[2]) : 150;
+    if (slices <= 0) {
+        fprintf(stderr, "Invalid number of slices\nUsage:\n<Executable Name> [slices] [threshold_HU]\n");
+        return -1;
+    }
+    bool ok = check();
+    ok = bench(BENCH_CSIM_SIZE, BENCH_CSIM_SIZE, slices, threshold_hu) && ok;
+    ok = bench(BENCH_HEIGHT, BENCH_WIDTH, slices, threshold_hu) && ok;
+    return ok ? 0 : 1;
+}
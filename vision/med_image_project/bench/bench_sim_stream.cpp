@@ -0,0 +1,147 @@
+/*
+ * Copyright 2021 Xilinx, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * C-simulation stream benchmark: the vendor hls::stream model against common/xf_sim_stream.hpp.
+ *
+ * Runs the medimg_accel kernel on a 4K frame, then pushes one 4K frame worth of words through a chain of
+ * three streams the way sequential C-sim of the medimg DATAFLOW region does. Peak RSS is reported after
+ * the kernel run. Build it once per stream
+ * model and compare (the bench directory is not part of the Vitis host build):
+ *   KSRC=../../med_image_project_kernels/src
+ *   FLAGS="-std=c++14 -O3 -I../libs/xf_opencv/L1/include -I$KSRC -I$KSRC/build -I$XILINX_VIVADO_HLS/include"
+ *   g++ $FLAGS bench_sim_stream.cpp $KSRC/medimg_accel.cpp -o bench_vendor_stream
+ *   g++ $FLAGS -DHLS_STREAM_THREAD_SAFE -pthread bench_sim_stream.cpp $KSRC/medimg_accel.cpp -o bench_locked_stream
+ *   g++ $FLAGS -DXF_SIM_SPSC_STREAM bench_sim_stream.cpp $KSRC/medimg_accel.cpp -o bench_spsc_stream
+ *   g++ $FLAGS -DXF_SIM_DATAFLOW_THREADS -pthread bench_sim_stream.cpp $KSRC/medimg_accel.cpp -o bench_dataflow_threads
+ * Usage:
+ *   ./bench_vendor_stream [iterations]
+ */
+
+#include "medimg_config.h"
+#include <chrono>
+#include <iostream>
+#include <vector>
+#include <sys/resource.h>
+
+typedef XF_TNAME(XF_8UC1, NPIX) word_t;
+
+static volatile int sink;
+
+static double now_ms() {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/* Sequential C-sim of a three stage chain: every stage drains its input completely into the next stream */
+static double stream_chain(int words) {
+    hls::stream<word_t, 2> s0, s1, s2;
+    double start = now_ms();
+    for (int i = 0; i < words; i++) s0.write(word_t(i));
+    for (int i = 0; i < words; i++) s1.write(s0.read());
+    for (int i = 0; i < words; i++) s2 << s1.read();
+    word_t acc = 0;
+    for (int i = 0; i < words; i++) acc ^= s2.read();
+    double end = now_ms();
+    sink = acc.to_int();
+    return end - start;
+}
+
+#if defined(XF_SIM_SPSC_STREAM) || defined(XF_SIM_DATAFLOW_THREADS)
+static double stream_chain_batched(int words) {
+    const int BATCH = WIDTH / NPIX;
+    hls::stream<word_t, 2> s0, s1, s2;
+    std::vector<word_t> line(BATCH);
+    double start = now_ms();
+    for (int i = 0; i < words; i += BATCH) {
+        for (int j = 0; j < BATCH; j++) line[j] = word_t(i + j);
+        s0.write(line.data(), BATCH);
+    }
+    for (int i = 0; i < words; i += BATCH) {
+        s0.read(line.data(), BATCH);
+        s1.write(line.data(), BATCH);
+    }
+    for (int i = 0; i < words; i += BATCH) {
+        s1.read(line.data(), BATCH);
+        s2.write(line.data(), BATCH);
+    }
+    for (int i = 0; i < words; i += BATCH) s2.read(line.data(), BATCH);
+    return now_ms() - start;
+}
+#endif
+
+int main(int argc, char** argv) {
+    int iterations = (argc > 1) ? atoi(argv[1]) : 1;
+    if (iterations <= 0) {
+        fprintf(stderr, "Invalid number of iterations\nUsage:\n<Executable Name> [iterations]\n");
+        return -1;
+    }
+
+    const int in_words = (HEIGHT * WIDTH * 8 + INPUT_PTR_WIDTH - 1) / INPUT_PTR_WIDTH;
+    const int out_words = (HEIGHT * WIDTH * 8 + OUTPUT_PTR_WIDTH - 1) / OUTPUT_PTR_WIDTH;
+    std::vector<ap_uint<INPUT_PTR_WIDTH> > img_inp(in_words);
+    std::vector<ap_uint<OUTPUT_PTR_WIDTH> > img_out(out_words);
+    for (int i = 0; i < in_words; i++) {
+        for (int b = 0; b < INPUT_PTR_WIDTH; b += 8) img_inp[i].range(b + 7, b) = (i * 7 + b * 13) & 0xff;
+    }
+    unsigned char shape[FILTER_SIZE * FILTER_SIZE];
+    for (int i = 0; i < FILTER_SIZE * FILTER_SIZE; i++) shape[i] = 1;
+
+#if defined(XF_SIM_DATAFLOW_THREADS)
+    const char* model = "xf_sim_stream, threaded dataflow";
+#elif defined(XF_SIM_SPSC_STREAM)
+    const char* model = "xf_sim_stream (SPSC ring)";
+#else
+    const char* model = "vendor hls::stream";
+#endif
+    std::cout << "Stream model: " << model << ", " << WIDTH << "x" << HEIGHT << " NPPC" << NPIX << ", " << iterations
+              << " iterations" << std::endl;
+
+#if EQUALIZE
+    // The iterations are one series of slices, each equalized with the histogram of the one before
+    std::vector<unsigned int> hist(256, 0);
+#endif
+
+    double start = now_ms();
+    for (int i = 0; i < iterations; i++) {
+        medimg_accel(img_inp.data(), shape, img_out.data(), HEIGHT, WIDTH, 100, 255
+#if EQUALIZE
+                     , hist.data()
+#endif
+                     );
+    }
+    double accel_ms = (now_ms() - start) / iterations;
+    unsigned long long checksum = 0;
+    for (int i = 0; i < out_words; i++) {
+        for (int b = 0; b < OUTPUT_PTR_WIDTH; b += 32) checksum = checksum * 31 + img_out[i].range(b + 31, b).to_uint();
+    }
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    std::cout << "medimg_accel C-sim : " << accel_ms << " ms/frame, output checksum " << std::hex << checksum << std::dec
+              << ", peak RSS " << usage.ru_maxrss / 1024 << " MB" << std::endl;
+
+    const int words = HEIGHT * WIDTH / NPIX;
+    double chain_ms = 0;
+    for (int i = 0; i < iterations; i++) chain_ms += stream_chain(words);
+    std::cout << "3 stream chain     : " << chain_ms / iterations << " ms/frame ("
+              << (chain_ms * 1e6 / iterations) / (4.0 * words) << " ns per push/pop)" << std::endl;
+#if defined(XF_SIM_SPSC_STREAM) || defined(XF_SIM_DATAFLOW_THREADS)
+    double batched_ms = 0;
+    for (int i = 0; i < iterations; i++) batched_ms += stream_chain_batched(words);
+    std::cout << "3 stream chain, row batched: " << batched_ms / iterations << " ms/frame" << std::endl;
+#endif
+
+    return 0;
+}
@@ -0,0 +1,176 @@
+/*
+ * Copyright 2021 Xilinx, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * End-to-end host flow on the software OpenCL device (ext/xcl2/xcl_sw_device.hpp): phantom slices are
+ * written, processed by medimg_accel (C-simulation) and read back, once strictly one slice after the
+ * other and once double buffered on two command queues, so that the transfers of one slice overlap the
+ * kernel of the previous one. No Xilinx runtime or card is involved.
+ *
+ * Build (the bench directory is not part of the Vitis host build):
+ *   KSRC=../../med_image_project_kernels/src
+ *   XCL=../libs/xf_opencv/ext/xcl2
+ *   g++ -std=c++14 -O3 -pthread -DXCL_SW_DEVICE -I$KSRC -I$KSRC/build -I../src -I$XCL \
+ *       -I../libs/xf_opencv/L1/include -I$XILINX_VIVADO_HLS/include bench_sw_device.cpp $XCL/xcl2.cpp \
+ *       $KSRC/medimg_accel.cpp -o bench_sw_device
+ * Usage:
+ *   XCL_SW_PCIE_GBPS=12 XCL_SW_KERNEL_LATENCY_US=50 ./bench_sw_device [WIDTHxHEIGHTxDEPTH]
+ */
+
+#include "xcl2.hpp"
+#include "medimg_config.h"
+#include "medimg_phantom.h"
+#include <chrono>
+#include <iostream>
+#include <stdio.h>
+#include <vector>
+
+static void medimg_accel_sw(xcl_sw::KernelArgs& args) {
+    medimg_accel(args.buffer<ap_uint<INPUT_PTR_WIDTH> >(0), args.buffer<unsigned char>(1),
+                 args.buffer<ap_uint<OUTPUT_PTR_WIDTH> >(2), args.scalar<int>(3), args.scalar<int>(4),
+                 args.scalar<unsigned char>(5), args.scalar<unsigned char>(6)
+#if EQUALIZE
+                 , args.buffer<unsigned int>(7)
+#endif
+                 );
+}
+XCL_SW_KERNEL(medimg_accel, medimg_accel_sw);
+
+static double now_ms() {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+struct Slot {
+    cl::CommandQueue queue;
+    cl::Kernel kernel;
+    cl::Buffer in, out;
+    cl::Event read;
+};
+
+int main(int argc, char** argv) {
+    int width = 512, height = 512, depth = 16;
+    if (argc > 1 && sscanf(argv[1], "%dx%dx%d", &width, &height, &depth) != 3) depth = 0;
+    if (width <= 0 || width > WIDTH || height <= 0 || height > HEIGHT || depth <= 0) {
+        fprintf(stderr, "Invalid volume size, at most %dx%d per slice\nUsage:\n", WIDTH, HEIGHT);
+        fprintf(stderr, "<Executable Name> [WIDTHxHEIGHTxDEPTH]\n");
+        return -1;
+    }
+
+    // Slices are generated up front, only the device flow is timed
+    const size_t bytes = (size_t)width * height;
+    medimg::Phantom phantom(medimg::PhantomParams(width, height, depth));
+    std::vector<std::vector<unsigned char> > slices(depth, std::vector<unsigned char>(bytes));
+    std::vector<std::vector<unsigned char> > results(depth, std::vector<unsigned char>(bytes));
+    for (int z = 0; z < depth; z++) phantom.sliceWindowed(z, slices[z].data());
+    std::vector<unsigned char> shape(FILTER_SIZE * FILTER_SIZE, 1);
+
+    cl_int err;
+    std::vector<cl::Device> devices = xcl::get_xil_devices();
+    cl::Device device = devices[0];
+    devices.resize(1);
+    OCL_CHECK(err, cl::Context context(device, NULL, NULL, NULL, &err));
+    OCL_CHECK(err, cl::Program program(context, devices, cl::Program::Binaries(), NULL, &err));
+    OCL_CHECK(err, cl::Buffer shape_buf(context, CL_MEM_READ_ONLY, shape.size(), NULL, &err));
+#if EQUALIZE
+    // Slices are equalized with the histogram of the previous one, which stays on the device between kernels
+    std::vector<unsigned int> hist_zero(256, 0);
+    OCL_CHECK(err, cl::Buffer hist_buf(context, CL_MEM_READ_WRITE, hist_zero.size() * sizeof(unsigned int), NULL, &err));
+#endif
+
+    Slot slots[2];
+    for (auto& s : slots) {
+        OCL_CHECK(err, s.queue = cl::CommandQueue(context, device, CL_QUEUE_PROFILING_ENABLE, &err));
+        OCL_CHECK(err, s.kernel = cl::Kernel(program, "medimg_accel", &err));
+        OCL_CHECK(err, s.in = cl::Buffer(context, CL_MEM_READ_ONLY, bytes, NULL, &err));
+        OCL_CHECK(err, s.out = cl::Buffer(context, CL_MEM_WRITE_ONLY, bytes, NULL, &err));
+        s.kernel.setArg(0, s.in);
+        s.kernel.setArg(1, shape_buf);
+        s.kernel.setArg(2, s.out);
+        s.kernel.setArg(3, height);
+        s.kernel.setArg(4, width);
+        s.kernel.setArg(5, (unsigned char)100);
+        s.kernel.setArg(6, (unsigned char)255);
+#if EQUALIZE
+        s.kernel.setArg(7, hist_buf);
+#endif
+    }
+    OCL_CHECK(err, err = slots[0].queue.enqueueWriteBuffer(shape_buf, CL_TRUE, 0, shape.size(), shape.data()));
+
+    std::cout << "Software device, " << width << "x" << height << "x" << depth << " phantom, PCIe "
+              << xcl_sw::config().pcieGBps << " GB/s (0: unthrottled), kernel latency "
+              << xcl_sw::config().kernelLatencyUs << " us" << std::endl;
+
+    // One slice at a time on one queue
+#if EQUALIZE
+    OCL_CHECK(err, err = slots[0].queue.enqueueWriteBuffer(hist_buf, CL_TRUE, 0, hist_zero.size() * sizeof(unsigned int),
+                                                           hist_zero.data()));
+#endif
+    double start = now_ms();
+    for (int z = 0; z < depth; z++) {
+        Slot& s = slots[0];
+        cl::Event write, task;
+        std::vector<cl::Event> after_write(1), after_task(1);
+        OCL_CHECK(err, err = s.queue.enqueueWriteBuffer(s.in, CL_FALSE, 0, bytes, slices[z].data(), NULL, &write));
+        after_write[0] = write;
+        OCL_CHECK(err, err = s.queue.enqueueTask(s.kernel, &after_write, &task));
+        after_task[0] = task;
+        OCL_CHECK(err, err = s.queue.enqueueReadBuffer(s.out, CL_TRUE, 0, bytes, results[z].data(), &after_task));
+    }
+    double serial_ms = now_ms() - start;
+    unsigned long long serial_sum = 0;
+    for (int z = 0; z < depth; z++) {
+        for (size_t i = 0; i < bytes; i++) serial_sum += results[z][i];
+    }
+
+    // Double buffered: slice z + 1 is written while slice z is processed
+    for (auto& r : results) std::fill(r.begin(), r.end(), 0);
+#if EQUALIZE
+    OCL_CHECK(err, err = slots[0].queue.enqueueWriteBuffer(hist_buf, CL_TRUE, 0, hist_zero.size() * sizeof(unsigned int),
+                                                           hist_zero.data()));
+    cl::Event prev_task;
+#endif
+    start = now_ms();
+    for (int z = 0; z < depth; z++) {
+        Slot& s = slots[z & 1]; // In order queue, the slot's buffers are free once its last read is done
+        cl::Event write, task;
+        std::vector<cl::Event> after_write(1), after_task(1);
+        OCL_CHECK(err, err = s.queue.enqueueWriteBuffer(s.in, CL_FALSE, 0, bytes, slices[z].data(), NULL, &write));
+        after_write[0] = write;
+#if EQUALIZE
+        if (z > 0) after_write.push_back(prev_task); // The kernels chain through the histogram
+#endif
+        OCL_CHECK(err, err = s.queue.enqueueTask(s.kernel, &after_write, &task));
+#if EQUALIZE
+        prev_task = task;
+#endif
+        after_task[0] = task;
+        OCL_CHECK(err,
+                  err = s.queue.enqueueReadBuffer(s.out, CL_FALSE, 0, bytes, results[z].data(), &after_task, &s.read));
+    }
+    for (auto& s : slots) s.queue.finish();
+    double overlap_ms = now_ms() - start;
+    unsigned long long overlap_sum = 0;
+    for (int z = 0; z < depth; z++) {
+        for (size_t i = 0; i < bytes; i++) overlap_sum += results[z][i];
+    }
+
+    std::cout << "serial          : " << serial_ms << " ms, " << depth * 1000.0 / serial_ms << " slices/s" << std::endl;
+    std::cout << "double buffered : " << overlap_ms << " ms, " << depth * 1000.0 / overlap_ms << " slices/s"
+              << std::endl;
+    std::cout << "results " << ((serial_sum == overlap_sum) ? "match" : "DIFFER") << " (checksum " << serial_sum << ")"
+              << std::endl;
+    return (serial_sum == overlap_sum) ? 0 : 1;
+}
@@ -0,0 +1,155 @@
+/*
+ * Copyright 2021 Xilinx, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Startup cost of loading an xclbin: the former ifstream + new char[] loader against the mmap cache of
+ * xcl::import_binary_file, for one program and for one program per kernel as cl_kernel_mgr builds them,
+ * and the time from opening the device to the end of the first kernel. Without an xclbin argument a
+ * synthetic file of the given size is written to the working directory and removed afterwards.
+ *
+ * Build (the bench directory is not part of the Vitis host build), against the software device:
+ *   XCL=../libs/xf_opencv/ext/xcl2
+ *   g++ -std=c++14 -O3 -pthread -DXCL_SW_DEVICE -I$XCL bench_xclbin_load.cpp $XCL/xcl2.cpp -o bench_xclbin_load
+ * or against XRT, replacing -DXCL_SW_DEVICE with -I$XILINX_XRT/include -L$XILINX_XRT/lib -lOpenCL.
+ * Usage:
+ *   ./bench_xclbin_load [xclbin | size_MB] [kernels]
+ */
+
+#include "xcl2.hpp"
+#include <chrono>
+#include <iostream>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+#ifdef XCL_SW_DEVICE
+static void noop_sw(xcl_sw::KernelArgs&) {}
+XCL_SW_KERNEL(noop, noop_sw);
+#endif
+
+static double now_ms() {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/* The loader import_binary_file used before the cache, the buffer is never freed */
+static cl::Program::Binaries import_binary_file_ifstream(const std::string& path) {
+    std::ifstream bin_file(path.c_str(), std::ifstream::binary);
+    bin_file.seekg(0, bin_file.end);
+    unsigned nb = bin_file.tellg();
+    bin_file.seekg(0, bin_file.beg);
+    char* buf = new char[nb];
+    bin_file.read(buf, nb);
+    cl::Program::Binaries bins;
+    bins.push_back({buf, nb});
+    return bins;
+}
+
+/* Stands in for the runtime parsing the image: touches one byte per page */
+static unsigned touch(const cl::Program::Binaries& bins) {
+    unsigned sum = 0;
+    for (size_t i = 0; i < bins[0].second; i += 4096) sum += ((const unsigned char*)bins[0].first)[i];
+    return sum;
+}
+
+int main(int argc, char** argv) {
+    std::string path = "bench_xclbin_load.xclbin";
+    bool synthetic = true;
+    size_t size_mb = 64;
+    int kernels = (argc > 2) ? atoi(argv[2]) : 4;
+    if (argc > 1) {
+        char* end;
+        size_t mb = strtoul(argv[1], &end, 10);
+        if (*end == '\0' && mb > 0) {
+            size_mb = mb;
+        } else {
+            path = argv[1];
+            synthetic = false;
+        }
+    }
+    if (kernels <= 0) {
+        fprintf(stderr, "Usage:\n<Executable Name> [xclbin | size_MB] [kernels]\n");
+        return -1;
+    }
+    if (synthetic) {
+        std::vector<char> block(1 << 20);
+        for (size_t i = 0; i < block.size(); i++) block[i] = (char)(i * 131);
+        FILE* f = fopen(path.c_str(), "wb");
+        for (size_t i = 0; f != NULL && i < size_mb; i++) fwrite(block.data(), 1, block.size(), f);
+        if (f == NULL || fclose(f) != 0) {
+            fprintf(stderr, "ERROR: Cannot write %s\n", path.c_str());
+            return -1;
+        }
+    }
+    std::cout.setstate(std::ios::failbit); // Silence the INFO lines of xcl2 while timing
+
+    // One load, as the host binary does
+    unsigned sink = 0;
+    double start = now_ms();
+    cl::Program::Binaries bins = import_binary_file_ifstream(path);
+    sink += touch(bins);
+    double ifstream_one = now_ms() - start;
+    delete[](const char*) bins[0].first;
+
+    start = now_ms();
+    bins = xcl::import_binary_file(path);
+    sink += touch(bins);
+    xcl::release_binary_file(bins);
+    double mmap_one = now_ms() - start;
+
+    // One load per kernel, as cl_kernel_mgr does; the cache shares the mapping while programs are built
+    start = now_ms();
+    std::vector<cl::Program::Binaries> all(kernels);
+    for (int k = 0; k < kernels; k++) {
+        all[k] = import_binary_file_ifstream(path);
+        sink += touch(all[k]);
+    }
+    double ifstream_all = now_ms() - start;
+    for (auto& b : all) delete[](const char*) b[0].first;
+
+    start = now_ms();
+    for (int k = 0; k < kernels; k++) {
+        all[k] = xcl::import_binary_file(path);
+        sink += touch(all[k]);
+    }
+    for (auto& b : all) xcl::release_binary_file(b);
+    double mmap_all = now_ms() - start;
+
+    // Device open to the end of the first kernel
+    start = now_ms();
+    cl_int err;
+    std::vector<cl::Device> devices = xcl::get_xil_devices();
+    devices.resize(1);
+    OCL_CHECK(err, cl::Context context(devices[0], NULL, NULL, NULL, &err));
+    OCL_CHECK(err, cl::CommandQueue q(context, devices[0], CL_QUEUE_PROFILING_ENABLE, &err));
+    bins = xcl::import_binary_file(path);
+    OCL_CHECK(err, cl::Program program(context, devices, bins, NULL, &err));
+    xcl::release_binary_file(bins);
+    OCL_CHECK(err, cl::Kernel kernel(program, "noop", &err));
+    OCL_CHECK(err, err = q.enqueueTask(kernel));
+    q.finish();
+    double first_kernel = now_ms() - start;
+
+    std::cout.clear();
+    if (synthetic) remove(path.c_str());
+    std::cout << path << (synthetic ? " (synthetic, " + std::to_string(size_mb) + " MB)" : std::string()) << ", "
+              << kernels << " kernels" << std::endl;
+    std::cout << "ifstream, 1 program        : " << ifstream_one << " ms" << std::endl;
+    std::cout << "mmap cache, 1 program      : " << mmap_one << " ms" << std::endl;
+    std::cout << "ifstream, " << kernels << " programs       : " << ifstream_all << " ms" << std::endl;
+    std::cout << "mmap cache, " << kernels << " programs     : " << mmap_all << " ms" << std::endl;
+    std::cout << "device open to first kernel: " << first_kernel << " ms" << std::endl;
+    return (sink == 0xffffffff) ? 1 : 0;
+}
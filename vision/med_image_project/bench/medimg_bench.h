@@ -0,0 +1,131 @@
+/*
+ * Copyright 2021 Xilinx, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _MEDIMG_BENCH_H_
+#define _MEDIMG_BENCH_H_
+
+#include "medimg_phantom.h"
+
+#include <chrono>
+#include <math.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <vector>
+
+//----------------------------------------------------------------------------------------------------//
+// What the bench_*.cpp kernel benches share: a wall clock, one line per timed run and per check, the
+// phantom slices they run on and a small pseudo-random generator for the brute-force checks that every
+// bench runs before timing anything:
+//
+//     medimg::bench::PhantomSlices in(512, 512, slices);
+//     double start = medimg::bench::now_ms();
+//     ... run on in.raw[z] or in.soft[z] ...
+//     medimg::bench::report("CPU, 1 thread", 512, 512, slices, medimg::bench::now_ms() - start);
+//     ok = medimg::bench::verdict("C-sim vs CPU", mismatches, "differing slices") && ok;
+//----------------------------------------------------------------------------------------------------//
+
+namespace medimg {
+namespace bench {
+
+inline double now_ms() {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/* Time per slice and throughput of a run, followed by what the printf style fmt adds */
+inline void report(const char* name, int rows, int cols, int slices, double ms, const char* fmt = "", ...) {
+    printf("  %-40s: %9.2f ms/slice, %8.2f Mpix/s", name, ms / slices, (double)rows * cols * slices / ms / 1000.0);
+    va_list args;
+    va_start(args, fmt);
+    vprintf(fmt, args);
+    va_end(args);
+    printf("\n");
+}
+
+/* Outcome of a comparison, true when nothing failed */
+inline bool verdict(const char* name, size_t failures, const char* what) {
+    printf("  %-40s: %s (%zu %s)\n", name, failures ? "DIFFER" : "match", failures, what);
+    return failures == 0;
+}
+
+/* Sum of the squared differences of a and b, and the RMS difference over slices of n pixels */
+template <typename T, typename U>
+inline double sumSquares(const std::vector<T>& a, const std::vector<U>& b) {
+    double sum = 0;
+    for (size_t i = 0; i < a.size(); i++) sum += ((double)a[i] - (double)b[i]) * ((double)a[i] - (double)b[i]);
+    return sum;
+}
+
+inline double rms(double sum_squares, int slices, size_t n) {
+    return sqrt(sum_squares / ((double)slices * n));
+}
+
+/* 12-bit raw phantom slices and, unless windowed is false, the same slices in the 8-bit soft tissue window */
+struct PhantomSlices {
+    int rows, cols;
+    std::vector<std::vector<uint16_t> > raw;
+    std::vector<std::vector<uint8_t> > soft;
+
+    PhantomSlices(int _rows, int _cols, int slices, bool windowed = true) : rows(_rows), cols(_cols) {
+        generate(medimg::PhantomParams(cols, rows, slices), windowed);
+    }
+
+    /* Slices of the phantom params describes, e.g. without noise */
+    explicit PhantomSlices(const medimg::PhantomParams& params, bool windowed = true)
+        : rows(params.height), cols(params.width) {
+        generate(params, windowed);
+    }
+
+    size_t pixels() const { return (size_t)rows * cols; }
+
+   private:
+    void generate(const medimg::PhantomParams& params, bool windowed) {
+        const size_t n = (size_t)rows * cols;
+        const int slices = params.depth;
+        medimg::Phantom phantom(params);
+        raw.assign(slices, std::vector<uint16_t>(n));
+        if (windowed) soft.assign(slices, std::vector<uint8_t>(n));
+        for (int z = 0; z < slices; z++) {
+            phantom.slice(z, raw[z].data());
+            if (windowed)
+                medimg::Phantom::window(raw[z].data(), soft[z].data(), n, medimg::Phantom::SOFT_TISSUE_CENTER,
+                                        medimg::Phantom::SOFT_TISSUE_WIDTH);
+        }
+    }
+};
+
+/* Linear congruential generator, the same sequence on every platform */
+class Random {
+   public:
+    explicit Random(uint32_t seed = 1) : mState(seed * 2654435761u + 0x9e3779b9u) {}
+
+    uint32_t next() {
+        mState = mState * 1664525u + 1013904223u;
+        return mState >> 8;
+    }
+
+    /* lo .. hi, both included */
+    int uniform(int lo, int hi) { return lo + (int)(next() % (uint32_t)(hi - lo + 1)); }
+
+   private:
+    uint32_t mState;
+};
+
+} // namespace bench
+} // namespace medimg
+
+#endif //_MEDIMG_BENCH_H_
@@ -0,0 +1,413 @@
+/*
+ * Copyright 2021 Xilinx, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * L1 micro-benchmark suite for the Vitis Vision functions medimg uses.
+ *
+ * Runs Threshold, dilate, erode, Array2xfMat, xfMat2Array, calcHist, OtsuThreshold, equalizeHist,
+ * equalizeHistTemporal, medianBlur and GaussianBlur in C-sim at NPPC1 and NPPC8, and their OpenCV counterparts as the CPU backend, on
+ * 512x512, 1920x1080 and 3840x2160 phantom CT slices (src/medimg_phantom.h). Every run records pixels/s,
+ * heap allocations and peak RSS.
+ * Results are written as JSON (schema "medimg-l1-bench/1", one object per run, keys always present)
+ * so that runs before and after a bump of the vendored library can be diffed by a script. "npc" is 0 for
+ * the CPU backend. An iteration includes allocating the Mats and loading the input frame, like every call
+ * of a C-sim testbench does.
+ *
+ * Build (the bench directory is not part of the Vitis host build):
+ *   g++ -std=c++14 -O3 -I../src -I../libs/xf_opencv/L1/include -I$XILINX_VIVADO_HLS/include \
+ *       medimg_l1_bench.cpp -o medimg_l1_bench `pkg-config --cflags --libs opencv4`
+ * Add -DMEDIMG_BENCH_NO_OPENCV to build the C-sim backend only.
+ * Usage:
+ *   ./medimg_l1_bench [-i iterations] [-k kernel] [-r WIDTHxHEIGHT] [-o results.json]
+ */
+
+#include "common/xf_common.hpp"
+#include "common/xf_utility.hpp"
+#include "imgproc/xf_dilation.hpp"
+#include "imgproc/xf_erosion.hpp"
+#include "imgproc/xf_gaussian_filter.hpp"
+#include "imgproc/xf_hist_equalize.hpp"
+#include "imgproc/xf_histogram.hpp"
+#include "imgproc/xf_median_blur.hpp"
+#include "imgproc/xf_otsuthreshold.hpp"
+#include "imgproc/xf_threshold.hpp"
+#include "medimg_phantom.h"
+#ifndef MEDIMG_BENCH_NO_OPENCV
+#include "opencv2/opencv.hpp"
+#endif
+
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <string.h>
+#include <vector>
+#include <malloc.h>
+#include <sys/resource.h>
+
+#define BENCH_HEIGHT 2160
+#define BENCH_WIDTH 3840
+#define BENCH_PTR_WIDTH 256
+#define BENCH_THRESH 100
+#define BENCH_MAXVAL 255
+
+/*
+ * Heap allocation counting. malloc and friends are interposed and forwarded to glibc, so allocations made
+ * by Mats, MatPools, hls::streams and OpenCV are all counted the same way.
+ */
+static std::atomic<unsigned long long> g_allocs(0);
+static std::atomic<unsigned long long> g_alloc_bytes(0);
+
+#ifdef __GLIBC__
+extern "C" {
+void* __libc_malloc(size_t size);
+void* __libc_calloc(size_t n, size_t size);
+void* __libc_realloc(void* ptr, size_t size);
+void* __libc_memalign(size_t alignment, size_t size);
+
+void* malloc(size_t size) {
+    g_allocs.fetch_add(1, std::memory_order_relaxed);
+    g_alloc_bytes.fetch_add(size, std::memory_order_relaxed);
+    return __libc_malloc(size);
+}
+
+void* calloc(size_t n, size_t size) {
+    g_allocs.fetch_add(1, std::memory_order_relaxed);
+    g_alloc_bytes.fetch_add(n * size, std::memory_order_relaxed);
+    return __libc_calloc(n, size);
+}
+
+void* realloc(void* ptr, size_t size) {
+    g_allocs.fetch_add(1, std::memory_order_relaxed);
+    g_alloc_bytes.fetch_add(size, std::memory_order_relaxed);
+    return __libc_realloc(ptr, size);
+}
+
+void* memalign(size_t alignment, size_t size) {
+    g_allocs.fetch_add(1, std::memory_order_relaxed);
+    g_alloc_bytes.fetch_add(size, std::memory_order_relaxed);
+    return __libc_memalign(alignment, size);
+}
+
+void* aligned_alloc(size_t alignment, size_t size) {
+    return memalign(alignment, size);
+}
+
+int posix_memalign(void** ptr, size_t alignment, size_t size) {
+    void* p = memalign(alignment, size);
+    if (p == NULL) return ENOMEM;
+    *ptr = p;
+    return 0;
+}
+}
+#endif
+
+/* Resets the peak RSS of the process (Linux >= 4.0), returns false when the kernel does not support it */
+static bool reset_peak_rss() {
+    std::ofstream f("/proc/self/clear_refs");
+    if (!f) return false;
+    f << "5";
+    f.close();
+    return !f.fail();
+}
+
+static long peak_rss_kb() {
+    std::ifstream f("/proc/self/status");
+    std::string line;
+    while (std::getline(f, line)) {
+        if (line.compare(0, 6, "VmHWM:") == 0) return atol(line.c_str() + 6);
+    }
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+}
+
+struct BenchResult {
+    std::string kernel;
+    std::string backend;
+    int width, height, npc;
+    int iterations;
+    double seconds;
+    unsigned long long allocs, alloc_bytes;
+    long peak_rss_kb;
+};
+
+struct BenchFrame {
+    int rows, cols;
+    std::vector<unsigned char> pixels;
+};
+
+/* Mid-torso slice of the synthetic CT phantom, in the soft tissue window */
+static BenchFrame make_frame(int rows, int cols) {
+    BenchFrame f;
+    f.rows = rows;
+    f.cols = cols;
+    f.pixels.resize((size_t)rows * cols);
+    medimg::Phantom phantom(medimg::PhantomParams(cols, rows, 1));
+    phantom.sliceWindowed(0, f.pixels.data());
+    return f;
+}
+
+/* Runs setup once, then times iterations of run, and collects allocation and RSS figures for both */
+static BenchResult measure(const std::string& kernel,
+                           const std::string& backend,
+                           const BenchFrame& frame,
+                           int npc,
+                           int iterations,
+                           const std::function<void()>& run) {
+    BenchResult r;
+    r.kernel = kernel;
+    r.backend = backend;
+    r.width = frame.cols;
+    r.height = frame.rows;
+    r.npc = npc;
+    r.iterations = iterations;
+
+    malloc_trim(0);
+    reset_peak_rss();
+    unsigned long long allocs = g_allocs.load(), bytes = g_alloc_bytes.load();
+
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; i++) run();
+    auto end = std::chrono::steady_clock::now();
+
+    r.seconds = std::chrono::duration<double>(end - start).count();
+    r.allocs = (g_allocs.load() - allocs) / iterations;
+    r.alloc_bytes = (g_alloc_bytes.load() - bytes) / iterations;
+    r.peak_rss_kb = peak_rss_kb();
+    return r;
+}
+
+template <int NPC>
+static void bench_csim(const BenchFrame& frame, int iterations, const std::string& filter, std::vector<BenchResult>& out) {
+    typedef xf::cv::Mat<XF_8UC1, BENCH_HEIGHT, BENCH_WIDTH, NPC> mat_t;
+    const int rows = frame.rows, cols = frame.cols;
+    const int ptr_words = (rows * cols * 8 + BENCH_PTR_WIDTH - 1) / BENCH_PTR_WIDTH;
+    unsigned char* src = const_cast<unsigned char*>(frame.pixels.data());
+
+    unsigned char shape[3 * 3];
+    for (int i = 0; i < 9; i++) shape[i] = (i == 1 || i == 3 || i == 4 || i == 5 || i == 7) ? 1 : 0;
+
+    std::vector<std::pair<std::string, std::function<void()> > > runs;
+    runs.push_back(std::make_pair("Threshold", std::function<void()>([&] {
+        mat_t in(rows, cols), dst(rows, cols);
+        in.copyTo(src);
+        xf::cv::Threshold<XF_THRESHOLD_TYPE_BINARY, XF_8UC1, BENCH_HEIGHT, BENCH_WIDTH, NPC>(in, dst, BENCH_THRESH,
+                                                                                           BENCH_MAXVAL);
+    })));
+    runs.push_back(std::make_pair("dilate", std::function<void()>([&] {
+        mat_t in(rows, cols), dst(rows, cols);
+        in.copyTo(src);
+        xf::cv::dilate<XF_BORDER_CONSTANT, XF_8UC1, BENCH_HEIGHT, BENCH_WIDTH, XF_SHAPE_CROSS, 3, 3, 1, NPC>(in, dst,
+                                                                                                           shape);
+    })));
+    runs.push_back(std::make_pair("erode", std::function<void()>([&] {
+        mat_t in(rows, cols), dst(rows, cols);
+        in.copyTo(src);
+        xf::cv::erode<XF_BORDER_CONSTANT, XF_8UC1, BENCH_HEIGHT, BENCH_WIDTH, XF_SHAPE_CROSS, 3, 3, 1, NPC>(in, dst,
+                                                                                                          shape);
+    })));
+    runs.push_back(std::make_pair("Array2xfMat", std::function<void()>([&] {
+        std::vector<ap_uint<BENCH_PTR_WIDTH> > ptr(ptr_words);
+        mat_t dst(rows, cols);
+        xf::cv::Array2xfMat<BENCH_PTR_WIDTH, XF_8UC1, BENCH_HEIGHT, BENCH_WIDTH, NPC>(ptr.data(), dst);
+    })));
+    runs.push_back(std::make_pair("xfMat2Array", std::function<void()>([&] {
+        std::vector<ap_uint<BENCH_PTR_WIDTH> > ptr(ptr_words);
+        mat_t in(rows, cols);
+        in.copyTo(src);
+        xf::cv::xfMat2Array<BENCH_PTR_WIDTH, XF_8UC1, BENCH_HEIGHT, BENCH_WIDTH, NPC>(in, ptr.data());
+    })));
+    runs.push_back(std::make_pair("calcHist", std::function<void()>([&] {
+        uint32_t hist[256];
+        mat_t in(rows, cols);
+        in.copyTo(src);
+        xf::cv::calcHist<XF_8UC1, BENCH_HEIGHT, BENCH_WIDTH, NPC>(in, hist);
+    })));
+    runs.push_back(std::make_pair("OtsuThreshold", std::function<void()>([&] {
+        uint8_t thresh;
+        mat_t in(rows, cols);
+        in.copyTo(src);
+        xf::cv::OtsuThreshold<XF_8UC1, BENCH_HEIGHT, BENCH_WIDTH, NPC>(in, thresh);
+    })));
+    // equalizeHist reads the frame twice, so it is loaded twice as from DDR
+    runs.push_back(std::make_pair("equalizeHist", std::function<void()>([&] {
+        mat_t in(rows, cols), in1(rows, cols), dst(rows, cols);
+        in.copyTo(src);
+        in1.copyTo(src);
+        xf::cv::equalizeHist<XF_8UC1, BENCH_HEIGHT, BENCH_WIDTH, NPC>(in, in1, dst);
+    })));
+    uint32_t series_hist[256] = {0};
+    runs.push_back(std::make_pair("equalizeHistTemporal", std::function<void()>([&] {
+        mat_t in(rows, cols), dst(rows, cols);
+        in.copyTo(src);
+        xf::cv::equalizeHistTemporal<XF_8UC1, BENCH_HEIGHT, BENCH_WIDTH, NPC>(in, dst, series_hist);
+    })));
+    runs.push_back(std::make_pair("medianBlur", std::function<void()>([&] {
+        mat_t in(rows, cols), dst(rows, cols);
+        in.copyTo(src);
+        xf::cv::medianBlur<3, XF_BORDER_REPLICATE, XF_8UC1, BENCH_HEIGHT, BENCH_WIDTH, NPC>(in, dst);
+    })));
+    runs.push_back(std::make_pair("GaussianBlur", std::function<void()>([&] {
+        mat_t in(rows, cols), dst(rows, cols);
+        in.copyTo(src);
+        xf::cv::GaussianBlur<XF_FILTER_3X3, XF_BORDER_CONSTANT, XF_8UC1, BENCH_HEIGHT, BENCH_WIDTH, NPC>(in, dst,
+                                                                                                       0.8f);
+    })));
+
+    for (size_t i = 0; i < runs.size(); i++) {
+        if (!filter.empty() && runs[i].first != filter) continue;
+        out.push_back(measure(runs[i].first, "csim", frame, NPC, iterations, runs[i].second));
+        std::cerr << "  csim " << runs[i].first << " NPPC" << NPC << " done" << std::endl;
+    }
+}
+
+#ifndef MEDIMG_BENCH_NO_OPENCV
+static void bench_cpu(const BenchFrame& frame, int iterations, const std::string& filter, std::vector<BenchResult>& out) {
+    cv::Mat src(frame.rows, frame.cols, CV_8UC1, const_cast<unsigned char*>(frame.pixels.data()));
+    cv::Mat element = cv::getStructuringElement(cv::MORPH_CROSS, cv::Size(3, 3), cv::Point(-1, -1));
+
+    std::vector<std::pair<std::string, std::function<void()> > > runs;
+    runs.push_back(std::make_pair("Threshold", std::function<void()>([&] {
+        cv::Mat dst;
+        cv::threshold(src, dst, BENCH_THRESH, BENCH_MAXVAL, cv::THRESH_BINARY);
+    })));
+    runs.push_back(std::make_pair("dilate", std::function<void()>([&] {
+        cv::Mat dst;
+        cv::dilate(src, dst, element, cv::Point(-1, -1), 1, cv::BORDER_CONSTANT, 0);
+    })));
+    runs.push_back(std::make_pair("erode", std::function<void()>([&] {
+        cv::Mat dst;
+        cv::erode(src, dst, element, cv::Point(-1, -1), 1, cv::BORDER_CONSTANT, 0);
+    })));
+    // The CPU backend has no AXI packing, a plain frame copy is the equivalent work
+    runs.push_back(std::make_pair("Array2xfMat", std::function<void()>([&] {
+        cv::Mat dst;
+        src.copyTo(dst);
+    })));
+    runs.push_back(std::make_pair("xfMat2Array", std::function<void()>([&] {
+        cv::Mat dst;
+        src.copyTo(dst);
+    })));
+    runs.push_back(std::make_pair("calcHist", std::function<void()>([&] {
+        cv::Mat hist;
+        int channels[] = {0}, hist_size[] = {256};
+        float range[] = {0, 256};
+        const float* ranges[] = {range};
+        cv::calcHist(&src, 1, channels, cv::Mat(), hist, 1, hist_size, ranges);
+    })));
+    runs.push_back(std::make_pair("OtsuThreshold", std::function<void()>([&] {
+        cv::Mat dst;
+        cv::threshold(src, dst, 0, BENCH_MAXVAL, cv::THRESH_BINARY | cv::THRESH_OTSU);
+    })));
+    runs.push_back(std::make_pair("equalizeHist", std::function<void()>([&] {
+        cv::Mat dst;
+        cv::equalizeHist(src, dst);
+    })));
+    // The previous slice's lookup table applied, then this slice's histogram taken for the next one
+    cv::Mat series_lut(1, 256, CV_8UC1);
+    for (int i = 0; i < 256; i++) series_lut.data[i] = i;
+    runs.push_back(std::make_pair("equalizeHistTemporal", std::function<void()>([&] {
+        cv::Mat dst, hist;
+        int channels[] = {0}, hist_size[] = {256};
+        float range[] = {0, 256};
+        const float* ranges[] = {range};
+        cv::LUT(src, series_lut, dst);
+        cv::calcHist(&src, 1, channels, cv::Mat(), hist, 1, hist_size, ranges);
+    })));
+    runs.push_back(std::make_pair("medianBlur", std::function<void()>([&] {
+        cv::Mat dst;
+        cv::medianBlur(src, dst, 3);
+    })));
+    runs.push_back(std::make_pair("GaussianBlur", std::function<void()>([&] {
+        cv::Mat dst;
+        cv::GaussianBlur(src, dst, cv::Size(3, 3), 0.8, 0.8, cv::BORDER_CONSTANT);
+    })));
+
+    for (size_t i = 0; i < runs.size(); i++) {
+        if (!filter.empty() && runs[i].first != filter) continue;
+        out.push_back(measure(runs[i].first, "cpu", frame, 0, iterations, runs[i].second));
+    }
+}
+#endif
+
+static void write_json(std::ostream& os, const std::vector<BenchResult>& results, int iterations) {
+    os << "{\n  \"schema\": \"medimg-l1-bench/1\",\n  \"iterations\": " << iterations << ",\n  \"results\": [";
+    for (size_t i = 0; i < results.size(); i++) {
+        const BenchResult& r = results[i];
+        double pixels = (double)r.width * r.height * r.iterations;
+        os << (i ? ",\n" : "\n") << "    {\"kernel\": \"" << r.kernel << "\", \"backend\": \"" << r.backend
+           << "\", \"width\": " << r.width << ", \"height\": " << r.height << ", \"npc\": " << r.npc
+           << ", \"seconds\": " << r.seconds << ", \"pixels_per_sec\": " << (r.seconds > 0 ? pixels / r.seconds : 0)
+           << ", \"allocs_per_iter\": " << r.allocs << ", \"alloc_bytes_per_iter\": " << r.alloc_bytes
+           << ", \"peak_rss_kb\": " << r.peak_rss_kb << "}";
+    }
+    os << "\n  ]\n}\n";
+}
+
+int main(int argc, char** argv) {
+    int iterations = 1;
+    std::string filter, resolution, out_path;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "-i") && i + 1 < argc) {
+            iterations = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "-k") && i + 1 < argc) {
+            filter = argv[++i];
+        } else if (!strcmp(argv[i], "-r") && i + 1 < argc) {
+            resolution = argv[++i];
+        } else if (!strcmp(argv[i], "-o") && i + 1 < argc) {
+            out_path = argv[++i];
+        } else {
+            iterations = 0;
+            break;
+        }
+    }
+    if (iterations <= 0) {
+        fprintf(stderr, "Invalid arguments\nUsage:\n<Executable Name> [-i iterations] [-k kernel] [-r WIDTHxHEIGHT] [-o results.json]\n");
+        return -1;
+    }
+
+    const int sizes[][2] = {{512, 512}, {1080, 1920}, {BENCH_HEIGHT, BENCH_WIDTH}};
+    std::vector<BenchResult> results;
+    for (int s = 0; s < 3; s++) {
+        std::stringstream name;
+        name << sizes[s][1] << "x" << sizes[s][0];
+        if (!resolution.empty() && name.str() != resolution) continue;
+
+        BenchFrame frame = make_frame(sizes[s][0], sizes[s][1]);
+        std::cerr << "Frame " << frame.cols << "x" << frame.rows << std::endl;
+#ifndef MEDIMG_BENCH_NO_OPENCV
+        bench_cpu(frame, iterations, filter, results);
+#endif
+        bench_csim<XF_NPPC1>(frame, iterations, filter, results);
+        bench_csim<XF_NPPC8>(frame, iterations, filter, results);
+    }
+
+    if (out_path.empty()) {
+        write_json(std::cout, results, iterations);
+    } else {
+        std::ofstream f(out_path.c_str());
+        write_json(f, results, iterations);
+        if (!f) {
+            fprintf(stderr, "Cannot write results to %s\n", out_path.c_str());
+            return -1;
+        }
+    }
+    return 0;
+}
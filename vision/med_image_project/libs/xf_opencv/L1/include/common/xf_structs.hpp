@@ -23,6 +23,12 @@
 
 #ifndef __SYNTHESIS__
 #include <iostream>
+#include "xf_mat_pool.hpp"
+#ifdef XF_SIM_DATAFLOW_THREADS
+#include "xf_sim_dataflow.hpp"
+#elif defined(XF_SIM_SPSC_STREAM)
+#include "xf_sim_stream.hpp"
+#endif
 #endif
 #include "ap_axi_sdata.h"
 #include "hls_stream.h"
@@ -30,6 +36,7 @@
 #include <assert.h>
 #include <math.h>
 #include <stdio.h>
+#include <string.h>
 #include <type_traits>
 
 namespace xf {
@@ -436,6 +443,9 @@ class Mat {
    public:
     unsigned char allocatedFlag; // flag to mark memory allocation in this class
     int rows, cols, size;        // actual image size
+#ifndef __SYNTHESIS__
+    MatPool* pool; // pool the data was allocated from, NULL when malloc-ed
+#endif
     //	int cols_align_npc;						// cols
     // multiple
     // of
@@ -457,18 +467,35 @@ class Mat {
     Mat(int _rows, int _cols);
     Mat(int _size, int _rows, int _cols);
     Mat(int _rows, int _cols, void* _data);
-    Mat(const Mat&); // copy constructor
+#ifdef XF_MAT_EXPLICIT_COPY
+    // Frames can only be duplicated through clone(), copies by value do not compile
+    Mat(const Mat&) = delete;
+    Mat& operator=(const Mat&) = delete;
+#else
+    Mat(const Mat&);            // copy constructor
+    Mat& operator=(const Mat&); // Assignment operator
+#endif
+#ifndef __SYNTHESIS__
+    Mat(Mat&&);            // move constructor, takes over the buffer of the source
+    Mat& operator=(Mat&&); // move assignment
+#endif
 
     ~Mat();
 
-    Mat& operator=(const Mat&); // Assignment operator
+    Mat clone() const; // deep copy
     //  XF_TNAME(T, XF_NPPC1) operator() (unsigned int r, unsigned int c);
     //  XF_CTUNAME(T, NPC) operator() (unsigned int r, unsigned int c, unsigned
     //  int ch);
     template <int D = XFCVDEPTH, typename std::enable_if<(D < 0)>::type* = nullptr>
     void alloc_data() {
 #ifndef __SYNTHESIS__
-        data = (DATATYPE*)malloc(size * sizeof(DATATYPE));
+        pool = MatPool::active();
+        if (pool != NULL) {
+            data = (DATATYPE*)pool->allocate(size * sizeof(DATATYPE));
+        } else {
+            MatPool::unpooledAllocs()++;
+            data = (DATATYPE*)malloc(size * sizeof(DATATYPE));
+        }
 
         if (data == NULL) {
             fprintf(stderr, "\nFailed to allocate memory\n");
@@ -487,7 +514,11 @@ class Mat {
     void free_data() {
         if (data != NULL) {
 #ifndef __SYNTHESIS__
-            free(data);
+            if (pool != NULL) {
+                pool->deallocate(data, size * sizeof(DATATYPE));
+            } else {
+                free(data);
+            }
 #endif
         }
     }
@@ -508,6 +539,24 @@ class Mat {
         assert(0);
     }
 
+#ifndef __SYNTHESIS__
+    template <int D = XFCVDEPTH, typename std::enable_if<(D < 0)>::type* = nullptr>
+    void moveData(Mat& src) {
+        data = src.data;
+        allocatedFlag = src.allocatedFlag;
+        pool = src.pool;
+        src.data = NULL;
+        src.allocatedFlag = 0;
+        src.pool = NULL;
+    }
+
+    template <int D = XFCVDEPTH, typename std::enable_if<(D >= 0)>::type* = nullptr>
+    void moveData(Mat& src) {
+        // This is a stream, moving one is rejected when it is compiled rather than when it runs
+        static_assert(D < 0, "Only memory mapped Mats (XFCVDEPTH < 0) can be moved");
+    }
+#endif
+
     template <int D = XFCVDEPTH, typename std::enable_if<(D < 0)>::type* = nullptr>
     void assignDataPtr(void* _data) {
         data = (DATATYPE*)_data;
@@ -556,8 +605,82 @@ class Mat {
     }
 
     void init(int _rows, int _cols, bool allocate = true);
+
+    /* Host buffers hold pixels interleaved and densely packed, XF_PTSNAME(T, NPC) per channel. copyTo() packs
+     * such a buffer into the Mat, copyFrom() unpacks the Mat into it. Both pick the cheapest path the bit
+     * layout allows and fall back to the per channel copies below. */
     void copyTo(void* fromData);
-    unsigned char* copyFrom();
+    void copyFrom(void* toData);
+    unsigned char* copyFrom(); // Allocates the host buffer with malloc, the caller has to free() it
+    void copyToPerChannel(void* fromData);
+    void copyFromPerChannel(void* toData);
+
+    /* True when every channel of every pixel starts on a byte boundary and fits into 64 bits */
+    static constexpr bool isBytePacked() {
+        return ((XF_PIXELWIDTH(T, NPC) / XF_CHANNELS(T, NPC)) % 8 == 0) && (XF_PIXELWIDTH(T, NPC) <= 64) &&
+               (sizeof(XF_PTSNAME(T, NPC)) * 8 == (XF_PIXELWIDTH(T, NPC) / XF_CHANNELS(T, NPC)));
+    }
+
+    /* True when the in-memory image of DATATYPE equals the packed host layout, so whole frames can be
+     * memcpy-ed. Holds for e.g. XF_8UC1 at any NPC, not for XF_8UC3 where ap_uint<24> occupies 4 bytes */
+    static constexpr bool isMemcpyCompatible() {
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__)
+        return isBytePacked() && (XFCVDEPTH < 0) &&
+               (sizeof(DATATYPE) * 8 == XF_PIXELWIDTH(T, NPC) * XF_NPIXPERCYCLE(NPC));
+#else
+        return false;
+#endif
+    }
+
+    template <int D = XFCVDEPTH, typename std::enable_if<(D < 0)>::type* = nullptr>
+    void copyToMemcpy(void* fromData) {
+#ifndef __SYNTHESIS__
+        int nppc = XF_NPIXPERCYCLE(NPC);
+        int words = (cols + nppc - 1) >> XF_BITSHIFT(NPC);
+        size_t row_bytes = (size_t)cols * (XF_PIXELWIDTH(T, NPC) / 8);
+        size_t word_row_bytes = (size_t)words * sizeof(DATATYPE);
+
+        if (row_bytes == word_row_bytes) {
+            memcpy((void*)data, fromData, row_bytes * rows);
+            return;
+        }
+        for (int r = 0; r < rows; r++) {
+            unsigned char* dst = (unsigned char*)data + r * word_row_bytes;
+            memcpy(dst, (unsigned char*)fromData + r * row_bytes, row_bytes);
+            memset(dst + row_bytes, 0, word_row_bytes - row_bytes);
+        }
+#endif
+    }
+
+    template <int D = XFCVDEPTH, typename std::enable_if<(D >= 0)>::type* = nullptr>
+    void copyToMemcpy(void* fromData) {
+        // This is a stream
+        assert(0);
+    }
+
+    template <int D = XFCVDEPTH, typename std::enable_if<(D < 0)>::type* = nullptr>
+    void copyFromMemcpy(void* toData) {
+#ifndef __SYNTHESIS__
+        int nppc = XF_NPIXPERCYCLE(NPC);
+        int words = (cols + nppc - 1) >> XF_BITSHIFT(NPC);
+        size_t row_bytes = (size_t)cols * (XF_PIXELWIDTH(T, NPC) / 8);
+        size_t word_row_bytes = (size_t)words * sizeof(DATATYPE);
+
+        if (row_bytes == word_row_bytes) {
+            memcpy(toData, (const void*)data, row_bytes * rows);
+            return;
+        }
+        for (int r = 0; r < rows; r++) {
+            memcpy((unsigned char*)toData + r * row_bytes, (unsigned char*)data + r * word_row_bytes, row_bytes);
+        }
+#endif
+    }
+
+    template <int D = XFCVDEPTH, typename std::enable_if<(D >= 0)>::type* = nullptr>
+    void copyFromMemcpy(void* toData) {
+        // This is a stream
+        assert(0);
+    }
 
     const int type() const;
     const int depth() const;
@@ -603,12 +726,17 @@ inline void Mat<T, ROWS, COLS, NPPC, XFCVDEPTH>::init(int _rows, int _cols, bool
     rows = _rows;
     cols = _cols;
     size = _rows * ((_cols + NPPC - 1) >> XF_BITSHIFT(NPPC));
+    allocatedFlag = 0;
+#ifndef __SYNTHESIS__
+    pool = NULL;
+#endif
 
     if (allocate) {
         alloc_data();
     }
 }
 
+#ifndef XF_MAT_EXPLICIT_COPY
 /*Copy constructor definition*/
 template <int T, int ROWS, int COLS, int NPC, int XFCVDEPTH>
 inline Mat<T, ROWS, COLS, NPC, XFCVDEPTH>::Mat(const Mat& src) {
@@ -627,7 +755,9 @@ inline Mat<T, ROWS, COLS, NPC, XFCVDEPTH>& Mat<T, ROWS, COLS, NPC, XFCVDEPTH>::o
     }
 
     // Cleaning up old data memory if any
-    free_data();
+    if (allocatedFlag == 1) {
+        free_data();
+    }
     allocatedFlag = 0;
 
     init(src.rows, src.cols);
@@ -635,6 +765,40 @@ inline Mat<T, ROWS, COLS, NPC, XFCVDEPTH>& Mat<T, ROWS, COLS, NPC, XFCVDEPTH>::o
 
     return *this;
 }
+#endif
+
+#ifndef __SYNTHESIS__
+/*Move constructor definition*/
+template <int T, int ROWS, int COLS, int NPC, int XFCVDEPTH>
+inline Mat<T, ROWS, COLS, NPC, XFCVDEPTH>::Mat(Mat&& src) {
+    init(src.rows, src.cols, false);
+    moveData(src);
+}
+
+/*Move assignment operator definition*/
+template <int T, int ROWS, int COLS, int NPC, int XFCVDEPTH>
+inline Mat<T, ROWS, COLS, NPC, XFCVDEPTH>& Mat<T, ROWS, COLS, NPC, XFCVDEPTH>::operator=(Mat&& src) {
+    if (this == &src) {
+        return *this;
+    }
+
+    if (allocatedFlag == 1) {
+        free_data();
+    }
+
+    init(src.rows, src.cols, false);
+    moveData(src);
+
+    return *this;
+}
+#endif
+
+template <int T, int ROWS, int COLS, int NPC, int XFCVDEPTH>
+inline Mat<T, ROWS, COLS, NPC, XFCVDEPTH> Mat<T, ROWS, COLS, NPC, XFCVDEPTH>::clone() const {
+    Mat dst(rows, cols);
+    dst.copyData(*this);
+    return dst;
+}
 
 template <int T, int ROWS, int COLS, int NPPC, int XFCVDEPTH>
 inline Mat<T, ROWS, COLS, NPPC, XFCVDEPTH>::Mat() {
@@ -691,7 +855,7 @@ inline void Mat<T, ROWS, COLS, NPPC, XFCVDEPTH>::write_float(int index, float fl
 }
 
 template <int T, int ROWS, int COLS, int NPPC, int XFCVDEPTH>
-inline void Mat<T, ROWS, COLS, NPPC, XFCVDEPTH>::copyTo(void* _input) {
+inline void Mat<T, ROWS, COLS, NPPC, XFCVDEPTH>::copyToPerChannel(void* _input) {
 // clang-format off
 #pragma HLS inline
     // clang-format on
@@ -706,8 +870,8 @@ inline void Mat<T, ROWS, COLS, NPPC, XFCVDEPTH>::copyTo(void* _input) {
 
     for (int r = 0; r < rows; r++) {
         for (int c = 0; c < packcols; c++) {
+            DATATYPE out_val = 0;
             for (int p = 0; p < nppc; p++) {
-                DATATYPE out_val;
                 for (int ch = 0; ch < XF_CHANNELS(T, NPPC); ch++) {
                     if (T == XF_32FC1) {
                         in_val = float2ap_uint<ap_uint<32> >(
@@ -718,37 +882,83 @@ inline void Mat<T, ROWS, COLS, NPPC, XFCVDEPTH>::copyTo(void* _input) {
 
                     out_val.range((p * pixdepth) + (ch + 1) * bitdepth - 1, (p * pixdepth) + ch * bitdepth) = in_val;
                 }
-                write((r * packcols + c), out_val);
             }
+            write((r * packcols + c), out_val);
         }
     }
 }
 
 template <int T, int ROWS, int COLS, int NPPC, int XFCVDEPTH>
-inline unsigned char* Mat<T, ROWS, COLS, NPPC, XFCVDEPTH>::copyFrom() {
+inline void Mat<T, ROWS, COLS, NPPC, XFCVDEPTH>::copyTo(void* _input) {
+// clang-format off
+#pragma HLS inline
+    // clang-format on
+
+#ifndef __SYNTHESIS__
+    if (isMemcpyCompatible()) {
+        copyToMemcpy(_input);
+        return;
+    }
+
+    if (isBytePacked()) {
+        // Whole words or whole pixels at a time instead of one range assignment per channel
+        const unsigned char* input = (const unsigned char*)_input;
+        const int pixdepth = XF_PIXELWIDTH(T, NPPC);
+        const int pixbytes = pixdepth / 8;
+        const int nppc = XF_NPIXPERCYCLE(NPPC);
+        int words = (cols + nppc - 1) >> XF_BITSHIFT(NPPC);
+
+        for (int r = 0, idx = 0; r < rows; r++) {
+            for (int c = 0; c < words; c++, idx++) {
+                DATATYPE out_val = 0;
+                int npix = ((c + 1) * nppc <= cols) ? nppc : (cols - c * nppc);
+                const unsigned char* src = input + ((size_t)r * cols + c * nppc) * pixbytes;
+                if (pixdepth * nppc <= 64) {
+                    // The whole word fits a native integer, assemble it in one go
+                    unsigned long long word = 0;
+                    memcpy(&word, src, npix * pixbytes);
+                    out_val = word;
+                } else {
+                    for (int p = 0; p < npix; p++) {
+                        unsigned long long pix = 0;
+                        memcpy(&pix, src + p * pixbytes, pixbytes);
+                        out_val.range((p + 1) * pixdepth - 1, p * pixdepth) = pix;
+                    }
+                }
+                write(idx, out_val);
+            }
+        }
+        return;
+    }
+#endif
+
+    copyToPerChannel(_input);
+}
+
+template <int T, int ROWS, int COLS, int NPPC, int XFCVDEPTH>
+inline void Mat<T, ROWS, COLS, NPPC, XFCVDEPTH>::copyFromPerChannel(void* _output) {
 // clang-format off
 #pragma HLS inline
     // clang-format on
 
-    //	int packcols  = cols >> XF_BITSHIFT(NPPC); //Total columns after
-    // considering parallelism
     int pixdepth = XF_PIXELWIDTH(T, NPPC);          // Total bits that make up the pixel
     int bitdepth = pixdepth / XF_CHANNELS(T, NPPC); // Total bits that make up each channel of the pixel
     int nppc = XF_NPIXPERCYCLE(NPPC);
 
     int cv_nbytes = bitdepth / 8;
 
-    unsigned char* value =
-        (unsigned char*)malloc(rows * cols * (XF_CHANNELS(T, NPPC)) * (sizeof(unsigned char)) * cv_nbytes);
+    unsigned char* value = (unsigned char*)_output;
 
     int xf_npc_idx = 0;
-    int diff_ptr = 0;
     int xf_ptr = 0;
     int cv_ptr = 0;
 
+    DATATYPE in_val;
     for (int r = 0; r < rows; r++) {
         for (int c = 0; c < cols; c++) {
-            DATATYPE in_val = read(xf_ptr);
+            if (xf_npc_idx == 0) {
+                in_val = read(xf_ptr);
+            }
             for (int ch = 0; ch < XF_CHANNELS(T, NPPC); ch++) {
                 for (int b = 0; b < cv_nbytes; ++b) {
                     value[cv_ptr++] = in_val.range((xf_npc_idx * pixdepth) + (ch * bitdepth) + (b + 1) * 8 - 1,
@@ -763,6 +973,62 @@ inline unsigned char* Mat<T, ROWS, COLS, NPPC, XFCVDEPTH>::copyFrom() {
             }
         }
     }
+}
+
+template <int T, int ROWS, int COLS, int NPPC, int XFCVDEPTH>
+inline void Mat<T, ROWS, COLS, NPPC, XFCVDEPTH>::copyFrom(void* _output) {
+// clang-format off
+#pragma HLS inline
+    // clang-format on
+
+#ifndef __SYNTHESIS__
+    if (isMemcpyCompatible()) {
+        copyFromMemcpy(_output);
+        return;
+    }
+
+    if (isBytePacked()) {
+        unsigned char* output = (unsigned char*)_output;
+        const int pixdepth = XF_PIXELWIDTH(T, NPPC);
+        const int pixbytes = pixdepth / 8;
+        const int nppc = XF_NPIXPERCYCLE(NPPC);
+        int words = (cols + nppc - 1) >> XF_BITSHIFT(NPPC);
+
+        for (int r = 0, idx = 0; r < rows; r++) {
+            for (int c = 0; c < words; c++, idx++) {
+                DATATYPE in_val = read(idx);
+                int npix = ((c + 1) * nppc <= cols) ? nppc : (cols - c * nppc);
+                unsigned char* dst = output + ((size_t)r * cols + c * nppc) * pixbytes;
+                if (pixdepth * nppc <= 64) {
+                    unsigned long long word = in_val.to_uint64();
+                    memcpy(dst, &word, npix * pixbytes);
+                } else {
+                    for (int p = 0; p < npix; p++) {
+                        unsigned long long pix = in_val.range((p + 1) * pixdepth - 1, p * pixdepth);
+                        memcpy(dst + p * pixbytes, &pix, pixbytes);
+                    }
+                }
+            }
+        }
+        return;
+    }
+#endif
+
+    copyFromPerChannel(_output);
+}
+
+template <int T, int ROWS, int COLS, int NPPC, int XFCVDEPTH>
+inline unsigned char* Mat<T, ROWS, COLS, NPPC, XFCVDEPTH>::copyFrom() {
+// clang-format off
+#pragma HLS inline
+    // clang-format on
+
+    int cv_nbytes = (XF_PIXELWIDTH(T, NPPC) / XF_CHANNELS(T, NPPC)) / 8;
+
+    unsigned char* value =
+        (unsigned char*)malloc(rows * cols * (XF_CHANNELS(T, NPPC)) * (sizeof(unsigned char)) * cv_nbytes);
+
+    copyFrom(value);
 
     return (unsigned char*)value;
 }
@@ -866,6 +1132,100 @@ Mat<SRC_T, ROWS, COLS, NPC, XFCVDEPTH>::~Mat() {
 }
 //----------------------------------------------------------------------------------------------------//
 
+#ifndef __SYNTHESIS__
+//----------------------------------------------------------------------------------------------------//
+// Template class of MatView (host / C-simulation only)
+//
+// Non-owning window into the buffer of a memory mapped Mat or any host buffer with the same packed
+// layout. The view spans rows x cols pixels starting at a word aligned column, consecutive rows are
+// 'stride' words apart. Views never allocate or free; the underlying buffer must outlive them.
+//
+// L1 functions take a Mat. mat() hands them a non-owning Mat on the view's buffer without copying;
+// that needs a continuous view (full width, or a single row). For strided views, copyTo() gathers
+// into a Mat and copyFrom() scatters the result back.
+//----------------------------------------------------------------------------------------------------//
+template <int T, int ROWS, int COLS, int NPC>
+class MatView {
+   public:
+    typedef XF_TNAME(T, NPC) DATATYPE;
+    typedef Mat<T, ROWS, COLS, NPC, -1> MatType;
+
+    DATATYPE* data;  // first word of the view
+    int rows, cols;  // view size in pixels
+    int stride;      // words between the starts of consecutive rows
+
+    MatView() : data(NULL), rows(0), cols(0), stride(0) {}
+
+    /* View on a host buffer, stride_words < 0 means rows are packed back to back */
+    MatView(int _rows, int _cols, void* _data, int stride_words = -1)
+        : data((DATATYPE*)_data), rows(_rows), cols(_cols) {
+        stride = (stride_words < 0) ? words(_cols) : stride_words;
+        assert((stride >= words(_cols)) && "Stride must cover the view width");
+    }
+
+    /* View on a whole Mat */
+    explicit MatView(MatType& mat) : data(mat.data), rows(mat.rows), cols(mat.cols), stride(words(mat.cols)) {}
+
+    /* View on a region of a Mat, roi.x must be a multiple of the pixels per word */
+    MatView(MatType& mat, const Rect_<int>& roi) : rows(roi.height), cols(roi.width), stride(words(mat.cols)) {
+        assert((roi.x >= 0) && (roi.y >= 0) && (roi.x + roi.width <= mat.cols) && (roi.y + roi.height <= mat.rows) &&
+               "ROI must lie inside the Mat");
+        assert(((roi.x & (XF_NPIXPERCYCLE(NPC) - 1)) == 0) && "ROI must start on a word boundary");
+        data = mat.data + roi.y * stride + (roi.x >> XF_BITSHIFT(NPC));
+    }
+
+    /* Sub-view relative to this view */
+    MatView roi(const Rect_<int>& r) const {
+        assert((r.x >= 0) && (r.y >= 0) && (r.x + r.width <= cols) && (r.y + r.height <= rows) &&
+               "ROI must lie inside the view");
+        assert(((r.x & (XF_NPIXPERCYCLE(NPC) - 1)) == 0) && "ROI must start on a word boundary");
+        return MatView(r.height, r.width, data + r.y * stride + (r.x >> XF_BITSHIFT(NPC)), stride);
+    }
+
+    static int words(int _cols) { return (_cols + XF_NPIXPERCYCLE(NPC) - 1) >> XF_BITSHIFT(NPC); }
+
+    bool isContinuous() const { return (rows == 1) || (stride == words(cols)); }
+
+    DATATYPE* ptr(int r) const { return data + r * stride; }
+
+    /* Word at linear packed index, the same indexing Mat::read() uses */
+    DATATYPE read(int index) const {
+        int w = words(cols);
+        return data[(index / w) * stride + (index % w)];
+    }
+
+    void write(int index, DATATYPE val) {
+        int w = words(cols);
+        data[(index / w) * stride + (index % w)] = val;
+    }
+
+    /* Non-owning Mat aliasing the view, for passing a continuous view to L1 functions */
+    MatType mat() const {
+        assert(isContinuous() && "Strided views have to go through copyTo()/copyFrom()");
+        return MatType(rows, cols, (void*)data);
+    }
+
+    /* Gathers the view into dst, which must have the view's size */
+    void copyTo(MatType& dst) const {
+        assert((dst.rows == rows) && (dst.cols == cols) && "Destination must have the size of the view");
+        int w = words(cols);
+        for (int r = 0; r < rows; r++) {
+            memcpy((void*)(dst.data + r * w), (const void*)ptr(r), w * sizeof(DATATYPE));
+        }
+    }
+
+    /* Scatters src, which must have the view's size, into the view */
+    void copyFrom(const MatType& src) {
+        assert((src.rows == rows) && (src.cols == cols) && "Source must have the size of the view");
+        int w = words(cols);
+        for (int r = 0; r < rows; r++) {
+            memcpy((void*)ptr(r), (const void*)(src.data + r * w), w * sizeof(DATATYPE));
+        }
+    }
+};
+//----------------------------------------------------------------------------------------------------//
+#endif
+
 // Template metaprogramming implementation of floor log2 [[
 template <int N>
 struct log2 {
@@ -221,9 +221,9 @@ class accel_utils {
         }
     }
 
-    template <int PTR_WIDTH, int MAT_T, int ROWS, int COLS, int NPC, int TRIPCOUNT>
+    template <int PTR_WIDTH, int MAT_T, int ROWS, int COLS, int NPC, int TRIPCOUNT, int XFCVDEPTH = _XFCVDEPTH_DEFAULT>
     void hlsStrm2xfMat(hls::stream<ap_uint<PTR_WIDTH> >& srcStrm,
-                       xf::cv::Mat<MAT_T, ROWS, COLS, NPC>& dstMat,
+                       xf::cv::Mat<MAT_T, ROWS, COLS, NPC, XFCVDEPTH>& dstMat,
                        int dstMat_cols_align_npc) {
         int rows = dstMat.rows;
         int cols = dstMat.cols;
@@ -295,10 +295,12 @@ class accel_utils {
         int stop = 0;
     }
 
-    template <int PTR_WIDTH, int MAT_T, int ROWS, int COLS, int NPC>
-    void Array2xfMat(ap_uint<PTR_WIDTH>* srcPtr, xf::cv::Mat<MAT_T, ROWS, COLS, NPC>& dstMat, int stride = -1) {
+    template <int PTR_WIDTH, int MAT_T, int ROWS, int COLS, int NPC, int XFCVDEPTH = _XFCVDEPTH_DEFAULT>
+    void Array2xfMat(ap_uint<PTR_WIDTH>* srcPtr,
+                     xf::cv::Mat<MAT_T, ROWS, COLS, NPC, XFCVDEPTH>& dstMat,
+                     int stride = -1) {
 #if !defined(__XF_USE_OLD_IMPL__)
-        MMIterIn<PTR_WIDTH, MAT_T, ROWS, COLS, NPC>::Array2xfMat(srcPtr, dstMat, stride);
+        MMIterIn<PTR_WIDTH, MAT_T, ROWS, COLS, NPC, XFCVDEPTH>::Array2xfMat(srcPtr, dstMat, stride);
 #else
 // clang-format off
         #pragma HLS DATAFLOW
@@ -361,8 +363,8 @@ class accel_utils {
     // Write module(s) to handle data transfer from xfMat to AXI/HLS stream
     // ------------------------------------------------------------------------------
 
-    template <int PTR_WIDTH, int MAT_T, int ROWS, int COLS, int NPC, int TRIPCOUNT>
-    void xfMat2hlsStrm(xf::cv::Mat<MAT_T, ROWS, COLS, NPC>& srcMat,
+    template <int PTR_WIDTH, int MAT_T, int ROWS, int COLS, int NPC, int TRIPCOUNT, int XFCVDEPTH = _XFCVDEPTH_DEFAULT>
+    void xfMat2hlsStrm(xf::cv::Mat<MAT_T, ROWS, COLS, NPC, XFCVDEPTH>& srcMat,
                        hls::stream<ap_uint<PTR_WIDTH> >& dstStrm,
                        int srcMat_cols_align_npc) {
         int rows = srcMat.rows;
@@ -442,10 +444,18 @@ class accel_utils {
         }
     }
 
-    template <int PTR_WIDTH, int MAT_T, int ROWS, int COLS, int NPC, int FILLZERO = 1>
-    void xfMat2Array(xf::cv::Mat<MAT_T, ROWS, COLS, NPC>& srcMat, ap_uint<PTR_WIDTH>* dstPtr, int stride = -1) {
+    template <int PTR_WIDTH,
+              int MAT_T,
+              int ROWS,
+              int COLS,
+              int NPC,
+              int FILLZERO = 1,
+              int XFCVDEPTH = _XFCVDEPTH_DEFAULT>
+    void xfMat2Array(xf::cv::Mat<MAT_T, ROWS, COLS, NPC, XFCVDEPTH>& srcMat,
+                     ap_uint<PTR_WIDTH>* dstPtr,
+                     int stride = -1) {
 #if !defined(__XF_USE_OLD_IMPL__)
-        MMIterOut<PTR_WIDTH, MAT_T, ROWS, COLS, NPC, FILLZERO>::xfMat2Array(srcMat, dstPtr, stride);
+        MMIterOut<PTR_WIDTH, MAT_T, ROWS, COLS, NPC, FILLZERO, XFCVDEPTH>::xfMat2Array(srcMat, dstPtr, stride);
 #else
 // clang-format off
         #pragma HLS DATAFLOW
@@ -510,20 +520,20 @@ class accel_utils {
     }
 };
 
-template <int PTR_WIDTH, int MAT_T, int ROWS, int COLS, int NPC, int FILLZERO = 1>
-void xfMat2Array(xf::cv::Mat<MAT_T, ROWS, COLS, NPC>& srcMat, ap_uint<PTR_WIDTH>* dstPtr, int stride = -1) {
+template <int PTR_WIDTH, int MAT_T, int ROWS, int COLS, int NPC, int FILLZERO = 1, int XFCVDEPTH = _XFCVDEPTH_DEFAULT>
+void xfMat2Array(xf::cv::Mat<MAT_T, ROWS, COLS, NPC, XFCVDEPTH>& srcMat, ap_uint<PTR_WIDTH>* dstPtr, int stride = -1) {
 #if !defined(__XF_USE_OLD_IMPL__)
-    MMIterOut<PTR_WIDTH, MAT_T, ROWS, COLS, NPC, FILLZERO>::xfMat2Array(srcMat, dstPtr, stride);
+    MMIterOut<PTR_WIDTH, MAT_T, ROWS, COLS, NPC, FILLZERO, XFCVDEPTH>::xfMat2Array(srcMat, dstPtr, stride);
 #else
     accel_utils au;
     au.xfMat2Array<PTR_WIDTH, MAT_T, ROWS, COLS, NPC>(srcMat, dstPtr);
 #endif
 }
 
-template <int PTR_WIDTH, int MAT_T, int ROWS, int COLS, int NPC>
-void Array2xfMat(ap_uint<PTR_WIDTH>* srcPtr, xf::cv::Mat<MAT_T, ROWS, COLS, NPC>& dstMat, int stride = -1) {
+template <int PTR_WIDTH, int MAT_T, int ROWS, int COLS, int NPC, int XFCVDEPTH = _XFCVDEPTH_DEFAULT>
+void Array2xfMat(ap_uint<PTR_WIDTH>* srcPtr, xf::cv::Mat<MAT_T, ROWS, COLS, NPC, XFCVDEPTH>& dstMat, int stride = -1) {
 #if !defined(__XF_USE_OLD_IMPL__)
-    MMIterIn<PTR_WIDTH, MAT_T, ROWS, COLS, NPC>::Array2xfMat(srcPtr, dstMat, stride);
+    MMIterIn<PTR_WIDTH, MAT_T, ROWS, COLS, NPC, XFCVDEPTH>::Array2xfMat(srcPtr, dstMat, stride);
 #else
     accel_utils au;
     au.Array2xfMat<PTR_WIDTH, MAT_T, ROWS, COLS, NPC>(srcPtr, dstMat);
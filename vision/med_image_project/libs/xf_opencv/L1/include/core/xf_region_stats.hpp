@@ -0,0 +1,297 @@
+/*
+ * Copyright 2021 Xilinx, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _XF_REGION_STATS_HPP_
+#define _XF_REGION_STATS_HPP_
+
+#ifndef __cplusplus
+#error C++ is needed to include this header
+#endif
+
+#include "ap_int.h"
+#include "common/xf_common.hpp"
+#include "common/xf_utility.hpp"
+
+#ifndef __SYNTHESIS__
+#include <memory>
+#endif
+
+//----------------------------------------------------------------------------------------------------//
+// Per region intensity statistics, meanStdDev and minMaxLoc for every label of a label image at once.
+//
+// The intensity image and its label image (or mask) are read together in raster order, once. Pixels
+// labelled r count into entry r of a table of MAX_REGIONS: number of pixels, sum and sum of squares of
+// the intensities, minimum and maximum with the location of the first pixel in raster order that holds
+// each. Mean and standard deviation follow on the host as sum / count and
+// sqrt(sum_sq / count - mean^2). Labels of MAX_REGIONS and above count into no region; their number is
+// returned. A mask from Threshold with maxval 1 gives the background in entry 0 and the foreground in
+// entry 1, the XF_16UC1 label image of connectedComponentsWithStats one entry per provisional label.
+//
+// Runs of pixels with the same label are accumulated in registers and added to the table when the
+// label changes, so uniform regions cost one table update per run. The table is held BANKS times and
+// the runs go to the banks in turn; as consecutive runs never share a label, an entry is read and
+// written back at most every BANKS clocks and the loop runs at II=1. The banks are merged at the end
+// of the frame. XF_8UC1 or XF_16UC1 intensities and labels at XF_NPPC1; empty regions are all zero.
+//----------------------------------------------------------------------------------------------------//
+
+namespace xf {
+namespace cv {
+
+struct region_stats_t {
+    unsigned int count;
+    unsigned long long sum, sum_sq;
+    unsigned short min, max;
+    unsigned short min_x, min_y, max_x, max_y; // first pixel in raster order holding min and max
+};
+
+template <int SRC_T, int LBL_T, int ROWS, int COLS, int MAX_REGIONS, int BANKS>
+class RegionStats {
+   public:
+    static constexpr int PIXEL_BITS = XF_DTPIXELDEPTH(SRC_T, XF_NPPC1);
+    static constexpr int LABEL_BITS = XF_DTPIXELDEPTH(LBL_T, XF_NPPC1);
+    static constexpr int COUNT_BITS = xf::cv::log2<ROWS * COLS>::cvalue + 1;
+    typedef ap_uint<PIXEL_BITS> pixel_t;
+    typedef ap_uint<LABEL_BITS> label_t;
+    typedef ap_uint<COUNT_BITS> count_t;
+    typedef ap_uint<COUNT_BITS + PIXEL_BITS> sum_t;
+    typedef ap_uint<COUNT_BITS + 2 * PIXEL_BITS> sum_sq_t;
+
+    RegionStats() {
+// clang-format off
+#pragma HLS INLINE
+#pragma HLS ARRAY_PARTITION variable=_count complete dim=1
+#pragma HLS ARRAY_PARTITION variable=_sum complete dim=1
+#pragma HLS ARRAY_PARTITION variable=_sumSq complete dim=1
+#pragma HLS ARRAY_PARTITION variable=_min complete dim=1
+#pragma HLS ARRAY_PARTITION variable=_max complete dim=1
+#pragma HLS ARRAY_PARTITION variable=_minX complete dim=1
+#pragma HLS ARRAY_PARTITION variable=_minY complete dim=1
+#pragma HLS ARRAY_PARTITION variable=_maxX complete dim=1
+#pragma HLS ARRAY_PARTITION variable=_maxY complete dim=1
+        // clang-format on
+    }
+
+    unsigned int process(xf::cv::Mat<SRC_T, ROWS, COLS, XF_NPPC1>& _src,
+                         xf::cv::Mat<LBL_T, ROWS, COLS, XF_NPPC1>& _labels,
+                         region_stats_t* stats) {
+// clang-format off
+#pragma HLS INLINE OFF
+        // clang-format on
+        int rows = _src.rows, cols = _src.cols;
+        int idx = 0;
+        unsigned int outside = 0;
+
+    TABLE_INIT_LOOP:
+        for (int r = 0; r < MAX_REGIONS; r++) {
+// clang-format off
+#pragma HLS PIPELINE II=1
+            // clang-format on
+            for (int b = 0; b < BANKS; b++) {
+// clang-format off
+#pragma HLS UNROLL
+                // clang-format on
+                _count[b][r] = 0;
+            }
+        }
+
+        // The current run, flushed to bank b when a pixel of another region arrives
+        bool run = false;
+        label_t run_label = 0;
+        count_t run_count = 0;
+        sum_t run_sum = 0;
+        sum_sq_t run_sum_sq = 0;
+        pixel_t run_min = 0, run_max = 0;
+        unsigned short run_min_x = 0, run_min_y = 0, run_max_x = 0, run_max_y = 0;
+        int b = 0;
+
+    ROW_LOOP:
+        for (int y = 0; y < rows; y++) {
+// clang-format off
+#pragma HLS LOOP_TRIPCOUNT min=1 max=ROWS
+        // clang-format on
+        COL_LOOP:
+            for (int x = 0; x < cols; x++) {
+// clang-format off
+#pragma HLS LOOP_TRIPCOUNT min=1 max=COLS
+#pragma HLS PIPELINE II=1
+#pragma HLS DEPENDENCE variable=_count inter RAW distance=BANKS true
+#pragma HLS DEPENDENCE variable=_sum inter RAW distance=BANKS true
+#pragma HLS DEPENDENCE variable=_sumSq inter RAW distance=BANKS true
+#pragma HLS DEPENDENCE variable=_min inter RAW distance=BANKS true
+#pragma HLS DEPENDENCE variable=_max inter RAW distance=BANKS true
+                // clang-format on
+                pixel_t p = _src.read(idx);
+                label_t l = _labels.read(idx++);
+                if (l >= MAX_REGIONS) {
+                    outside++;
+                } else if (run && l == run_label) {
+                    run_count++;
+                    run_sum += p;
+                    run_sum_sq += (sum_sq_t)(p * p);
+                    if (p < run_min) {
+                        run_min = p;
+                        run_min_x = x;
+                        run_min_y = y;
+                    }
+                    if (p > run_max) {
+                        run_max = p;
+                        run_max_x = x;
+                        run_max_y = y;
+                    }
+                } else {
+                    if (run) {
+                        flush(b, run_label, run_count, run_sum, run_sum_sq, run_min, run_min_x, run_min_y, run_max,
+                              run_max_x, run_max_y);
+                        b = (b == BANKS - 1) ? 0 : (b + 1);
+                    }
+                    run = true;
+                    run_label = l;
+                    run_count = 1;
+                    run_sum = p;
+                    run_sum_sq = p * p;
+                    run_min = p;
+                    run_max = p;
+                    run_min_x = x;
+                    run_min_y = y;
+                    run_max_x = x;
+                    run_max_y = y;
+                }
+            }
+        }
+        if (run)
+            flush(b, run_label, run_count, run_sum, run_sum_sq, run_min, run_min_x, run_min_y, run_max, run_max_x,
+                  run_max_y);
+
+    MERGE_LOOP:
+        for (int r = 0; r < MAX_REGIONS; r++) {
+// clang-format off
+#pragma HLS PIPELINE II=1
+            // clang-format on
+            region_stats_t s;
+            s.count = 0;
+            s.sum = 0;
+            s.sum_sq = 0;
+            s.min = s.max = 0;
+            s.min_x = s.min_y = s.max_x = s.max_y = 0;
+            for (int k = 0; k < BANKS; k++) {
+// clang-format off
+#pragma HLS UNROLL
+                // clang-format on
+                if (_count[k][r] == 0) continue;
+                const bool first = (s.count == 0);
+                s.count += (unsigned int)_count[k][r];
+                s.sum += _sum[k][r].to_uint64();
+                s.sum_sq += _sumSq[k][r].to_uint64();
+                // On equal values the earlier pixel in raster order wins
+                if (first || _min[k][r] < s.min ||
+                    (_min[k][r] == s.min && before(_minX[k][r], _minY[k][r], s.min_x, s.min_y))) {
+                    s.min = _min[k][r];
+                    s.min_x = _minX[k][r];
+                    s.min_y = _minY[k][r];
+                }
+                if (first || _max[k][r] > s.max ||
+                    (_max[k][r] == s.max && before(_maxX[k][r], _maxY[k][r], s.max_x, s.max_y))) {
+                    s.max = _max[k][r];
+                    s.max_x = _maxX[k][r];
+                    s.max_y = _maxY[k][r];
+                }
+            }
+            stats[r] = s;
+        }
+        return outside;
+    }
+
+   private:
+    count_t _count[BANKS][MAX_REGIONS];
+    sum_t _sum[BANKS][MAX_REGIONS];
+    sum_sq_t _sumSq[BANKS][MAX_REGIONS];
+    pixel_t _min[BANKS][MAX_REGIONS], _max[BANKS][MAX_REGIONS];
+    unsigned short _minX[BANKS][MAX_REGIONS], _minY[BANKS][MAX_REGIONS];
+    unsigned short _maxX[BANKS][MAX_REGIONS], _maxY[BANKS][MAX_REGIONS];
+
+    /* Adds a run to entry l of bank b; runs come in raster order, so only a smaller minimum or a larger
+     * maximum moves a location */
+    void flush(int b,
+               label_t l,
+               count_t count,
+               sum_t sum,
+               sum_sq_t sum_sq,
+               pixel_t min,
+               unsigned short min_x,
+               unsigned short min_y,
+               pixel_t max,
+               unsigned short max_x,
+               unsigned short max_y) {
+// clang-format off
+#pragma HLS INLINE
+        // clang-format on
+        const bool empty = (_count[b][l] == 0);
+        _count[b][l] = _count[b][l] + count;
+        _sum[b][l] = (empty ? sum_t(0) : _sum[b][l]) + sum;
+        _sumSq[b][l] = (empty ? sum_sq_t(0) : _sumSq[b][l]) + sum_sq;
+        if (empty || min < _min[b][l]) {
+            _min[b][l] = min;
+            _minX[b][l] = min_x;
+            _minY[b][l] = min_y;
+        }
+        if (empty || max > _max[b][l]) {
+            _max[b][l] = max;
+            _maxX[b][l] = max_x;
+            _maxY[b][l] = max_y;
+        }
+    }
+
+    static bool before(unsigned short x0, unsigned short y0, unsigned short x1, unsigned short y1) {
+// clang-format off
+#pragma HLS INLINE
+        // clang-format on
+        return (y0 < y1) || (y0 == y1 && x0 < x1);
+    }
+};
+
+// ======================================================================================
+
+/* Fills stats[0 .. MAX_REGIONS - 1] and returns the number of pixels labelled MAX_REGIONS or above */
+template <int SRC_T, int LBL_T, int ROWS, int COLS, int MAX_REGIONS, int BANKS = 2>
+unsigned int regionStats(xf::cv::Mat<SRC_T, ROWS, COLS, XF_NPPC1>& _src,
+                         xf::cv::Mat<LBL_T, ROWS, COLS, XF_NPPC1>& _labels,
+                         region_stats_t* stats) {
+// clang-format off
+#pragma HLS INLINE OFF
+    // clang-format on
+#ifndef __SYNTHESIS__
+    assert(((_src.rows <= ROWS) && (_src.cols <= COLS)) && "ROWS and COLS should be greater than input image");
+    assert(((_labels.rows == _src.rows) && (_labels.cols == _src.cols)) && "Image and label sizes must match");
+    assert(((SRC_T == XF_8UC1) || (SRC_T == XF_16UC1)) && "SRC_T must be XF_8UC1 or XF_16UC1");
+    assert(((LBL_T == XF_8UC1) || (LBL_T == XF_16UC1)) && "LBL_T must be XF_8UC1 or XF_16UC1");
+    assert((COLS <= 65536) && (ROWS <= 65536) && "The locations are 16 bits wide");
+    assert((BANKS >= 2) && "At least two banks are needed");
+#endif
+    typedef RegionStats<SRC_T, LBL_T, ROWS, COLS, MAX_REGIONS, BANKS> table_t;
+#ifndef __SYNTHESIS__
+    // BANKS copies of a table of up to 65536 regions; C-simulation builds them on the heap, one per call
+    std::unique_ptr<table_t> table_mem(new table_t);
+    table_t& table = *table_mem;
+#else
+    table_t table;
+#endif
+    return table.process(_src, _labels, stats);
+}
+
+} // namespace cv
+} // namespace xf
+
+#endif //_XF_REGION_STATS_HPP_
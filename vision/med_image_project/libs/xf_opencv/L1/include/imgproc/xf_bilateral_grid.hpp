@@ -0,0 +1,381 @@
+/*
+ * Copyright 2021 Xilinx, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __XF_BILATERAL_GRID_HPP__
+#define __XF_BILATERAL_GRID_HPP__
+
+#include "ap_int.h"
+#include "common/xf_common.hpp"
+#include "common/xf_structs.hpp"
+#include "common/xf_utility.hpp"
+#ifndef __SYNTHESIS__
+#include <memory>
+#endif
+
+//----------------------------------------------------------------------------------------------------//
+// Edge preserving smoothing on a bilateral grid (Paris and Durand; Chen, Paris and Durand), streaming.
+//
+// Pixels are splatted into a grid of S x S pixel by R grey level cells, S = 1 << SPACE_SHIFT and
+// R = 1 << RANGE_SHIFT, each cell summing the values and the count of its pixels. The grid is blurred
+// with [1 2 1] along x, y and the range axis, and every output pixel is the trilinear interpolation of
+// the blurred sums divided by that of the counts at (x / S, y / S, value / R). Overall this is a
+// bilateral filter with sigma_space of about 0.87 * S and sigma_color of about 0.87 * R, at a cost per
+// pixel that does not depend on either: large spatial sigmas only make the grid coarser.
+//
+// The grid is kept one cell row at a time. While band b of S input rows is splatted, output rows of
+// band b - 3 are sliced from the blurred cell rows b - 3 and b - 2; between bands the finished cell row
+// is blurred along x and range and combined with its two predecessors along y, one cell column per
+// clock. Output lags input by 2.5 * S rows, which a 3 * S x COLS pixel ring covers (USE_URAM to place
+// it in UltraRAM); the cell rows take (COLS / S + 2) x ((1 << IN_BITS) / R + 2) cells each.
+//
+// Values above (1 << IN_BITS) - 1 count as the maximum. XF_8UC1 and XF_16UC1 at XF_NPPC1; all
+// arithmetic is integer, rounded to nearest.
+//----------------------------------------------------------------------------------------------------//
+
+namespace xf {
+namespace cv {
+
+template <int TYPE, int ROWS, int COLS, int SPACE_SHIFT, int RANGE_SHIFT, int IN_BITS, int USE_URAM>
+class BilateralGrid {
+   public:
+    static constexpr int S = 1 << SPACE_SHIFT;
+    static constexpr int HALF = S / 2;
+    static constexpr int R = 1 << RANGE_SHIFT;
+    static constexpr int IN_MAX = (1 << IN_BITS) - 1;
+    static constexpr int GX = (COLS >> SPACE_SHIFT) + 2;
+    static constexpr int GZ = (IN_MAX >> RANGE_SHIFT) + 2;
+    static constexpr int RING = 3 * S;
+    static constexpr int PIXEL_BITS = XF_DTPIXELDEPTH(TYPE, XF_NPPC1);
+    // At most S x S pixels per cell, x64 from the three [1 2 1] passes, x S * S * R from the slicing
+    static constexpr int SPLAT_V_BITS = IN_BITS + 2 * SPACE_SHIFT;
+    static constexpr int SPLAT_W_BITS = 2 * SPACE_SHIFT + 1;
+    static constexpr int GRID_V_BITS = SPLAT_V_BITS + 6;
+    static constexpr int GRID_W_BITS = SPLAT_W_BITS + 6;
+    static constexpr int SLICE_V_BITS = GRID_V_BITS + 2 * SPACE_SHIFT + RANGE_SHIFT;
+    static constexpr int SLICE_W_BITS = GRID_W_BITS + 2 * SPACE_SHIFT + RANGE_SHIFT;
+    typedef ap_uint<PIXEL_BITS> pixel_t;
+    typedef ap_uint<SPLAT_V_BITS> splat_v_t;
+    typedef ap_uint<SPLAT_W_BITS> splat_w_t;
+    typedef ap_uint<GRID_V_BITS> grid_v_t;
+    typedef ap_uint<GRID_W_BITS> grid_w_t;
+    typedef ap_uint<SLICE_V_BITS> slice_v_t;
+    typedef ap_uint<SLICE_W_BITS> slice_w_t;
+
+    BilateralGrid() {
+// clang-format off
+#pragma HLS INLINE
+#pragma HLS ARRAY_PARTITION variable=_splat_v complete dim=1
+#pragma HLS ARRAY_PARTITION variable=_splat_w complete dim=1
+#pragma HLS ARRAY_PARTITION variable=_xz_v complete dim=1
+#pragma HLS ARRAY_PARTITION variable=_xz_v complete dim=2
+#pragma HLS ARRAY_PARTITION variable=_xz_w complete dim=1
+#pragma HLS ARRAY_PARTITION variable=_xz_w complete dim=2
+#pragma HLS ARRAY_PARTITION variable=_grid_v complete dim=1
+#pragma HLS ARRAY_PARTITION variable=_grid_v complete dim=2
+#pragma HLS ARRAY_PARTITION variable=_grid_w complete dim=1
+#pragma HLS ARRAY_PARTITION variable=_grid_w complete dim=2
+        // clang-format on
+        if (USE_URAM) {
+// clang-format off
+#pragma HLS RESOURCE variable=_ring core=RAM_S2P_URAM
+            // clang-format on
+        }
+    }
+
+    template <int XFCVDEPTH_IN, int XFCVDEPTH_OUT>
+    void process(xf::cv::Mat<TYPE, ROWS, COLS, XF_NPPC1, XFCVDEPTH_IN>& _src,
+                 xf::cv::Mat<TYPE, ROWS, COLS, XF_NPPC1, XFCVDEPTH_OUT>& _dst) {
+// clang-format off
+#pragma HLS INLINE OFF
+        // clang-format on
+        const int rows = _src.rows, cols = _src.cols;
+        const int gx_n = ((cols - 1) >> SPACE_SHIFT) + 2;
+        const int gy_n = ((rows - 1) >> SPACE_SHIFT) + 2;
+        int idx_in = 0, idx_out = 0;
+        int slot_in = 0, slot_out = 0;
+        int s_cur = 0, s_prev1 = 2, s_prev2 = 1; // slots of cell rows b, b - 1 and b - 2, modulo 3
+
+        splat_v_t acc_v[GZ];
+        splat_w_t acc_w[GZ];
+// clang-format off
+#pragma HLS ARRAY_PARTITION variable=acc_v complete dim=1
+#pragma HLS ARRAY_PARTITION variable=acc_w complete dim=1
+        // clang-format on
+
+    SPLAT_INIT_LOOP:
+        for (int gx = 0; gx < gx_n; gx++) {
+// clang-format off
+#pragma HLS LOOP_TRIPCOUNT min=1 max=GX
+#pragma HLS PIPELINE II=1
+            // clang-format on
+            for (int z = 0; z < GZ; z++) {
+// clang-format off
+#pragma HLS UNROLL
+                // clang-format on
+                _splat_v[z][gx] = 0;
+                _splat_w[z][gx] = 0;
+                acc_v[z] = 0;
+                acc_w[z] = 0;
+            }
+        }
+
+    // Band b splats input rows b * S - S / 2 .. b * S + S / 2 - 1 into cell row b and slices the output
+    // rows of band b - 3 from the blurred cell rows b - 3 (slot s_cur) and b - 2 (slot s_prev2)
+    BAND_LOOP:
+        for (int b = 0; b < gy_n + 2; b++) {
+// clang-format off
+#pragma HLS LOOP_TRIPCOUNT min=1 max=(ROWS>>SPACE_SHIFT)+4
+            // clang-format on
+        ROW_LOOP:
+            for (int t = 0; t < S; t++) {
+// clang-format off
+#pragma HLS LOOP_TRIPCOUNT min=S max=S
+                // clang-format on
+                const int y_in = b * S - HALF + t;
+                const int y_out = (b - 3) * S + t;
+                const bool read = (y_in >= 0) && (y_in < rows);
+                const bool write = (y_out >= 0) && (y_out < rows);
+                if (!read && !write) continue;
+                const int fy = t; // y_out & (S - 1)
+
+            COL_LOOP:
+                for (int x = 0; x < cols; x++) {
+// clang-format off
+#pragma HLS LOOP_TRIPCOUNT min=1 max=COLS
+#pragma HLS PIPELINE II=1
+#pragma HLS DEPENDENCE variable=_ring inter false
+#pragma HLS DEPENDENCE variable=_splat_v inter false
+#pragma HLS DEPENDENCE variable=_splat_w inter false
+                    // clang-format on
+                    if (read) {
+                        pixel_t p = clamp(pixel_t(_src.read(idx_in++)));
+                        _ring[slot_in][x] = p;
+                        // Nearest cell; the register vector is flushed when the next pixel leaves it
+                        const int gx = (x + HALF) >> SPACE_SHIFT;
+                        const int gz = (int(p) + R / 2) >> RANGE_SHIFT;
+                        const bool flush = (((x + HALF + 1) & (S - 1)) == 0) || (x == cols - 1);
+                        for (int z = 0; z < GZ; z++) {
+// clang-format off
+#pragma HLS UNROLL
+                            // clang-format on
+                            splat_v_t v = acc_v[z] + ((z == gz) ? splat_v_t(p) : splat_v_t(0));
+                            splat_w_t w = acc_w[z] + ((z == gz) ? 1 : 0);
+                            if (flush) {
+                                _splat_v[z][gx] = _splat_v[z][gx] + v;
+                                _splat_w[z][gx] = _splat_w[z][gx] + w;
+                                v = 0;
+                                w = 0;
+                            }
+                            acc_v[z] = v;
+                            acc_w[z] = w;
+                        }
+                    }
+                    if (write) {
+                        pixel_t q = _ring[slot_out][x];
+                        _dst.write(idx_out++, slice(q, x, fy, s_cur, s_prev2));
+                    }
+                }
+                if (read) slot_in = (slot_in == RING - 1) ? 0 : (slot_in + 1);
+                if (write) slot_out = (slot_out == RING - 1) ? 0 : (slot_out + 1);
+            }
+
+            blurRow(b, gx_n, s_cur, s_prev1, s_prev2);
+
+            int s_next = s_prev2;
+            s_prev2 = s_prev1;
+            s_prev1 = s_cur;
+            s_cur = s_next;
+        }
+    }
+
+   private:
+    splat_v_t _splat_v[GZ][GX];
+    splat_w_t _splat_w[GZ][GX];
+    grid_v_t _xz_v[3][GZ][GX]; // [1 2 1] along x and range, by cell row modulo 3
+    grid_w_t _xz_w[3][GZ][GX];
+    grid_v_t _grid_v[3][GZ][GX]; // and along y
+    grid_w_t _grid_w[3][GZ][GX];
+    pixel_t _ring[RING][COLS];
+
+    /* Blurs the finished cell row b along x and range into _xz, then cell row b - 1 along y into _grid,
+     * and clears the splat row; cells outside the grid count as empty */
+    void blurRow(int b, int gx_n, int s_cur, int s_prev1, int s_prev2) {
+// clang-format off
+#pragma HLS INLINE
+        // clang-format on
+        grid_v_t lv[GZ], mv[GZ], rv[GZ];
+        grid_w_t lw[GZ], mw[GZ], rw[GZ];
+// clang-format off
+#pragma HLS ARRAY_PARTITION variable=lv complete dim=1
+#pragma HLS ARRAY_PARTITION variable=mv complete dim=1
+#pragma HLS ARRAY_PARTITION variable=rv complete dim=1
+#pragma HLS ARRAY_PARTITION variable=lw complete dim=1
+#pragma HLS ARRAY_PARTITION variable=mw complete dim=1
+#pragma HLS ARRAY_PARTITION variable=rw complete dim=1
+        // clang-format on
+        for (int z = 0; z < GZ; z++) {
+// clang-format off
+#pragma HLS UNROLL
+            // clang-format on
+            mv[z] = 0;
+            mw[z] = 0;
+            rv[z] = 0;
+            rw[z] = 0;
+        }
+
+    // Step gx reads cell column gx and finishes column gx - 1
+    BLUR_LOOP:
+        for (int gx = 0; gx <= gx_n; gx++) {
+// clang-format off
+#pragma HLS LOOP_TRIPCOUNT min=2 max=GX+1
+#pragma HLS PIPELINE II=1
+            // clang-format on
+            for (int z = 0; z < GZ; z++) {
+// clang-format off
+#pragma HLS UNROLL
+                // clang-format on
+                lv[z] = mv[z];
+                lw[z] = mw[z];
+                mv[z] = rv[z];
+                mw[z] = rw[z];
+                rv[z] = (gx < gx_n) ? grid_v_t(_splat_v[z][gx]) : grid_v_t(0);
+                rw[z] = (gx < gx_n) ? grid_w_t(_splat_w[z][gx]) : grid_w_t(0);
+                if (gx < gx_n) {
+                    _splat_v[z][gx] = 0;
+                    _splat_w[z][gx] = 0;
+                }
+            }
+            if (gx == 0) continue;
+
+            grid_v_t hv[GZ + 2];
+            grid_w_t hw[GZ + 2];
+// clang-format off
+#pragma HLS ARRAY_PARTITION variable=hv complete dim=1
+#pragma HLS ARRAY_PARTITION variable=hw complete dim=1
+            // clang-format on
+            hv[0] = hv[GZ + 1] = 0;
+            hw[0] = hw[GZ + 1] = 0;
+            for (int z = 0; z < GZ; z++) {
+// clang-format off
+#pragma HLS UNROLL
+                // clang-format on
+                hv[z + 1] = lv[z] + (mv[z] << 1) + rv[z];
+                hw[z + 1] = lw[z] + (mw[z] << 1) + rw[z];
+            }
+            for (int z = 0; z < GZ; z++) {
+// clang-format off
+#pragma HLS UNROLL
+                // clang-format on
+                grid_v_t xz_v = hv[z] + (hv[z + 1] << 1) + hv[z + 2];
+                grid_w_t xz_w = hw[z] + (hw[z + 1] << 1) + hw[z + 2];
+                _xz_v[s_cur][z][gx - 1] = xz_v;
+                _xz_w[s_cur][z][gx - 1] = xz_w;
+                if (b >= 1) {
+                    grid_v_t above_v = (b >= 2) ? _xz_v[s_prev2][z][gx - 1] : grid_v_t(0);
+                    grid_w_t above_w = (b >= 2) ? _xz_w[s_prev2][z][gx - 1] : grid_w_t(0);
+                    _grid_v[s_prev1][z][gx - 1] = above_v + (_xz_v[s_prev1][z][gx - 1] << 1) + xz_v;
+                    _grid_w[s_prev1][z][gx - 1] = above_w + (_xz_w[s_prev1][z][gx - 1] << 1) + xz_w;
+                }
+            }
+        }
+    }
+
+    /* Trilinear interpolation of the blurred grid at pixel value q of column x, row fy of the band */
+    pixel_t slice(pixel_t q, int x, int fy, int s_top, int s_bottom) {
+// clang-format off
+#pragma HLS INLINE
+        // clang-format on
+        const int x0 = x >> SPACE_SHIFT, fx = x & (S - 1);
+        const int z0 = int(q) >> RANGE_SHIFT, fz = int(q) & (R - 1);
+        slice_v_t num = 0;
+        slice_w_t den = 0;
+        for (int i = 0; i < 2; i++) {
+// clang-format off
+#pragma HLS UNROLL
+            // clang-format on
+            const int slot = i ? s_bottom : s_top;
+            const int wy = i ? fy : (S - fy);
+            slice_v_t row_v = 0;
+            slice_w_t row_w = 0;
+            for (int j = 0; j < 2; j++) {
+// clang-format off
+#pragma HLS UNROLL
+                // clang-format on
+                const int wx = j ? fx : (S - fx);
+                slice_v_t cell_v = slice_v_t(_grid_v[slot][z0][x0 + j]) * (R - fz) +
+                                   slice_v_t(_grid_v[slot][z0 + 1][x0 + j]) * fz;
+                slice_w_t cell_w = slice_w_t(_grid_w[slot][z0][x0 + j]) * (R - fz) +
+                                   slice_w_t(_grid_w[slot][z0 + 1][x0 + j]) * fz;
+                row_v += cell_v * wx;
+                row_w += cell_w * wx;
+            }
+            num += row_v * wy;
+            den += row_w * wy;
+        }
+        // The pixel's own cell always has a non-zero weight
+        slice_v_t out = (den == 0) ? slice_v_t(q) : slice_v_t((num + (den >> 1)) / den);
+        return pixel_t(out);
+    }
+
+    pixel_t clamp(pixel_t p) {
+// clang-format off
+#pragma HLS INLINE
+        // clang-format on
+        return (p > IN_MAX) ? pixel_t(IN_MAX) : p;
+    }
+};
+
+// ======================================================================================
+
+template <int TYPE,
+          int ROWS,
+          int COLS,
+          int NPC = 1,
+          int SPACE_SHIFT = 4,
+          int RANGE_SHIFT = XF_DTPIXELDEPTH(TYPE, NPC) - 4,
+          int IN_BITS = XF_DTPIXELDEPTH(TYPE, NPC),
+          int USE_URAM = 0,
+          int XFCVDEPTH_IN = _XFCVDEPTH_DEFAULT,
+          int XFCVDEPTH_OUT = _XFCVDEPTH_DEFAULT>
+void bilateralGrid(xf::cv::Mat<TYPE, ROWS, COLS, NPC, XFCVDEPTH_IN>& _src,
+                   xf::cv::Mat<TYPE, ROWS, COLS, NPC, XFCVDEPTH_OUT>& _dst) {
+// clang-format off
+#pragma HLS INLINE OFF
+    // clang-format on
+#ifndef __SYNTHESIS__
+    assert(((_src.rows <= ROWS) && (_src.cols <= COLS)) && "ROWS and COLS should be greater than input image");
+    assert(((_dst.rows == _src.rows) && (_dst.cols == _src.cols)) && "Input and output image sizes must match");
+    assert((NPC == XF_NPPC1) && "NPC must be XF_NPPC1");
+    assert(((TYPE == XF_8UC1) || (TYPE == XF_16UC1)) && "TYPE must be XF_8UC1 or XF_16UC1");
+    assert((SPACE_SHIFT >= 1) && (SPACE_SHIFT <= 6) && "SPACE_SHIFT must be in 1 .. 6");
+    assert((RANGE_SHIFT >= 0) && (RANGE_SHIFT < IN_BITS) && "RANGE_SHIFT must be below IN_BITS");
+    assert((IN_BITS <= XF_DTPIXELDEPTH(TYPE, NPC)) && "IN_BITS must not exceed the pixel depth");
+#endif
+    typedef BilateralGrid<TYPE, ROWS, COLS, SPACE_SHIFT, RANGE_SHIFT, IN_BITS, USE_URAM> grid_t;
+#ifndef __SYNTHESIS__
+    // Each call gets its own grid; C-simulation puts the pixel ring and the cell rows on the heap
+    std::unique_ptr<grid_t> grid_mem(new grid_t);
+    grid_t& grid = *grid_mem;
+#else
+    grid_t grid;
+#endif
+    grid.process(_src, _dst);
+}
+
+} // namespace cv
+} // namespace xf
+
+#endif //__XF_BILATERAL_GRID_HPP__
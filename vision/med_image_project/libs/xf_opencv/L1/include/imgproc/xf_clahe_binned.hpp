@@ -0,0 +1,408 @@
+/*
+ * Copyright 2021 Xilinx, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _XF_CLAHE_BINNED_HPP_
+#define _XF_CLAHE_BINNED_HPP_
+
+#include "imgproc/xf_clahe.hpp"
+
+//----------------------------------------------------------------------------------------------------//
+// CLAHE for 12 and 16-bit data
+//
+// CLAHEImpl keeps one histogram bin per pixel value, (1 << 16) bins per tile and copy for 16-bit input,
+// which does not fit on chip. CLAHEBinnedImpl uses the same tiling, clipping and bilinear interpolation
+// but histograms IN_BITS significant bits into (1 << BIN_BITS) bins, e.g. 12-bit CT into 1024 bins, and
+// maps every bin to an IN_BITS wide output value. Values above the IN_BITS range, as in a 16-bit
+// container holding 12-bit data, fall into the last bin.
+//
+// As in CLAHEImpl the LUTs come in two sets: process() histograms frame N into _lutw while it
+// interpolates frame N with _lutr, built from frame N - 1. Swap the two sets between calls; the first
+// frame of a series needs a second call, or a _lutr populated from a representative slice.
+//
+// The clip limit is relative to the bin count: clip * tile pixels / (1 << BIN_BITS) counts per bin.
+// Tile widths that are a multiple of 2 * NPC pixels keep the tile boundaries exact, otherwise a pair of
+// pixel words at a boundary is counted in the left tile, as in CLAHEImpl.
+//----------------------------------------------------------------------------------------------------//
+
+namespace xf {
+namespace cv {
+namespace clahe {
+
+template <int IN_TYPE,
+          int HEIGHT,
+          int WIDTH,
+          int NPC,
+          int CLIPLIMIT,
+          int TILES_Y_MAX,
+          int TILES_X_MAX,
+          int BIN_BITS = 10,
+          int IN_BITS = XF_DTPIXELDEPTH(IN_TYPE, NPC),
+          int TILES_Y_MIN = 4,
+          int TILES_X_MIN = 4>
+class CLAHEBinnedImpl {
+   public:
+    static constexpr int PIXEL_BITS = XF_DTPIXELDEPTH(IN_TYPE, NPC);
+    static constexpr int BINS = (1 << BIN_BITS);
+    static constexpr int BIN_SHIFT = IN_BITS - BIN_BITS;
+    static constexpr int OUT_MAX = (1 << IN_BITS) - 1;
+    static constexpr int COLS_NPC_ALIGNED = (WIDTH + NPC - 1) >> XF_BITSHIFT(NPC);
+    static constexpr int COL_TRIPCOUNT = COLS_NPC_ALIGNED >> 1; // pixel word pairs per row
+
+    static constexpr int TILE_HEIGHT_MAX = _CLAHE_TILE::TILE_HEIGHT_MAX;
+    static constexpr int TILE_WIDTH_MAX = _CLAHE_TILE::TILE_WIDTH_MAX;
+    static constexpr int CLIP_COUNTER_BITS = _CLAHE_TILE::CLIP_COUNTER_BITS;
+
+    static constexpr int _MAXCLIPVALUE = ((CLIPLIMIT * TILE_HEIGHT_MAX * TILE_WIDTH_MAX) >> BIN_BITS);
+    static constexpr int MAXCLIPVALUE = (_MAXCLIPVALUE > 1) ? _MAXCLIPVALUE : 1;
+
+    // Holds a clipped count while histogramming, then an output value
+    static constexpr int HIST_COUNTER_BITS = (IN_BITS > (xf::cv::log2<MAXCLIPVALUE>::cvalue + 1))
+                                                 ? IN_BITS
+                                                 : (xf::cv::log2<MAXCLIPVALUE>::cvalue + 1);
+
+    typedef ap_uint<HIST_COUNTER_BITS> lut_t;
+
+    static_assert((BIN_BITS > 0) && (BIN_BITS <= IN_BITS), "BIN_BITS must be in 1..IN_BITS");
+    static_assert(IN_BITS <= PIXEL_BITS, "IN_BITS can not exceed the pixel depth of IN_TYPE");
+
+    static ap_uint<BIN_BITS> bin(ap_uint<PIXEL_BITS> a) {
+// clang-format off
+    #pragma HLS inline
+        // clang-format on
+        if (a > OUT_MAX) a = OUT_MAX;
+        return a >> BIN_SHIFT;
+    }
+
+    void init(lut_t _lut[TILES_Y_MAX][TILES_X_MAX][(XF_NPIXPERCYCLE(NPC) << 1)][BINS],
+              ap_uint<CLIP_COUNTER_BITS> _clipCounter[TILES_Y_MAX][TILES_X_MAX]) {
+// clang-format off
+    #pragma HLS inline off
+    // clang-format on
+
+    INITLY:
+        for (int i = 0; i < TILES_Y_MAX; i++) {
+        INITLX:
+            for (int j = 0; j < TILES_X_MAX; j++) {
+            INITLP:
+                for (int k = 0; k < BINS; k++) {
+// clang-format off
+      #pragma HLS PIPELINE
+                    // clang-format on
+                    for (int l = 0; l < (XF_NPIXPERCYCLE(NPC) << 1); l++) {
+// clang-format off
+      #pragma HLS UNROLL
+                        // clang-format on
+                        _lut[i][j][l][k] = 0;
+                    }
+                    _clipCounter[i][j] = 0;
+                }
+            }
+        }
+    }
+
+    void clipLut(_CLAHE_TILE& Tile,
+                 lut_t _lut[TILES_Y_MAX][TILES_X_MAX][(XF_NPIXPERCYCLE(NPC) << 1)][BINS],
+                 ap_uint<CLIP_COUNTER_BITS> _clipCounter[TILES_Y_MAX][TILES_X_MAX]) {
+// clang-format off
+      #pragma HLS inline off
+    // clang-format on
+    ACY:
+        for (int i = 0; i < TILES_Y_MAX; i++) {
+        ACX:
+            for (int j = 0; j < TILES_X_MAX; j++) {
+                ap_uint<CLIP_COUNTER_BITS> add = _clipCounter[i][j];
+            ACN:
+                for (int k = 0; k < BINS; k++) {
+// clang-format off
+      #pragma HLS PIPELINE
+                    // clang-format on
+
+                    ap_uint<CLIP_COUNTER_BITS> v = 0;
+                    for (int l = 0; l < (XF_NPIXPERCYCLE(NPC) << 1); l++) {
+// clang-format off
+              #pragma HLS UNROLL
+                        // clang-format on
+                        v += _lut[i][j][l][k];
+                    }
+                    if (v > Tile.mClipValue) add += (v - Tile.mClipValue);
+                }
+
+                int sum = 0;
+            ACK:
+                for (int k = 0; k < BINS; k++) {
+// clang-format off
+      #pragma HLS PIPELINE
+                    // clang-format on
+
+                    ap_uint<CLIP_COUNTER_BITS> div = add >> BIN_BITS;
+                    ap_uint<BIN_BITS> rem = add.range(BIN_BITS - 1, 0);
+                    ap_uint<CLIP_COUNTER_BITS> v = 0;
+
+                    for (int l = 0; l < (XF_NPIXPERCYCLE(NPC) << 1); l++) {
+// clang-format off
+              #pragma HLS UNROLL
+                        // clang-format on
+                        v += _lut[i][j][l][k];
+                    }
+
+                    if (v > Tile.mClipValue) v = Tile.mClipValue;
+                    v += div;
+
+                    if (rem > 0) {
+                        int step = BINS / rem;
+                        if (step < 1) step = 1;
+
+                        if (((k % step) == 0) && (k < ((int)rem * step))) v++;
+                    }
+
+                    sum += v;
+
+                    int tileSize = Tile.mTileHeight * Tile.mTileWidth;
+                    ap_uint<32 + IN_BITS> fi = ((ap_uint<32 + IN_BITS>)sum * OUT_MAX) / tileSize;
+                    if (fi > OUT_MAX) fi = OUT_MAX;
+
+                    for (int l = 0; l < (XF_NPIXPERCYCLE(NPC) << 1); l++) {
+// clang-format off
+              #pragma HLS UNROLL
+                        // clang-format on
+                        _lut[i][j][l][k] = fi;
+                    }
+                }
+            }
+        }
+    }
+
+    void populateLutBlk(xf::cv::Mat<IN_TYPE, HEIGHT, WIDTH, NPC>& in,
+                        _CLAHE_TILE& Tile,
+                        xf::cv::Mat<IN_TYPE, HEIGHT, WIDTH, NPC>& in_copy,
+                        lut_t _lut[TILES_Y_MAX][TILES_X_MAX][(XF_NPIXPERCYCLE(NPC) << 1)][BINS],
+                        ap_uint<CLIP_COUNTER_BITS> _clipCounter[TILES_Y_MAX][TILES_X_MAX]) {
+// clang-format off
+    #pragma HLS inline off
+        // clang-format on
+        int address = 0;
+        int counterY = 0;
+        int histY = 0;
+    R:
+        for (int i = 0; i < Tile.mRows; i++) {
+// clang-format off
+      #pragma HLS LOOP_TRIPCOUNT min=1 max=HEIGHT
+            // clang-format on
+            int counterX = 0;
+            int histX = 0;
+        C:
+            for (int j = 0; j < Tile.mColsNPCAlligned; j += 2) {
+// clang-format off
+        #pragma HLS LOOP_TRIPCOUNT min=1 max=COL_TRIPCOUNT
+        #pragma HLS LOOP_FLATTEN OFF
+        #pragma HLS PIPELINE II=2
+                // clang-format on
+                XF_TNAME(IN_TYPE, NPC) pxl1;
+                XF_TNAME(IN_TYPE, NPC) pxl2;
+                pxl1 = in.read(address);
+                in_copy.write(address, pxl1);
+                if (j < (Tile.mColsNPCAlligned - 1)) {
+                    pxl2 = in.read(address + 1);
+                    in_copy.write(address + 1, pxl2);
+                } else
+                    pxl2 = 0;
+                bool has2 = (j < (Tile.mColsNPCAlligned - 1));
+                address += 2;
+
+                ap_uint<XF_BITSHIFT(NPC) + 1> _clip1 = 0;
+                ap_uint<XF_BITSHIFT(NPC) + 1> _clip2 = 0;
+            N:
+                for (int k = 0; k < XF_NPIXPERCYCLE(NPC); k++) {
+// clang-format off
+            #pragma HLS UNROLL
+                    // clang-format on
+                    ap_uint<BIN_BITS> a1 = bin(pxl1.range(((k + 1) * PIXEL_BITS) - 1, (k * PIXEL_BITS)));
+                    ap_uint<BIN_BITS> a2 = bin(pxl2.range(((k + 1) * PIXEL_BITS) - 1, (k * PIXEL_BITS)));
+
+                    lut_t val1 = _lut[histY][histX][2 * k][a1] + 1;
+                    lut_t val2 = _lut[histY][histX][2 * k + 1][a2] + 1;
+
+                    if (val1 <= Tile.mClipValue)
+                        _lut[histY][histX][2 * k][a1] = val1;
+                    else
+                        _clip1++;
+
+                    // The padding word after an odd number of words is not counted
+                    if (has2) {
+                        if (val2 <= Tile.mClipValue)
+                            _lut[histY][histX][2 * k + 1][a2] = val2;
+                        else
+                            _clip2++;
+                    }
+                }
+                _clipCounter[histY][histX] += (_clip1 + _clip2);
+
+                counterX += (2 << XF_BITSHIFT(NPC));
+                if (counterX >= Tile.mTileWidthNPCAlligned) {
+                    histX++;
+                    counterX = 0;
+                }
+            }
+            counterY++;
+            if (counterY == (Tile.mTileHeight)) {
+                histY++;
+                counterY = 0;
+            }
+        }
+    }
+
+    void populateLut(xf::cv::Mat<IN_TYPE, HEIGHT, WIDTH, NPC>& in,
+                     _CLAHE_TILE& Tile,
+                     xf::cv::Mat<IN_TYPE, HEIGHT, WIDTH, NPC>& in_copy,
+                     lut_t _lut[TILES_Y_MAX][TILES_X_MAX][(XF_NPIXPERCYCLE(NPC) << 1)][BINS],
+                     ap_uint<CLIP_COUNTER_BITS> _clipCounter[TILES_Y_MAX][TILES_X_MAX]) {
+// clang-format off
+    #pragma HLS inline off
+        // clang-format on
+
+        // Initialize LUT
+        init(_lut, _clipCounter);
+
+        // Populate LUT
+        populateLutBlk(in, Tile, in_copy, _lut, _clipCounter);
+
+        // Accumulate values
+        clipLut(Tile, _lut, _clipCounter);
+    }
+
+    void interpolate(xf::cv::Mat<IN_TYPE, HEIGHT, WIDTH, NPC>& in,
+                     _CLAHE_TILE& Tile,
+                     lut_t _lut[TILES_Y_MAX][TILES_X_MAX][(XF_NPIXPERCYCLE(NPC) << 1)][BINS],
+                     xf::cv::Mat<IN_TYPE, HEIGHT, WIDTH, NPC>& dst) {
+        int counterY = Tile.mTileHeight >> 1;
+        int histY = -1;
+        int address = 0;
+
+    RI:
+        for (int i = 0; i < Tile.mRows; i++) {
+// clang-format off
+        #pragma HLS LOOP_TRIPCOUNT min=1 max=HEIGHT
+            // clang-format on
+            int counterX = (Tile.mTileWidth >> 1);
+            int histX = -1;
+        CI:
+            for (int j = 0; j < Tile.mColsNPCAlligned; j++) {
+// clang-format off
+            #pragma HLS LOOP_TRIPCOUNT min=1 max=COLS_NPC_ALIGNED
+            #pragma HLS PIPELINE
+                // clang-format on
+                XF_TNAME(IN_TYPE, NPC) pxl;
+                pxl = in.read(address);
+
+                XF_TNAME(IN_TYPE, NPC) pxlout;
+            NI:
+                for (int k = 0; k < XF_NPIXPERCYCLE(NPC); k++) {
+// clang-format off
+                #pragma HLS UNROLL
+                    // clang-format on
+                    ap_uint<BIN_BITS> a = bin(pxl.range(((k + 1) * PIXEL_BITS) - 1, (k * PIXEL_BITS)));
+
+                    int Y1 = std::max(histY, 0);
+                    int X1 = std::max(histX, 0);
+
+                    int Y2 = histY + 1;
+                    if (Y2 >= Tile.mTilesY) Y2 = (Tile.mTilesY - 1);
+
+                    int X2 = (histX + 1);
+                    if (X2 >= Tile.mTilesX) X2 = (Tile.mTilesX - 1);
+
+                    lut_t a1 = _lut[Y1][X1][2 * k][a];
+                    lut_t a2 = _lut[Y1][X2][2 * k][a];
+                    lut_t b1 = _lut[Y2][X1][2 * k + 1][a];
+                    lut_t b2 = _lut[Y2][X2][2 * k + 1][a];
+
+                    int tileSize = Tile.mTileHeight * Tile.mTileWidth;
+                    int xa1 = Tile.mTileWidth - counterX;
+                    int xa = counterX;
+                    int ya1 = Tile.mTileHeight - counterY;
+                    int ya = counterY;
+
+                    ap_uint<HIST_COUNTER_BITS + xf::cv::log2<TILE_WIDTH_MAX>::cvalue> t1 = a1 * xa1 + a2 * xa;
+                    ap_uint<HIST_COUNTER_BITS + xf::cv::log2<TILE_WIDTH_MAX>::cvalue> t2 = b1 * xa1 + b2 * xa;
+                    ap_uint<HIST_COUNTER_BITS + xf::cv::log2<TILE_WIDTH_MAX>::cvalue +
+                            xf::cv::log2<TILE_HEIGHT_MAX>::cvalue>
+                        t3 = t1 * ya1 + t2 * ya;
+                    ap_uint<HIST_COUNTER_BITS + xf::cv::log2<TILE_WIDTH_MAX>::cvalue +
+                            xf::cv::log2<TILE_HEIGHT_MAX>::cvalue>
+                        t4 = t3 / tileSize;
+
+                    ap_uint<PIXEL_BITS> d;
+                    if (t4 > OUT_MAX)
+                        d = OUT_MAX;
+                    else
+                        d = t4;
+
+                    pxlout.range(((k + 1) * PIXEL_BITS) - 1, (k * PIXEL_BITS)) = d;
+                }
+                dst.write(address, pxlout);
+                address++;
+
+                counterX += (1 << XF_BITSHIFT(NPC));
+                if (counterX >= Tile.mTileWidthNPCAlligned) {
+                    counterX = 0;
+                    histX++;
+                }
+            }
+            counterY++;
+            if (counterY == (Tile.mTileHeight)) {
+                histY++;
+                counterY = 0;
+            }
+        }
+    }
+
+    void process_i(xf::cv::Mat<IN_TYPE, HEIGHT, WIDTH, NPC>& dst,
+                   xf::cv::Mat<IN_TYPE, HEIGHT, WIDTH, NPC>& in,
+                   _CLAHE_TILE& Tile,
+                   lut_t _lutw[TILES_Y_MAX][TILES_X_MAX][(XF_NPIXPERCYCLE(NPC) << 1)][BINS],
+                   lut_t _lutr[TILES_Y_MAX][TILES_X_MAX][(XF_NPIXPERCYCLE(NPC) << 1)][BINS],
+                   ap_uint<CLIP_COUNTER_BITS> _clipCounter[TILES_Y_MAX][TILES_X_MAX]) {
+        xf::cv::Mat<IN_TYPE, HEIGHT, WIDTH, NPC> in_copy(in.rows, in.cols);
+
+// clang-format off
+    #pragma HLS DATAFLOW
+        // clang-format on
+        populateLut(in, Tile, in_copy, _lutw, _clipCounter);
+        interpolate(in_copy, Tile, _lutr, dst);
+    }
+
+    void process(xf::cv::Mat<IN_TYPE, HEIGHT, WIDTH, NPC>& dst,
+                 xf::cv::Mat<IN_TYPE, HEIGHT, WIDTH, NPC>& in,
+                 lut_t _lutw[TILES_Y_MAX][TILES_X_MAX][(XF_NPIXPERCYCLE(NPC) << 1)][BINS],
+                 lut_t _lutr[TILES_Y_MAX][TILES_X_MAX][(XF_NPIXPERCYCLE(NPC) << 1)][BINS],
+                 ap_uint<CLIP_COUNTER_BITS> _clipCounter[TILES_Y_MAX][TILES_X_MAX],
+                 int height,
+                 int width,
+                 int clip,
+                 int tilesY,
+                 int tilesX) {
+        _CLAHE_TILE Tile(height, width, clip, tilesY, tilesX);
+        // CLAHETile scales the clip limit to one bin per pixel value
+        if (clip > 0) Tile.mClipValue = std::max(((clip * Tile.mTileHeight * Tile.mTileWidth) >> BIN_BITS), 1);
+        process_i(dst, in, Tile, _lutw, _lutr, _clipCounter);
+    }
+};
+
+} // namespace clahe
+} // namespace cv
+} // namespace xf
+
+#endif
@@ -0,0 +1,358 @@
+/*
+ * Copyright 2021 Xilinx, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __XF_CONNECTED_COMPONENTS_HPP__
+#define __XF_CONNECTED_COMPONENTS_HPP__
+
+#include "ap_int.h"
+#include "common/xf_common.hpp"
+#include "common/xf_structs.hpp"
+#include "common/xf_utility.hpp"
+#ifndef __SYNTHESIS__
+#include <memory>
+#endif
+
+//----------------------------------------------------------------------------------------------------//
+// Single pass connected component labeling with per component statistics, 8-connectivity.
+//
+// The mask is read once in raster order. Each run of non-zero pixels gets the label of the first
+// component it touches in the row above, or a new one; runs touching several components merge them in
+// an on-chip union-find table (the smaller label becomes the root), and the statistics of a run are
+// accumulated in registers and added to its root when the run ends. Only the previous row of labels is
+// buffered, there are no DDR temporaries.
+//
+// Component ids are assigned at the end of the frame in the order of their first pixel, as
+// cv::connectedComponentsWithStats(mask, labels, stats, centroids, 8) numbers them: stats[0] describes
+// the zero pixels, stats[1 .. n - 1] the components, and the return value n counts both.
+//
+// The optional label image holds the provisional label of every pixel, which remap[] (MAX_LABELS
+// entries) maps to its component id. A frame with more than MAX_LABELS - 1 runs that start a new
+// component sets overflow; the pixels of the runs that found no free label are counted as zero pixels.
+//
+// Lookups in the union-find table take two reads. At the start of a row every label of the row above
+// is a root or points to one: the labels that lost a merge during a row are pointed at their roots
+// after it, in reverse order of the merges, so one step each suffices. During the row a component of
+// the row above loses at most one merge before its next pixel there is read, as the components
+// between two of its pixels are enclosed by it and so have larger labels. A pixel above is looked up
+// once, as the upper right neighbour, and its root shifted through registers; neighbours above that
+// touch belong to one component, so a pixel merges at most once. COL_LOOP runs at II=2: a pixel reads
+// the union-find table twice, and a merge reads two entries of the statistics and writes one. Pointing
+// the losers at their roots takes one clock per merge of a row.
+//----------------------------------------------------------------------------------------------------//
+
+namespace xf {
+namespace cv {
+
+struct ccl_stats_t {
+    unsigned int area;
+    unsigned short left, top, right, bottom; // inclusive bounding box
+    float cx, cy;                            // centroid
+};
+
+/* Label sink of the statistics only variant */
+struct ccl_no_labels_t {
+    template <typename T>
+    void write(int, T) {
+// clang-format off
+#pragma HLS INLINE
+        // clang-format on
+    }
+};
+
+template <int ROWS, int COLS, int MAX_LABELS>
+class ConnectedComponents {
+   public:
+    static constexpr int LABEL_BITS = xf::cv::log2<MAX_LABELS>::cvalue;
+    typedef ap_uint<LABEL_BITS> label_t;
+    typedef ap_uint<64> sum_t;
+
+    ConnectedComponents() {
+// clang-format off
+#pragma HLS INLINE
+        // clang-format on
+    }
+
+    /* LABELS is an xf::cv::Mat or ccl_no_labels_t */
+    template <int SRC_T, typename LABELS>
+    int process(xf::cv::Mat<SRC_T, ROWS, COLS, XF_NPPC1>& _src,
+                LABELS& _labels,
+                unsigned short* remap,
+                ccl_stats_t* stats,
+                bool& overflow) {
+// clang-format off
+#pragma HLS INLINE OFF
+        // clang-format on
+        int rows = _src.rows, cols = _src.cols;
+        int idx = 0;
+        _next = 1;
+        overflow = false;
+        initStats(0);
+
+    PREV_INIT_LOOP:
+        for (int x = 0; x < cols; x++) {
+// clang-format off
+#pragma HLS LOOP_TRIPCOUNT min=1 max=COLS
+#pragma HLS PIPELINE II=1
+            // clang-format on
+            _prev[x] = 0;
+        }
+
+    ROW_LOOP:
+        for (int y = 0; y < rows; y++) {
+// clang-format off
+#pragma HLS LOOP_TRIPCOUNT min=1 max=ROWS
+            // clang-format on
+            label_t cur = 0;       // root of the current run, 0 outside of runs
+            label_t ul = 0, u = 0; // roots of the previous row at x - 1 and x
+            label_t ur = (_prev[0] != 0) ? find(_prev[0]) : label_t(0);
+            int run_x0 = 0;
+            int merges = 0;
+
+        COL_LOOP:
+            for (int x = 0; x < cols; x++) {
+// clang-format off
+#pragma HLS LOOP_TRIPCOUNT min=1 max=COLS
+#pragma HLS PIPELINE II=2
+                // clang-format on
+                ul = u;
+                u = ur;
+                label_t above = (x + 1 < cols) ? _prev[x + 1] : label_t(0);
+                ur = (above != 0) ? find(above) : label_t(0);
+                XF_TNAME(SRC_T, XF_NPPC1) pix = _src.read(idx);
+
+                if (pix != 0) {
+                    if (cur == 0) {
+                        // Run start: ul and u, or u and ur, are one component when both are set
+                        cur = (u != 0) ? u : ((ul != 0) ? ul : ur);
+                        if (cur == 0 && _next < MAX_LABELS) {
+                            cur = _next++;
+                            _parent[cur] = cur;
+                            initStats(cur);
+                        } else if (cur == 0) {
+                            overflow = true;
+                        }
+                        run_x0 = x;
+                    }
+                    if (cur != 0 && ur != 0 && ur != cur) {
+                        label_t w = merge(cur, ur);
+                        label_t l = (w == cur) ? ur : cur;
+                        _merged[merges++] = l;
+                        ur = w; // ul and u are not read again before the next run starts
+                        cur = w;
+                    }
+                }
+                if (pix == 0 || cur == 0) {
+                    if (cur != 0) addRun(cur, run_x0, x - 1, y);
+                    cur = 0;
+                    addBackground(x, y);
+                }
+                _prev[x] = cur;
+                _labels.write(idx, cur);
+                idx++;
+            }
+            if (cur != 0) addRun(cur, run_x0, cols - 1, y);
+
+        // The winner of a later merge already points at its root
+        FLATTEN_LOOP:
+            for (int m = merges - 1; m >= 0; m--) {
+// clang-format off
+#pragma HLS LOOP_TRIPCOUNT min=0 max=COLS/2
+#pragma HLS PIPELINE
+                // clang-format on
+                label_t l = _merged[m];
+                _parent[l] = _parent[_parent[l]];
+            }
+        }
+
+        return finish(remap, stats);
+    }
+
+   private:
+    label_t _prev[COLS];
+    label_t _merged[COLS]; // losers of the merges of the current row
+    label_t _parent[MAX_LABELS];
+    unsigned int _area[MAX_LABELS];
+    sum_t _sum_x[MAX_LABELS], _sum_y[MAX_LABELS];
+    unsigned short _left[MAX_LABELS], _top[MAX_LABELS], _right[MAX_LABELS], _bottom[MAX_LABELS];
+    int _next;
+
+    /* Root of a label of the previous row, see the top of the file */
+    label_t find(label_t l) {
+// clang-format off
+#pragma HLS INLINE
+        // clang-format on
+        label_t r = _parent[_parent[l]];
+#ifndef __SYNTHESIS__
+        assert((_parent[r] == r) && "A label of the previous row is more than two steps from its root");
+#endif
+        return r;
+    }
+
+    /* Unites the components of roots a and b, returns the new root */
+    label_t merge(label_t a, label_t b) {
+// clang-format off
+#pragma HLS INLINE
+        // clang-format on
+        if (a == b) return a;
+        label_t w = (a < b) ? a : b, l = (a < b) ? b : a;
+        _parent[l] = w;
+        _area[w] += _area[l];
+        _sum_x[w] += _sum_x[l];
+        _sum_y[w] += _sum_y[l];
+        if (_left[l] < _left[w]) _left[w] = _left[l];
+        if (_top[l] < _top[w]) _top[w] = _top[l];
+        if (_right[l] > _right[w]) _right[w] = _right[l];
+        if (_bottom[l] > _bottom[w]) _bottom[w] = _bottom[l];
+        return w;
+    }
+
+    void initStats(label_t l) {
+// clang-format off
+#pragma HLS INLINE
+        // clang-format on
+        _area[l] = 0;
+        _sum_x[l] = 0;
+        _sum_y[l] = 0;
+        _left[l] = 0xffff;
+        _top[l] = 0xffff;
+        _right[l] = 0;
+        _bottom[l] = 0;
+    }
+
+    void addRun(label_t l, int x0, int x1, int y) {
+// clang-format off
+#pragma HLS INLINE
+        // clang-format on
+        unsigned int len = x1 - x0 + 1;
+        _area[l] += len;
+        _sum_x[l] += (sum_t)(x0 + x1) * len / 2;
+        _sum_y[l] += (sum_t)y * len;
+        if (x0 < _left[l]) _left[l] = x0;
+        if (y < _top[l]) _top[l] = y;
+        if (x1 > _right[l]) _right[l] = x1;
+        if (y > _bottom[l]) _bottom[l] = y;
+    }
+
+    void addBackground(int x, int y) {
+// clang-format off
+#pragma HLS INLINE
+        // clang-format on
+        _area[0]++;
+        _sum_x[0] += x;
+        _sum_y[0] += y;
+        if (x < _left[0]) _left[0] = x;
+        if (y < _top[0]) _top[0] = y;
+        if (x > _right[0]) _right[0] = x;
+        if (y > _bottom[0]) _bottom[0] = y;
+    }
+
+    /* Numbers the roots in label order, which is the order of their first pixel. Every label points
+     * to a smaller one, whose component id is known by then */
+    int finish(unsigned short* remap, ccl_stats_t* stats) {
+// clang-format off
+#pragma HLS INLINE
+        // clang-format on
+        int n = 1;
+        remap[0] = 0;
+        writeStats(stats[0], 0);
+    FINISH_LOOP:
+        for (int l = 1; l < _next; l++) {
+// clang-format off
+#pragma HLS LOOP_TRIPCOUNT min=1 max=MAX_LABELS
+            // clang-format on
+            label_t p = _parent[l];
+            if (p == l) {
+                writeStats(stats[n], l);
+                remap[l] = n++;
+            } else {
+                remap[l] = remap[p];
+            }
+        }
+        return n;
+    }
+
+    void writeStats(ccl_stats_t& s, label_t l) {
+// clang-format off
+#pragma HLS INLINE
+        // clang-format on
+        s.area = _area[l];
+        s.left = _left[l];
+        s.top = _top[l];
+        s.right = _right[l];
+        s.bottom = _bottom[l];
+        s.cx = (_area[l] != 0) ? (float)_sum_x[l].to_uint64() / (float)_area[l] : 0.f;
+        s.cy = (_area[l] != 0) ? (float)_sum_y[l].to_uint64() / (float)_area[l] : 0.f;
+    }
+};
+
+// ======================================================================================
+
+/* Statistics only */
+template <int SRC_T, int ROWS, int COLS, int MAX_LABELS>
+int connectedComponentsWithStats(xf::cv::Mat<SRC_T, ROWS, COLS, XF_NPPC1>& _src,
+                                 ccl_stats_t* stats,
+                                 unsigned short* remap,
+                                 bool& overflow) {
+// clang-format off
+#pragma HLS INLINE OFF
+    // clang-format on
+#ifndef __SYNTHESIS__
+    assert(((_src.rows <= ROWS) && (_src.cols <= COLS)) && "ROWS and COLS should be greater than input image");
+    assert((SRC_T == XF_8UC1) && "The input must be a XF_8UC1 mask");
+    assert((COLS <= 65536) && (ROWS <= 65536) && "The bounding box coordinates are 16 bits wide");
+#endif
+    typedef xf::cv::ConnectedComponents<ROWS, COLS, MAX_LABELS> ccl_t;
+#ifndef __SYNTHESIS__
+    // The tables of MAX_LABELS entries are allocated per call in C-simulation, not on the stack
+    std::unique_ptr<ccl_t> ccl_mem(new ccl_t);
+    ccl_t& ccl = *ccl_mem;
+#else
+    ccl_t ccl;
+#endif
+    ccl_no_labels_t no_labels;
+    return ccl.template process<SRC_T>(_src, no_labels, remap, stats, overflow);
+}
+
+/* Statistics and the provisional label image, which remap[] turns into component ids */
+template <int SRC_T, int LBL_T, int ROWS, int COLS, int MAX_LABELS>
+int connectedComponentsWithStats(xf::cv::Mat<SRC_T, ROWS, COLS, XF_NPPC1>& _src,
+                                 xf::cv::Mat<LBL_T, ROWS, COLS, XF_NPPC1>& _labels,
+                                 ccl_stats_t* stats,
+                                 unsigned short* remap,
+                                 bool& overflow) {
+// clang-format off
+#pragma HLS INLINE OFF
+    // clang-format on
+#ifndef __SYNTHESIS__
+    assert(((_src.rows <= ROWS) && (_src.cols <= COLS)) && "ROWS and COLS should be greater than input image");
+    assert(((_labels.rows == _src.rows) && (_labels.cols == _src.cols)) && "Mask and label sizes must match");
+    assert((SRC_T == XF_8UC1) && "The input must be a XF_8UC1 mask");
+    assert((LBL_T == XF_16UC1) && (MAX_LABELS <= 65536) && "Labels are XF_16UC1");
+#endif
+    typedef xf::cv::ConnectedComponents<ROWS, COLS, MAX_LABELS> ccl_t;
+#ifndef __SYNTHESIS__
+    std::unique_ptr<ccl_t> ccl_mem(new ccl_t);
+    ccl_t& ccl = *ccl_mem;
+#else
+    ccl_t ccl;
+#endif
+    return ccl.template process<SRC_T>(_src, _labels, remap, stats, overflow);
+}
+
+} // namespace cv
+} // namespace xf
+
+#endif //__XF_CONNECTED_COMPONENTS_HPP__
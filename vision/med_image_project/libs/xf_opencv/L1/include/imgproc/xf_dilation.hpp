@@ -66,10 +66,20 @@ Apply_dilate_Loop:
     return;
 }
 
-template <int ROWS, int COLS, int PLANES, int TYPE, int NPC, int WORDWIDTH, int TC, int K_ROWS, int K_COLS>
-void Process_function_d(xf::cv::Mat<TYPE, ROWS, COLS, NPC>& _src_mat,
+template <int ROWS,
+          int COLS,
+          int PLANES,
+          int TYPE,
+          int NPC,
+          int WORDWIDTH,
+          int TC,
+          int K_ROWS,
+          int K_COLS,
+          int XFCVDEPTH_IN = _XFCVDEPTH_DEFAULT,
+          int XFCVDEPTH_OUT = _XFCVDEPTH_DEFAULT>
+void Process_function_d(xf::cv::Mat<TYPE, ROWS, COLS, NPC, XFCVDEPTH_IN>& _src_mat,
                         unsigned char kernel[K_ROWS][K_COLS],
-                        xf::cv::Mat<TYPE, ROWS, COLS, NPC>& _out_mat,
+                        xf::cv::Mat<TYPE, ROWS, COLS, NPC, XFCVDEPTH_OUT>& _out_mat,
                         XF_TNAME(TYPE, NPC) buf[K_ROWS][(COLS >> XF_BITSHIFT(NPC))],
                         XF_PTUNAME(TYPE) src_buf[K_ROWS][XF_NPIXPERCYCLE(NPC) + (K_COLS - 1)],
                         XF_TNAME(TYPE, NPC) & P0,
@@ -226,9 +236,19 @@ Col_Loop:
 
 } //	end of processDilate
 
-template <int ROWS, int COLS, int PLANES, int TYPE, int NPC, int WORDWIDTH, int TC, int K_ROWS, int K_COLS>
-void xfdilate(xf::cv::Mat<TYPE, ROWS, COLS, NPC>& _src,
-              xf::cv::Mat<TYPE, ROWS, COLS, NPC>& _dst,
+template <int ROWS,
+          int COLS,
+          int PLANES,
+          int TYPE,
+          int NPC,
+          int WORDWIDTH,
+          int TC,
+          int K_ROWS,
+          int K_COLS,
+          int XFCVDEPTH_IN = _XFCVDEPTH_DEFAULT,
+          int XFCVDEPTH_OUT = _XFCVDEPTH_DEFAULT>
+void xfdilate(xf::cv::Mat<TYPE, ROWS, COLS, NPC, XFCVDEPTH_IN>& _src,
+              xf::cv::Mat<TYPE, ROWS, COLS, NPC, XFCVDEPTH_OUT>& _dst,
               uint16_t img_height,
               uint16_t img_width,
               unsigned char kernel[K_ROWS][K_COLS]) {
@@ -329,9 +349,11 @@ template <int BORDER_TYPE,
           int K_ROWS,
           int K_COLS,
           int ITERATIONS,
-          int NPC = 1>
-void dilate(xf::cv::Mat<TYPE, ROWS, COLS, NPC>& _src,
-            xf::cv::Mat<TYPE, ROWS, COLS, NPC>& _dst,
+          int NPC = 1,
+          int XFCVDEPTH_IN = _XFCVDEPTH_DEFAULT,
+          int XFCVDEPTH_OUT = _XFCVDEPTH_DEFAULT>
+void dilate(xf::cv::Mat<TYPE, ROWS, COLS, NPC, XFCVDEPTH_IN>& _src,
+            xf::cv::Mat<TYPE, ROWS, COLS, NPC, XFCVDEPTH_OUT>& _dst,
             unsigned char _kernel[K_ROWS * K_COLS]) {
 // clang-format off
     #pragma HLS INLINE OFF
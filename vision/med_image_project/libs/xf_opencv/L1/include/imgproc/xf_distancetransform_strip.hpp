@@ -0,0 +1,316 @@
+/*
+ * Copyright 2021 Xilinx, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __XF_VITIS_DISTANCETRANSFORM_STRIP_HPP__
+#define __XF_VITIS_DISTANCETRANSFORM_STRIP_HPP__
+
+#include "ap_int.h"
+#include "common/xf_common.hpp"
+#include "common/xf_structs.hpp"
+#include "common/xf_utility.hpp"
+#include "hls_math.h"
+#include "hls_stream.h"
+#ifndef __SYNTHESIS__
+#include <memory>
+#endif
+
+//----------------------------------------------------------------------------------------------------//
+// Streaming Euclidean distance transform on strips of rows, without the DDR forward-pass buffer of
+// xf::cv::distanceTransform.
+//
+// For every non-zero pixel of a binary mask the output is the exact Euclidean distance to the nearest
+// zero pixel (cv::distanceTransform with DIST_L2 and DIST_MASK_PRECISE), saturated at MAX_DIST. The
+// bound is what makes the transform streamable: a zero further than MAX_DIST away cannot change the
+// result, so the backward (bottom-up) pass of a strip only needs MAX_DIST rows below it instead of the
+// rest of the image. Three stages run under DATAFLOW with their intermediates on chip:
+//
+//   dtStripFwPass  top-down: rows to the nearest zero above, per column
+//   dtStripBkPass  bottom-up over strip k and its MAX_DIST halo rows, while the rows of strip k + 1
+//                  arrive and the vertical distances of strip k - 1 leave
+//   dtStripRowPass per row: min over |dx| <= MAX_DIST of dx^2 + g(x + dx)^2, then sqrt
+//
+// The backward pass reads (STRIP + MAX_DIST) rows per STRIP rows, so the pipeline runs at
+// STRIP / (STRIP + MAX_DIST) pixels per clock; the row pass compares 2 * MAX_DIST + 1 candidates per
+// pixel. On chip: a (2 * STRIP + MAX_DIST) x COLS ring and 2 x STRIP x COLS vertical distances, both
+// log2(MAX_DIST + 2) bits wide.
+//
+// DST_T XF_32FC1 writes the distance as float, XF_16UC1 as unsigned fixed point with FRAC_BITS
+// fractional bits, rounded to nearest.
+//----------------------------------------------------------------------------------------------------//
+
+namespace xf {
+namespace cv {
+
+template <int MAX_DIST>
+struct dt_strip_traits {
+    static constexpr int FAR = MAX_DIST + 1; // no zero within MAX_DIST rows
+    static constexpr int DIST_BITS = xf::cv::log2<MAX_DIST + 1>::fvalue + 1;
+    static constexpr int DIST2_BITS = xf::cv::log2<MAX_DIST * MAX_DIST>::fvalue + 2;
+    typedef ap_uint<DIST_BITS> dist_t;
+    typedef ap_uint<DIST2_BITS> dist2_t;
+};
+
+template <int SRC_T, int ROWS, int COLS, int MAX_DIST>
+void dtStripFwPass(xf::cv::Mat<SRC_T, ROWS, COLS, XF_NPPC1>& _src,
+                   hls::stream<typename dt_strip_traits<MAX_DIST>::dist_t>& _up,
+                   int rows,
+                   int cols) {
+// clang-format off
+#pragma HLS INLINE OFF
+    // clang-format on
+    typedef typename dt_strip_traits<MAX_DIST>::dist_t dist_t;
+    const dist_t far = dt_strip_traits<MAX_DIST>::FAR;
+
+    dist_t up[COLS];
+    int idx = 0;
+
+ROW_LOOP:
+    for (int r = 0; r < rows; r++) {
+// clang-format off
+#pragma HLS LOOP_TRIPCOUNT min=1 max=ROWS
+    // clang-format on
+    COL_LOOP:
+        for (int c = 0; c < cols; c++) {
+// clang-format off
+#pragma HLS LOOP_TRIPCOUNT min=1 max=COLS
+#pragma HLS PIPELINE II=1
+            // clang-format on
+            XF_TNAME(SRC_T, XF_NPPC1) pix = _src.read(idx++);
+            dist_t prev = (r == 0) ? far : up[c];
+            dist_t u = (pix == 0) ? dist_t(0) : ((prev == far) ? far : dist_t(prev + 1));
+            up[c] = u;
+            _up.write(u);
+        }
+    }
+}
+
+template <int ROWS, int COLS, int MAX_DIST, int STRIP, int USE_URAM>
+void dtStripBkPass(hls::stream<typename dt_strip_traits<MAX_DIST>::dist_t>& _up,
+                   hls::stream<typename dt_strip_traits<MAX_DIST>::dist_t>& _g,
+                   int rows,
+                   int cols) {
+// clang-format off
+#pragma HLS INLINE OFF
+    // clang-format on
+    typedef typename dt_strip_traits<MAX_DIST>::dist_t dist_t;
+    const dist_t far = dt_strip_traits<MAX_DIST>::FAR;
+    constexpr int RING = 2 * STRIP + MAX_DIST;
+
+#ifndef __SYNTHESIS__
+    // Frame wide rows, C-simulation allocates them per call rather than on the stack
+    std::unique_ptr<dist_t[][COLS]> ring(new dist_t[RING][COLS]);
+    std::unique_ptr<dist_t[][STRIP][COLS]> vdist(new dist_t[2][STRIP][COLS]);
+#else
+    dist_t ring[RING][COLS];
+    dist_t vdist[2][STRIP][COLS];
+#endif
+    dist_t down[COLS];
+// clang-format off
+#pragma HLS ARRAY_PARTITION variable=vdist complete dim=1
+#pragma HLS DEPENDENCE variable=ring inter false
+#pragma HLS DEPENDENCE variable=vdist inter false
+    // clang-format on
+    if (USE_URAM) {
+// clang-format off
+#pragma HLS RESOURCE variable=ring core=RAM_S2P_URAM
+        // clang-format on
+    }
+
+    const int strips = (rows + STRIP - 1) / STRIP;
+    int loaded = (rows < STRIP + MAX_DIST) ? rows : (STRIP + MAX_DIST);
+
+// The first strip and its halo fill the ring before the backward pass can start
+PRIME_ROW_LOOP:
+    for (int r = 0; r < loaded; r++) {
+// clang-format off
+#pragma HLS LOOP_TRIPCOUNT min=1 max=STRIP+MAX_DIST
+    // clang-format on
+    PRIME_COL_LOOP:
+        for (int c = 0; c < cols; c++) {
+// clang-format off
+#pragma HLS LOOP_TRIPCOUNT min=1 max=COLS
+#pragma HLS PIPELINE II=1
+            // clang-format on
+            ring[r][c] = _up.read();
+        }
+    }
+
+// Strip k: load the rows strip k + 1 still needs, run the backward pass over strip k and its halo,
+// and emit the vertical distances of strip k - 1. One extra iteration drains the last strip.
+STRIP_LOOP:
+    for (int k = 0; k <= strips; k++) {
+// clang-format off
+#pragma HLS LOOP_TRIPCOUNT min=1 max=ROWS/STRIP+1
+        // clang-format on
+        int s0 = k * STRIP;
+        int s1 = (s0 + STRIP < rows) ? (s0 + STRIP) : rows;
+        int h1 = (s1 + MAX_DIST < rows) ? (s1 + MAX_DIST) : rows;
+        int bk_rows = (k < strips) ? (h1 - s0) : 0;
+        int ld_rows = (rows - loaded < STRIP) ? (rows - loaded) : STRIP;
+        int em_rows = 0;
+        if (k > 0) em_rows = (rows - (k - 1) * STRIP < STRIP) ? (rows - (k - 1) * STRIP) : STRIP;
+        int steps = (bk_rows > ld_rows) ? bk_rows : ld_rows;
+        if (em_rows > steps) steps = em_rows;
+
+        int ld_slot = loaded % RING;
+        int bk_slot = (h1 - 1) % RING;
+
+    STEP_LOOP:
+        for (int t = 0; t < steps; t++) {
+// clang-format off
+#pragma HLS LOOP_TRIPCOUNT min=1 max=STRIP+MAX_DIST
+            // clang-format on
+            int r = h1 - 1 - t;
+            bool ld = (t < ld_rows), bk = (t < bk_rows), em = (t < em_rows);
+
+        STEP_COL_LOOP:
+            for (int c = 0; c < cols; c++) {
+// clang-format off
+#pragma HLS LOOP_TRIPCOUNT min=1 max=COLS
+#pragma HLS PIPELINE II=1
+                // clang-format on
+                if (ld) ring[ld_slot][c] = _up.read();
+                if (bk) {
+                    dist_t u = ring[bk_slot][c];
+                    dist_t d = (t == 0) ? far : down[c];
+                    d = (u == 0) ? dist_t(0) : ((d == far) ? far : dist_t(d + 1));
+                    down[c] = d;
+                    if (r < s1) vdist[k & 1][r - s0][c] = (u < d) ? u : d;
+                }
+                if (em) _g.write(vdist[(k - 1) & 1][t][c]);
+            }
+
+            ld_slot = (ld_slot == RING - 1) ? 0 : (ld_slot + 1);
+            bk_slot = (bk_slot == 0) ? (RING - 1) : (bk_slot - 1);
+        }
+        loaded += ld_rows;
+    }
+}
+
+template <int DST_T, int ROWS, int COLS, int MAX_DIST, int FRAC_BITS>
+void dtStripRowPass(hls::stream<typename dt_strip_traits<MAX_DIST>::dist_t>& _g,
+                    xf::cv::Mat<DST_T, ROWS, COLS, XF_NPPC1>& _dst,
+                    int rows,
+                    int cols) {
+// clang-format off
+#pragma HLS INLINE OFF
+    // clang-format on
+    typedef typename dt_strip_traits<MAX_DIST>::dist_t dist_t;
+    typedef typename dt_strip_traits<MAX_DIST>::dist2_t dist2_t;
+    const dist_t far = dt_strip_traits<MAX_DIST>::FAR;
+    constexpr int WIN = 2 * MAX_DIST + 1;
+
+    dist_t win[WIN];
+// clang-format off
+#pragma HLS ARRAY_PARTITION variable=win complete dim=1
+    // clang-format on
+    int idx = 0;
+
+ROW_LOOP:
+    for (int r = 0; r < rows; r++) {
+// clang-format off
+#pragma HLS LOOP_TRIPCOUNT min=1 max=ROWS
+    // clang-format on
+    WIN_INIT_LOOP:
+        for (int i = 0; i < WIN; i++) {
+// clang-format off
+#pragma HLS UNROLL
+            // clang-format on
+            win[i] = far;
+        }
+
+    // The window is centered MAX_DIST columns behind the input
+    COL_LOOP:
+        for (int c = 0; c < cols + MAX_DIST; c++) {
+// clang-format off
+#pragma HLS LOOP_TRIPCOUNT min=1 max=COLS+MAX_DIST
+#pragma HLS PIPELINE II=1
+        // clang-format on
+        WIN_SHIFT_LOOP:
+            for (int i = 0; i < WIN - 1; i++) {
+// clang-format off
+#pragma HLS UNROLL
+                // clang-format on
+                win[i] = win[i + 1];
+            }
+            win[WIN - 1] = (c < cols) ? _g.read() : far;
+            if (c < MAX_DIST) continue;
+
+            dist2_t d2 = MAX_DIST * MAX_DIST;
+        MIN_LOOP:
+            for (int i = 0; i < WIN; i++) {
+// clang-format off
+#pragma HLS UNROLL
+                // clang-format on
+                int dx = i - MAX_DIST;
+                dist2_t v = (dist2_t)(dx * dx) + (dist2_t)(win[i] * win[i]);
+                if (win[i] != far && v < d2) d2 = v;
+            }
+
+            float dist = hls::sqrt((float)d2.to_uint());
+            XF_TNAME(DST_T, XF_NPPC1) out;
+            if (DST_T == XF_32FC1) {
+                union {
+                    float f;
+                    unsigned int u;
+                } bits;
+                bits.f = dist;
+                out = bits.u;
+            } else {
+                out = (unsigned int)(dist * (float)(1 << FRAC_BITS) + 0.5f);
+            }
+            _dst.write(idx++, out);
+        }
+    }
+}
+
+// ======================================================================================
+
+template <int SRC_T, int DST_T, int ROWS, int COLS, int MAX_DIST, int STRIP, int FRAC_BITS = 8, int USE_URAM = 0>
+void distanceTransformStrip(xf::cv::Mat<SRC_T, ROWS, COLS, XF_NPPC1>& _src,
+                            xf::cv::Mat<DST_T, ROWS, COLS, XF_NPPC1>& _dst) {
+// clang-format off
+#pragma HLS INLINE OFF
+    // clang-format on
+#ifndef __SYNTHESIS__
+    assert(((_src.rows <= ROWS) && (_src.cols <= COLS)) && "ROWS and COLS should be greater than input image");
+    assert(((_dst.rows == _src.rows) && (_dst.cols == _src.cols)) && "Input and output image sizes must match");
+    assert((SRC_T == XF_8UC1) && "The input must be a binary XF_8UC1 mask, zero for background");
+    assert(((DST_T == XF_32FC1) || (DST_T == XF_16UC1)) && "DST_T must be XF_32FC1 or XF_16UC1");
+    assert(((DST_T == XF_32FC1) || ((MAX_DIST << FRAC_BITS) < (1 << 16))) &&
+           "MAX_DIST << FRAC_BITS must fit the 16-bit output");
+    assert((STRIP >= 1) && (MAX_DIST >= 1) && "STRIP and MAX_DIST must be at least 1");
+#endif
+    typedef typename dt_strip_traits<MAX_DIST>::dist_t dist_t;
+    int rows = _src.rows, cols = _src.cols;
+
+    hls::stream<dist_t> up;
+    hls::stream<dist_t> vdist;
+// clang-format off
+#pragma HLS STREAM variable=up depth=2
+#pragma HLS STREAM variable=vdist depth=2
+#pragma HLS DATAFLOW
+    // clang-format on
+
+    dtStripFwPass<SRC_T, ROWS, COLS, MAX_DIST>(_src, up, rows, cols);
+    dtStripBkPass<ROWS, COLS, MAX_DIST, STRIP, USE_URAM>(up, vdist, rows, cols);
+    dtStripRowPass<DST_T, ROWS, COLS, MAX_DIST, FRAC_BITS>(vdist, _dst, rows, cols);
+}
+
+} // namespace cv
+} // namespace xf
+
+#endif //__XF_VITIS_DISTANCETRANSFORM_STRIP_HPP__
@@ -14,8 +14,8 @@
  * limitations under the License.
  */
 
-#ifndef _XF_MEDIAN_BLUR_
-#define _XF_MEDIAN_BLUR_
+#ifndef _XF_EROSION_
+#define _XF_EROSION_
 
 #include "ap_int.h"
 #include "hls_stream.h"
@@ -66,10 +66,20 @@ Apply_dilate_Loop:
     return;
 }
 
-template <int ROWS, int COLS, int PLANES, int TYPE, int NPC, int WORDWIDTH, int TC, int K_ROWS, int K_COLS>
-void Process_function(xf::cv::Mat<TYPE, ROWS, COLS, NPC>& _src_mat,
+template <int ROWS,
+          int COLS,
+          int PLANES,
+          int TYPE,
+          int NPC,
+          int WORDWIDTH,
+          int TC,
+          int K_ROWS,
+          int K_COLS,
+          int XFCVDEPTH_IN = _XFCVDEPTH_DEFAULT,
+          int XFCVDEPTH_OUT = _XFCVDEPTH_DEFAULT>
+void Process_function(xf::cv::Mat<TYPE, ROWS, COLS, NPC, XFCVDEPTH_IN>& _src_mat,
                       unsigned char kernel[K_ROWS][K_COLS],
-                      xf::cv::Mat<TYPE, ROWS, COLS, NPC>& _out_mat,
+                      xf::cv::Mat<TYPE, ROWS, COLS, NPC, XFCVDEPTH_OUT>& _out_mat,
                       XF_TNAME(TYPE, NPC) buf[K_ROWS][(COLS >> XF_BITSHIFT(NPC))],
                       XF_PTUNAME(TYPE) src_buf[K_ROWS][XF_NPIXPERCYCLE(NPC) + (K_COLS - 1)],
                       XF_TNAME(TYPE, NPC) & P0,
@@ -230,9 +240,19 @@ Col_Loop:
 
 } //	end of processDilate
 
-template <int ROWS, int COLS, int PLANES, int TYPE, int NPC, int WORDWIDTH, int TC, int K_ROWS, int K_COLS>
-void xferode(xf::cv::Mat<TYPE, ROWS, COLS, NPC>& _src,
-             xf::cv::Mat<TYPE, ROWS, COLS, NPC>& _dst,
+template <int ROWS,
+          int COLS,
+          int PLANES,
+          int TYPE,
+          int NPC,
+          int WORDWIDTH,
+          int TC,
+          int K_ROWS,
+          int K_COLS,
+          int XFCVDEPTH_IN = _XFCVDEPTH_DEFAULT,
+          int XFCVDEPTH_OUT = _XFCVDEPTH_DEFAULT>
+void xferode(xf::cv::Mat<TYPE, ROWS, COLS, NPC, XFCVDEPTH_IN>& _src,
+             xf::cv::Mat<TYPE, ROWS, COLS, NPC, XFCVDEPTH_OUT>& _dst,
              uint16_t img_height,
              uint16_t img_width,
              unsigned char kernel[K_ROWS][K_COLS]) {
@@ -333,9 +353,11 @@ template <int BORDER_TYPE,
           int K_ROWS,
           int K_COLS,
           int ITERATIONS,
-          int NPC = 1>
-void erode(xf::cv::Mat<TYPE, ROWS, COLS, NPC>& _src,
-           xf::cv::Mat<TYPE, ROWS, COLS, NPC>& _dst,
+          int NPC = 1,
+          int XFCVDEPTH_IN = _XFCVDEPTH_DEFAULT,
+          int XFCVDEPTH_OUT = _XFCVDEPTH_DEFAULT>
+void erode(xf::cv::Mat<TYPE, ROWS, COLS, NPC, XFCVDEPTH_IN>& _src,
+           xf::cv::Mat<TYPE, ROWS, COLS, NPC, XFCVDEPTH_OUT>& _dst,
            unsigned char _kernel[K_ROWS * K_COLS]) {
 // clang-format off
     #pragma HLS INLINE OFF
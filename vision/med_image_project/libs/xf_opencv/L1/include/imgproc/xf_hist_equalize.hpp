@@ -123,6 +123,184 @@ NORMALISE_ROW_LOOP:
     }
 }
 
+/**
+ *  xFEqualizeTemporal : Maps the image through the cumulative distribution of the
+ *                       previous slice while accumulating its own histogram, so
+ *                       every pixel is read once
+ *  _src	: Input image
+ *  hist	: In: histogram of the previous slice, all zeros if there is none
+ *		  Out: histogram of _src
+ *  _dst_mat	: Output image
+ *  BANKS	: Copies of the histogram per pixel lane. Runs of equal pixels are
+ *		  counted in registers and added to the copies in turn, so a bin is
+ *		  read and written back at most every BANKS clocks and the loop
+ *		  runs at II=1
+ */
+template <int SRC_T,
+          int ROWS,
+          int COLS,
+          int DEPTH,
+          int NPC,
+          int WORDWIDTH,
+          int SRC_TC,
+          int BANKS = 2,
+          int XFCVDEPTH_IN = _XFCVDEPTH_DEFAULT,
+          int XFCVDEPTH_OUT = _XFCVDEPTH_DEFAULT>
+void xFEqualizeTemporal(xf::cv::Mat<SRC_T, ROWS, COLS, NPC, XFCVDEPTH_IN>& _src,
+                        uint32_t hist[256],
+                        xf::cv::Mat<SRC_T, ROWS, COLS, NPC, XFCVDEPTH_OUT>& _dst_mat,
+                        uint16_t img_height,
+                        uint16_t img_width) {
+    XF_SNAME(WORDWIDTH)
+    in_buf, temp_buf;
+    // Cumulative distribution of the previous slice, one copy per pixel lane
+    ap_uint<8> tmp_cum_hist[(1 << XF_BITSHIFT(NPC))][256];
+// clang-format off
+    #pragma HLS ARRAY_PARTITION variable=tmp_cum_hist complete dim=1
+    // clang-format on
+    // Histogram of the current slice, BANKS copies per pixel lane
+    uint32_t tmp_hist[BANKS][(1 << XF_BITSHIFT(NPC))][256];
+// clang-format off
+    #pragma HLS ARRAY_PARTITION variable=tmp_hist complete dim=1
+    #pragma HLS ARRAY_PARTITION variable=tmp_hist complete dim=2
+    // clang-format on
+    // Bin of the last pixel, its count so far and the copy it is added to when the run ends
+    ap_uint<8> last_val[(1 << XF_BITSHIFT(NPC))];
+    uint32_t last_cnt[(1 << XF_BITSHIFT(NPC))];
+    ap_uint<8> bank[(1 << XF_BITSHIFT(NPC))];
+// clang-format off
+    #pragma HLS ARRAY_PARTITION variable=last_val complete dim=1
+    #pragma HLS ARRAY_PARTITION variable=last_cnt complete dim=1
+    #pragma HLS ARRAY_PARTITION variable=bank complete dim=1
+    // clang-format on
+
+    /*	Normalization, as in xFEqualize with the pixel count taken from the histogram	*/
+    uint32_t total = 0;
+Total_Loop:
+    for (ap_uint<9> i = 0; i < 256; i++) {
+// clang-format off
+        #pragma HLS PIPELINE
+        // clang-format on
+        total += hist[i];
+    }
+    uint32_t init_val = (uint32_t)(total - hist[0]);
+    uint32_t scale;
+    if (init_val == 0) {
+        scale = 0;
+    } else {
+        scale = (uint32_t)(((uint32_t)1 << 31) / init_val);
+    }
+
+    ap_uint<40> scale1 = (ap_uint<40>)((ap_uint<40>)255 * (ap_uint<40>)scale);
+    ap_uint32_t temp_sum = 0;
+
+Normalize_Loop:
+    for (ap_uint<9> i = 0; i < 256; i++) {
+// clang-format off
+        #pragma HLS PIPELINE
+        // clang-format on
+        ap_uint<8> cum_val;
+        if (total == 0) {
+            cum_val = i; // First slice of a series: passed through unchanged
+        } else if (i == 0) {
+            cum_val = 0;
+        } else {
+            temp_sum = (uint32_t)temp_sum + (uint32_t)hist[i];
+            uint64_t sum = (uint64_t)((uint64_t)temp_sum * (uint64_t)scale1);
+            sum = (uint64_t)(sum + 0x40000000);
+            cum_val = sum >> 31;
+        }
+        for (ap_uint<5> j = 0; j < (1 << XF_BITSHIFT(NPC)); j++) {
+// clang-format off
+            #pragma HLS UNROLL
+            // clang-format on
+            tmp_cum_hist[j][i] = cum_val;
+            for (int b = 0; b < BANKS; b++) {
+// clang-format off
+                #pragma HLS UNROLL
+                // clang-format on
+                tmp_hist[b][j][i] = 0;
+            }
+        }
+    }
+
+    for (ap_uint<5> j = 0; j < (1 << XF_BITSHIFT(NPC)); j++) {
+// clang-format off
+        #pragma HLS UNROLL
+        // clang-format on
+        last_val[j] = 0;
+        last_cnt[j] = 0;
+        bank[j] = 0;
+    }
+
+TEMPORAL_ROW_LOOP:
+    for (ap_uint<13> row = 0; row < img_height; row++) {
+// clang-format off
+        #pragma HLS LOOP_TRIPCOUNT min=ROWS max=ROWS
+    // clang-format on
+    TEMPORAL_COL_LOOP:
+        for (ap_uint<13> col = 0; col < img_width; col++) {
+// clang-format off
+            #pragma HLS LOOP_TRIPCOUNT min=SRC_TC max=SRC_TC
+            #pragma HLS PIPELINE
+            #pragma HLS LOOP_FLATTEN OFF
+            #pragma HLS DEPENDENCE variable=tmp_hist inter RAW distance=BANKS true
+            // clang-format on
+            in_buf = _src.read(row * img_width + col);
+        Temporal_Extract:
+            for (ap_uint<9> i = 0, j = 0; i < (8 << XF_BITSHIFT(NPC)); j++, i += 8) {
+// clang-format off
+                #pragma HLS DEPENDENCE variable=tmp_cum_hist array intra false
+                #pragma HLS DEPENDENCE variable=tmp_hist array intra false
+                #pragma HLS unroll
+                // clang-format on
+                XF_PTNAME(DEPTH)
+                val;
+                val = in_buf.range(i + 7, i);
+                temp_buf(i + 7, i) = tmp_cum_hist[j][val];
+
+                // A run ends on another value; the next one goes to the next copy
+                if (val == last_val[j]) {
+                    last_cnt[j]++;
+                } else {
+                    tmp_hist[bank[j]][j][last_val[j]] += last_cnt[j];
+                    bank[j] = (bank[j] == BANKS - 1) ? 0 : (bank[j] + 1);
+                    last_cnt[j] = 1;
+                    last_val[j] = val;
+                }
+            }
+            _dst_mat.write(row * img_width + col, temp_buf);
+        }
+    }
+
+    for (ap_uint<5> j = 0; j < (1 << XF_BITSHIFT(NPC)); j++) {
+// clang-format off
+        #pragma HLS UNROLL
+        // clang-format on
+        tmp_hist[bank[j]][j][last_val[j]] += last_cnt[j];
+    }
+
+Merge_Loop:
+    for (ap_uint<9> i = 0; i < 256; i++) {
+// clang-format off
+        #pragma HLS PIPELINE
+        // clang-format on
+        uint32_t value = 0;
+        for (ap_uint<5> j = 0; j < (1 << XF_BITSHIFT(NPC)); j++) {
+// clang-format off
+            #pragma HLS UNROLL
+            // clang-format on
+            for (int b = 0; b < BANKS; b++) {
+// clang-format off
+                #pragma HLS UNROLL
+                // clang-format on
+                value += tmp_hist[b][j][i];
+            }
+        }
+        hist[i] = value;
+    }
+}
+
 /****************************************************************
  * equalizeHist : Wrapper function which calls the main kernel
  ****************************************************************/
@@ -153,6 +331,41 @@ void equalizeHist(xf::cv::Mat<SRC_T, ROWS, COLS, NPC>& _src,
     xFEqualize<SRC_T, ROWS, COLS, XF_DEPTH(SRC_T, NPC), NPC, XF_WORDWIDTH(SRC_T, NPC), (COLS >> XF_BITSHIFT(NPC))>(
         _src1, histogram, _dst, img_height, img_width);
 }
+
+/****************************************************************
+ * equalizeHistTemporal : Single pass equalization of a slice
+ * series. Adjacent slices have nearly identical histograms, so
+ * each slice is equalized with the distribution of the one
+ * before it; hist carries that distribution from call to call
+ * and must be zeroed at the start of a series.
+ ****************************************************************/
+
+template <int SRC_T,
+          int ROWS,
+          int COLS,
+          int NPC = 1,
+          int XFCVDEPTH_IN = _XFCVDEPTH_DEFAULT,
+          int XFCVDEPTH_OUT = _XFCVDEPTH_DEFAULT>
+void equalizeHistTemporal(xf::cv::Mat<SRC_T, ROWS, COLS, NPC, XFCVDEPTH_IN>& _src,
+                          xf::cv::Mat<SRC_T, ROWS, COLS, NPC, XFCVDEPTH_OUT>& _dst,
+                          uint32_t hist[256]) {
+// clang-format off
+    #pragma HLS inline off
+    // clang-format on
+
+    uint16_t img_height = _src.rows;
+    uint16_t img_width = _src.cols;
+#ifndef __SYNTHESIS__
+    assert(((img_height <= ROWS) && (img_width <= COLS)) && "ROWS and COLS should be greater than input image");
+
+    assert((SRC_T == XF_8UC1) && "Type must be of XF_8UC1");
+    assert(((NPC == XF_NPPC1) || (NPC == XF_NPPC8)) && " NPC must be XF_NPPC1, XF_NPPC8");
+#endif
+
+    img_width = img_width >> XF_BITSHIFT(NPC);
+    xFEqualizeTemporal<SRC_T, ROWS, COLS, XF_DEPTH(SRC_T, NPC), NPC, XF_WORDWIDTH(SRC_T, NPC),
+                       (COLS >> XF_BITSHIFT(NPC))>(_src, hist, _dst, img_height, img_width);
+}
 } // namespace cv
 } // namespace xf
 #endif // _XF_HIST_EQUALIZE_H_
@@ -37,9 +37,18 @@ namespace cv {
  * Input   : _src_mat, _thresh_type, _binary_thresh_val,  _upper_range and _lower_range
  * Output  : _dst_mat
  */
-template <int SRC_T, int ROWS, int COLS, int DEPTH, int NPC, int WORDWIDTH_SRC, int WORDWIDTH_DST, int COLS_TRIP>
-void xFThresholdKernel(xf::cv::Mat<SRC_T, ROWS, COLS, NPC>& _src_mat,
-                       xf::cv::Mat<SRC_T, ROWS, COLS, NPC>& _dst_mat,
+template <int SRC_T,
+          int ROWS,
+          int COLS,
+          int DEPTH,
+          int NPC,
+          int WORDWIDTH_SRC,
+          int WORDWIDTH_DST,
+          int COLS_TRIP,
+          int XFCVDEPTH_IN = _XFCVDEPTH_DEFAULT,
+          int XFCVDEPTH_OUT = _XFCVDEPTH_DEFAULT>
+void xFThresholdKernel(xf::cv::Mat<SRC_T, ROWS, COLS, NPC, XFCVDEPTH_IN>& _src_mat,
+                       xf::cv::Mat<SRC_T, ROWS, COLS, NPC, XFCVDEPTH_OUT>& _dst_mat,
                        ap_uint<8> _thresh_type,
                        short int _thresh,
                        short int maxval,
@@ -102,9 +111,15 @@ rowLoop:
     }
 }
 
-template <int THRESHOLD_TYPE, int SRC_T, int ROWS, int COLS, int NPC = 1>
-void Threshold(xf::cv::Mat<SRC_T, ROWS, COLS, NPC>& _src_mat,
-               xf::cv::Mat<SRC_T, ROWS, COLS, NPC>& _dst_mat,
+template <int THRESHOLD_TYPE,
+          int SRC_T,
+          int ROWS,
+          int COLS,
+          int NPC = 1,
+          int XFCVDEPTH_IN = _XFCVDEPTH_DEFAULT,
+          int XFCVDEPTH_OUT = _XFCVDEPTH_DEFAULT>
+void Threshold(xf::cv::Mat<SRC_T, ROWS, COLS, NPC, XFCVDEPTH_IN>& _src_mat,
+               xf::cv::Mat<SRC_T, ROWS, COLS, NPC, XFCVDEPTH_OUT>& _dst_mat,
                short int thresh,
                short int maxval) {
     unsigned short width = _src_mat.cols >> XF_BITSHIFT(NPC);
@@ -29,7 +29,11 @@ EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include <unistd.h>
 #include <limits.h>
+#include <fcntl.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
+#include <map>
+#include <mutex>
 #include "xcl2.hpp"
 namespace xcl {
 std::vector<cl::Device> get_devices(const std::string& vendor_name) {
@@ -60,43 +64,110 @@ std::vector<cl::Device> get_devices(const std::string& vendor_name) {
 std::vector<cl::Device> get_xil_devices() {
     return get_devices("Xilinx");
 }
-cl::Program::Binaries import_binary_file(std::string xclbin_file_name) {
-    std::cout << "INFO: Importing " << xclbin_file_name << std::endl;
+/* Process-wide xclbin cache. Mappings are shared while anyone holds them, files are keyed by path and
+ * re-mapped when their size or modification time changes (e.g. after a rebuild). Binaries handed out by
+ * import_binary_file() pin their mapping until release_binary_file() */
+namespace {
+struct binary_cache {
+    std::mutex lock;
+    std::map<std::string, std::weak_ptr<const binary_file> > files;
+    std::multimap<const void*, std::shared_ptr<const binary_file> > pinned;
+};
 
-    if (access(xclbin_file_name.c_str(), R_OK) != 0) {
+binary_cache& cache() {
+    static binary_cache c;
+    return c;
+}
+
+bool same_version(const binary_file& file, const struct stat& sb) {
+    return file.size == (size_t)sb.st_size && file.mtime.tv_sec == sb.st_mtim.tv_sec &&
+           file.mtime.tv_nsec == sb.st_mtim.tv_nsec;
+}
+}
+
+binary_file::~binary_file() {
+    if (data != NULL) munmap((void*)data, size);
+}
+
+std::shared_ptr<const binary_file> map_binary_file(const std::string& xclbin_file_name) {
+    struct stat sb;
+    if (access(xclbin_file_name.c_str(), R_OK) != 0 || stat(xclbin_file_name.c_str(), &sb) != 0) {
         fprintf(stderr, "ERROR: %s xclbin not available please build\n", xclbin_file_name.c_str());
         exit(EXIT_FAILURE);
     }
-    // Loading XCL Bin into char buffer
+
+    binary_cache& c = cache();
+    std::lock_guard<std::mutex> lg(c.lock);
+    std::shared_ptr<const binary_file> cached = c.files[xclbin_file_name].lock();
+    if (cached && same_version(*cached, sb)) return cached;
+
     std::cout << "Loading: '" << xclbin_file_name.c_str() << "'\n";
-    std::ifstream bin_file(xclbin_file_name.c_str(), std::ifstream::binary);
-    bin_file.seekg(0, bin_file.end);
-    unsigned nb = bin_file.tellg();
-    bin_file.seekg(0, bin_file.beg);
-    char* buf = new char[nb];
-    bin_file.read(buf, nb);
-    bin_file.close();
+    if (sb.st_size == 0) {
+        fprintf(stderr, "ERROR: %s is empty\n", xclbin_file_name.c_str());
+        exit(EXIT_FAILURE);
+    }
+    int fd = open(xclbin_file_name.c_str(), O_RDONLY);
+    if (fd < 0) {
+        fprintf(stderr, "ERROR: Cannot read %s\n", xclbin_file_name.c_str());
+        exit(EXIT_FAILURE);
+    }
+    void* addr = mmap(NULL, sb.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (addr == MAP_FAILED) {
+        fprintf(stderr, "ERROR: Cannot map %s\n", xclbin_file_name.c_str());
+        exit(EXIT_FAILURE);
+    }
+    // The runtime reads the whole image front to back while programming the device. Advice values are not
+    // flags, each takes a call of its own.
+    madvise(addr, sb.st_size, MADV_SEQUENTIAL);
+    madvise(addr, sb.st_size, MADV_WILLNEED);
+
+    std::shared_ptr<binary_file> file = std::make_shared<binary_file>();
+    file->path = xclbin_file_name;
+    file->data = (const char*)addr;
+    file->size = sb.st_size;
+    file->mtime = sb.st_mtim;
+    c.files[xclbin_file_name] = file;
+    return file;
+}
+
+cl::Program::Binaries import_binary_file(std::string xclbin_file_name) {
+    std::cout << "INFO: Importing " << xclbin_file_name << std::endl;
+#ifdef XCL_SW_DEVICE
+    if (access(xclbin_file_name.c_str(), R_OK) != 0) {
+        std::cout << "INFO: Software device, running without " << xclbin_file_name << std::endl;
+        return cl::Program::Binaries();
+    }
+#endif
+
+    std::shared_ptr<const binary_file> file = map_binary_file(xclbin_file_name);
+    {
+        binary_cache& c = cache();
+        std::lock_guard<std::mutex> lg(c.lock);
+        c.pinned.insert(std::make_pair((const void*)file->data, file));
+    }
 
     cl::Program::Binaries bins;
-    bins.push_back({buf, nb});
+    bins.push_back({file->data, file->size});
     return bins;
 }
 
+void release_binary_file(const cl::Program::Binaries& bins) {
+    binary_cache& c = cache();
+    std::lock_guard<std::mutex> lg(c.lock);
+    for (size_t i = 0; i < bins.size(); i++) {
+        auto it = c.pinned.find(bins[i].first);
+        if (it != c.pinned.end()) c.pinned.erase(it); // Unmaps once no other import shares the file
+    }
+}
+
 char* read_binary_file(const std::string& xclbin_file_name, unsigned& nb) {
     std::cout << "INFO: Reading " << xclbin_file_name << std::endl;
 
-    if (access(xclbin_file_name.c_str(), R_OK) != 0) {
-        fprintf(stderr, "ERROR: %s xclbin not available please build\n", xclbin_file_name.c_str());
-        exit(EXIT_FAILURE);
-    }
-    // Loading XCL Bin into char buffer
-    std::cout << "Loading: '" << xclbin_file_name.c_str() << "'\n";
-    std::ifstream bin_file(xclbin_file_name.c_str(), std::ifstream::binary);
-    bin_file.seekg(0, bin_file.end);
-    nb = bin_file.tellg();
-    bin_file.seekg(0, bin_file.beg);
+    std::shared_ptr<const binary_file> file = map_binary_file(xclbin_file_name);
+    nb = file->size;
     char* buf = new char[nb];
-    bin_file.read(buf, nb);
+    memcpy(buf, file->data, nb);
     return buf;
 }
 
@@ -42,9 +42,16 @@ EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
         fprintf(stderr, "%s:%d Error calling " #call ", error code is: %d\n", __FILE__, __LINE__, error); \
         exit(EXIT_FAILURE);                                                                               \
     }
+#ifdef XCL_SW_DEVICE
+#include "xcl_sw_device.hpp" // In-process software device, no OpenCL runtime needed
+#else
 #include <CL/cl2.hpp> //"/opt/intel/opencl-1.2-4.4.0.117/include/CL/cl.h"
+#endif
 #include <iostream>
 #include <fstream>
+#include <memory>
+#include <string>
+#include <time.h>
 
 // When creating a buffer with user pointer (CL_MEM_USE_HOST_PTR), under the hood
 // User ptr is used if and only if it is properly aligned (page aligned). When not
@@ -102,7 +109,38 @@ std::vector<cl::Device> get_devices(const std::string& vendor_name);
  *   An opencl program Binaries object that was created from xclbin_name file.
  */
 std::string find_binary_file(const std::string& _device_name, const std::string& xclbin_name);
+
+/* Read-only mapping of an xclbin, unmapped with its last reference */
+struct binary_file {
+    std::string path;
+    const char* data = NULL;
+    size_t size = 0;
+    struct timespec mtime;
+
+    binary_file() = default;
+    binary_file(const binary_file&) = delete;
+    binary_file& operator=(const binary_file&) = delete;
+    ~binary_file();
+};
+
+/* map_binary_file
+ *
+ * Description:
+ *   Maps an xclbin through a process-wide cache keyed by path and modification time: loads of the same
+ *   unchanged file share one mapping, a rebuilt file is mapped again.
+ */
+std::shared_ptr<const binary_file> map_binary_file(const std::string& xclbin_file_name);
+
+/* import_binary_file
+ *
+ * Description:
+ *   Returns Binaries pointing into the cached mapping of the xclbin, which stays mapped until the
+ *   Binaries are passed to release_binary_file(). Call it once cl::Program has been built from them.
+ */
 cl::Program::Binaries import_binary_file(std::string xclbin_file_name);
+void release_binary_file(const cl::Program::Binaries& bins);
+
+/* Copy of the xclbin contents, the caller owns the buffer and frees it with delete[] */
 char* read_binary_file(const std::string& xclbin_file_name, unsigned& nb);
 bool is_emulation();
 bool is_hw_emulation();
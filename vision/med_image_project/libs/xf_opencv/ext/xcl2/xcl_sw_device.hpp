@@ -0,0 +1,734 @@
+/*
+ * Copyright 2021 Xilinx, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _XCL_SW_DEVICE_H_
+#define _XCL_SW_DEVICE_H_
+
+//----------------------------------------------------------------------------------------------------//
+// In-process software stand-in for a Xilinx OpenCL device
+//
+// Built with -DXCL_SW_DEVICE, xcl2.hpp includes this header instead of <CL/cl2.hpp>. It implements the
+// subset of the OpenCL C++ bindings the host code uses (platform and device discovery, cl::Buffer,
+// cl::Kernel arguments, enqueueWriteBuffer / enqueueTask / enqueueReadBuffer with wait lists, events with
+// profiling and callbacks), so the complete host flow runs on any Linux machine without an ICD, an
+// xclbin or XRT.
+//
+// Every command queue executes its commands in order on a worker thread, after the events they wait for
+// (out-of-order queues are legal to run in order). Kernels are plain C++ functions registered by name:
+//
+//     static void medimg_accel_sw(xcl_sw::KernelArgs& args) {
+//         medimg_accel(args.buffer<ap_uint<256> >(0), args.buffer<unsigned char>(1), ...,
+//                      args.scalar<int>(3), ...);
+//     }
+//     XCL_SW_KERNEL(medimg_accel, medimg_accel_sw);
+//
+// Like the card, the device has one DMA engine per direction and a fixed number of compute units shared
+// by all queues, so commands of different queues overlap only where the hardware could. The timing is
+// modelled with knobs read from the environment on first use:
+//     XCL_SW_PCIE_GBPS          host <-> device bandwidth in GB/s per direction, transfers last at least
+//                               bytes / rate (0, the default, copies at memcpy speed)
+//     XCL_SW_KERNEL_LATENCY_US  launch latency added in front of every kernel (default 0)
+//     XCL_SW_COMPUTE_UNITS      kernels that may run at the same time (default 1)
+//----------------------------------------------------------------------------------------------------//
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <stdio.h>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+typedef int cl_int;
+typedef unsigned int cl_uint;
+typedef unsigned long cl_ulong;
+typedef cl_ulong cl_bitfield;
+typedef cl_bitfield cl_mem_flags;
+typedef cl_bitfield cl_mem_migration_flags;
+typedef cl_bitfield cl_command_queue_properties;
+typedef cl_bitfield cl_device_type;
+typedef cl_uint cl_bool;
+typedef cl_uint cl_profiling_info;
+typedef cl_uint cl_command_type;
+typedef cl_uint cl_device_info;
+typedef cl_uint cl_platform_info;
+typedef cl_uint cl_event_info;
+
+#define CL_CALLBACK
+#define CL_SUCCESS 0
+#define CL_INVALID_VALUE -30
+#define CL_INVALID_MEM_OBJECT -38
+#define CL_INVALID_KERNEL_NAME -46
+#define CL_INVALID_KERNEL_ARGS -52
+#define CL_INVALID_EVENT_WAIT_LIST -57
+#define CL_EXEC_STATUS_ERROR_FOR_EVENTS_IN_WAIT_LIST -14
+
+#define CL_FALSE 0
+#define CL_TRUE 1
+#define CL_COMPLETE 0x0
+#define CL_RUNNING 0x1
+#define CL_SUBMITTED 0x2
+#define CL_QUEUED 0x3
+
+#define CL_DEVICE_TYPE_ACCELERATOR (1 << 3)
+#define CL_DEVICE_TYPE_ALL 0xFFFFFFFF
+#define CL_PLATFORM_NAME 0x0902
+#define CL_PLATFORM_VENDOR 0x0903
+#define CL_DEVICE_NAME 0x102B
+
+#define CL_QUEUE_OUT_OF_ORDER_EXEC_MODE_ENABLE (1 << 0)
+#define CL_QUEUE_PROFILING_ENABLE (1 << 1)
+
+#define CL_MEM_READ_WRITE (1 << 0)
+#define CL_MEM_WRITE_ONLY (1 << 1)
+#define CL_MEM_READ_ONLY (1 << 2)
+#define CL_MEM_USE_HOST_PTR (1 << 3)
+#define CL_MEM_ALLOC_HOST_PTR (1 << 4)
+#define CL_MEM_COPY_HOST_PTR (1 << 5)
+#define CL_MIGRATE_MEM_OBJECT_HOST (1 << 0)
+
+#define CL_EVENT_COMMAND_TYPE 0x11D1
+#define CL_EVENT_COMMAND_EXECUTION_STATUS 0x11D3
+#define CL_COMMAND_TASK 0x11F1
+#define CL_COMMAND_READ_BUFFER 0x11F3
+#define CL_COMMAND_WRITE_BUFFER 0x11F4
+#define CL_COMMAND_MIGRATE_MEM_OBJECTS 0x1206
+
+#define CL_PROFILING_COMMAND_QUEUED 0x1280
+#define CL_PROFILING_COMMAND_SUBMIT 0x1281
+#define CL_PROFILING_COMMAND_START 0x1282
+#define CL_PROFILING_COMMAND_END 0x1283
+
+namespace xcl_sw {
+
+struct Config {
+    double pcieGBps;        // 0 for unthrottled transfers
+    double kernelLatencyUs; // added in front of every kernel
+    int computeUnits;
+};
+
+inline Config& config() {
+    static Config cfg = [] {
+        Config c;
+        const char* gbps = getenv("XCL_SW_PCIE_GBPS");
+        const char* latency = getenv("XCL_SW_KERNEL_LATENCY_US");
+        const char* cus = getenv("XCL_SW_COMPUTE_UNITS");
+        c.pcieGBps = (gbps != NULL) ? atof(gbps) : 0.0;
+        c.kernelLatencyUs = (latency != NULL) ? atof(latency) : 0.0;
+        c.computeUnits = (cus != NULL && atoi(cus) > 0) ? atoi(cus) : 1;
+        return c;
+    }();
+    return cfg;
+}
+
+/* A device resource commands queue up for: a DMA engine or the compute units */
+class Engine {
+   public:
+    explicit Engine(int slots) : mFree(slots) {}
+
+    void acquire() {
+        std::unique_lock<std::mutex> lk(mLock);
+        mWake.wait(lk, [&] { return mFree > 0; });
+        mFree--;
+    }
+
+    void release() {
+        {
+            std::lock_guard<std::mutex> lg(mLock);
+            mFree++;
+        }
+        mWake.notify_one();
+    }
+
+   private:
+    std::mutex mLock;
+    std::condition_variable mWake;
+    int mFree;
+};
+
+inline Engine& hostToDevice() {
+    static Engine engine(1);
+    return engine;
+}
+
+inline Engine& deviceToHost() {
+    static Engine engine(1);
+    return engine;
+}
+
+inline Engine& computeUnits() {
+    static Engine engine(config().computeUnits);
+    return engine;
+}
+
+inline cl_ulong now() {
+    return (cl_ulong)std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+inline void sleepUntil(cl_ulong t) {
+    cl_ulong n = now();
+    if (t > n) std::this_thread::sleep_for(std::chrono::nanoseconds(t - n));
+}
+
+/* Arguments of a kernel launch: device memory for buffer arguments, the raw bytes of scalars */
+class KernelArgs {
+   public:
+    struct Arg {
+        void* data;
+        size_t size;
+        bool isBuffer;
+        std::vector<unsigned char> value;
+    };
+
+    explicit KernelArgs(std::vector<Arg>& args) : mArgs(args) {}
+
+    size_t count() const { return mArgs.size(); }
+
+    template <typename T>
+    T* buffer(size_t idx) {
+        return (T*)mArgs.at(idx).data;
+    }
+
+    size_t bufferSize(size_t idx) { return mArgs.at(idx).size; }
+
+    template <typename T>
+    T scalar(size_t idx) {
+        T value = T();
+        const Arg& a = mArgs.at(idx);
+        memcpy((void*)&value, a.value.data(), std::min(sizeof(T), a.value.size()));
+        return value;
+    }
+
+   private:
+    std::vector<Arg>& mArgs;
+};
+
+typedef std::function<void(KernelArgs&)> KernelFunc;
+
+inline std::map<std::string, KernelFunc>& kernels() {
+    static std::map<std::string, KernelFunc> registry;
+    return registry;
+}
+
+/* Makes name available to cl::Kernel, see XCL_SW_KERNEL */
+inline bool registerKernel(const std::string& name, KernelFunc func) {
+    kernels()[name] = func;
+    return true;
+}
+
+} // namespace xcl_sw
+
+#define XCL_SW_KERNEL(name, func) static bool xcl_sw_kernel_##name = xcl_sw::registerKernel(#name, func)
+
+// Reference counted objects behind the C handles
+struct _cl_event {
+    std::atomic<int> refs;
+    std::mutex lock;
+    std::condition_variable done;
+    cl_int status;
+    cl_command_type type;
+    cl_ulong times[4]; // QUEUED, SUBMIT, START, END
+    std::vector<std::pair<void(CL_CALLBACK*)(_cl_event*, cl_int, void*), void*> > callbacks;
+
+    explicit _cl_event(cl_command_type t) : refs(1), status(CL_QUEUED), type(t) {
+        times[0] = xcl_sw::now();
+        times[1] = times[2] = times[3] = 0;
+    }
+};
+
+struct _cl_mem {
+    std::atomic<int> refs;
+    std::vector<unsigned char> storage;
+    unsigned char* data;
+    size_t size;
+
+    _cl_mem(size_t sz, cl_mem_flags flags, void* host_ptr) : refs(1), size(sz) {
+        if ((flags & CL_MEM_USE_HOST_PTR) && (host_ptr != NULL)) {
+            data = (unsigned char*)host_ptr;
+        } else {
+            // Padded like device allocations, kernels may read whole AXI words past the last byte
+            storage.resize((sz + 4095) & ~(size_t)4095);
+            data = storage.data();
+            if ((flags & CL_MEM_COPY_HOST_PTR) && (host_ptr != NULL)) memcpy(data, host_ptr, sz);
+        }
+    }
+};
+
+struct _cl_command_queue;
+typedef _cl_event* cl_event;
+typedef _cl_mem* cl_mem;
+typedef _cl_command_queue* cl_command_queue;
+
+inline void xcl_sw_retain(cl_event e) {
+    if (e != NULL) e->refs++;
+}
+inline void xcl_sw_release(cl_event e) {
+    if ((e != NULL) && (--e->refs == 0)) delete e;
+}
+inline void xcl_sw_retain(cl_mem m) {
+    if (m != NULL) m->refs++;
+}
+inline void xcl_sw_release(cl_mem m) {
+    if ((m != NULL) && (--m->refs == 0)) delete m;
+}
+
+inline cl_int clWaitForEvents(cl_uint num, const cl_event* events) {
+    cl_int result = CL_SUCCESS;
+    for (cl_uint i = 0; i < num; i++) {
+        if (events[i] == NULL) return CL_INVALID_EVENT_WAIT_LIST;
+        std::unique_lock<std::mutex> lk(events[i]->lock);
+        events[i]->done.wait(lk, [&] { return events[i]->status <= CL_COMPLETE; });
+        if (events[i]->status < 0) result = CL_EXEC_STATUS_ERROR_FOR_EVENTS_IN_WAIT_LIST;
+    }
+    return result;
+}
+
+inline cl_int clGetEventProfilingInfo(cl_event e, cl_profiling_info name, size_t size, void* value, size_t* ret) {
+    if ((e == NULL) || (name < CL_PROFILING_COMMAND_QUEUED) || (name > CL_PROFILING_COMMAND_END)) {
+        return CL_INVALID_VALUE;
+    }
+    std::lock_guard<std::mutex> lg(e->lock);
+    if (value != NULL && size >= sizeof(cl_ulong)) *(cl_ulong*)value = e->times[name - CL_PROFILING_COMMAND_QUEUED];
+    if (ret != NULL) *ret = sizeof(cl_ulong);
+    return CL_SUCCESS;
+}
+
+/* CL_EVENT_COMMAND_TYPE or CL_EVENT_COMMAND_EXECUTION_STATUS */
+inline cl_int clGetEventInfo(cl_event e, cl_event_info name, size_t size, void* value, size_t* ret) {
+    if ((e == NULL) || ((name != CL_EVENT_COMMAND_TYPE) && (name != CL_EVENT_COMMAND_EXECUTION_STATUS))) {
+        return CL_INVALID_VALUE;
+    }
+    std::lock_guard<std::mutex> lg(e->lock);
+    cl_int v = (name == CL_EVENT_COMMAND_TYPE) ? (cl_int)e->type : e->status;
+    if (value != NULL && size >= sizeof(cl_int)) *(cl_int*)value = v;
+    if (ret != NULL) *ret = sizeof(cl_int);
+    return CL_SUCCESS;
+}
+
+inline cl_int clSetEventCallback(cl_event e, cl_int type, void(CL_CALLBACK* func)(cl_event, cl_int, void*), void* user) {
+    if ((e == NULL) || (type != CL_COMPLETE) || (func == NULL)) return CL_INVALID_VALUE;
+    cl_int status;
+    {
+        std::lock_guard<std::mutex> lg(e->lock);
+        status = e->status;
+        if (status > CL_COMPLETE) {
+            e->callbacks.push_back(std::make_pair(func, user));
+            return CL_SUCCESS;
+        }
+    }
+    func(e, status, user); // Already complete
+    return CL_SUCCESS;
+}
+
+/* In order command queue with its own worker thread */
+struct _cl_command_queue {
+    struct Command {
+        cl_event event;
+        std::vector<cl_event> waits;
+        std::function<void()> work;
+        cl_ulong minDurationNs;
+        xcl_sw::Engine* engine;
+    };
+
+    std::atomic<int> refs;
+    std::mutex lock;
+    std::condition_variable wake, idle;
+    std::deque<Command> pending;
+    bool busy, stop;
+    std::thread worker;
+
+    _cl_command_queue() : refs(1), busy(false), stop(false) { worker = std::thread([this] { run(); }); }
+
+    ~_cl_command_queue() {
+        {
+            std::lock_guard<std::mutex> lg(lock);
+            stop = true;
+        }
+        wake.notify_all();
+        worker.join();
+    }
+
+    void push(Command& cmd) {
+        {
+            std::lock_guard<std::mutex> lg(lock);
+            pending.push_back(cmd);
+        }
+        wake.notify_all();
+    }
+
+    void finish() {
+        std::unique_lock<std::mutex> lk(lock);
+        idle.wait(lk, [&] { return pending.empty() && !busy; });
+    }
+
+    void run() {
+        for (;;) {
+            Command cmd;
+            {
+                std::unique_lock<std::mutex> lk(lock);
+                wake.wait(lk, [&] { return stop || !pending.empty(); });
+                if (pending.empty()) return;
+                cmd = pending.front();
+                pending.pop_front();
+                busy = true;
+            }
+
+            cl_int status = CL_COMPLETE;
+            if (!cmd.waits.empty() && (clWaitForEvents((cl_uint)cmd.waits.size(), cmd.waits.data()) != CL_SUCCESS)) {
+                status = CL_EXEC_STATUS_ERROR_FOR_EVENTS_IN_WAIT_LIST;
+            }
+            for (auto& w : cmd.waits) xcl_sw_release(w);
+
+            {
+                std::lock_guard<std::mutex> lg(cmd.event->lock);
+                cmd.event->times[1] = xcl_sw::now();
+                cmd.event->status = CL_SUBMITTED;
+            }
+            if (status == CL_COMPLETE) {
+                if (cmd.engine != NULL) cmd.engine->acquire();
+                cl_ulong start = xcl_sw::now();
+                {
+                    std::lock_guard<std::mutex> lg(cmd.event->lock);
+                    cmd.event->times[2] = start;
+                    cmd.event->status = CL_RUNNING;
+                }
+                cmd.work();
+                xcl_sw::sleepUntil(start + cmd.minDurationNs);
+                if (cmd.engine != NULL) cmd.engine->release();
+            } else {
+                cmd.event->times[2] = cmd.event->times[1];
+            }
+
+            std::vector<std::pair<void(CL_CALLBACK*)(cl_event, cl_int, void*), void*> > callbacks;
+            {
+                std::lock_guard<std::mutex> lg(cmd.event->lock);
+                cmd.event->times[3] = xcl_sw::now();
+                cmd.event->status = status;
+                callbacks.swap(cmd.event->callbacks);
+            }
+            cmd.event->done.notify_all();
+            for (auto& cb : callbacks) cb.first(cmd.event, status, cb.second);
+            xcl_sw_release(cmd.event);
+
+            {
+                std::lock_guard<std::mutex> lg(lock);
+                busy = false;
+            }
+            idle.notify_all();
+        }
+    }
+};
+
+inline void xcl_sw_retain(cl_command_queue q) {
+    if (q != NULL) q->refs++;
+}
+inline void xcl_sw_release(cl_command_queue q) {
+    if ((q != NULL) && (--q->refs == 0)) delete q;
+}
+
+namespace cl {
+
+/* Handle holding one reference, like the cl::detail::Wrapper of the real bindings */
+template <typename T>
+class Handle {
+   public:
+    Handle() : object_(NULL) {}
+    Handle(const Handle& other) : object_(other.object_) { xcl_sw_retain(object_); }
+    Handle(Handle&& other) : object_(other.object_) { other.object_ = NULL; }
+    ~Handle() { xcl_sw_release(object_); }
+
+    Handle& operator=(const Handle& other) {
+        xcl_sw_retain(other.object_);
+        xcl_sw_release(object_);
+        object_ = other.object_;
+        return *this;
+    }
+    Handle& operator=(Handle&& other) {
+        if (this != &other) {
+            xcl_sw_release(object_);
+            object_ = other.object_;
+            other.object_ = NULL;
+        }
+        return *this;
+    }
+
+    const T& operator()() const { return object_; }
+    T& operator()() { return object_; }
+
+   protected:
+    T object_; // Only member, so &handle can be passed as a T*
+};
+
+class Device {
+   public:
+    template <cl_device_info name>
+    std::string getInfo(cl_int* err = NULL) const {
+        if (err != NULL) *err = CL_SUCCESS;
+        return "xilinx_sw_device";
+    }
+};
+
+class Platform {
+   public:
+    static cl_int get(std::vector<Platform>* platforms) {
+        platforms->assign(1, Platform());
+        return CL_SUCCESS;
+    }
+
+    template <cl_platform_info name>
+    std::string getInfo(cl_int* err = NULL) const {
+        if (err != NULL) *err = CL_SUCCESS;
+        return "Xilinx";
+    }
+
+    cl_int getDevices(cl_device_type, std::vector<Device>* devices) const {
+        devices->assign(1, Device());
+        return CL_SUCCESS;
+    }
+};
+
+class Context {
+   public:
+    Context() {}
+    Context(const Device&, void*, void*, void*, cl_int* err = NULL) {
+        if (err != NULL) *err = CL_SUCCESS;
+    }
+};
+
+class Memory : public Handle<cl_mem> {};
+
+class Buffer : public Memory {
+   public:
+    Buffer() {}
+    Buffer(const Context&, cl_mem_flags flags, size_t size, void* host_ptr = NULL, cl_int* err = NULL) {
+        object_ = new _cl_mem(size, flags, host_ptr);
+        if (err != NULL) *err = CL_SUCCESS;
+    }
+};
+
+class Program {
+   public:
+    typedef std::vector<std::pair<const void*, size_t> > Binaries;
+
+    Program() {}
+    Program(const Context&, const std::vector<Device>&, const Binaries&, std::vector<cl_int>* = NULL, cl_int* err = NULL) {
+        // Kernels are linked into the host, the xclbin contents are not needed
+        if (err != NULL) *err = CL_SUCCESS;
+    }
+};
+
+class Kernel {
+   public:
+    Kernel() {}
+    Kernel(const Program&, const char* name, cl_int* err = NULL) : mName(name) {
+        bool found = (xcl_sw::kernels().find(mName) != xcl_sw::kernels().end());
+        if (!found) fprintf(stderr, "ERROR: No software kernel registered as %s\n", name);
+        if (err != NULL) *err = found ? CL_SUCCESS : CL_INVALID_KERNEL_NAME;
+    }
+
+    cl_int setArg(cl_uint idx, const Buffer& buffer) {
+        Arg& a = arg(idx);
+        a.mem = buffer;
+        a.value.clear();
+        return CL_SUCCESS;
+    }
+
+    template <typename T>
+    cl_int setArg(cl_uint idx, const T& value) {
+        Arg& a = arg(idx);
+        a.mem = Buffer();
+        a.value.assign((const unsigned char*)&value, (const unsigned char*)&value + sizeof(T));
+        return CL_SUCCESS;
+    }
+
+    const std::string& name() const { return mName; }
+
+    /* Runs the registered function on the current arguments */
+    void launch() const {
+        std::vector<xcl_sw::KernelArgs::Arg> args(mArgs.size());
+        for (size_t i = 0; i < mArgs.size(); i++) {
+            args[i].isBuffer = (mArgs[i].mem() != NULL);
+            args[i].data = args[i].isBuffer ? (void*)mArgs[i].mem()->data : NULL;
+            args[i].size = args[i].isBuffer ? mArgs[i].mem()->size : 0;
+            args[i].value = mArgs[i].value;
+        }
+        xcl_sw::KernelArgs kargs(args);
+        xcl_sw::kernels()[mName](kargs);
+    }
+
+   private:
+    struct Arg {
+        Buffer mem;
+        std::vector<unsigned char> value;
+    };
+    std::string mName;
+    std::vector<Arg> mArgs;
+
+    Arg& arg(cl_uint idx) {
+        if (mArgs.size() <= idx) mArgs.resize(idx + 1);
+        return mArgs[idx];
+    }
+};
+
+class Event : public Handle<cl_event> {
+   public:
+    Event() {}
+    explicit Event(cl_event e) { object_ = e; }
+
+    template <typename T>
+    cl_int getProfilingInfo(cl_profiling_info name, T* value) const {
+        cl_ulong v = 0;
+        cl_int err = clGetEventProfilingInfo(object_, name, sizeof(v), &v, NULL);
+        *value = (T)v;
+        return err;
+    }
+
+    template <cl_event_info name>
+    cl_int getInfo(cl_int* err = NULL) const {
+        cl_int v = 0;
+        cl_int result = clGetEventInfo(object_, name, sizeof(v), &v, NULL);
+        if (err != NULL) *err = result;
+        return v;
+    }
+
+    cl_int setCallback(cl_int type, void(CL_CALLBACK* func)(cl_event, cl_int, void*), void* user = NULL) {
+        return clSetEventCallback(object_, type, func, user);
+    }
+
+    cl_int wait() const { return clWaitForEvents(1, &object_); }
+};
+
+inline cl_int WaitForEvents(const std::vector<Event>& events) {
+    cl_int result = CL_SUCCESS;
+    for (auto& e : events) {
+        if (e.wait() != CL_SUCCESS) result = CL_EXEC_STATUS_ERROR_FOR_EVENTS_IN_WAIT_LIST;
+    }
+    return result;
+}
+
+class CommandQueue : public Handle<cl_command_queue> {
+   public:
+    CommandQueue() {}
+    CommandQueue(const Context&, const Device&, cl_command_queue_properties = 0, cl_int* err = NULL) {
+        object_ = new _cl_command_queue();
+        if (err != NULL) *err = CL_SUCCESS;
+    }
+
+    cl_int enqueueWriteBuffer(const Buffer& buffer,
+                              cl_bool blocking,
+                              size_t offset,
+                              size_t size,
+                              const void* ptr,
+                              const std::vector<Event>* events = NULL,
+                              Event* event = NULL) const {
+        if ((buffer() == NULL) || (offset + size > buffer()->size)) return CL_INVALID_VALUE;
+        Buffer dst = buffer;
+        return submit(CL_COMMAND_WRITE_BUFFER, events, event, blocking, transferNs(size), &xcl_sw::hostToDevice(),
+                      [dst, offset, size, ptr] { memcpy(dst()->data + offset, ptr, size); });
+    }
+
+    cl_int enqueueReadBuffer(const Buffer& buffer,
+                             cl_bool blocking,
+                             size_t offset,
+                             size_t size,
+                             void* ptr,
+                             const std::vector<Event>* events = NULL,
+                             Event* event = NULL) const {
+        if ((buffer() == NULL) || (offset + size > buffer()->size)) return CL_INVALID_VALUE;
+        Buffer src = buffer;
+        return submit(CL_COMMAND_READ_BUFFER, events, event, blocking, transferNs(size), &xcl_sw::deviceToHost(),
+                      [src, offset, size, ptr] { memcpy(ptr, src()->data + offset, size); });
+    }
+
+    /* Buffers live in host memory, so only the transfer time is modelled */
+    cl_int enqueueMigrateMemObjects(const std::vector<Memory>& objects,
+                                    cl_mem_migration_flags flags,
+                                    const std::vector<Event>* events = NULL,
+                                    Event* event = NULL) const {
+        size_t bytes = 0;
+        for (auto& m : objects) bytes += (m() != NULL) ? m()->size : 0;
+        xcl_sw::Engine* engine = (flags & CL_MIGRATE_MEM_OBJECT_HOST) ? &xcl_sw::deviceToHost() : &xcl_sw::hostToDevice();
+        return submit(CL_COMMAND_MIGRATE_MEM_OBJECTS, events, event, CL_FALSE, transferNs(bytes), engine, [] {});
+    }
+
+    cl_int enqueueTask(const Kernel& kernel, const std::vector<Event>* events = NULL, Event* event = NULL) const {
+        Kernel k = kernel; // Arguments as of enqueue time
+        cl_ulong latency = (cl_ulong)(xcl_sw::config().kernelLatencyUs * 1000.0);
+        return submit(CL_COMMAND_TASK, events, event, CL_FALSE, 0, &xcl_sw::computeUnits(), [k, latency] {
+            xcl_sw::sleepUntil(xcl_sw::now() + latency);
+            k.launch();
+        });
+    }
+
+    cl_int flush() const { return CL_SUCCESS; }
+
+    cl_int finish() const {
+        if (object_ != NULL) object_->finish();
+        return CL_SUCCESS;
+    }
+
+   private:
+    static cl_ulong transferNs(size_t bytes) {
+        double gbps = xcl_sw::config().pcieGBps;
+        return (gbps > 0.0) ? (cl_ulong)((double)bytes / gbps) : 0;
+    }
+
+    cl_int submit(cl_command_type type,
+                  const std::vector<Event>* events,
+                  Event* event,
+                  cl_bool blocking,
+                  cl_ulong min_ns,
+                  xcl_sw::Engine* engine,
+                  std::function<void()> work) const {
+        // The whole wait list is checked before anything is allocated or retained
+        if (events != NULL) {
+            for (auto& e : *events) {
+                if (e() == NULL) return CL_INVALID_EVENT_WAIT_LIST;
+            }
+        }
+        _cl_command_queue::Command cmd;
+        cmd.event = new _cl_event(type);
+        cmd.work = work;
+        cmd.minDurationNs = min_ns;
+        cmd.engine = engine;
+        if (events != NULL) {
+            for (auto& e : *events) {
+                xcl_sw_retain(e());
+                cmd.waits.push_back(e());
+            }
+        }
+        cl_event handle = cmd.event;
+        xcl_sw_retain(handle); // Reference of the caller's Event
+        Event done(handle);
+        object_->push(cmd);
+        if (event != NULL) *event = done;
+        return blocking ? done.wait() : CL_SUCCESS;
+    }
+};
+
+} // namespace cl
+
+#endif //_XCL_SW_DEVICE_H_
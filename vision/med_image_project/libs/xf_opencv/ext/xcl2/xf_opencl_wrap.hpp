@@ -16,7 +16,15 @@
 
 #ifndef _XF_OPENCL_WRAPPER_H
 #define _XF_OPENCL_WRAPPER_H
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <functional>
+#include <future>
 #include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
 #include "common/xf_headers.hpp"
 #include "xcl2.hpp"
 
@@ -24,6 +32,16 @@
 #define ASSERT(x) assert(x)
 #endif
 
+// Upper bound on the command queues cl_kernel_mgr spreads independent branches of a kernel graph over
+#ifndef XF_CL_MAX_QUEUES
+#define XF_CL_MAX_QUEUES 4
+#endif
+
+// Bound on the device memory cl_kernel_mgr's buffer pool keeps cached, 0 means unbounded
+#ifndef XF_CL_BUFFER_POOL_MAX_CACHED
+#define XF_CL_BUFFER_POOL_MAX_CACHED 0
+#endif
+
 template <typename T>
 class XclIn;
 class XclIn2;
@@ -32,6 +50,154 @@ template <typename T>
 class XclOut;
 class XclOut2;
 
+//----------------------------------------------------------------------------------------------------//
+// Device buffer pool
+//
+// Every registerInput/registerOutput(void*, size_t) used to create a fresh cl::Buffer, so processing a
+// volume slice by slice allocated device memory in the hot loop. cl_kernel_mgr owns a cl_buffer_pool that
+// keeps released device buffers in size classes (those of xf::cv::MatPool) and hands them out again.
+// Pooled buffers are CL_MEM_READ_WRITE, so a buffer passed from one kernel to the next is never
+// reallocated to change its access flags. A cl_buffer_handle owns one pooled buffer and returns it on
+// destruction. Kernels own the buffer wrappers they create; they are released with
+// cl_kernel_mgr::releaseKernels(), or kept and rebound to the next frame with setData().
+//----------------------------------------------------------------------------------------------------//
+struct cl_buffer_pool_stats {
+    uint64_t hits;              // acquisitions served from a free list
+    uint64_t misses;            // acquisitions that created a cl::Buffer
+    uint64_t releases;          // buffers handed back
+    uint64_t bytesInUse;        // bytes currently handed out
+    uint64_t bytesResident;     // device bytes held, in use or cached
+    uint64_t peakBytesResident; // high water mark of bytesResident
+};
+
+class cl_buffer_pool;
+
+/* Owns one pooled device buffer, move-only */
+class cl_buffer_handle {
+   public:
+    cl_buffer_handle() : mPool(nullptr), mClass(0) {}
+    cl_buffer_handle(cl_buffer_pool* pool, const cl::Buffer& buffer, size_t cls)
+        : mPool(pool), mBuffer(buffer), mClass(cls) {}
+    cl_buffer_handle(cl_buffer_handle&& other) : mPool(other.mPool), mBuffer(other.mBuffer), mClass(other.mClass) {
+        other.mPool = nullptr;
+        other.mBuffer = cl::Buffer();
+    }
+    cl_buffer_handle& operator=(cl_buffer_handle&& other) {
+        if (this != &other) {
+            reset();
+            mPool = other.mPool;
+            mBuffer = other.mBuffer;
+            mClass = other.mClass;
+            other.mPool = nullptr;
+            other.mBuffer = cl::Buffer();
+        }
+        return *this;
+    }
+    ~cl_buffer_handle() { reset(); }
+
+    inline void reset();
+    cl::Buffer& get() { return mBuffer; }
+    size_t capacity() { return mClass; }
+
+   private:
+    cl_buffer_pool* mPool;
+    cl::Buffer mBuffer;
+    size_t mClass;
+
+    cl_buffer_handle(const cl_buffer_handle&);
+    cl_buffer_handle& operator=(const cl_buffer_handle&);
+};
+
+class cl_buffer_pool {
+   public:
+    // max_cached_bytes bounds the device memory kept in free lists, 0 means unbounded
+    explicit cl_buffer_pool(const cl::Context& context, size_t max_cached_bytes = 0)
+        : mContext(context), mMaxCached(max_cached_bytes), mBytesCached(0) {
+        mStats = cl_buffer_pool_stats();
+    }
+
+    ~cl_buffer_pool() {
+        if (mStats.bytesInUse != 0) {
+            fprintf(stderr, "WARNING: cl_buffer_pool destroyed with %llu bytes still in use\n",
+                    (unsigned long long)mStats.bytesInUse);
+        }
+    }
+
+    cl_buffer_handle acquire(size_t bytes) {
+        size_t cls = xf::cv::MatPool::sizeClass(bytes);
+        std::lock_guard<std::mutex> lg(mLock);
+        cl::Buffer buffer;
+        std::vector<cl::Buffer>& list = mFree[cls];
+        if (!list.empty()) {
+            buffer = list.back();
+            list.pop_back();
+            mBytesCached -= cls;
+            mStats.hits++;
+        } else {
+            OCL_CHECK(err, cl::Buffer created(mContext, CL_MEM_READ_WRITE, cls, NULL, &err));
+            buffer = std::move(created);
+            mStats.misses++;
+            mStats.bytesResident += cls;
+            if (mStats.bytesResident > mStats.peakBytesResident) mStats.peakBytesResident = mStats.bytesResident;
+        }
+        mStats.bytesInUse += cls;
+        return cl_buffer_handle(this, buffer, cls);
+    }
+
+    /* Releases every cached buffer back to the device */
+    void trim() {
+        std::lock_guard<std::mutex> lg(mLock);
+        mFree.clear();
+        mStats.bytesResident -= mBytesCached;
+        mBytesCached = 0;
+    }
+
+    cl_buffer_pool_stats stats() {
+        std::lock_guard<std::mutex> lg(mLock);
+        return mStats;
+    }
+
+    void printStats() {
+        cl_buffer_pool_stats st = stats();
+        std::cout << "INFO: Device buffer pool : " << st.hits << " hits, " << st.misses << " misses, "
+                  << ((double)st.bytesResident / 1048576) << " MB resident (peak "
+                  << ((double)st.peakBytesResident / 1048576) << " MB)" << std::endl;
+    }
+
+   private:
+    friend class cl_buffer_handle;
+
+    cl::Context mContext;
+    std::mutex mLock;
+    std::map<size_t, std::vector<cl::Buffer> > mFree;
+    size_t mMaxCached;
+    uint64_t mBytesCached;
+    cl_buffer_pool_stats mStats;
+    static int err;
+
+    cl_buffer_pool(const cl_buffer_pool&);
+    cl_buffer_pool& operator=(const cl_buffer_pool&);
+
+    void release(cl::Buffer& buffer, size_t cls) {
+        std::lock_guard<std::mutex> lg(mLock);
+        mStats.releases++;
+        mStats.bytesInUse -= cls;
+        if ((mMaxCached != 0) && (mBytesCached + cls > mMaxCached)) {
+            mStats.bytesResident -= cls;
+            return; // The last reference goes with the handle
+        }
+        mFree[cls].push_back(buffer);
+        mBytesCached += cls;
+    }
+};
+int cl_buffer_pool::err = 0;
+
+inline void cl_buffer_handle::reset() {
+    if (mPool != nullptr) mPool->release(mBuffer, mClass);
+    mPool = nullptr;
+    mBuffer = cl::Buffer();
+}
+
 struct cl_buffer_wrapper {
     void* mData;
     size_t mSize;
@@ -39,6 +205,8 @@ struct cl_buffer_wrapper {
     static int err;
     cl::Event mEvent;
     cl_mem_flags mFlag;
+    cl_buffer_handle mHandle;
+    std::vector<cl::Event> mReaders;
 
     cl_buffer_wrapper(cl::Context& context, void* data, size_t size, cl_mem_flags flag)
         : mData(data), mSize(size), mFlag(flag) {
@@ -48,15 +216,231 @@ struct cl_buffer_wrapper {
         }
     }
 
+    /* Device buffer taken from a pool and handed back when the wrapper is deleted */
+    cl_buffer_wrapper(cl_buffer_pool& pool, void* data, size_t size)
+        : mData(data), mSize(size), mFlag(CL_MEM_READ_WRITE) {
+        if (size > 0) {
+            mHandle = pool.acquire(size);
+            mBuffer = mHandle.get();
+        }
+    }
+
     cl::Event& getEvent() { return mEvent; }
     cl::Buffer& getBuffer() { return mBuffer; }
+
+    /* Commands of the last run that read the device buffer; whatever writes it next waits on them */
+    void addReader(const cl::Event& event) {
+        // Drop readers that have completed, a buffer nothing writes would otherwise collect every run's
+        mReaders.erase(std::remove_if(mReaders.begin(), mReaders.end(),
+                                      [](const cl::Event& e) {
+                                          return e.getInfo<CL_EVENT_COMMAND_EXECUTION_STATUS>() <= CL_COMPLETE;
+                                      }),
+                       mReaders.end());
+        mReaders.push_back(event);
+    }
+
+    /* Appends the pending readers to a writer's wait list, which orders every later reader behind them */
+    void takeReaders(std::vector<cl::Event>& events) {
+        events.insert(events.end(), mReaders.begin(), mReaders.end());
+        mReaders.clear();
+    }
+
     size_t getSize() { return mSize; }
     void* getData() { return mData; }
+    /* Rebinds the host side, e.g. to the next slice, keeping the device buffer */
+    void setData(void* data) { mData = data; }
     cl_mem_flags getFlag() { return mFlag; }
     void setFlag(cl_mem_flags flg) { mFlag = flg; }
 };
 int cl_buffer_wrapper::err = 0;
 
+/* Completion of a set of events, delivered through event callbacks instead of a blocking wait. The future
+ * holds CL_SUCCESS, or the first negative execution status reported by one of the events. */
+class cl_completion {
+   public:
+    static std::future<int> whenAll(const std::vector<cl::Event>& events, std::function<void()> on_done = nullptr) {
+        cl_completion* done = new cl_completion(events.size(), on_done);
+        std::future<int> result = done->mPromise.get_future();
+        if (events.empty()) {
+            if (on_done) on_done();
+            done->mPromise.set_value(CL_SUCCESS);
+            delete done;
+            return result;
+        }
+        for (auto event : events) {
+            OCL_CHECK(err, err = event.setCallback(CL_COMPLETE, &cl_completion::notify, done));
+        }
+        return result;
+    }
+
+   private:
+    std::atomic<size_t> mPending;
+    std::atomic<int> mStatus;
+    std::promise<int> mPromise;
+    std::function<void()> mOnDone;
+    static int err;
+
+    cl_completion(size_t pending, std::function<void()> on_done)
+        : mPending(pending), mStatus(CL_SUCCESS), mOnDone(on_done) {}
+
+    static void CL_CALLBACK notify(cl_event, cl_int status, void* user_data) {
+        cl_completion* done = (cl_completion*)user_data;
+        if (status < 0) {
+            int expected = CL_SUCCESS;
+            done->mStatus.compare_exchange_strong(expected, status);
+        }
+        if (--done->mPending == 0) {
+            if (done->mOnDone) done->mOnDone();
+            done->mPromise.set_value(done->mStatus.load());
+            delete done;
+        }
+    }
+};
+int cl_completion::err = 0;
+
+//----------------------------------------------------------------------------------------------------//
+// OpenCL event timeline
+//
+// When enabled, every kernel, write and read the wrappers enqueue is timed from a completion callback
+// (QUEUED, SUBMIT, START and END) and can be written as a Chrome trace, which chrome://tracing and
+// ui.perfetto.dev open. Each command queue gets its own lane, so transfers that fail to overlap with
+// kernels show up directly, without the xrt.ini trace options:
+//
+//     cl_trace::instance().enable();
+//     cl_kernel_mgr::exec_all();
+//     cl_trace::instance().write("medimg_trace.json");
+//
+// Setting XF_CL_TRACE=<file> in the environment enables it when cl_kernel_mgr starts and writes <file>
+// at exit.
+//----------------------------------------------------------------------------------------------------//
+class cl_trace {
+   public:
+    static cl_trace& instance() {
+        static cl_trace trace;
+        return trace;
+    }
+
+    /* Starts recording; with a path, the trace is written there when the process exits */
+    void enable(const char* path_at_exit = nullptr) {
+        mEnabled = true;
+        if ((path_at_exit != nullptr) && mExitPath.empty()) {
+            mExitPath = path_at_exit;
+            std::atexit(&cl_trace::writeAtExit);
+        }
+    }
+
+    void disable() { mEnabled = false; }
+    bool enabled() { return mEnabled; }
+
+    /* Times event once it completes; category is "kernel", "write" or "read" */
+    void record(cl::Event& event, cl::CommandQueue& queue, const char* category, const std::string& name, size_t bytes) {
+        if (!mEnabled || (event() == nullptr)) return;
+        Record* rec = new Record();
+        rec->owner = this;
+        rec->category = category;
+        rec->name = name;
+        rec->bytes = bytes;
+        {
+            std::lock_guard<std::mutex> lg(mLock);
+            auto it = mLanes.find((const void*)queue());
+            if (it == mLanes.end()) it = mLanes.insert(std::make_pair((const void*)queue(), (int)mLanes.size())).first;
+            rec->lane = it->second;
+        }
+        OCL_CHECK(err, err = event.setCallback(CL_COMPLETE, &cl_trace::onComplete, rec));
+    }
+
+    size_t size() {
+        std::lock_guard<std::mutex> lg(mLock);
+        return mRecords.size();
+    }
+
+    void clear() {
+        std::lock_guard<std::mutex> lg(mLock);
+        mRecords.clear();
+    }
+
+    /* Writes the events recorded so far in Chrome trace event format, times in us from the first QUEUED */
+    bool write(const char* path) {
+        std::lock_guard<std::mutex> lg(mLock);
+        FILE* f = fopen(path, "w");
+        if (f == NULL) {
+            fprintf(stderr, "ERROR: Cannot open trace file %s\n", path);
+            return false;
+        }
+        cl_ulong origin = ~(cl_ulong)0;
+        for (auto& r : mRecords) origin = std::min(origin, r.queued);
+
+        fprintf(f, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+        fprintf(f, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"OpenCL device\"}}");
+        for (size_t lane = 0; lane < mLanes.size(); lane++) {
+            fprintf(f, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%zu,\"args\":{\"name\":\"queue %zu\"}}",
+                    lane, lane);
+        }
+        for (auto& r : mRecords) {
+            fprintf(f,
+                    ",\n{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f,"
+                    "\"args\":{\"bytes\":%zu,\"queued_us\":%.3f,\"submit_us\":%.3f,\"wait_us\":%.3f,\"status\":%d}}",
+                    escape(r.name).c_str(), r.category.c_str(), r.lane, (double)(r.start - origin) / 1000,
+                    (double)(r.end - r.start) / 1000, r.bytes, (double)(r.queued - origin) / 1000,
+                    (double)(r.submit - origin) / 1000, (double)(r.start - r.queued) / 1000, r.status);
+        }
+        fprintf(f, "\n]}\n");
+        fclose(f);
+        std::cout << "INFO: Wrote " << mRecords.size() << " OpenCL events to " << path << std::endl;
+        return true;
+    }
+
+   private:
+    struct Record {
+        cl_trace* owner;
+        std::string category;
+        std::string name;
+        size_t bytes;
+        int lane;
+        cl_ulong queued, submit, start, end;
+        cl_int status;
+    };
+
+    std::atomic<bool> mEnabled;
+    std::string mExitPath;
+    std::mutex mLock;
+    std::map<const void*, int> mLanes; // Command queue to trace lane
+    std::vector<Record> mRecords;
+    static int err;
+
+    cl_trace() : mEnabled(false) {}
+
+    static void CL_CALLBACK onComplete(cl_event event, cl_int status, void* user_data) {
+        Record* rec = (Record*)user_data;
+        rec->queued = rec->submit = rec->start = rec->end = 0;
+        clGetEventProfilingInfo(event, CL_PROFILING_COMMAND_QUEUED, sizeof(cl_ulong), &rec->queued, NULL);
+        clGetEventProfilingInfo(event, CL_PROFILING_COMMAND_SUBMIT, sizeof(cl_ulong), &rec->submit, NULL);
+        clGetEventProfilingInfo(event, CL_PROFILING_COMMAND_START, sizeof(cl_ulong), &rec->start, NULL);
+        clGetEventProfilingInfo(event, CL_PROFILING_COMMAND_END, sizeof(cl_ulong), &rec->end, NULL);
+        rec->status = status;
+        {
+            std::lock_guard<std::mutex> lg(rec->owner->mLock);
+            rec->owner->mRecords.push_back(*rec);
+        }
+        delete rec;
+    }
+
+    static void writeAtExit() {
+        cl_trace& trace = instance();
+        trace.write(trace.mExitPath.c_str());
+    }
+
+    static std::string escape(const std::string& str) {
+        std::string out;
+        for (char c : str) {
+            if ((c == '"') || (c == '\\')) out += '\\';
+            if ((unsigned char)c >= 0x20) out += c;
+        }
+        return out;
+    }
+};
+int cl_trace::err = 0;
+
 class cl_kernel_wrapper {
    private:
     cl::Context mContext;
@@ -65,15 +449,44 @@ class cl_kernel_wrapper {
     std::vector<cl_buffer_wrapper*> mBuffersIn;
     std::vector<cl_buffer_wrapper*> mBuffersOut;
     std::vector<cl_buffer_wrapper*> mBuffersAll;
+    std::vector<std::unique_ptr<cl_buffer_wrapper> > mBuffersOwned; // Created by this kernel
+    cl_buffer_pool* mPool;
     cl::Event mEvent;
     cl::CommandQueue mQueue;
+    bool mQueuePinned; // mQueue was chosen by the user, the graph scheduler leaves it alone
     bool mConsumed;
+    std::shared_ptr<std::atomic<cl_ulong> > mExecTimeNs; // Shared with the completion callbacks
 
     cl::Kernel mKernel;
     std::vector<cl_kernel_wrapper*> mDepends; // Adjacency list for a DAG of kernel wrappers
 
     static int err;
 
+    /* Owned by one completion callback, which may run after releaseKernels() deleted the wrapper */
+    struct KernelRun {
+        std::string name;
+        std::shared_ptr<std::atomic<cl_ulong> > execTimeNs;
+    };
+
+    /* Runs on an OpenCL runtime thread once the kernel has finished, must not block */
+    static void CL_CALLBACK onKernelComplete(cl_event event, cl_int status, void* user_data) {
+        std::unique_ptr<KernelRun> run((KernelRun*)user_data);
+        static std::mutex print_lock;
+        std::lock_guard<std::mutex> lg(print_lock);
+        if (status < 0) {
+            std::cout << "Kernel [" << run->name << "] failed with status " << status << std::endl;
+            return;
+        }
+        // mEvent may already belong to the next run, the event of this one is the argument
+        cl_ulong start = 0;
+        cl_ulong end = 0;
+        clGetEventProfilingInfo(event, CL_PROFILING_COMMAND_START, sizeof(cl_ulong), &start, NULL);
+        clGetEventProfilingInfo(event, CL_PROFILING_COMMAND_END, sizeof(cl_ulong), &end, NULL);
+        *run->execTimeNs = end - start;
+        std::cout << "Kernel [" << run->name << "] execution time : " << ((double)(end - start) / 1000000) << "ms"
+                  << std::endl;
+    }
+
     void sanitizeRW(cl_buffer_wrapper* buff, const cl_mem_flags flag) {
         /* In case a cl::Buffer was created as output of a kernel function and later is modified as input to another
          * kernel function then the flag needs to be modified to RW */
@@ -90,19 +503,26 @@ class cl_kernel_wrapper {
                       const std::string& bin_name,
                       std::string& device_name,
                       cl::CommandQueue Queue,
-                      std::vector<cl::Device>& devices)
-        : mContext(context), mFuncName(func_name), mBinName(bin_name), mQueue(Queue) {
+                      std::vector<cl::Device>& devices,
+                      cl_buffer_pool* pool = nullptr)
+        : mContext(context), mFuncName(func_name), mBinName(bin_name), mPool(pool), mQueue(Queue) {
         std::string binaryFile = xcl::find_binary_file(device_name, mBinName.c_str());
         cl::Program::Binaries bins = xcl::import_binary_file(binaryFile);
         OCL_CHECK(err, cl::Program program(context, devices, bins, NULL, &err));
+        xcl::release_binary_file(bins);
         OCL_CHECK(err, cl::Kernel kernel(program, mFuncName.c_str(), &err));
         mKernel = std::move(kernel);
+        mQueuePinned = false;
         mConsumed = false;
+        mExecTimeNs = std::make_shared<std::atomic<cl_ulong> >(0);
     }
 
     bool isConsumed() { return mConsumed; }
     void setConsumed(bool bflg) { mConsumed = bflg; }
 
+    /* Device time of the last completed execution, 0 until its profiling callback has run */
+    double getExecTimeMs() { return (double)mExecTimeNs->load() / 1000000; }
+
     /*IMP : Inputs and outputs should be registered exactly in the same order as they are expected at Kernel interface
      */
     int argCount() { return mBuffersAll.size(); }
@@ -125,7 +545,9 @@ class cl_kernel_wrapper {
 
     /*NOTE : host data pointer can be NULL in case data transaction from host is not required */
     cl_buffer_wrapper* registerInput(void* data, size_t size) {
-        cl_buffer_wrapper* buffin = new cl_buffer_wrapper(mContext, data, size, CL_MEM_READ_ONLY);
+        cl_buffer_wrapper* buffin = (mPool != nullptr) ? new cl_buffer_wrapper(*mPool, data, size)
+                                                       : new cl_buffer_wrapper(mContext, data, size, CL_MEM_READ_ONLY);
+        mBuffersOwned.push_back(std::unique_ptr<cl_buffer_wrapper>(buffin));
         registerInput(buffin);
         return buffin;
     }
@@ -156,7 +578,9 @@ class cl_kernel_wrapper {
 
     /*NOTE : host data pointer can be NULL in case data transaction from host is not required */
     cl_buffer_wrapper* registerOutput(void* data, size_t size) {
-        cl_buffer_wrapper* buffout = new cl_buffer_wrapper(mContext, data, size, CL_MEM_WRITE_ONLY);
+        cl_buffer_wrapper* buffout = (mPool != nullptr) ? new cl_buffer_wrapper(*mPool, data, size)
+                                                        : new cl_buffer_wrapper(mContext, data, size, CL_MEM_WRITE_ONLY);
+        mBuffersOwned.push_back(std::unique_ptr<cl_buffer_wrapper>(buffout));
         registerOutput(buffout);
         return buffout;
     }
@@ -192,14 +616,21 @@ class cl_kernel_wrapper {
         for (unsigned int i = 0; i < mBuffersIn.size(); i++) {
             if (mBuffersIn[i]->getSize() > 0) {
                 if ((mBuffersIn[i]->getData())) {
+                    // The previous run's kernels may still be reading the buffer
+                    std::vector<cl::Event> readers;
+                    mBuffersIn[i]->takeReaders(readers);
                     OCL_CHECK(err, mQueue.enqueueWriteBuffer(mBuffersIn[i]->getBuffer(), // buffer on the FPGA
                                                              CL_FALSE,                   // blocking call
                                                              0,                          // buffer offset in bytes
                                                              mBuffersIn[i]->getSize(),   // Size in bytes
                                                              mBuffersIn[i]->getData(),   // Host data pointer
-                                                             nullptr, &(mBuffersIn[i]->getEvent())));
+                                                             readers.empty() ? nullptr : &readers,
+                                                             &(mBuffersIn[i]->getEvent())));
+                    cl_trace::instance().record(mBuffersIn[i]->getEvent(), mQueue, "write",
+                                                mFuncName + " arg " + std::to_string(i), mBuffersIn[i]->getSize());
                 }
-                events.push_back(mBuffersIn[i]->getEvent());
+                // Buffers produced by another kernel have no write event, mDepends orders them
+                if (mBuffersIn[i]->getEvent()() != nullptr) events.push_back(mBuffersIn[i]->getEvent());
             }
         }
     }
@@ -216,6 +647,9 @@ class cl_kernel_wrapper {
                                                         mBuffersOut[i]->getSize(),   // Size in bytes
                                                         mBuffersOut[i]->getData(),   // Host data pointer
                                                         &events, &(mBuffersOut[i]->getEvent())));
+                mBuffersOut[i]->addReader(mBuffersOut[i]->getEvent());
+                cl_trace::instance().record(mBuffersOut[i]->getEvent(), mQueue, "read",
+                                            mFuncName + " out " + std::to_string(i), mBuffersOut[i]->getSize());
             }
         }
     }
@@ -225,35 +659,69 @@ class cl_kernel_wrapper {
         krnl->setConsumed(true);
     }
 
-    void exec() {
-        for (auto& k : mDepends) {
-            k->exec();
-        }
+    const std::vector<cl_kernel_wrapper*>& getDepends() { return mDepends; }
+    const std::string& getName() { return mFuncName; }
+    cl::CommandQueue& getQueue() { return mQueue; }
+    /* Runs the kernel on queue from now on, whichever lane the graph scheduler gives it */
+    void setQueue(const cl::CommandQueue& queue) {
+        mQueue = queue;
+        mQueuePinned = true;
+    }
+    /* The graph scheduler's lane, unless the queue was set explicitly */
+    void setLaneQueue(const cl::CommandQueue& queue) {
+        if (!mQueuePinned) mQueue = queue;
+    }
+
+    /* Kernel event of the last exec(), the next exec() replaces it */
+    cl::Event lastEvent() { return mEvent; }
 
+    /* Profiled START and END of an execution, valid once it has completed */
+    static void profiledTime(const cl::Event& event, cl_ulong& start, cl_ulong& end) {
+        start = end = 0;
+        event.getProfilingInfo(CL_PROFILING_COMMAND_START, &start);
+        event.getProfilingInfo(CL_PROFILING_COMMAND_END, &end);
+    }
+
+    /* Enqueues this kernel only, behind the kernels it depends on. Those have to be enqueued already, see
+     * cl_kernel_mgr::exec() for running a kernel together with everything it depends on. */
+    void exec() {
         std::vector<cl::Event> events;
         for (auto& k : mDepends) {
             events.push_back(k->mEvent);
         }
         std::cout << "Starting kernel [" << mFuncName << "] execution" << std::endl;
         enqueueWriteBuffer(events);
+        // Outputs are overwritten, behind whatever still reads them from the previous run
+        for (unsigned int i = 0; i < mBuffersOut.size(); i++) {
+            if (mBuffersOut[i]->getSize() > 0) mBuffersOut[i]->takeReaders(events);
+        }
         if (events.size() == 0) {
             OCL_CHECK(err, err = mQueue.enqueueTask(mKernel, NULL, &mEvent));
         } else {
             OCL_CHECK(err, err = mQueue.enqueueTask(mKernel, &events, &mEvent));
         }
-        // Added for profiling [[
-        clWaitForEvents(1, (const cl_event*)&mEvent);
-
-        cl_ulong start = 0;
-        cl_ulong end = 0;
-        double diff_prof = 0.0f;
-        mEvent.getProfilingInfo(CL_PROFILING_COMMAND_START, &start);
-        mEvent.getProfilingInfo(CL_PROFILING_COMMAND_END, &end);
-        diff_prof = end - start;
-        std::cout << "Kernel [" << mFuncName << "] execution time : " << (diff_prof / 1000000) << "ms" << std::endl;
-        //]]
+        for (unsigned int i = 0; i < mBuffersIn.size(); i++) {
+            if (mBuffersIn[i]->getSize() > 0) mBuffersIn[i]->addReader(mEvent);
+        }
+        // Profiling is reported from the completion callback, the host never waits here
+        KernelRun* run = new KernelRun();
+        run->name = mFuncName;
+        run->execTimeNs = mExecTimeNs;
+        OCL_CHECK(err, err = mEvent.setCallback(CL_COMPLETE, &cl_kernel_wrapper::onKernelComplete, run));
+        cl_trace::instance().record(mEvent, mQueue, "kernel", mFuncName, 0);
         enqueueReadBuffer();
     }
+
+    /* Events that complete the last exec(): the kernel and the reads back to the host */
+    void completionEvents(std::vector<cl::Event>& events) {
+        if (mEvent() == nullptr) return;
+        events.push_back(mEvent);
+        for (unsigned int i = 0; i < mBuffersOut.size(); i++) {
+            if ((mBuffersOut[i]->getSize() > 0) && (mBuffersOut[i]->getData())) {
+                events.push_back(mBuffersOut[i]->getEvent());
+            }
+        }
+    }
 };
 int cl_kernel_wrapper::err = 0;
 
@@ -271,6 +739,137 @@ class cl_kernel_mgr {
     static cl_kernel_mgr* mRegistry;
     static int err;
 
+    std::vector<cl::CommandQueue> mLaneQueues; // Queues of the graph scheduler beyond mCurrQueue
+    bool mQueueChosen;                         // createNewQueue() was called, new kernels keep mCurrQueue
+    std::atomic<double> mCriticalPathMs;       // Written by the completion callback of a graph
+    std::unique_ptr<cl_buffer_pool> mBufferPool;
+
+    cl::CommandQueue& laneQueue(size_t lane) {
+        if (lane == 0) return mCurrQueue;
+        while (mLaneQueues.size() < lane) {
+            OCL_CHECK(err,
+                      cl::CommandQueue queue(mContext, mDevice,
+                                             (CL_QUEUE_PROFILING_ENABLE | CL_QUEUE_OUT_OF_ORDER_EXEC_MODE_ENABLE), &err));
+            mLaneQueues.push_back(std::move(queue));
+        }
+        return mLaneQueues[lane - 1];
+    }
+
+    /* Enqueues every node exactly once in topological order (Kahn). A node continues the lane (command queue)
+     * of a producer that ended there, independent branches get lanes of their own, up to XF_CL_MAX_QUEUES.
+     * Kernels whose queue was chosen with createNewQueue() or setQueue() stay on it; the event dependencies
+     * order them all the same. */
+    std::future<int> schedule(const std::vector<cl_kernel_wrapper*>& nodes) {
+        const size_t n = nodes.size();
+        std::vector<int> indegree(n, 0);
+        std::vector<std::vector<size_t> > consumers(n);
+        std::vector<std::vector<size_t> > producers(n);
+        for (size_t i = 0; i < n; i++) {
+            for (auto& d : nodes[i]->getDepends()) {
+                size_t p = std::find(nodes.begin(), nodes.end(), d) - nodes.begin();
+                if (p == n) continue; // Not part of this run
+                producers[i].push_back(p);
+                consumers[p].push_back(i);
+                indegree[i]++;
+            }
+        }
+
+        std::vector<size_t> order;
+        for (size_t i = 0; i < n; i++) {
+            if (indegree[i] == 0) order.push_back(i);
+        }
+        for (size_t head = 0; head < order.size(); head++) {
+            for (auto& c : consumers[order[head]]) {
+                if (--indegree[c] == 0) order.push_back(c);
+            }
+        }
+        if (order.size() != n) {
+            fprintf(stderr, "ERROR: Kernel graph has a dependency cycle, %zu of %zu kernels can't be scheduled\n",
+                    n - order.size(), n);
+            exit(EXIT_FAILURE);
+        }
+
+        std::vector<size_t> lane(n, 0);
+        std::vector<size_t> laneTail; // Last node of every lane
+        std::vector<size_t> laneLoad;
+        for (auto& i : order) {
+            size_t l = laneTail.size();
+            for (auto& p : producers[i]) {
+                if (laneTail[lane[p]] == p) {
+                    l = lane[p];
+                    break;
+                }
+            }
+            if (l == laneTail.size()) {
+                if (laneTail.size() < XF_CL_MAX_QUEUES) {
+                    laneTail.push_back(i);
+                    laneLoad.push_back(0);
+                } else {
+                    l = std::min_element(laneLoad.begin(), laneLoad.end()) - laneLoad.begin();
+                }
+            }
+            lane[i] = l;
+            laneTail[l] = i;
+            laneLoad[l]++;
+            nodes[i]->setLaneQueue(laneQueue(l));
+            nodes[i]->exec();
+        }
+
+        std::vector<cl::Event> events;
+        for (auto& node : nodes) {
+            node->completionEvents(events);
+        }
+        flush();
+
+        std::cout << "INFO: Scheduled " << n << " kernels on " << laneTail.size() << " queue(s)" << std::endl;
+        // Copies, the callback must not touch the wrappers: releaseKernels() may delete them first
+        std::vector<std::string> names;
+        std::vector<cl::Event> runs; // Kernel events of this run, the wrappers' own move on with the next one
+        for (auto& i : order) {
+            names.push_back(nodes[i]->getName());
+            runs.push_back(nodes[i]->lastEvent());
+        }
+        return cl_completion::whenAll(
+            events, [this, names, runs, producers, order]() { reportCriticalPath(names, runs, producers, order); });
+    }
+
+    /* Runs from the completion callback of a graph, all its events are complete */
+    void reportCriticalPath(const std::vector<std::string>& names,
+                            const std::vector<cl::Event>& runs,
+                            const std::vector<std::vector<size_t> >& producers,
+                            const std::vector<size_t>& order) {
+        const size_t n = names.size();
+        if (n == 0) return;
+        std::vector<size_t> position(n);
+        for (size_t k = 0; k < n; k++) position[order[k]] = k;
+
+        // Longest path over the topological order, by kernel execution time
+        std::vector<double> path(n, 0.0);
+        std::vector<size_t> prev(n, n);
+        cl_ulong first = ~(cl_ulong)0, last = 0;
+        size_t end = 0;
+        for (size_t k = 0; k < n; k++) {
+            cl_ulong start, stop;
+            cl_kernel_wrapper::profiledTime(runs[k], start, stop);
+            first = std::min(first, start);
+            last = std::max(last, stop);
+            for (auto& p : producers[order[k]]) {
+                if (path[position[p]] > path[k]) {
+                    path[k] = path[position[p]];
+                    prev[k] = position[p];
+                }
+            }
+            path[k] += (double)(stop - start) / 1000000;
+            if (path[k] > path[end]) end = k;
+        }
+
+        std::string chain = names[end];
+        for (size_t k = prev[end]; k != n; k = prev[k]) chain = names[k] + " -> " + chain;
+        mCriticalPathMs.store(path[end]);
+        std::cout << "INFO: Kernel graph makespan " << ((double)(last - first) / 1000000) << "ms, critical path "
+                  << path[end] << "ms (" << chain << ")" << std::endl;
+    }
+
     cl_kernel_mgr() {
         std::cout << "INFO: Running OpenCL section." << std::endl;
 
@@ -290,6 +889,12 @@ class cl_kernel_mgr {
         OCL_CHECK(err, std::string device_name = mDevice.getInfo<CL_DEVICE_NAME>(&err));
         std::cout << "INFO: Device found - " << device_name << std::endl;
         mDeviceName = device_name;
+        mQueueChosen = false;
+        mCriticalPathMs.store(0.0);
+        mBufferPool.reset(new cl_buffer_pool(mContext, XF_CL_BUFFER_POOL_MAX_CACHED));
+
+        const char* trace_path = getenv("XF_CL_TRACE");
+        if ((trace_path != nullptr) && (trace_path[0] != '\0')) cl_trace::instance().enable(trace_path);
     }
 
    public:
@@ -301,7 +906,8 @@ class cl_kernel_mgr {
 
         cl_kernel_wrapper* kernel =
             new cl_kernel_wrapper(mRegistry->mContext, func_name, bin_name, mRegistry->mDeviceName,
-                                  mRegistry->mCurrQueue, mRegistry->mDevices);
+                                  mRegistry->mCurrQueue, mRegistry->mDevices, mRegistry->mBufferPool.get());
+        if (mRegistry->mQueueChosen) kernel->setQueue(mRegistry->mCurrQueue);
         mRegistry->mKernelVec.push_back(kernel);
         return kernel;
     }
@@ -315,15 +921,38 @@ class cl_kernel_mgr {
 
         cl_kernel_wrapper* kernel =
             new cl_kernel_wrapper(mRegistry->mContext, func_name, bin_name, mRegistry->mDeviceName,
-                                  mRegistry->mCurrQueue, mRegistry->mDevices);
+                                  mRegistry->mCurrQueue, mRegistry->mDevices, mRegistry->mBufferPool.get());
+        if (mRegistry->mQueueChosen) kernel->setQueue(mRegistry->mCurrQueue);
         mRegistry->mKernelVec.push_back(kernel);
         kernel->registerArgs(argv...);
         return kernel;
     }
 
-    static void exec(cl_kernel_wrapper* kernel) {
+    /* Runs kernel together with the kernels it (transitively) depends on, see exec_all() */
+    static std::future<int> exec(cl_kernel_wrapper* kernel) {
         ASSERT(nullptr != mRegistry);
-        kernel->exec();
+        std::vector<cl_kernel_wrapper*> nodes;
+        std::vector<cl_kernel_wrapper*> pending(1, kernel);
+        while (!pending.empty()) {
+            cl_kernel_wrapper* k = pending.back();
+            pending.pop_back();
+            if (std::find(nodes.begin(), nodes.end(), k) != nodes.end()) continue;
+            nodes.push_back(k);
+            for (auto& d : k->getDepends()) pending.push_back(d);
+        }
+        return mRegistry->schedule(nodes);
+    }
+
+    /* Submits everything enqueued so far, so that it runs while the host carries on */
+    static void flush() {
+        ASSERT(nullptr != mRegistry);
+        for (auto& q : mRegistry->mQueueVec) {
+            q.flush();
+        }
+        for (auto& q : mRegistry->mLaneQueues) {
+            q.flush();
+        }
+        mRegistry->mCurrQueue.flush();
     }
 
     static void finish() {
@@ -331,19 +960,57 @@ class cl_kernel_mgr {
         for (auto& q : mRegistry->mQueueVec) {
             q.finish();
         }
+        for (auto& q : mRegistry->mLaneQueues) {
+            q.finish();
+        }
         mRegistry->mCurrQueue.finish();
     }
 
-    static void exec_all() {
+    /* Deletes every registered kernel and hands the buffers they created back to the pool, for the next
+     * frame's kernels to reuse. Waits for the work still enqueued, which may be using those buffers. */
+    static void releaseKernels() {
         ASSERT(nullptr != mRegistry);
+        finish();
         for (auto& it : mRegistry->mKernelVec) {
-            if (it->isConsumed() == false) exec(it);
+            delete it;
         }
+        mRegistry->mKernelVec.clear();
+    }
+
+    static cl_buffer_pool& bufferPool() {
+        ASSERT(nullptr != mRegistry);
+        return *mRegistry->mBufferPool;
+    }
+
+    /* Longest dependency chain of the last completed graph, by profiled kernel time */
+    static double criticalPathMs() {
+        ASSERT(nullptr != mRegistry);
+        return mRegistry->mCriticalPathMs.load();
+    }
+
+    /* Runs the whole graph and returns once every kernel and read back has completed */
+    static void exec_all() {
+        exec_all_async().wait();
         finish();
     }
 
+    /* Enqueues the whole graph with event dependencies only and returns without waiting. The future becomes
+     * ready with CL_SUCCESS (or the first failing status) once every kernel and read back has completed:
+     *
+     *     std::future<int> done = cl_kernel_mgr::exec_all_async();
+     *     ... CPU work on the next frame ...
+     *     if (done.get() != CL_SUCCESS) ...
+     */
+    static std::future<int> exec_all_async() {
+        ASSERT(nullptr != mRegistry);
+        return mRegistry->schedule(mRegistry->mKernelVec);
+    }
+
+    /* Kernels registered from now on run on a new command queue, which the graph scheduler keeps them on
+     * instead of placing them on its own lanes */
     static void createNewQueue() {
         ASSERT(nullptr != mRegistry);
+        mRegistry->mQueueChosen = true;
         mRegistry->mQueueVec.push_back(mRegistry->mCurrQueue);
         OCL_CHECK(err,
                   cl::CommandQueue queue(mRegistry->mContext, mRegistry->mDevice,
@@ -0,0 +1,214 @@
+/*
+ * Copyright 2021 Xilinx, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _MEDIMG_BILATERAL_GRID_H_
+#define _MEDIMG_BILATERAL_GRID_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+namespace medimg {
+
+//----------------------------------------------------------------------------------------------------//
+// CPU counterpart of xf::cv::bilateralGrid (imgproc/xf_bilateral_grid.hpp)
+//
+// Edge preserving denoise ahead of thresholding: pixels are splatted into cells of 2^spaceShift square
+// pixels by 2^rangeShift grey levels, the grid is blurred with [1 2 1] along all three axes and sliced
+// trilinearly, which approximates a bilateral filter with sigma_space ~ 0.87 * 2^spaceShift and
+// sigma_color ~ 0.87 * 2^rangeShift at a cost per pixel independent of both. The same integer arithmetic
+// as the kernel, so both give identical results. Every thread takes a range of S pixel row bands and
+// keeps only the cell rows around it, splatting the two cell rows on either side again; dst must not
+// overlap src:
+//
+//     medimg::BilateralGrid denoise(medimg::BilateralGridParams(4, 6, 12));  // sigma ~14 px, ~56 HU
+//     denoise.apply(raw, smooth, rows, cols);
+//----------------------------------------------------------------------------------------------------//
+
+struct BilateralGridParams {
+    int spaceShift; // log2 of the cell size in pixels, 1 .. 6
+    int rangeShift; // log2 of the cell size in grey levels, below inBits
+    int inBits;     // significant bits of the input, larger values count as the maximum
+    int threads;    // 0 for one per hardware thread
+
+    BilateralGridParams(int _spaceShift = 4, int _rangeShift = 6, int _inBits = 12)
+        : spaceShift(_spaceShift), rangeShift(_rangeShift), inBits(_inBits), threads(0) {}
+};
+
+class BilateralGrid {
+   public:
+    explicit BilateralGrid(const BilateralGridParams& params) : mParams(params) {}
+
+    const BilateralGridParams& params() const { return mParams; }
+
+    /* T is uint8_t or uint16_t; strides in elements, 0 for cols */
+    template <typename T>
+    void apply(const T* src, T* dst, int rows, int cols, int src_stride = 0, int dst_stride = 0) {
+        if (src_stride == 0) src_stride = cols;
+        if (dst_stride == 0) dst_stride = cols;
+        const int ss = mParams.spaceShift, rs = mParams.rangeShift;
+        const int s = 1 << ss, half = s / 2, r = 1 << rs;
+        const uint32_t in_max = (1u << mParams.inBits) - 1;
+        const int gx_n = ((cols - 1) >> ss) + 2, gy_n = ((rows - 1) >> ss) + 2;
+        const int gz = (int)(in_max >> rs) + 2;
+        const size_t row_cells = (size_t)gx_n * gz; // cell (gx, z) of a cell row at gx * gz + z
+        // Division in double is exact while the numerator and the quotient's resolution fit 52 bits
+        const bool exact_double = ((uint64_t)64 << (4 * ss + rs + mParams.inBits)) < ((uint64_t)1 << 52);
+
+        // Each thread slices a range of bands (band c = rows c * s .. c * s + s - 1) from its own rolling
+        // cell rows: splat row g covers rows g * s - s / 2 .. g * s + s / 2 - 1, blurred row g needs the
+        // [1 2 1] x and range blurred splat rows g - 1 .. g + 1, and band c blurred rows c and c + 1
+        forRanges(gy_n - 1, [&](int c0, int c1) {
+            std::vector<uint64_t> splat_v(row_cells), tmp_v(row_cells), xz_v(3 * row_cells), grid_v(2 * row_cells);
+            std::vector<uint32_t> splat_w(row_cells), tmp_w(row_cells), xz_w(3 * row_cells), grid_w(2 * row_cells);
+            for (int g = c0 - 1; g <= c1 + 1; g++) {
+                uint64_t* xv = &xz_v[(size_t)((g + 3) % 3) * row_cells];
+                uint32_t* xw = &xz_w[(size_t)((g + 3) % 3) * row_cells];
+                std::fill(splat_v.begin(), splat_v.end(), 0);
+                std::fill(splat_w.begin(), splat_w.end(), 0);
+                int y0 = std::max(g * s - half, 0), y1 = std::min(g * s + half, rows);
+                for (int y = y0; y < y1; y++) {
+                    const T* row = src + (size_t)y * src_stride;
+                    for (int x = 0; x < cols; x++) {
+                        uint32_t p = std::min<uint32_t>(row[x], in_max);
+                        size_t c = (size_t)((x + half) >> ss) * gz + ((p + r / 2) >> rs);
+                        splat_v[c] += p;
+                        splat_w[c]++;
+                    }
+                }
+                blurX(splat_v.data(), tmp_v.data(), gx_n, gz);
+                blurX(splat_w.data(), tmp_w.data(), gx_n, gz);
+                blurZ(tmp_v.data(), xv, gx_n, gz);
+                blurZ(tmp_w.data(), xw, gx_n, gz);
+
+                if (g - 1 >= c0) {
+                    // Blurred row g - 1 along y, rows outside the grid are empty
+                    const size_t above = (size_t)((g + 1) % 3) * row_cells, mid = (size_t)((g + 2) % 3) * row_cells;
+                    uint64_t* gv = &grid_v[(size_t)((g - 1) & 1) * row_cells];
+                    uint32_t* gw = &grid_w[(size_t)((g - 1) & 1) * row_cells];
+                    const bool has_above = (g - 2 >= 0), has_below = (g < gy_n);
+                    for (size_t i = 0; i < row_cells; i++) {
+                        gv[i] = 2 * xz_v[mid + i] + (has_above ? xz_v[above + i] : 0) + (has_below ? xv[i] : 0);
+                        gw[i] = 2 * xz_w[mid + i] + (has_above ? xz_w[above + i] : 0) + (has_below ? xw[i] : 0);
+                    }
+                }
+                if (g - 2 >= c0) {
+                    const int c = g - 2;
+                    sliceBand(src, dst, c, rows, cols, src_stride, dst_stride, &grid_v[(size_t)(c & 1) * row_cells],
+                              &grid_v[(size_t)((c + 1) & 1) * row_cells], &grid_w[(size_t)(c & 1) * row_cells],
+                              &grid_w[(size_t)((c + 1) & 1) * row_cells], gz, exact_double);
+                }
+            }
+        });
+    }
+
+   private:
+    BilateralGridParams mParams;
+
+    /* [1 2 1] along the cell columns, vectorizes over the grey level cells */
+    template <typename U>
+    static void blurX(const U* in, U* out, int gx_n, int gz) {
+        for (int gx = 0; gx < gx_n; gx++) {
+            const U* m = in + (size_t)gx * gz;
+            U* o = out + (size_t)gx * gz;
+            for (int z = 0; z < gz; z++) o[z] = 2 * m[z];
+            if (gx > 0)
+                for (int z = 0; z < gz; z++) o[z] += m[z - gz];
+            if (gx < gx_n - 1)
+                for (int z = 0; z < gz; z++) o[z] += m[z + gz];
+        }
+    }
+
+    /* [1 2 1] along the grey level cells of every cell column */
+    template <typename U>
+    static void blurZ(const U* in, U* out, int gx_n, int gz) {
+        for (int gx = 0; gx < gx_n; gx++) {
+            const U* m = in + (size_t)gx * gz;
+            U* o = out + (size_t)gx * gz;
+            o[0] = 2 * m[0] + m[1];
+            for (int z = 1; z < gz - 1; z++) o[z] = m[z - 1] + 2 * m[z] + m[z + 1];
+            o[gz - 1] = m[gz - 2] + 2 * m[gz - 1];
+        }
+    }
+
+    /* Trilinear interpolation of band c between blurred cell rows c (top) and c + 1 (bottom) */
+    template <typename T>
+    void sliceBand(const T* src,
+                   T* dst,
+                   int c,
+                   int rows,
+                   int cols,
+                   int src_stride,
+                   int dst_stride,
+                   const uint64_t* top_v,
+                   const uint64_t* bottom_v,
+                   const uint32_t* top_w,
+                   const uint32_t* bottom_w,
+                   int gz,
+                   bool exact_double) const {
+        const int ss = mParams.spaceShift, rs = mParams.rangeShift;
+        const int s = 1 << ss, r = 1 << rs;
+        const uint32_t in_max = (1u << mParams.inBits) - 1;
+        for (int y = c * s; y < std::min((c + 1) * s, rows); y++) {
+            const T* in = src + (size_t)y * src_stride;
+            T* out = dst + (size_t)y * dst_stride;
+            const uint64_t wy1 = y & (s - 1), wy0 = s - wy1;
+            for (int x = 0; x < cols; x++) {
+                const uint32_t q = std::min<uint32_t>(in[x], in_max);
+                const uint64_t wx1 = x & (s - 1), wx0 = s - wx1;
+                const uint64_t wz1 = q & (r - 1), wz0 = r - wz1;
+                const size_t i = (size_t)(x >> ss) * gz + (q >> rs), j = i + gz;
+                const uint64_t num =
+                    wy0 * (wx0 * (top_v[i] * wz0 + top_v[i + 1] * wz1) + wx1 * (top_v[j] * wz0 + top_v[j + 1] * wz1)) +
+                    wy1 * (wx0 * (bottom_v[i] * wz0 + bottom_v[i + 1] * wz1) +
+                           wx1 * (bottom_v[j] * wz0 + bottom_v[j + 1] * wz1));
+                const uint64_t den =
+                    wy0 * (wx0 * (top_w[i] * wz0 + top_w[i + 1] * wz1) + wx1 * (top_w[j] * wz0 + top_w[j + 1] * wz1)) +
+                    wy1 * (wx0 * (bottom_w[i] * wz0 + bottom_w[i + 1] * wz1) +
+                           wx1 * (bottom_w[j] * wz0 + bottom_w[j + 1] * wz1));
+                // The pixel's own cell always weighs in, den is never 0
+                const uint64_t n = num + (den >> 1);
+                out[x] = (T)(exact_double ? (uint64_t)((double)n / (double)den) : n / den);
+            }
+        }
+    }
+
+    int threadCount() const {
+        int n = mParams.threads;
+        if (n <= 0) n = (int)std::thread::hardware_concurrency();
+        return std::max(n, 1);
+    }
+
+    /* f(begin, end) on contiguous ranges of 0 .. n - 1, one per thread */
+    template <typename F>
+    void forRanges(int n, F f) const {
+        const int threads = std::max(1, std::min(threadCount(), n));
+        if (threads == 1) {
+            f(0, n);
+            return;
+        }
+        std::vector<std::thread> workers;
+        for (int t = 0; t < threads; t++)
+            workers.push_back(std::thread(f, (int)((int64_t)n * t / threads), (int)((int64_t)n * (t + 1) / threads)));
+        for (auto& t : workers) t.join();
+    }
+};
+
+} // namespace medimg
+
+#endif //_MEDIMG_BILATERAL_GRID_H_
@@ -0,0 +1,178 @@
+/*
+ * Copyright 2021 Xilinx, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _MEDIMG_CCL_H_
+#define _MEDIMG_CCL_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <algorithm>
+#include <vector>
+
+namespace medimg {
+
+//----------------------------------------------------------------------------------------------------//
+// CPU counterpart of xf::cv::connectedComponentsWithStats (imgproc/xf_connected_components.hpp)
+//
+// 8-connected labeling of a mask in one raster pass over runs of non-zero pixels, merging labels in a
+// union-find table and accumulating area, bounding box and centroid per root. Components are numbered
+// in the order of their first pixel and the statistics match the kernel's exactly; entry 0 describes
+// the zero pixels, as in cv::connectedComponentsWithStats. The label image, when requested, holds
+// component ids; the provisional labels are remapped in place after the pass:
+//
+//     medimg::ConnectedComponents ccl;
+//     std::vector<medimg::ComponentStats> stats;
+//     int n = ccl.apply(mask, rows, cols, stats);  // components 1 .. n - 1
+//----------------------------------------------------------------------------------------------------//
+
+struct ComponentStats {
+    uint32_t area;
+    uint16_t left, top, right, bottom; // inclusive bounding box
+    float cx, cy;                      // centroid
+};
+
+class ConnectedComponents {
+   public:
+    /* Returns the number of components including the zero pixels; labels (optional) and strides in
+     * elements, 0 for cols */
+    int apply(const uint8_t* mask, int rows, int cols, std::vector<ComponentStats>& stats,
+              uint32_t* labels = NULL, int src_stride = 0, int dst_stride = 0) {
+        if (src_stride == 0) src_stride = cols;
+        if (dst_stride == 0) dst_stride = cols;
+        mParent.assign(1, 0);
+        mAcc.assign(1, Acc());
+        mPrev.assign(cols, 0);
+        mCur.assign(cols, 0);
+
+        for (int y = 0; y < rows; y++) {
+            const uint8_t* in = mask + (size_t)y * src_stride;
+            int x = 0;
+            while (x < cols) {
+                if (in[x] == 0) {
+                    mAcc[0].add(x, x, y);
+                    mCur[x++] = 0;
+                    continue;
+                }
+                // One run: every label touching [x0 - 1, x1 + 1] in the row above joins it
+                int x0 = x;
+                while (x < cols && in[x] != 0) x++;
+                int x1 = x - 1;
+                uint32_t c = 0;
+                for (int k = std::max(x0 - 1, 0); k <= std::min(x1 + 1, cols - 1); k++) {
+                    if (mPrev[k] == 0) continue;
+                    uint32_t r = find(mPrev[k]);
+                    c = (c == 0) ? r : merge(c, r);
+                }
+                if (c == 0) {
+                    c = (uint32_t)mParent.size();
+                    mParent.push_back(c);
+                    mAcc.push_back(Acc());
+                }
+                mAcc[c].add(x0, x1, y);
+                std::fill(&mCur[x0], &mCur[x1] + 1, c);
+            }
+            if (labels != NULL) std::copy(mCur.begin(), mCur.end(), labels + (size_t)y * dst_stride);
+            mPrev.swap(mCur);
+        }
+
+        // Roots in label order are the components in order of their first pixel
+        std::vector<uint32_t> id(mParent.size(), 0);
+        stats.clear();
+        stats.push_back(mAcc[0].stats());
+        for (size_t l = 1; l < mParent.size(); l++) {
+            uint32_t r = find((uint32_t)l);
+            if (r == l) {
+                id[l] = (uint32_t)stats.size();
+                stats.push_back(mAcc[l].stats());
+            } else {
+                id[l] = id[r];
+            }
+        }
+        if (labels != NULL) {
+            for (int y = 0; y < rows; y++) {
+                uint32_t* row = labels + (size_t)y * dst_stride;
+                for (int x = 0; x < cols; x++) row[x] = id[row[x]];
+            }
+        }
+        return (int)stats.size();
+    }
+
+   private:
+    struct Acc {
+        uint64_t area, sumX, sumY;
+        int left, top, right, bottom;
+
+        Acc() : area(0), sumX(0), sumY(0), left(0xffff), top(0xffff), right(0), bottom(0) {}
+
+        void add(int x0, int x1, int y) {
+            uint64_t len = x1 - x0 + 1;
+            area += len;
+            sumX += (uint64_t)(x0 + x1) * len / 2;
+            sumY += (uint64_t)y * len;
+            left = std::min(left, x0);
+            top = std::min(top, y);
+            right = std::max(right, x1);
+            bottom = std::max(bottom, y);
+        }
+
+        void merge(const Acc& o) {
+            area += o.area;
+            sumX += o.sumX;
+            sumY += o.sumY;
+            left = std::min(left, o.left);
+            top = std::min(top, o.top);
+            right = std::max(right, o.right);
+            bottom = std::max(bottom, o.bottom);
+        }
+
+        ComponentStats stats() const {
+            ComponentStats s;
+            s.area = (uint32_t)area;
+            s.left = (uint16_t)left;
+            s.top = (uint16_t)top;
+            s.right = (uint16_t)right;
+            s.bottom = (uint16_t)bottom;
+            s.cx = area ? (float)sumX / (float)(uint32_t)area : 0.f;
+            s.cy = area ? (float)sumY / (float)(uint32_t)area : 0.f;
+            return s;
+        }
+    };
+
+    std::vector<uint32_t> mParent;
+    std::vector<Acc> mAcc;
+    std::vector<uint32_t> mPrev, mCur;
+
+    uint32_t find(uint32_t l) {
+        while (mParent[l] != l) {
+            mParent[l] = mParent[mParent[l]];
+            l = mParent[l];
+        }
+        return l;
+    }
+
+    /* The smaller root absorbs the larger one */
+    uint32_t merge(uint32_t a, uint32_t b) {
+        if (a == b) return a;
+        if (b < a) std::swap(a, b);
+        mParent[b] = a;
+        mAcc[a].merge(mAcc[b]);
+        return a;
+    }
+};
+
+} // namespace medimg
+
+#endif //_MEDIMG_CCL_H_
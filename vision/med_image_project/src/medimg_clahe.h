@@ -0,0 +1,210 @@
+/*
+ * Copyright 2021 Xilinx, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _MEDIMG_CLAHE_H_
+#define _MEDIMG_CLAHE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+namespace medimg {
+
+//----------------------------------------------------------------------------------------------------//
+// CPU counterpart of xf::cv::clahe::CLAHEBinnedImpl (imgproc/xf_clahe_binned.hpp)
+//
+// CLAHE on 12 or 16-bit slices with histograms of (1 << binBits) bins, using the same tiling, clip
+// redistribution, integer rounding and interpolation as the HLS implementation at XF_NPPC1, so both
+// produce identical slices when the tile width is even. apply() equalizes a slice with its own tile
+// LUTs; applyStreaming() uses the LUTs of the previous slice like the kernel's _lutr/_lutw ping-pong,
+// and reads every slice once:
+//
+//     medimg::ClaheBinned clahe(medimg::ClaheParams(12, 10));
+//     for (int z = 0; z < depth; z++) clahe.applyStreaming(raw[z], out[z], rows, cols);
+//----------------------------------------------------------------------------------------------------//
+
+struct ClaheParams {
+    int inBits;  // significant bits of the input, larger values fall into the last bin
+    int binBits; // log2 of the bins per tile histogram
+    int clip;    // clip limit, clip * tile pixels / bins counts per bin, 0 for none
+    int tilesY, tilesX;
+    int threads; // 0 for one per hardware thread
+
+    ClaheParams(int _inBits = 12, int _binBits = 10, int _clip = 4, int _tilesY = 8, int _tilesX = 8)
+        : inBits(_inBits), binBits(_binBits), clip(_clip), tilesY(_tilesY), tilesX(_tilesX), threads(0) {}
+};
+
+class ClaheBinned {
+   public:
+    explicit ClaheBinned(const ClaheParams& params) : mParams(params), mRows(0), mCols(0), mValid(false) {}
+
+    const ClaheParams& params() const { return mParams; }
+
+    /* Equalizes src with its own tile LUTs; strides in elements, 0 for cols */
+    void apply(const uint16_t* src, uint16_t* dst, int rows, int cols, int src_stride = 0, int dst_stride = 0) {
+        buildLuts(src, rows, cols, src_stride);
+        interpolate(src, dst, rows, cols, src_stride, dst_stride);
+    }
+
+    /* Equalizes src with the LUTs of the previous slice, then keeps the LUTs of src for the next one.
+     * The first slice, or one of another size, is equalized with its own */
+    void applyStreaming(const uint16_t* src, uint16_t* dst, int rows, int cols, int src_stride = 0,
+                        int dst_stride = 0) {
+        if (!mValid || rows != mRows || cols != mCols) buildLuts(src, rows, cols, src_stride);
+        interpolate(src, dst, rows, cols, src_stride, dst_stride);
+        buildLuts(src, rows, cols, src_stride);
+    }
+
+    /* Histograms src per tile, clips and redistributes, and turns the histograms into mapping LUTs */
+    void buildLuts(const uint16_t* src, int rows, int cols, int stride = 0) {
+        if (stride == 0) stride = cols;
+        setGeometry(rows, cols);
+        const int bins = 1 << mParams.binBits;
+        mLuts.assign((size_t)mParams.tilesY * mParams.tilesX * bins, 0);
+
+        // One tile row per task, each worker owns the histograms of the tiles it fills
+        forEach(mParams.tilesY, [&](int ty) {
+            int y0 = ty * mTileHeight, y1 = std::min(rows, y0 + mTileHeight);
+            std::vector<uint32_t> hist((size_t)mParams.tilesX * bins, 0);
+            for (int y = y0; y < y1; y++) {
+                const uint16_t* row = src + (size_t)y * stride;
+                for (int x = 0; x < cols; x++) hist[(size_t)(x / mTileWidth) * bins + bin(row[x])]++;
+            }
+            for (int tx = 0; tx < mParams.tilesX; tx++) clipToLut(&hist[(size_t)tx * bins], lut(ty, tx));
+        });
+        mValid = true;
+    }
+
+    /* Maps src through the current LUTs, bilinearly between the four nearest tile centers */
+    void interpolate(const uint16_t* src, uint16_t* dst, int rows, int cols, int src_stride = 0,
+                     int dst_stride = 0) const {
+        if (src_stride == 0) src_stride = cols;
+        if (dst_stride == 0) dst_stride = cols;
+        const uint32_t out_max = (1u << mParams.inBits) - 1;
+        const uint64_t tile_size = (uint64_t)mTileHeight * mTileWidth;
+
+        // Column weights and tiles do not depend on the row
+        std::vector<int> x1(cols), x2(cols), wx(cols);
+        for (int x = 0; x < cols; x++) {
+            int t = x + (mTileWidth >> 1);
+            int hx = t / mTileWidth - 1;
+            wx[x] = t % mTileWidth;
+            x1[x] = std::max(hx, 0);
+            x2[x] = std::min(hx + 1, mParams.tilesX - 1);
+        }
+
+        const int bands = std::min(rows, 4 * threadCount());
+        forEach(bands, [&](int band) {
+            int y0 = (int)((int64_t)rows * band / bands), y1 = (int)((int64_t)rows * (band + 1) / bands);
+            for (int y = y0; y < y1; y++) {
+                int t = y + (mTileHeight >> 1);
+                int hy = t / mTileHeight - 1;
+                uint64_t wy = t % mTileHeight;
+                int ty1 = std::max(hy, 0), ty2 = std::min(hy + 1, mParams.tilesY - 1);
+
+                const uint16_t* in = src + (size_t)y * src_stride;
+                uint16_t* out = dst + (size_t)y * dst_stride;
+                for (int x = 0; x < cols; x++) {
+                    uint32_t b = bin(in[x]);
+                    uint64_t xa = wx[x], xa1 = mTileWidth - xa;
+                    uint64_t t1 = lut(ty1, x1[x])[b] * xa1 + lut(ty1, x2[x])[b] * xa;
+                    uint64_t t2 = lut(ty2, x1[x])[b] * xa1 + lut(ty2, x2[x])[b] * xa;
+                    uint64_t v = (t1 * (mTileHeight - wy) + t2 * wy) / tile_size;
+                    out[x] = (uint16_t)std::min<uint64_t>(v, out_max);
+                }
+            }
+        });
+    }
+
+   private:
+    ClaheParams mParams;
+    int mRows, mCols;
+    int mTileHeight, mTileWidth;
+    uint32_t mClipValue;
+    bool mValid;
+    std::vector<uint32_t> mLuts; // [tilesY][tilesX][bins]
+
+    uint32_t* lut(int ty, int tx) { return &mLuts[((size_t)ty * mParams.tilesX + tx) << mParams.binBits]; }
+    const uint32_t* lut(int ty, int tx) const {
+        return &mLuts[((size_t)ty * mParams.tilesX + tx) << mParams.binBits];
+    }
+
+    uint32_t bin(uint32_t v) const {
+        const uint32_t out_max = (1u << mParams.inBits) - 1;
+        return std::min(v, out_max) >> (mParams.inBits - mParams.binBits);
+    }
+
+    /* Tile sizes round up as in CLAHETile */
+    void setGeometry(int rows, int cols) {
+        mRows = rows;
+        mCols = cols;
+        mTileHeight = (rows + mParams.tilesY - 1) / mParams.tilesY;
+        mTileWidth = (cols + mParams.tilesX - 1) / mParams.tilesX;
+        mClipValue = 0xffffffffu;
+        if (mParams.clip > 0) {
+            mClipValue = std::max((mParams.clip * mTileHeight * mTileWidth) >> mParams.binBits, 1);
+        }
+    }
+
+    void clipToLut(const uint32_t* hist, uint32_t* lut) const {
+        const int bins = 1 << mParams.binBits;
+        const uint64_t out_max = (1u << mParams.inBits) - 1;
+        const uint64_t tile_size = (uint64_t)mTileHeight * mTileWidth;
+
+        uint32_t add = 0;
+        for (int k = 0; k < bins; k++) {
+            if (hist[k] > mClipValue) add += hist[k] - mClipValue;
+        }
+        uint32_t div = add >> mParams.binBits, rem = add & (bins - 1);
+        int step = (rem > 0) ? std::max(bins / (int)rem, 1) : 1;
+
+        uint64_t sum = 0;
+        for (int k = 0; k < bins; k++) {
+            uint32_t v = std::min(hist[k], mClipValue) + div;
+            if (rem > 0 && (k % step) == 0 && k < (int)rem * step) v++;
+            sum += v;
+            lut[k] = (uint32_t)std::min(sum * out_max / tile_size, out_max);
+        }
+    }
+
+    int threadCount() const {
+        int n = mParams.threads;
+        if (n <= 0) n = (int)std::thread::hardware_concurrency();
+        return std::max(n, 1);
+    }
+
+    template <typename F>
+    void forEach(int tasks, F f) const {
+        int n = std::min(threadCount(), tasks);
+        if (n <= 1) {
+            for (int i = 0; i < tasks; i++) f(i);
+            return;
+        }
+        std::vector<std::thread> workers;
+        for (int w = 0; w < n; w++) {
+            workers.push_back(std::thread([&, w] {
+                for (int i = w; i < tasks; i += n) f(i);
+            }));
+        }
+        for (auto& t : workers) t.join();
+    }
+};
+
+} // namespace medimg
+
+#endif //_MEDIMG_CLAHE_H_
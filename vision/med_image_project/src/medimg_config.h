@@ -49,4 +49,19 @@ void canny_accel(xf::cv::Mat<XF_8UC1, HEIGHT, WIDTH, INTYPE>& _src,
                  unsigned char low_threshold,
                  unsigned char high_threshold);
 
+/* medimg_accel (med_image_project_kernels/src/medimg_accel.cpp), for the software device's C-sim: with
+ * EQUALIZE, hist carries the histogram of the previous slice in and of this slice out, and has to be
+ * zeroed at the start of every series */
+extern "C" void medimg_accel(ap_uint<INPUT_PTR_WIDTH>* img_inp,
+                             unsigned char* process_shape,
+                             ap_uint<OUTPUT_PTR_WIDTH>* img_out,
+                             int rows,
+                             int cols,
+                             unsigned char thresh,
+                             unsigned char maxval
+#if EQUALIZE
+                             , unsigned int* hist
+#endif
+                             );
+
 #endif
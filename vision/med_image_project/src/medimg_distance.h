@@ -0,0 +1,153 @@
+/*
+ * Copyright 2021 Xilinx, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _MEDIMG_DISTANCE_H_
+#define _MEDIMG_DISTANCE_H_
+
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <algorithm>
+#include <vector>
+
+namespace medimg {
+
+//----------------------------------------------------------------------------------------------------//
+// CPU counterpart of xf::cv::distanceTransformStrip (imgproc/xf_distancetransform_strip.hpp)
+//
+// Exact Euclidean distance of every non-zero mask pixel to the nearest zero pixel, as
+// cv::distanceTransform(DIST_L2, DIST_MASK_PRECISE), saturated at maxDist like the kernel so both
+// return identical values: float distances, or unsigned fixed point with fracBits fractional bits for
+// the XF_16UC1 output. Column distances first, then the lower envelope of parabolas per row
+// (Felzenszwalb and Huttenlocher), linear in the number of pixels whatever maxDist is:
+//
+//     medimg::DistanceTransform dt(32);
+//     dt.apply(mask, dist, rows, cols);  // lesion radius = max of dist inside the lesion mask
+//----------------------------------------------------------------------------------------------------//
+
+class DistanceTransform {
+   public:
+    explicit DistanceTransform(int maxDist, int fracBits = 8) : mMaxDist(maxDist), mFracBits(fracBits) {}
+
+    int maxDist() const { return mMaxDist; }
+    int fracBits() const { return mFracBits; }
+
+    /* Float distances; strides in elements, 0 for cols */
+    void apply(const uint8_t* mask, float* dst, int rows, int cols, int src_stride = 0, int dst_stride = 0) {
+        if (dst_stride == 0) dst_stride = cols;
+        squaredDistances(mask, rows, cols, src_stride);
+        for (int y = 0; y < rows; y++) {
+            const uint32_t* d2 = &mD2[(size_t)y * cols];
+            for (int x = 0; x < cols; x++) dst[(size_t)y * dst_stride + x] = distance(d2[x]);
+        }
+    }
+
+    /* Fixed point distances, rounded to nearest as the XF_16UC1 kernel output */
+    void applyFixed(const uint8_t* mask, uint16_t* dst, int rows, int cols, int src_stride = 0,
+                    int dst_stride = 0) {
+        if (dst_stride == 0) dst_stride = cols;
+        const float one = (float)(1 << mFracBits);
+        squaredDistances(mask, rows, cols, src_stride);
+        for (int y = 0; y < rows; y++) {
+            const uint32_t* d2 = &mD2[(size_t)y * cols];
+            for (int x = 0; x < cols; x++) {
+                dst[(size_t)y * dst_stride + x] = (uint16_t)(unsigned int)(distance(d2[x]) * one + 0.5f);
+            }
+        }
+    }
+
+   private:
+    enum : uint32_t { INF = 0xffffffffu }; // no zero in the column or image
+
+    int mMaxDist, mFracBits;
+    std::vector<uint32_t> mD2; // squared distances, [rows][cols]
+    std::vector<uint32_t> mG;  // column distances of one row
+    std::vector<int> mV;       // parabola vertices of the lower envelope
+    std::vector<double> mZ;    // boundaries between them
+
+    float distance(uint32_t d2) const {
+        const uint32_t cap = (uint32_t)mMaxDist * mMaxDist;
+        return sqrtf((float)std::min(d2, cap));
+    }
+
+    void squaredDistances(const uint8_t* mask, int rows, int cols, int stride) {
+        if (stride == 0) stride = cols;
+        mD2.assign((size_t)rows * cols, (uint32_t)INF);
+
+        // Rows to the nearest zero in the column, top-down then bottom-up
+        for (int y = 0; y < rows; y++) {
+            const uint8_t* in = mask + (size_t)y * stride;
+            uint32_t* d = &mD2[(size_t)y * cols];
+            const uint32_t* above = d - cols;
+            for (int x = 0; x < cols; x++) {
+                if (in[x] == 0)
+                    d[x] = 0;
+                else if (y > 0 && above[x] != INF)
+                    d[x] = above[x] + 1;
+            }
+        }
+        for (int y = rows - 2; y >= 0; y--) {
+            uint32_t* d = &mD2[(size_t)y * cols];
+            const uint32_t* below = d + cols;
+            for (int x = 0; x < cols; x++) {
+                if (below[x] != INF && below[x] + 1 < d[x]) d[x] = below[x] + 1;
+            }
+        }
+
+        mG.resize(cols);
+        mV.resize(cols);
+        mZ.resize(cols + 1);
+        for (int y = 0; y < rows; y++) {
+            uint32_t* d = &mD2[(size_t)y * cols];
+            std::copy(d, d + cols, mG.begin());
+            envelope(d, cols);
+        }
+    }
+
+    /* d[x] = min over q of (x - q)^2 + g[q]^2, over the columns with a finite g */
+    void envelope(uint32_t* d, int n) {
+        int k = -1;
+        for (int q = 0; q < n; q++) {
+            if (mG[q] == INF) continue;
+            double fq = (double)mG[q] * mG[q] + (double)q * q;
+            double s = -HUGE_VAL;
+            while (k >= 0) {
+                int v = mV[k];
+                double fv = (double)mG[v] * mG[v] + (double)v * v;
+                s = (fq - fv) / (2.0 * (q - v));
+                if (s > mZ[k]) break;
+                k--;
+            }
+            k++;
+            mV[k] = q;
+            mZ[k] = (k == 0) ? -HUGE_VAL : s;
+            mZ[k + 1] = HUGE_VAL;
+        }
+        if (k < 0) return; // no zero in the whole image, d stays INF
+
+        int j = 0;
+        for (int x = 0; x < n; x++) {
+            while (mZ[j + 1] < x) j++;
+            int v = mV[j];
+            int dx = x - v;
+            d[x] = (uint32_t)((int64_t)dx * dx + (uint64_t)mG[v] * mG[v]);
+        }
+    }
+};
+
+} // namespace medimg
+
+#endif //_MEDIMG_DISTANCE_H_
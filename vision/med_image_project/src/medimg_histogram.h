@@ -0,0 +1,105 @@
+/*
+ * Copyright 2021 Xilinx, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _MEDIMG_HISTOGRAM_H_
+#define _MEDIMG_HISTOGRAM_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+namespace medimg {
+
+//----------------------------------------------------------------------------------------------------//
+// CPU counterpart of xf::cv::calcHistBinned (imgproc/xf_histogram.hpp)
+//
+// (1 << binBits) bin histogram over the inBits significant bits of 12 or 16-bit data, values above
+// the range falling into the last bin. Each thread counts a band of rows into private histograms and
+// the bands are summed at the end; within a thread consecutive pixels go to four interleaved
+// sub-histograms, so runs of equal values do not serialize on one counter, the CPU side of the
+// kernel's replicated banks:
+//
+//     medimg::Histogram hist(12, 12);  // 4096 bins
+//     const std::vector<uint32_t>& counts = hist.compute(raw, rows, cols);
+//----------------------------------------------------------------------------------------------------//
+
+class Histogram {
+   public:
+    static const int SUB_HISTOGRAMS = 4;
+
+    Histogram(int inBits = 12, int binBits = 12, int threads = 0)
+        : mInBits(inBits), mBinBits(binBits), mThreads(threads) {}
+
+    int bins() const { return 1 << mBinBits; }
+
+    /* Counts src into bins() bins; stride in elements, 0 for cols */
+    const std::vector<uint32_t>& compute(const uint16_t* src, int rows, int cols, int stride = 0) {
+        if (stride == 0) stride = cols;
+        const int n = std::max(std::min(threadCount(), rows), 1);
+        const size_t bins = (size_t)1 << mBinBits;
+        mPrivate.assign((size_t)n * SUB_HISTOGRAMS * bins, 0);
+
+        auto band = [&](int w) {
+            int y0 = (int)((int64_t)rows * w / n), y1 = (int)((int64_t)rows * (w + 1) / n);
+            uint32_t* h0 = &mPrivate[(size_t)w * SUB_HISTOGRAMS * bins];
+            uint32_t *h1 = h0 + bins, *h2 = h1 + bins, *h3 = h2 + bins;
+            const uint32_t in_max = (1u << mInBits) - 1;
+            const int shift = mInBits - mBinBits;
+            for (int y = y0; y < y1; y++) {
+                const uint16_t* row = src + (size_t)y * stride;
+                int x = 0;
+                for (; x + 4 <= cols; x += 4) {
+                    h0[std::min<uint32_t>(row[x], in_max) >> shift]++;
+                    h1[std::min<uint32_t>(row[x + 1], in_max) >> shift]++;
+                    h2[std::min<uint32_t>(row[x + 2], in_max) >> shift]++;
+                    h3[std::min<uint32_t>(row[x + 3], in_max) >> shift]++;
+                }
+                for (; x < cols; x++) h0[std::min<uint32_t>(row[x], in_max) >> shift]++;
+            }
+        };
+        if (n == 1) {
+            band(0);
+        } else {
+            std::vector<std::thread> workers;
+            for (int w = 0; w < n; w++) workers.push_back(std::thread(band, w));
+            for (auto& t : workers) t.join();
+        }
+
+        mHist.assign(bins, 0);
+        for (size_t h = 0; h < (size_t)n * SUB_HISTOGRAMS; h++) {
+            const uint32_t* p = &mPrivate[h * bins];
+            for (size_t i = 0; i < bins; i++) mHist[i] += p[i];
+        }
+        return mHist;
+    }
+
+   private:
+    int mInBits, mBinBits, mThreads; // mThreads 0 for one per hardware thread
+    std::vector<uint32_t> mPrivate;  // [threads][SUB_HISTOGRAMS][bins]
+    std::vector<uint32_t> mHist;
+
+    int threadCount() const {
+        int n = mThreads;
+        if (n <= 0) n = (int)std::thread::hardware_concurrency();
+        return std::max(n, 1);
+    }
+};
+
+} // namespace medimg
+
+#endif //_MEDIMG_HISTOGRAM_H_
@@ -0,0 +1,200 @@
+/*
+ * Copyright 2021 Xilinx, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _MEDIMG_LOCAL_THRESHOLD_H_
+#define _MEDIMG_LOCAL_THRESHOLD_H_
+
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+namespace medimg {
+
+//----------------------------------------------------------------------------------------------------//
+// CPU counterpart of xf::cv::localThreshold (imgproc/xf_local_threshold.hpp)
+//
+// Thresholds every pixel of an 8-bit image against the mean m and standard deviation s of the window
+// around it, so that uneven contrast across a slice neither drowns regions nor lets noise through:
+//
+//   BRADLEY  p > m * (1 - k)
+//   NIBLACK  p > m + k * s
+//   SAUVOLA  p > m * (1 + k * (s / 128 - 1))
+//
+// with k in Q.8 (Niblack's may be negative). Pixels at or below the global thresh stay background.
+// Windows are clipped at the borders. The box sums of I and I^2 slide down the columns and along the
+// rows, so the cost per pixel does not depend on the window, and the decisions are the kernel's exact
+// integer comparisons with s from an integer square root, so both give identical results. Column
+// sums and the per pixel decisions are loops over the row that the compiler vectorizes; threads take
+// bands of rows:
+//
+//     medimg::LocalThreshold binarize(medimg::LocalThresholdParams(medimg::LocalThresholdParams::SAUVOLA,
+//                                                                   31, 64)); // k = 0.25
+//     binarize.apply(windowed, mask, rows, cols, 20, 255);
+//----------------------------------------------------------------------------------------------------//
+
+struct LocalThresholdParams {
+    // Same values as the kernel's XF_LOCAL_THRESH_* methods
+    enum Method { BRADLEY = 0, NIBLACK = 1, SAUVOLA = 2 };
+
+    Method method;
+    int window;  // odd, 3 .. 63
+    int k;       // Q.8: 0 .. 255 for BRADLEY and SAUVOLA, -255 .. 255 for NIBLACK
+    int threads; // 0 for one per hardware thread
+
+    LocalThresholdParams(Method _method = SAUVOLA, int _window = 31, int _k = 64)
+        : method(_method), window(_window), k(_k), threads(0) {}
+};
+
+class LocalThreshold {
+   public:
+    explicit LocalThreshold(const LocalThresholdParams& params) : mParams(params) {}
+
+    const LocalThresholdParams& params() const { return mParams; }
+
+    /* dst is maxval where the pixel is above both thresh and its local threshold, 0 elsewhere; strides in
+     * bytes, 0 for cols */
+    void apply(const uint8_t* src,
+               uint8_t* dst,
+               int rows,
+               int cols,
+               uint8_t thresh,
+               uint8_t maxval,
+               int src_stride = 0,
+               int dst_stride = 0) const {
+        if (src_stride == 0) src_stride = cols;
+        if (dst_stride == 0) dst_stride = cols;
+        const int h = mParams.window / 2;
+
+        forRanges(rows, [&](int y0, int y1) {
+            // Column sums over the window rows of the current row, prefix sums along it padded by h + 1
+            // columns on either side so that every window sum is one subtraction
+            std::vector<uint32_t> col_s(cols), col_q(cols);
+            std::vector<uint32_t> pre_s(cols + 2 * h + 2);
+            std::vector<uint64_t> pre_q(cols + 2 * h + 2);
+            std::vector<uint32_t> win_s(cols), win_n(cols);
+            std::vector<uint64_t> win_q(cols);
+            for (int c = 0; c < cols; c++) win_n[c] = std::min(c + h, cols - 1) - std::max(c - h, 0) + 1;
+
+            // Primed with the window of row y0 - 1
+            for (int r = std::max(y0 - h - 1, 0); r < std::min(y0 + h, rows); r++)
+                addRow(src + (size_t)r * src_stride, col_s, col_q, cols, 1);
+            for (int y = y0; y < y1; y++) {
+                if (y + h < rows) addRow(src + (size_t)(y + h) * src_stride, col_s, col_q, cols, 1);
+                if (y - h - 1 >= 0) addRow(src + (size_t)(y - h - 1) * src_stride, col_s, col_q, cols, -1);
+
+                // pre[j] sums the columns left of j - h - 1
+                for (int i = 0; i <= h + 1; i++) pre_s[i] = 0, pre_q[i] = 0;
+                for (int c = 0; c < cols; c++) {
+                    pre_s[h + 2 + c] = pre_s[h + 1 + c] + col_s[c];
+                    pre_q[h + 2 + c] = pre_q[h + 1 + c] + col_q[c];
+                }
+                for (int i = cols + h + 2; i < cols + 2 * h + 2; i++) {
+                    pre_s[i] = pre_s[i - 1];
+                    pre_q[i] = pre_q[i - 1];
+                }
+                for (int c = 0; c < cols; c++) {
+                    win_s[c] = pre_s[c + 2 * h + 2] - pre_s[c + 1];
+                    win_q[c] = pre_q[c + 2 * h + 2] - pre_q[c + 1];
+                }
+
+                const uint32_t n_rows = std::min(y + h, rows - 1) - std::max(y - h, 0) + 1;
+                decide(src + (size_t)y * src_stride, dst + (size_t)y * dst_stride, cols, n_rows, win_n.data(),
+                       win_s.data(), win_q.data(), thresh, maxval);
+            }
+        });
+    }
+
+   private:
+    LocalThresholdParams mParams;
+
+    static void addRow(const uint8_t* row, std::vector<uint32_t>& col_s, std::vector<uint32_t>& col_q, int cols,
+                       int sign) {
+        uint32_t* s = col_s.data();
+        uint32_t* q = col_q.data();
+        if (sign > 0) {
+            for (int c = 0; c < cols; c++) s[c] += row[c], q[c] += (uint32_t)row[c] * row[c];
+        } else {
+            for (int c = 0; c < cols; c++) s[c] -= row[c], q[c] -= (uint32_t)row[c] * row[c];
+        }
+    }
+
+    /* The kernel's comparisons, exact in 64 bits for windows up to 63 x 63 */
+    void decide(const uint8_t* in,
+                uint8_t* out,
+                int cols,
+                uint32_t n_rows,
+                const uint32_t* win_n,
+                const uint32_t* win_s,
+                const uint64_t* win_q,
+                uint8_t thresh,
+                uint8_t maxval) const {
+        const int64_t k = mParams.k;
+        const int64_t range = 128;
+        switch (mParams.method) {
+            case LocalThresholdParams::BRADLEY:
+                for (int c = 0; c < cols; c++) {
+                    const int64_t n = (int64_t)n_rows * win_n[c], s = win_s[c], p = in[c];
+                    out[c] = (p > thresh && 256 * n * p > (256 - k) * s) ? maxval : 0;
+                }
+                break;
+            case LocalThresholdParams::NIBLACK:
+                for (int c = 0; c < cols; c++) {
+                    const int64_t n = (int64_t)n_rows * win_n[c], s = win_s[c], p = in[c];
+                    const int64_t sd = isqrt(n * (int64_t)win_q[c] - s * s); // n * standard deviation
+                    out[c] = (p > thresh && 256 * n * p > 256 * s + k * sd) ? maxval : 0;
+                }
+                break;
+            case LocalThresholdParams::SAUVOLA:
+                for (int c = 0; c < cols; c++) {
+                    const int64_t n = (int64_t)n_rows * win_n[c], s = win_s[c], p = in[c];
+                    const int64_t sd = isqrt(n * (int64_t)win_q[c] - s * s);
+                    const int64_t lhs = 256 * range * n * n * p, rhs = 256 * range * n * s + k * s * (sd - range * n);
+                    out[c] = (p > thresh && lhs > rhs) ? maxval : 0;
+                }
+                break;
+        }
+    }
+
+    /* floor(sqrt(v)), exact in double for v below 2^52 */
+    static int64_t isqrt(int64_t v) { return (int64_t)sqrt((double)v); }
+
+    int threadCount() const {
+        int n = mParams.threads;
+        if (n <= 0) n = (int)std::thread::hardware_concurrency();
+        return std::max(n, 1);
+    }
+
+    /* f(begin, end) on contiguous ranges of 0 .. n - 1, one per thread */
+    template <typename F>
+    void forRanges(int n, F f) const {
+        const int threads = std::max(1, std::min(threadCount(), n));
+        if (threads == 1) {
+            f(0, n);
+            return;
+        }
+        std::vector<std::thread> workers;
+        for (int t = 0; t < threads; t++)
+            workers.push_back(std::thread(f, (int)((int64_t)n * t / threads), (int)((int64_t)n * (t + 1) / threads)));
+        for (auto& t : workers) t.join();
+    }
+};
+
+} // namespace medimg
+
+#endif //_MEDIMG_LOCAL_THRESHOLD_H_
@@ -0,0 +1,203 @@
+/*
+ * Copyright 2021 Xilinx, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _MEDIMG_MEDIAN_H_
+#define _MEDIMG_MEDIAN_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+namespace medimg {
+
+//----------------------------------------------------------------------------------------------------//
+// CPU counterpart of xf::cv::medianBlurHist (imgproc/xf_median_blur_hist.hpp)
+//
+// Constant time median filter after Perreault and Hebert: column histograms slide down the image, the
+// kernel histogram slides across a row by adding and subtracting whole column histograms. Histograms
+// are split into coarse and fine levels; the coarse kernel histogram is kept current and a fine
+// segment is only brought up to date when the median falls into it, so the work per pixel does not
+// depend on the filter size. Same binning, borders and bin center output as the kernel, so both give
+// identical results; binBits == inBits gives the exact median. The image is processed in column
+// stripes that bound the memory of the fine histograms and are spread over the threads:
+//
+//     medimg::MedianHist median(medimg::MedianParams(9, 12, 12));
+//     median.apply(raw, out, rows, cols);
+//----------------------------------------------------------------------------------------------------//
+
+struct MedianParams {
+    enum Border { REPLICATE, CONSTANT };
+
+    int filterSize;        // odd, 3 .. 255
+    int inBits;            // significant bits of the input, larger values count as the maximum
+    int binBits;           // log2 of the histogram bins, at most inBits
+    Border border;         // rows and columns outside the image
+    uint16_t borderValue;  // value of the outside for CONSTANT
+    int threads;           // 0 for one per hardware thread
+
+    MedianParams(int _filterSize = 7, int _inBits = 12, int _binBits = 12, Border _border = REPLICATE,
+                 uint16_t _borderValue = 0)
+        : filterSize(_filterSize),
+          inBits(_inBits),
+          binBits(_binBits),
+          border(_border),
+          borderValue(_borderValue),
+          threads(0) {}
+};
+
+class MedianHist {
+   public:
+    explicit MedianHist(const MedianParams& params) : mParams(params) {}
+
+    const MedianParams& params() const { return mParams; }
+
+    /* T is uint8_t or uint16_t; strides in elements, 0 for cols */
+    template <typename T>
+    void apply(const T* src, T* dst, int rows, int cols, int src_stride = 0, int dst_stride = 0) const {
+        if (src_stride == 0) src_stride = cols;
+        if (dst_stride == 0) dst_stride = cols;
+
+        // Fine histograms of a stripe stay within about 8 MB, and every thread gets stripes
+        const int r = mParams.filterSize / 2;
+        const size_t per_col = ((size_t)1 << mParams.binBits) * sizeof(uint16_t);
+        int width = (int)std::max<size_t>(64, (8u << 20) / per_col);
+        const int threads = std::max(1, std::min(threadCount(), cols));
+        width = std::min(width, (cols + threads - 1) / threads);
+        width = std::max(width, std::min(cols, 2 * r + 1));
+        const int stripes = (cols + width - 1) / width;
+
+        auto run = [&](int w) {
+            Stripe stripe;
+            for (int i = w; i < stripes; i += threads) {
+                int x0 = i * width, x1 = std::min(cols, x0 + width);
+                filterStripe(stripe, src, dst, rows, cols, x0, x1, src_stride, dst_stride);
+            }
+        };
+        if (threads == 1) {
+            run(0);
+        } else {
+            std::vector<std::thread> workers;
+            for (int w = 0; w < threads; w++) workers.push_back(std::thread(run, w));
+            for (auto& t : workers) t.join();
+        }
+    }
+
+   private:
+    MedianParams mParams;
+
+    struct Stripe {
+        std::vector<uint16_t> coarse, fine; // column histograms, [virtual column][bins]
+        std::vector<uint16_t> kc, kf;       // kernel histograms, coarse and fine
+        std::vector<int> stamp;             // column each fine segment of kf is valid for
+    };
+
+    int threadCount() const {
+        int n = mParams.threads;
+        if (n <= 0) n = (int)std::thread::hardware_concurrency();
+        return std::max(n, 1);
+    }
+
+    template <typename T>
+    void filterStripe(Stripe& st, const T* src, T* dst, int rows, int cols, int x0, int x1, int src_stride,
+                      int dst_stride) const {
+        const int k = mParams.filterSize, r = k / 2;
+        const int bin_bits = mParams.binBits, coarse_bits = (bin_bits + 1) / 2;
+        const int bins = 1 << bin_bits, coarse = 1 << coarse_bits, fine = bins / coarse;
+        const int shift = mParams.inBits - bin_bits;
+        const uint32_t in_max = (1u << mParams.inBits) - 1;
+        const uint32_t half = shift > 0 ? (1u << (shift - 1)) : 0;
+        const int rank = (k * k) / 2;
+        const bool constant = (mParams.border == MedianParams::CONSTANT);
+
+        // Virtual columns x0 - r .. x1 + r - 1
+        const int vcols = x1 - x0 + 2 * r;
+        st.coarse.assign((size_t)vcols * coarse, 0);
+        st.fine.assign((size_t)vcols * bins, 0);
+        st.kc.resize(coarse);
+        st.kf.resize(bins);
+        st.stamp.resize(coarse);
+
+        auto binOf = [&](uint32_t v) -> int { return (int)(std::min(v, in_max) >> shift); };
+        auto pixel = [&](int y, int x) -> uint32_t {
+            if (constant && (y < 0 || y >= rows || x < 0 || x >= cols)) return mParams.borderValue;
+            y = std::min(std::max(y, 0), rows - 1);
+            x = std::min(std::max(x, 0), cols - 1);
+            return src[(size_t)y * src_stride + x];
+        };
+        auto addRow = [&](int y, int delta) {
+            for (int j = 0; j < vcols; j++) {
+                int b = binOf(pixel(y, x0 - r + j));
+                st.coarse[(size_t)j * coarse + (b / fine)] += delta;
+                st.fine[(size_t)j * bins + b] += delta;
+            }
+        };
+
+        for (int y = -r; y <= r; y++) addRow(y, 1);
+        for (int y = 0; y < rows; y++) {
+            if (y > 0) {
+                addRow(y - r - 1, -1);
+                addRow(y + r, 1);
+            }
+
+            std::fill(st.kc.begin(), st.kc.end(), 0);
+            for (int j = 0; j < k; j++) {
+                const uint16_t* c = &st.coarse[(size_t)j * coarse];
+                for (int i = 0; i < coarse; i++) st.kc[i] += c[i];
+            }
+            std::fill(st.stamp.begin(), st.stamp.end(), -1);
+
+            T* out = dst + (size_t)y * dst_stride;
+            for (int x = x0; x < x1; x++) {
+                int jx = x - x0; // window covers virtual columns jx .. jx + k - 1
+                if (x > x0) {
+                    const uint16_t* in = &st.coarse[(size_t)(jx + k - 1) * coarse];
+                    const uint16_t* gone = &st.coarse[(size_t)(jx - 1) * coarse];
+                    for (int i = 0; i < coarse; i++) st.kc[i] += in[i] - gone[i];
+                }
+
+                int sum = 0, seg = 0;
+                while (sum + st.kc[seg] <= rank) sum += st.kc[seg++];
+
+                uint16_t* kf = &st.kf[(size_t)seg * fine];
+                if (st.stamp[seg] < 0 || x - st.stamp[seg] >= k) {
+                    std::fill(kf, kf + fine, 0);
+                    for (int j = jx; j < jx + k; j++) {
+                        const uint16_t* f = &st.fine[(size_t)j * bins + (size_t)seg * fine];
+                        for (int i = 0; i < fine; i++) kf[i] += f[i];
+                    }
+                } else {
+                    for (int t = st.stamp[seg] + 1; t <= x; t++) {
+                        int jt = t - x0;
+                        const uint16_t* in = &st.fine[(size_t)(jt + k - 1) * bins + (size_t)seg * fine];
+                        const uint16_t* gone = &st.fine[(size_t)(jt - 1) * bins + (size_t)seg * fine];
+                        for (int i = 0; i < fine; i++) kf[i] += in[i] - gone[i];
+                    }
+                }
+                st.stamp[seg] = x;
+
+                int b = 0;
+                while (sum + kf[b] <= rank) sum += kf[b++];
+                out[x] = (T)(((uint32_t)(seg * fine + b) << shift) | half);
+            }
+        }
+    }
+};
+
+} // namespace medimg
+
+#endif //_MEDIMG_MEDIAN_H_
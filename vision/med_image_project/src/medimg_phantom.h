@@ -0,0 +1,219 @@
+/*
+ * Copyright 2021 Xilinx, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _MEDIMG_PHANTOM_H_
+#define _MEDIMG_PHANTOM_H_
+
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+//----------------------------------------------------------------------------------------------------//
+// Deterministic synthetic CT phantom
+//
+// Generates a torso-like CT volume of any size slice by slice, in memory: body and fat outline, lungs,
+// heart, liver, kidneys, a vertebral column, contrast filled vessels and acquisition noise. Slices are
+// 12-bit raw values as stored by CT scanners, raw = HU + 1024 (rescale intercept -1024), covering
+// -1024..3071 HU. window() maps them to the 8-bit frames the medimg pipeline consumes.
+//
+// The same PhantomParams always produce the same voxels, on any machine and in any slice order, so
+// throughput and scaling runs are reproducible without shipping data sets:
+//
+//     medimg::Phantom phantom(medimg::PhantomParams(512, 512, 1000));
+//     std::vector<unsigned char> frame(512 * 512);
+//     for (int z = 0; z < phantom.depth(); z++) {
+//         phantom.sliceWindowed(z, frame.data());    // soft tissue window
+//         ... feed frame to the pipeline ...
+//     }
+//----------------------------------------------------------------------------------------------------//
+
+namespace medimg {
+
+struct PhantomParams {
+    int width, height, depth;
+    uint32_t seed;
+    float noiseHU;   // standard deviation of the acquisition noise in HU
+    int vessels;     // number of contrast filled vessels besides the aorta
+
+    PhantomParams(int _width, int _height, int _depth, uint32_t _seed = 1)
+        : width(_width), height(_height), depth(_depth), seed(_seed), noiseHU(12.0f), vessels(24) {}
+};
+
+class Phantom {
+   public:
+    static const int HU_MIN = -1024;
+    static const int HU_MAX = 3071;
+    static const int RAW_OFFSET = 1024; // raw = HU + RAW_OFFSET, 12 bits
+
+    // Common display windows (center, width) in HU
+    static const int SOFT_TISSUE_CENTER = 40, SOFT_TISSUE_WIDTH = 400;
+    static const int LUNG_CENTER = -600, LUNG_WIDTH = 1500;
+    static const int BONE_CENTER = 400, BONE_WIDTH = 1800;
+
+    explicit Phantom(const PhantomParams& params) : mParams(params) {
+        // Volume coordinates are normalized to [-1, 1], x and y by the shorter side so shapes stay round
+        mScale = 2.0f / (float)((params.width < params.height) ? params.width : params.height);
+
+        // Outline, then organs inside it; later shapes replace earlier ones
+        addEllipsoid(0.00f, 0.00f, 0.0f, 0.92f, 0.72f, 4.0f, -100); // subcutaneous fat
+        addEllipsoid(0.00f, 0.00f, 0.0f, 0.86f, 0.66f, 4.0f, 40);   // soft tissue
+        addEllipsoid(-0.40f, -0.08f, 0.45f, 0.30f, 0.42f, 0.75f, -850); // right lung
+        addEllipsoid(0.40f, -0.08f, 0.45f, 0.28f, 0.40f, 0.70f, -850);  // left lung
+        addEllipsoid(0.08f, -0.02f, 0.35f, 0.24f, 0.22f, 0.28f, 45);    // heart
+        addEllipsoid(-0.30f, 0.05f, -0.40f, 0.38f, 0.30f, 0.40f, 60);   // liver
+        addEllipsoid(-0.34f, 0.38f, -0.75f, 0.10f, 0.13f, 0.22f, 30);   // right kidney
+        addEllipsoid(0.34f, 0.38f, -0.72f, 0.10f, 0.13f, 0.22f, 30);    // left kidney
+
+        // Vertebral column: cortical shell, cancellous core, discs every 0.16 z
+        for (float z = -1.6f; z < 1.6f; z += 0.16f) {
+            addEllipsoid(0.0f, 0.48f, z, 0.11f, 0.10f, 0.065f, 900);
+            addEllipsoid(0.0f, 0.48f, z, 0.08f, 0.07f, 0.055f, 250);
+        }
+
+        // Aorta along the spine, then seeded vessels meandering through the body
+        Vessel aorta = {0.0f, 0.28f, 0.0f, 0.0f, 0.0f, 0.0f, 0.045f, -2.0f, 2.0f, 280};
+        mVessels.push_back(aorta);
+        uint32_t state = params.seed * 2654435761u + 0x9e3779b9u;
+        for (int i = 0; i < params.vessels; i++) {
+            Vessel v;
+            v.x = uniform(state) * 1.2f - 0.6f;
+            v.y = uniform(state) * 0.9f - 0.45f;
+            v.ax = uniform(state) * 0.15f;
+            v.ay = uniform(state) * 0.15f;
+            v.freq = 2.0f + uniform(state) * 6.0f;
+            v.phase = uniform(state) * 6.2831853f;
+            v.r = 0.006f + uniform(state) * 0.02f;
+            v.z0 = uniform(state) * 2.0f - 1.2f;
+            v.z1 = v.z0 + 0.3f + uniform(state) * 1.2f;
+            v.hu = 150 + (int)(uniform(state) * 200.0f);
+            mVessels.push_back(v);
+        }
+    }
+
+    int width() const { return mParams.width; }
+    int height() const { return mParams.height; }
+    int depth() const { return mParams.depth; }
+
+    /* Slice z as 12-bit raw values, stride in elements (0 for width) */
+    void slice(int z, uint16_t* dst, int stride = 0) const {
+        const int w = mParams.width, h = mParams.height;
+        if (stride == 0) stride = w;
+        const float zn = ((float)z + 0.5f) * 2.0f / (float)mParams.depth - 1.0f;
+
+        std::vector<int16_t> row(w);
+        for (int y = 0; y < h; y++) {
+            const float yn = ((float)y + 0.5f - 0.5f * (float)h) * mScale;
+            for (int x = 0; x < w; x++) row[x] = -1000; // air
+
+            for (size_t i = 0; i < mShapes.size(); i++) {
+                const Ellipsoid& e = mShapes[i];
+                float dy = (yn - e.y) / e.ry, dz = (zn - e.z) / e.rz;
+                float q = 1.0f - dy * dy - dz * dz;
+                if (q > 0.0f) fillSpan(row, e.x, e.rx * sqrtf(q), e.hu);
+            }
+            for (size_t i = 0; i < mVessels.size(); i++) {
+                const Vessel& v = mVessels[i];
+                if (zn < v.z0 || zn > v.z1) continue;
+                float cx = v.x + v.ax * sinf(v.freq * zn + v.phase);
+                float cy = v.y + v.ay * cosf(v.freq * zn + v.phase);
+                float dy = yn - cy;
+                float q = v.r * v.r - dy * dy;
+                if (q > 0.0f) fillSpan(row, cx, sqrtf(q), v.hu);
+            }
+
+            uint16_t* out = dst + (size_t)y * stride;
+            for (int x = 0; x < w; x++) {
+                int hu = row[x] + noise(x, y, z);
+                if (hu < HU_MIN) hu = HU_MIN;
+                if (hu > HU_MAX) hu = HU_MAX;
+                out[x] = (uint16_t)(hu + RAW_OFFSET);
+            }
+        }
+    }
+
+    /* Maps 12-bit raw values to 8 bits through a (center, width) HU window */
+    static void window(const uint16_t* src, unsigned char* dst, size_t n, int center, int width) {
+        const int lo = center - width / 2 + RAW_OFFSET;
+        for (size_t i = 0; i < n; i++) {
+            int v = ((int)src[i] - lo) * 255 / width;
+            dst[i] = (unsigned char)((v < 0) ? 0 : ((v > 255) ? 255 : v));
+        }
+    }
+
+    /* Slice z windowed to 8 bits, densely packed */
+    void sliceWindowed(int z,
+                       unsigned char* dst,
+                       int center = SOFT_TISSUE_CENTER,
+                       int width = SOFT_TISSUE_WIDTH) const {
+        std::vector<uint16_t> raw((size_t)mParams.width * mParams.height);
+        slice(z, raw.data());
+        window(raw.data(), dst, raw.size(), center, width);
+    }
+
+   private:
+    struct Ellipsoid {
+        float x, y, z, rx, ry, rz;
+        int hu;
+    };
+    struct Vessel {
+        float x, y, ax, ay, freq, phase, r, z0, z1;
+        int hu;
+    };
+
+    PhantomParams mParams;
+    float mScale;
+    std::vector<Ellipsoid> mShapes;
+    std::vector<Vessel> mVessels;
+
+    void addEllipsoid(float x, float y, float z, float rx, float ry, float rz, int hu) {
+        Ellipsoid e = {x, y, z, rx, ry, rz, hu};
+        mShapes.push_back(e);
+    }
+
+    static float uniform(uint32_t& state) {
+        state = state * 1664525u + 1013904223u;
+        return (float)(state >> 8) / 16777216.0f;
+    }
+
+    /* Paints [cx - half, cx + half] (normalized) of the current row */
+    void fillSpan(std::vector<int16_t>& row, float cx, float half, int hu) const {
+        const float x0 = 0.5f * (float)mParams.width;
+        int a = (int)ceilf((cx - half) / mScale + x0 - 0.5f);
+        int b = (int)floorf((cx + half) / mScale + x0 - 0.5f);
+        if (a < 0) a = 0;
+        if (b >= mParams.width) b = mParams.width - 1;
+        for (int x = a; x <= b; x++) row[x] = (int16_t)hu;
+    }
+
+    /* Approximately Gaussian noise from a hash of the voxel position, independent of generation order */
+    int noise(int x, int y, int z) const {
+        uint64_t k = ((uint64_t)(uint32_t)x << 40) ^ ((uint64_t)(uint32_t)y << 20) ^ (uint64_t)(uint32_t)z;
+        k ^= (uint64_t)mParams.seed * 0x9e3779b97f4a7c15ull;
+        k ^= k >> 30;
+        k *= 0xbf58476d1ce4e5b9ull;
+        k ^= k >> 27;
+        k *= 0x94d049bb133111ebull;
+        k ^= k >> 31;
+        // Sum of four 16-bit uniforms: mean 2 * 65535, standard deviation 65535 / sqrt(3)
+        int sum = (int)(k & 0xffff) + (int)((k >> 16) & 0xffff) + (int)((k >> 32) & 0xffff) + (int)(k >> 48);
+        return (int)lrintf((float)(sum - 2 * 65535) * (mParams.noiseHU * 1.7320508f / 65535.0f));
+    }
+};
+
+} // namespace medimg
+
+#endif //_MEDIMG_PHANTOM_H_
@@ -0,0 +1,282 @@
+/*
+ * Copyright 2021 Xilinx, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _MEDIMG_RECURSIVE_GAUSSIAN_H_
+#define _MEDIMG_RECURSIVE_GAUSSIAN_H_
+
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+namespace medimg {
+
+//----------------------------------------------------------------------------------------------------//
+// CPU counterpart of xf::cv::recursiveGaussian (imgproc/xf_recursive_gaussian.hpp)
+//
+// Young and van Vliet's third order recursive Gaussian, a causal and an anti-causal pass along the rows
+// and then along the columns, with Triggs and Sdika's initialization for replicated borders. Seven
+// multiply-adds per pixel and pass whatever sigma is. The same fixed point arithmetic as the kernel:
+// with strip and halo set to the kernel's STRIP and HALO both give identical results, with strip 0 the
+// anti-causal vertical pass runs over whole columns instead. Rows are filtered eight at a time and
+// columns a row at a time, so every recursion step is a loop over independent lanes that the compiler
+// vectorizes; threads take blocks of rows, then stripes of columns:
+//
+//     medimg::RecursiveGaussian blur(medimg::RecursiveGaussianParams(8.0));
+//     blur.apply(raw, smooth, rows, cols);
+//----------------------------------------------------------------------------------------------------//
+
+struct RecursiveGaussianParams {
+    double sigma; // 0.5 .. 64, with strips up to halo / 8
+    int strip;    // rows per anti-causal vertical strip, 0 for whole columns
+    int halo;     // rows below a strip the anti-causal vertical pass starts from, at least 8 * sigma
+    int threads;  // 0 for one per hardware thread
+
+    RecursiveGaussianParams(double _sigma = 2.0, int _strip = 0, int _halo = 0)
+        : sigma(_sigma), strip(_strip), halo(_halo), threads(0) {}
+};
+
+class RecursiveGaussian {
+   public:
+    // Recursion coefficients are Q.COEF_FRAC, the border matrix Q.BORDER_FRAC, recursion states
+    // Q.STATE_FRAC and the values between passes Q.INTER_FRAC, as in the kernel. 16-bit states times
+    // coefficients fit 62 bits up to sigma 64, where b is ~1.5e-5. The border matrix entries reach ~830
+    // there and its rounding error is amplified ~q^2 by the anti-causal pass, so it takes 128-bit products
+    static const int COEF_FRAC = 26;
+    static const int BORDER_FRAC = 30;
+    static const int STATE_FRAC = 18;
+    static const int INTER_FRAC = 8;
+
+    /* w[n] = (b * x[n] + a1 * w[n - 1] + a2 * w[n - 2] + a3 * w[n - 3]) >> COEF_FRAC, b + a1 + a2 + a3
+     * exactly 1 << COEF_FRAC; m maps the last three causal states to the first anti-causal ones */
+    struct Coeffs {
+        int64_t b, a1, a2, a3;
+        int64_t m[3][3];
+    };
+
+    static Coeffs coeffs(double sigma) {
+        double q = (sigma >= 2.5) ? (0.98711 * sigma - 0.96330) : (3.97156 - 4.14554 * sqrt(1.0 - 0.26891 * sigma));
+        double b0 = 1.57825 + 2.44413 * q + 1.4281 * q * q + 0.422205 * q * q * q;
+        double a1 = (2.44413 * q + 2.85619 * q * q + 1.26661 * q * q * q) / b0;
+        double a2 = -(1.4281 * q * q + 1.26661 * q * q * q) / b0;
+        double a3 = (0.422205 * q * q * q) / b0;
+        const double one = (double)(1 << COEF_FRAC), border = (double)((int64_t)1 << BORDER_FRAC);
+        Coeffs c;
+        c.a1 = roundQ(a1 * one);
+        c.a2 = roundQ(a2 * one);
+        c.a3 = roundQ(a3 * one);
+        c.b = (1 << COEF_FRAC) - c.a1 - c.a2 - c.a3;
+
+        // The border matrix of the rounded coefficients, its entries grow with sigma and are sensitive to them
+        a1 = c.a1 / one, a2 = c.a2 / one, a3 = c.a3 / one;
+        double b = c.b / one;
+        double scale = b / ((1.0 + a1 - a2 + a3) * (1.0 - a1 - a2 - a3) * (1.0 + a2 + (a1 - a3) * a3));
+        double m[3][3] = {{-a3 * a1 + 1.0 - a3 * a3 - a2, (a3 + a1) * (a2 + a3 * a1), a3 * (a1 + a3 * a2)},
+                          {a1 + a3 * a2, -(a2 - 1.0) * (a2 + a3 * a1), -a3 * (a3 * a1 + a3 * a3 + a2 - 1.0)},
+                          {a3 * a1 + a2 + a1 * a1 - a2 * a2,
+                           a1 * a2 + a3 * a2 * a2 - a1 * a3 * a3 - a3 * a3 * a3 - a3 * a2 + a3, a3 * (a1 + a3 * a2)}};
+        for (int i = 0; i < 3; i++)
+            for (int j = 0; j < 3; j++) c.m[i][j] = roundQ(m[i][j] * scale * border);
+        return c;
+    }
+
+    explicit RecursiveGaussian(const RecursiveGaussianParams& params)
+        : mParams(params), mCoeffs(coeffs(params.sigma)) {}
+
+    const RecursiveGaussianParams& params() const { return mParams; }
+
+    /* T is uint8_t or uint16_t; strides in elements, 0 for cols */
+    template <typename T>
+    void apply(const T* src, T* dst, int rows, int cols, int src_stride = 0, int dst_stride = 0) {
+        if (src_stride == 0) src_stride = cols;
+        if (dst_stride == 0) dst_stride = cols;
+        mInter.resize((size_t)rows * cols);
+
+        // Rows, LANES at a time: a block is transposed so that lane l is row y + l
+        forRanges((rows + LANES - 1) / LANES, [&](int k0, int k1) {
+            std::vector<int64_t> x((size_t)cols * LANES), u((size_t)cols * LANES);
+            for (int k = k0; k < k1; k++) {
+                const int y0 = k * LANES, n = std::min(LANES, rows - y0);
+                for (int l = 0; l < LANES; l++) {
+                    const T* in = src + (size_t)(y0 + std::min(l, n - 1)) * src_stride;
+                    for (int i = 0; i < cols; i++) x[(size_t)i * LANES + l] = (int64_t)in[i] << STATE_FRAC;
+                }
+                filterLanes<LANES>(x.data(), u.data(), cols);
+                for (int l = 0; l < n; l++) {
+                    int32_t* out = &mInter[(size_t)(y0 + l) * cols];
+                    for (int i = 0; i < cols; i++) out[i] = toInter(x[(size_t)i * LANES + l]);
+                }
+            }
+        });
+
+        // Columns, a row of a stripe at a time
+        const int stripe = std::max(64, (cols + threadCount() - 1) / threadCount());
+        forRanges((cols + stripe - 1) / stripe, [&](int s0, int s1) {
+            const int c0 = s0 * stripe, c1 = std::min(cols, s1 * stripe);
+            filterColumns(dst, rows, cols, c0, c1, dst_stride);
+        });
+    }
+
+   private:
+    static const int LANES = 8;
+
+    RecursiveGaussianParams mParams;
+    Coeffs mCoeffs;
+    std::vector<int32_t> mInter; // after the row passes, Q.INTER_FRAC
+
+    static int64_t roundQ(double v) { return (int64_t)floor(v + 0.5); }
+
+    static int32_t toInter(int64_t v) {
+        return (int32_t)((v + ((int64_t)1 << (STATE_FRAC - INTER_FRAC - 1))) >> (STATE_FRAC - INTER_FRAC));
+    }
+
+    /* One recursion step over W independent lanes, n of them for W 0 */
+    template <int W>
+    void step(const int64_t* x, const int64_t* w1, const int64_t* w2, const int64_t* w3, int64_t* w, int n = W) const {
+        const int64_t b = mCoeffs.b, a1 = mCoeffs.a1, a2 = mCoeffs.a2, a3 = mCoeffs.a3;
+        const int64_t half = (int64_t)1 << (COEF_FRAC - 1);
+        const int lanes = W ? W : n;
+        for (int l = 0; l < lanes; l++)
+            w[l] = (b * x[l] + a1 * w1[l] + a2 * w2[l] + a3 * w3[l] + half) >> COEF_FRAC;
+    }
+
+    /* Triggs and Sdika: the anti-causal states v[n - 1], v[n], v[n + 1] of a sequence of n samples ending
+     * in x_end, from its last causal states u[n - 1], u[n - 2], u[n - 3] */
+    void triggs(int64_t x_end, int64_t u1, int64_t u2, int64_t u3, int64_t v[3]) const {
+        const __int128 half = (__int128)1 << (BORDER_FRAC - 1);
+        for (int i = 0; i < 3; i++) {
+            const __int128 sum = (__int128)mCoeffs.m[i][0] * (u1 - x_end) + (__int128)mCoeffs.m[i][1] * (u2 - x_end) +
+                                 (__int128)mCoeffs.m[i][2] * (u3 - x_end);
+            v[i] = x_end + (int64_t)((sum + half) >> BORDER_FRAC);
+        }
+    }
+
+    /* Causal then anti-causal over n samples of W interleaved lanes, in place in x (Q.STATE_FRAC) */
+    template <int W>
+    void filterLanes(int64_t* x, int64_t* u, int n) const {
+        int64_t init[3][W];
+        for (int l = 0; l < W; l++) init[0][l] = init[1][l] = init[2][l] = x[l];
+        for (int i = 0; i < n; i++) {
+            const int64_t* w1 = (i >= 1) ? &u[(size_t)(i - 1) * W] : init[0];
+            const int64_t* w2 = (i >= 2) ? &u[(size_t)(i - 2) * W] : init[1];
+            const int64_t* w3 = (i >= 3) ? &u[(size_t)(i - 3) * W] : init[2];
+            step<W>(&x[(size_t)i * W], w1, w2, w3, &u[(size_t)i * W]);
+        }
+
+        // The last causal input is still needed for the Triggs and Sdika start
+        int64_t tail[3][W];
+        for (int l = 0; l < W; l++) {
+            const int64_t u1 = u[(size_t)(n - 1) * W + l];
+            const int64_t u2 = (n >= 2) ? u[(size_t)(n - 2) * W + l] : init[0][l];
+            const int64_t u3 = (n >= 3) ? u[(size_t)(n - 3) * W + l] : init[0][l];
+            int64_t v[3];
+            triggs(x[(size_t)(n - 1) * W + l], u1, u2, u3, v);
+            for (int i = 0; i < 3; i++) tail[i][l] = v[i];
+        }
+        for (int l = 0; l < W; l++) x[(size_t)(n - 1) * W + l] = tail[0][l];
+        for (int i = n - 2; i >= 0; i--) {
+            const int64_t* w1 = &x[(size_t)(i + 1) * W];
+            const int64_t* w2 = (i + 2 < n) ? &x[(size_t)(i + 2) * W] : tail[i + 2 - n + 1];
+            const int64_t* w3 = (i + 3 < n) ? &x[(size_t)(i + 3) * W] : tail[i + 3 - n + 1];
+            int64_t* w = &x[(size_t)i * W];
+            // u[i] is read before x[i] is overwritten
+            step<W>(&u[(size_t)i * W], w1, w2, w3, w);
+        }
+    }
+
+    /* Vertical passes over columns c0 .. c1 - 1: the causal pass over the whole height, keeping its output
+     * at Q.INTER_FRAC, then per strip the anti-causal pass from the halo end, or from the bottom border
+     * with the Triggs and Sdika start when the halo reaches it */
+    template <typename T>
+    void filterColumns(T* dst, int rows, int cols, int c0, int c1, int dst_stride) const {
+        const int w = c1 - c0, shift = STATE_FRAC - INTER_FRAC;
+        const int strip = (mParams.strip > 0) ? mParams.strip : rows;
+        const int halo = (mParams.strip > 0) ? mParams.halo : 0;
+        const int64_t out_max = (T)~(T)0;
+        std::vector<int32_t> u((size_t)rows * w);
+        std::vector<int64_t> x(w), s0(w), s1(w), s2(w), s3(w);
+        int64_t *w1 = s1.data(), *w2 = s2.data(), *w3 = s3.data(), *w0 = s0.data();
+
+        for (int c = 0; c < w; c++) w1[c] = w2[c] = w3[c] = (int64_t)mInter[c0 + c] << shift;
+        for (int r = 0; r < rows; r++) {
+            const int32_t* in = &mInter[(size_t)r * cols + c0];
+            for (int c = 0; c < w; c++) x[c] = (int64_t)in[c] << shift;
+            step<0>(x.data(), w1, w2, w3, w0, w);
+            int32_t* keep = &u[(size_t)r * w];
+            for (int c = 0; c < w; c++) keep[c] = toInter(w0[c]);
+            std::swap(w3, w2);
+            std::swap(w2, w1);
+            std::swap(w1, w0);
+        }
+        // w1, w2, w3 now hold the last three causal states, x the last input row
+
+        std::vector<int64_t> uin(w), d0(w), d1(w), d2(w), d3(w);
+        for (int top = 0; top < rows; top += strip) {
+            const int bottom = std::min(top + strip, rows), end = std::min(bottom + halo, rows);
+            int64_t *v0 = d0.data(), *v1 = d1.data(), *v2 = d2.data(), *v3 = d3.data();
+            for (int c = 0; c < w; c++) {
+                if (end == rows) {
+                    int64_t v[3];
+                    triggs(x[c], w1[c], w2[c], w3[c], v);
+                    v1[c] = v[0], v2[c] = v[1], v3[c] = v[2];
+                } else {
+                    v1[c] = v2[c] = v3[c] = (int64_t)u[(size_t)(end - 1) * w + c] << shift;
+                }
+            }
+            for (int r = end - 1; r >= top; r--) {
+                if (r < end - 1) {
+                    const int32_t* in = &u[(size_t)r * w];
+                    for (int c = 0; c < w; c++) uin[c] = (int64_t)in[c] << shift;
+                    step<0>(uin.data(), v1, v2, v3, v0, w);
+                    std::swap(v3, v2);
+                    std::swap(v2, v1);
+                    std::swap(v1, v0);
+                }
+                if (r >= bottom) continue;
+                T* out = dst + (size_t)r * dst_stride + c0;
+                const int64_t half = (int64_t)1 << (STATE_FRAC - 1);
+                for (int c = 0; c < w; c++)
+                    out[c] = (T)std::min(std::max((v1[c] + half) >> STATE_FRAC, (int64_t)0), out_max);
+            }
+        }
+    }
+
+    int threadCount() const {
+        int n = mParams.threads;
+        if (n <= 0) n = (int)std::thread::hardware_concurrency();
+        return std::max(n, 1);
+    }
+
+    /* f(begin, end) on contiguous ranges of 0 .. n - 1, one per thread */
+    template <typename F>
+    void forRanges(int n, F f) const {
+        const int threads = std::max(1, std::min(threadCount(), n));
+        if (threads == 1) {
+            f(0, n);
+            return;
+        }
+        std::vector<std::thread> workers;
+        for (int t = 0; t < threads; t++)
+            workers.push_back(std::thread(f, (int)((int64_t)n * t / threads), (int)((int64_t)n * (t + 1) / threads)));
+        for (auto& t : workers) t.join();
+    }
+};
+
+} // namespace medimg
+
+#endif //_MEDIMG_RECURSIVE_GAUSSIAN_H_
@@ -0,0 +1,192 @@
+/*
+ * Copyright 2021 Xilinx, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _MEDIMG_REGION_STATS_H_
+#define _MEDIMG_REGION_STATS_H_
+
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+namespace medimg {
+
+//----------------------------------------------------------------------------------------------------//
+// CPU counterpart of xf::cv::regionStats (core/xf_region_stats.hpp)
+//
+// One pass over an intensity image and its label image gives, for every label below maxRegions, the
+// number of pixels, sum and sum of squares of their intensities, and minimum and maximum with the first
+// pixel in raster order that holds each; the same table as the kernel's. Every row is split into runs
+// of equal labels and each run is reduced by loops the compiler vectorizes, its minimum and maximum
+// located only when they beat the table's. Threads take bands of rows into tables of their own, which
+// are merged in band order:
+//
+//     medimg::RegionStats roi(medimg::RegionStatsParams(2));
+//     std::vector<medimg::RegionStatistics> stats;
+//     roi.apply(raw, mask, rows, cols, stats);  // mask of 0 and 1, stats[1].mean() in HU
+//----------------------------------------------------------------------------------------------------//
+
+struct RegionStatistics {
+    uint32_t count;
+    uint64_t sum, sum_sq;
+    uint16_t min, max;
+    uint16_t min_x, min_y, max_x, max_y; // first pixel in raster order holding min and max
+
+    double mean() const { return count ? (double)sum / count : 0.0; }
+    double stddev() const {
+        if (count == 0) return 0.0;
+        double m = mean();
+        return sqrt(std::max((double)sum_sq / count - m * m, 0.0));
+    }
+};
+
+struct RegionStatsParams {
+    int maxRegions; // labels of maxRegions and above count into no region
+    int threads;    // 0 for one per hardware thread
+
+    explicit RegionStatsParams(int _maxRegions = 256) : maxRegions(_maxRegions), threads(0) {}
+};
+
+class RegionStats {
+   public:
+    explicit RegionStats(const RegionStatsParams& params) : mParams(params) {}
+
+    const RegionStatsParams& params() const { return mParams; }
+
+    /* T is uint8_t or uint16_t, L any unsigned integer; fills stats[0 .. maxRegions - 1], empty regions
+     * all zero, and returns the number of pixels outside the table. Strides in elements, 0 for cols */
+    template <typename T, typename L>
+    uint32_t apply(const T* src,
+                   const L* labels,
+                   int rows,
+                   int cols,
+                   std::vector<RegionStatistics>& stats,
+                   int src_stride = 0,
+                   int lbl_stride = 0) const {
+        if (src_stride == 0) src_stride = cols;
+        if (lbl_stride == 0) lbl_stride = cols;
+        const int regions = mParams.maxRegions;
+        const int threads = std::max(1, std::min(threadCount(), rows));
+        std::vector<std::vector<RegionStatistics> > tables(threads);
+        std::vector<uint32_t> outside(threads, 0);
+
+        forRanges(rows, threads, [&](int t, int y0, int y1) {
+            std::vector<RegionStatistics>& table = tables[t];
+            table.assign(regions, RegionStatistics());
+            uint32_t out = 0;
+            for (int y = y0; y < y1; y++) {
+                const T* in = src + (size_t)y * src_stride;
+                const L* lbl = labels + (size_t)y * lbl_stride;
+                int x = 0;
+                while (x < cols) {
+                    const L l = lbl[x];
+                    int x1 = x + 1;
+                    while (x1 < cols && lbl[x1] == l) x1++;
+                    if ((size_t)l >= (size_t)regions)
+                        out += x1 - x;
+                    else
+                        addRun(table[l], in, x, x1, y);
+                    x = x1;
+                }
+            }
+            outside[t] = out;
+        });
+
+        stats.assign(regions, RegionStatistics());
+        uint32_t out = 0;
+        for (int t = 0; t < threads; t++) {
+            out += outside[t];
+            for (int r = 0; r < regions; r++) merge(stats[r], tables[t][r]);
+        }
+        return out;
+    }
+
+   private:
+    RegionStatsParams mParams;
+
+    /* Pixels x0 .. x1 - 1 of row y, which come after everything already in s */
+    template <typename T>
+    static void addRun(RegionStatistics& s, const T* in, int x0, int x1, int y) {
+        uint32_t sum = 0, lo = 0xffff, hi = 0;
+        uint64_t sum_sq = 0;
+        for (int x = x0; x < x1; x++) {
+            const uint32_t p = in[x];
+            sum += p;
+            sum_sq += p * p;
+            lo = std::min(lo, p);
+            hi = std::max(hi, p);
+        }
+        const bool empty = (s.count == 0);
+        s.count += x1 - x0;
+        s.sum += sum;
+        s.sum_sq += sum_sq;
+        if (empty || lo < s.min) {
+            s.min = (uint16_t)lo;
+            s.min_x = (uint16_t)(std::find(in + x0, in + x1, (T)lo) - in);
+            s.min_y = (uint16_t)y;
+        }
+        if (empty || hi > s.max) {
+            s.max = (uint16_t)hi;
+            s.max_x = (uint16_t)(std::find(in + x0, in + x1, (T)hi) - in);
+            s.max_y = (uint16_t)y;
+        }
+    }
+
+    /* Adds the table entry of a later band */
+    static void merge(RegionStatistics& s, const RegionStatistics& b) {
+        if (b.count == 0) return;
+        const bool empty = (s.count == 0);
+        s.count += b.count;
+        s.sum += b.sum;
+        s.sum_sq += b.sum_sq;
+        if (empty || b.min < s.min) {
+            s.min = b.min;
+            s.min_x = b.min_x;
+            s.min_y = b.min_y;
+        }
+        if (empty || b.max > s.max) {
+            s.max = b.max;
+            s.max_x = b.max_x;
+            s.max_y = b.max_y;
+        }
+    }
+
+    int threadCount() const {
+        int n = mParams.threads;
+        if (n <= 0) n = (int)std::thread::hardware_concurrency();
+        return std::max(n, 1);
+    }
+
+    /* f(t, begin, end) on contiguous ranges of 0 .. n - 1, one per thread t */
+    template <typename F>
+    static void forRanges(int n, int threads, F f) {
+        if (threads == 1) {
+            f(0, 0, n);
+            return;
+        }
+        std::vector<std::thread> workers;
+        for (int t = 0; t < threads; t++)
+            workers.push_back(
+                std::thread(f, t, (int)((int64_t)n * t / threads), (int)((int64_t)n * (t + 1) / threads)));
+        for (auto& t : workers) t.join();
+    }
+};
+
+} // namespace medimg
+
+#endif //_MEDIMG_REGION_STATS_H_
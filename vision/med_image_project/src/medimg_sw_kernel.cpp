@@ -0,0 +1,123 @@
+/*
+ * Copyright 2021 Xilinx, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * medimg_accel on the software OpenCL device (ext/xcl2/xcl_sw_device.hpp). Only compiled in with
+ * -DXCL_SW_DEVICE, the Vitis host build sees an empty translation unit.
+ *
+ * By default the kernel's own C++ source runs (C-simulation), which has to be compiled with the kernel
+ * project's include paths and linked in:
+ *   KSRC=../../med_image_project_kernels/src
+ *   XF="-I../libs/xf_opencv/L1/include -I../libs/xf_opencv/ext/xcl2"
+ *   g++ -std=c++14 -O3 -DXCL_SW_DEVICE $XF -I. -Ibuild -c medimg_tb.cpp medimg_sw_kernel.cpp \
+ *       ../libs/xf_opencv/ext/xcl2/xcl2.cpp
+ *   g++ -std=c++14 -O3 $XF -I$KSRC -I$KSRC/build -c $KSRC/medimg_accel.cpp
+ *   g++ -pthread *.o -lopencv_core -lopencv_imgproc -lopencv_imgcodecs -o medimg_sw
+ * With -DXCL_SW_MEDIMG_CPU the same pipeline runs on OpenCV instead and medimg_accel.cpp is not needed.
+ */
+
+#ifdef XCL_SW_DEVICE
+
+#include "common/xf_headers.hpp"
+#include "xcl2.hpp"
+#include "medimg_config.h"
+
+#ifdef XCL_SW_MEDIMG_CPU
+#if DENOISE
+#include "medimg_bilateral_grid.h"
+#endif
+#if LOCAL_THRESH
+#include "imgproc/xf_local_threshold.hpp"
+#include "medimg_local_threshold.h"
+#endif
+#if EQUALIZE
+/* Bit exact with xf::cv::equalizeHistTemporal: maps through the previous slice's distribution and leaves
+ * this slice's histogram in hist */
+static void equalize_temporal(cv::Mat& img, unsigned int* hist) {
+    uint32_t total = 0;
+    for (int i = 0; i < 256; i++) total += hist[i];
+    uint32_t init_val = total - hist[0];
+    uint64_t scale1 = (init_val == 0) ? 0 : 255 * (uint64_t)(((uint32_t)1 << 31) / init_val);
+
+    cv::Mat lut(1, 256, CV_8UC1);
+    uint32_t temp_sum = 0;
+    for (int i = 0; i < 256; i++) {
+        if (total == 0 || i == 0) {
+            lut.data[i] = (total == 0) ? i : 0;
+        } else {
+            temp_sum += hist[i];
+            lut.data[i] = (uint8_t)(((uint64_t)temp_sum * scale1 + 0x40000000) >> 31);
+        }
+    }
+
+    memset(hist, 0, 256 * sizeof(unsigned int));
+    for (int r = 0; r < img.rows; r++) {
+        const unsigned char* row = img.ptr<unsigned char>(r);
+        for (int c = 0; c < img.cols; c++) hist[row[c]]++;
+    }
+    cv::LUT(img, lut, img);
+}
+#endif
+
+static void medimg_accel_sw(xcl_sw::KernelArgs& args) {
+    int rows = args.scalar<int>(3);
+    int cols = args.scalar<int>(4);
+    unsigned char thresh = args.scalar<unsigned char>(5);
+    unsigned char maxval = args.scalar<unsigned char>(6);
+
+    cv::Mat in(rows, cols, CV_8UC1, args.buffer<unsigned char>(0));
+    cv::Mat element(FILTER_SIZE, FILTER_SIZE, CV_8UC1, args.buffer<unsigned char>(1));
+    cv::Mat out(rows, cols, CV_8UC1, args.buffer<unsigned char>(2));
+    cv::Mat thresh_out, morph_out;
+
+#if DENOISE
+    // Bit exact with xf::cv::bilateralGrid
+    cv::Mat denoised(rows, cols, CV_8UC1);
+    medimg::BilateralGrid denoise(medimg::BilateralGridParams(DENOISE_SPACE_SHIFT, DENOISE_RANGE_SHIFT, 8));
+    denoise.apply(in.data, denoised.data, rows, cols);
+    in = denoised;
+#endif
+#if EQUALIZE
+    in = in.clone(); // The input buffer stays untouched, as on the device
+    equalize_temporal(in, args.buffer<unsigned int>(7));
+#endif
+#if LOCAL_THRESH
+    // Bit exact with xf::cv::localThreshold
+    thresh_out.create(rows, cols, CV_8UC1);
+    medimg::LocalThreshold binarize(medimg::LocalThresholdParams(
+        (medimg::LocalThresholdParams::Method)LOCAL_THRESH_METHOD, LOCAL_THRESH_WIN, LOCAL_THRESH_K));
+    binarize.apply(in.data, thresh_out.data, rows, cols, thresh, maxval, (int)in.step);
+#else
+    cv::threshold(in, thresh_out, thresh, maxval, THRESH_TYPE);
+#endif
+    cv::dilate(thresh_out, morph_out, element);
+    cv::erode(morph_out, out, element);
+}
+#else
+static void medimg_accel_sw(xcl_sw::KernelArgs& args) {
+    medimg_accel(args.buffer<ap_uint<INPUT_PTR_WIDTH> >(0), args.buffer<unsigned char>(1),
+                 args.buffer<ap_uint<OUTPUT_PTR_WIDTH> >(2), args.scalar<int>(3), args.scalar<int>(4),
+                 args.scalar<unsigned char>(5), args.scalar<unsigned char>(6)
+#if EQUALIZE
+                 , args.buffer<unsigned int>(7)
+#endif
+                 );
+}
+#endif
+
+XCL_SW_KERNEL(medimg_accel, medimg_accel_sw);
+
+#endif // XCL_SW_DEVICE
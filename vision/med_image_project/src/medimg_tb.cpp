@@ -18,6 +18,7 @@
 #include "xcl2.hpp"
 #include <time.h>
 #include "medimg_config.h"
+#include <chrono>
 #include <iostream>
 
 int main(int argc, char** argv) {
@@ -81,6 +82,7 @@ int main(int argc, char** argv) {
 
     cl_int err;
     std::cout << "INFO: Running OpenCL section." << std::endl;
+    auto startup = std::chrono::steady_clock::now();
 
     std::vector<cl::Device> devices = xcl::get_xil_devices();
     cl::Device device = devices[0];
@@ -90,10 +92,13 @@ int main(int argc, char** argv) {
     std::string device_name = device.getInfo<CL_DEVICE_NAME>();
     //std::string binaryFile = xcl::find_binary_file(device_name, "krnl_medimg");
     std::string binaryFile = argv[4];
+    auto load = std::chrono::steady_clock::now();
     cl::Program::Binaries bins = xcl::import_binary_file(binaryFile);
+    double load_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - load).count();
     devices.resize(1);
 
     OCL_CHECK(err, cl::Program program(context, devices, bins, NULL, &err));
+    xcl::release_binary_file(bins); // The device is programmed, the xclbin mapping is no longer needed
 
     // Create a kernel:
     OCL_CHECK(err, cl::Kernel kernel(program, "medimg_accel", &err));
@@ -102,6 +107,11 @@ int main(int argc, char** argv) {
     OCL_CHECK(err, cl::Buffer imageToDevice(context, CL_MEM_READ_ONLY, (height * width), NULL, &err));
     OCL_CHECK(err, cl::Buffer buffer_inShape(context, CL_MEM_READ_ONLY, vec_in_size_bytes, NULL, &err));
     OCL_CHECK(err, cl::Buffer imageFromDevice(context, CL_MEM_WRITE_ONLY, (height * width), NULL, &err));
+#if EQUALIZE
+    // A single image is the first slice of its series and passes the equalizer unchanged
+    std::vector<unsigned int> hist(256, 0);
+    OCL_CHECK(err, cl::Buffer buffer_hist(context, CL_MEM_READ_WRITE, hist.size() * sizeof(unsigned int), NULL, &err));
+#endif
 
 
     // Set the kernel arguments
@@ -112,9 +122,15 @@ int main(int argc, char** argv) {
     OCL_CHECK(err, err = kernel.setArg(4, width));
     OCL_CHECK(err, err = kernel.setArg(5, thresh));
     OCL_CHECK(err, err = kernel.setArg(6, maxval));
+#if EQUALIZE
+    OCL_CHECK(err, err = kernel.setArg(7, buffer_hist));
+#endif
 
     cl::Event event;
     OCL_CHECK(err, q.enqueueWriteBuffer(imageToDevice, CL_TRUE, 0, (height * width), bw_img.data));
+#if EQUALIZE
+    OCL_CHECK(err, q.enqueueWriteBuffer(buffer_hist, CL_TRUE, 0, hist.size() * sizeof(unsigned int), hist.data()));
+#endif
     //OCL_CHECK(err, q.enqueueWriteBuffer(buffer_inShape, CL_TRUE, 0, vec_in_size_bytes, shape.data()));
     OCL_CHECK(err, q.enqueueWriteBuffer(buffer_inShape, CL_TRUE, 0, vec_in_size_bytes, shape.data(), nullptr, &event));
 
@@ -127,6 +143,9 @@ int main(int argc, char** argv) {
     // Launch the kernel
     OCL_CHECK(err, err = q.enqueueTask(kernel, NULL, &event_sp));
     clWaitForEvents(1, (const cl_event*)&event_sp);
+    std::cout << "INFO: Startup to first kernel: "
+              << std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startup).count()
+              << " ms (xclbin load " << load_ms << " ms)" << std::endl;
 
     event_sp.getProfilingInfo(CL_PROFILING_COMMAND_START, &start);
     event_sp.getProfilingInfo(CL_PROFILING_COMMAND_END, &end);
@@ -0,0 +1,228 @@
+/*
+ * Copyright 2021 Xilinx, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _XF_MAT_POOL_H_
+#define _XF_MAT_POOL_H_
+
+#ifndef __cplusplus
+#error C++ is needed to use this file!
+#endif
+
+#ifdef __SYNTHESIS__
+#error xf_mat_pool.hpp is a host / C-simulation only header!
+#endif
+
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+#include <sys/mman.h>
+
+namespace xf {
+namespace cv {
+
+//----------------------------------------------------------------------------------------------------//
+// Frame buffer pool for memory mapped xf::cv::Mat objects (host / C-simulation only)
+//
+// Mat::alloc_data() normally mallocs every frame buffer and free_data() hands it straight back. With
+// several 4K frames per iteration that churns the allocator and page faults fresh memory each time.
+// A MatPool keeps released buffers in per size class free lists and hands them out again:
+//
+//     xf::cv::MatPool pool;
+//     for (each frame) {
+//         xf::cv::MatPoolScope scope(pool);       // Mats allocated on this thread now use the pool
+//         xf::cv::Mat<XF_8UC1, HEIGHT, WIDTH, NPC1> in(rows, cols), out(rows, cols);
+//         ...
+//     }
+//
+// Buffers are page aligned (CL_MEM_USE_HOST_PTR friendly) and buffers of 2MB and up are aligned to and
+// advised as transparent huge pages. A Mat remembers the pool it was allocated from, so it may outlive
+// the scope, but not the pool itself. Defining XF_MAT_POOL_GLOBAL routes every Mat allocation made
+// outside a scope through MatPool::global().
+//----------------------------------------------------------------------------------------------------//
+struct MatPoolStats {
+    uint64_t allocs;         // allocate() calls
+    uint64_t frees;          // deallocate() calls
+    uint64_t hits;           // allocations served from a free list
+    uint64_t misses;         // allocations that had to go to the system
+    uint64_t bytesInUse;     // bytes currently handed out
+    uint64_t peakBytesInUse; // high water mark of bytesInUse
+    uint64_t bytesCached;    // bytes parked in free lists
+};
+
+class MatPool {
+   public:
+    static constexpr size_t PAGE_SIZE = 4096;
+    static constexpr size_t HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+
+    // max_cached_bytes bounds the memory kept in free lists, 0 means unbounded
+    explicit MatPool(size_t max_cached_bytes = 0) : mMaxCached(max_cached_bytes) { resetStats(); }
+
+    ~MatPool() {
+        if (mStats.bytesInUse != 0) {
+            fprintf(stderr, "WARNING: xf::cv::MatPool destroyed with %llu bytes still in use\n",
+                    (unsigned long long)mStats.bytesInUse);
+        }
+        trim();
+    }
+
+    /* Rounds a request up to its size class: whole pages, then at most 4 classes per power of two */
+    static size_t sizeClass(size_t bytes) {
+        size_t sz = (bytes + PAGE_SIZE - 1) & ~(PAGE_SIZE - 1);
+        if (sz <= 4 * PAGE_SIZE) return (sz == 0) ? PAGE_SIZE : sz;
+
+        int msb = 63 - __builtin_clzll((unsigned long long)sz);
+        size_t step = (size_t)1 << (msb - 2);
+        return (sz + step - 1) & ~(step - 1);
+    }
+
+    void* allocate(size_t bytes) {
+        size_t cls = sizeClass(bytes);
+        void* ptr = nullptr;
+        {
+            std::lock_guard<std::mutex> lg(mLock);
+            mStats.allocs++;
+            std::vector<void*>& list = mFree[cls];
+            if (!list.empty()) {
+                ptr = list.back();
+                list.pop_back();
+                mStats.hits++;
+                mStats.bytesCached -= cls;
+            } else {
+                mStats.misses++;
+            }
+            if (ptr != nullptr) inUse(cls);
+        }
+        if (ptr != nullptr) return ptr;
+
+        ptr = systemAlloc(cls);
+        if (ptr != nullptr) {
+            std::lock_guard<std::mutex> lg(mLock);
+            inUse(cls);
+        }
+        return ptr;
+    }
+
+    void deallocate(void* ptr, size_t bytes) {
+        if (ptr == nullptr) return;
+        size_t cls = sizeClass(bytes);
+
+        std::lock_guard<std::mutex> lg(mLock);
+        mStats.frees++;
+        mStats.bytesInUse -= cls;
+        if ((mMaxCached != 0) && (mStats.bytesCached + cls > mMaxCached)) {
+            free(ptr);
+            return;
+        }
+        mFree[cls].push_back(ptr);
+        mStats.bytesCached += cls;
+    }
+
+    /* Returns every cached buffer to the system */
+    void trim() {
+        std::lock_guard<std::mutex> lg(mLock);
+        for (auto& it : mFree) {
+            for (void* ptr : it.second) free(ptr);
+            it.second.clear();
+        }
+        mStats.bytesCached = 0;
+    }
+
+    MatPoolStats stats() {
+        std::lock_guard<std::mutex> lg(mLock);
+        return mStats;
+    }
+
+    void resetStats() {
+        std::lock_guard<std::mutex> lg(mLock);
+        uint64_t in_use = mStats.bytesInUse, cached = mStats.bytesCached;
+        mStats = MatPoolStats();
+        mStats.bytesInUse = in_use;
+        mStats.peakBytesInUse = in_use;
+        mStats.bytesCached = cached;
+    }
+
+    /* Pool installed by the innermost MatPoolScope of the calling thread, if any */
+    static MatPool*& current() {
+        static thread_local MatPool* pool = nullptr;
+        return pool;
+    }
+
+    static MatPool& global() {
+        static MatPool pool;
+        return pool;
+    }
+
+    /* Pool a Mat allocated right now on this thread should use, nullptr for plain malloc */
+    static MatPool* active() {
+#ifdef XF_MAT_POOL_GLOBAL
+        return (current() != nullptr) ? current() : &global();
+#else
+        return current();
+#endif
+    }
+
+    /* Number of Mat buffers that bypassed any pool and were malloc-ed directly */
+    static std::atomic<uint64_t>& unpooledAllocs() {
+        static std::atomic<uint64_t> count(0);
+        return count;
+    }
+
+   private:
+    std::mutex mLock;
+    std::map<size_t, std::vector<void*> > mFree;
+    size_t mMaxCached;
+    MatPoolStats mStats;
+
+    MatPool(const MatPool&);
+    MatPool& operator=(const MatPool&);
+
+    void inUse(size_t cls) {
+        mStats.bytesInUse += cls;
+        if (mStats.bytesInUse > mStats.peakBytesInUse) mStats.peakBytesInUse = mStats.bytesInUse;
+    }
+
+    static void* systemAlloc(size_t cls) {
+        void* ptr = nullptr;
+        size_t align = (cls >= HUGE_PAGE_SIZE) ? HUGE_PAGE_SIZE : PAGE_SIZE;
+        if (posix_memalign(&ptr, align, cls) != 0) return nullptr;
+#ifdef MADV_HUGEPAGE
+        if (cls >= HUGE_PAGE_SIZE) madvise(ptr, cls, MADV_HUGEPAGE);
+#endif
+        return ptr;
+    }
+};
+
+/* Installs a pool for Mat allocations on the calling thread for the lifetime of the scope */
+class MatPoolScope {
+   public:
+    explicit MatPoolScope(MatPool& pool) : mPrev(MatPool::current()) { MatPool::current() = &pool; }
+    ~MatPoolScope() { MatPool::current() = mPrev; }
+
+   private:
+    MatPool* mPrev;
+
+    MatPoolScope(const MatPoolScope&);
+    MatPoolScope& operator=(const MatPoolScope&);
+};
+
+} // namespace cv
+} // namespace xf
+
+#endif //_XF_MAT_POOL_H_
@@ -0,0 +1,166 @@
+/*
+ * Copyright 2021 Xilinx, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _XF_SIM_DATAFLOW_H_
+#define _XF_SIM_DATAFLOW_H_
+
+#ifndef __cplusplus
+#error C++ is needed to use this file!
+#endif
+
+#ifdef __SYNTHESIS__
+#error xf_sim_dataflow.hpp is a C-simulation only header!
+#endif
+
+//----------------------------------------------------------------------------------------------------//
+// Concurrent C-simulation of DATAFLOW regions
+//
+// Sequential C-sim runs every function of a DATAFLOW region to completion before the next one starts,
+// so each intermediate frame is buffered entirely and stream depths are never exercised. Built with
+// -DXF_SIM_DATAFLOW_THREADS, a region runs each stage on its own thread. The Mats connecting the stages
+// have to be streams, given an explicit depth (2, as in hardware); other Mats, host side ones included,
+// keep the memory mapped default:
+//
+//     xf::cv::Mat<XF_8UC1, HEIGHT, WIDTH, NPC, 2> in_mat(rows, cols), threshold_out(rows, cols), ...;
+//     xf::cv::DataflowRegion region("medimg_accel");
+//     region.stage("Threshold", [&] { xf::cv::Threshold<...>(in_mat, threshold_out, thresh, maxval); });
+//     region.stage("dilate", [&] { xf::cv::dilate<...>(threshold_out, morph_out, kernel); });
+//     region.join();
+//
+// Streams between stages block at their depth (see xf_sim_stream.hpp). When every live stage of a region
+// stays blocked for XF_SIM_DATAFLOW_TIMEOUT_MS, the blocked streams are reported and C-sim aborts.
+//----------------------------------------------------------------------------------------------------//
+
+#include "xf_sim_stream.hpp"
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <stdio.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifndef XF_SIM_DATAFLOW_TIMEOUT_MS
+#define XF_SIM_DATAFLOW_TIMEOUT_MS 10000
+#endif
+
+namespace xf {
+namespace cv {
+
+class DataflowRegion : public sim_dataflow_monitor {
+   public:
+    explicit DataflowRegion(const char* name = "dataflow", unsigned timeout_ms = XF_SIM_DATAFLOW_TIMEOUT_MS)
+        : mName(name), mTimeoutMs(timeout_ms), mLive(0), mProgress(0), mStalled(false), mReported(false) {}
+
+    ~DataflowRegion() { join(); }
+
+    /* Starts a stage of the region on its own thread */
+    template <typename F>
+    void stage(const char* name, F func) {
+        {
+            std::lock_guard<std::mutex> lg(mLock);
+            mLive++;
+        }
+        mThreads.push_back(std::thread([this, name, func]() {
+            sim_dataflow_thread& self = sim_dataflow_thread::self();
+            self.stage = name;
+            self.monitor = this;
+            func();
+            self.stage = NULL;
+            self.monitor = NULL;
+
+            std::lock_guard<std::mutex> lg(mLock);
+            mLive--;
+            mProgress++;
+        }));
+    }
+
+    /* Waits for all stages, the region can be reused afterwards */
+    void join() {
+        for (size_t i = 0; i < mThreads.size(); i++) mThreads[i].join();
+        mThreads.clear();
+    }
+
+    void blocked(const char* stage, const std::string& stream, bool writing, size_t depth) {
+        std::lock_guard<std::mutex> lg(mLock);
+        Block& b = mBlocked[stage];
+        b.stream = stream;
+        b.writing = writing;
+        b.depth = depth;
+    }
+
+    void unblocked(const char* stage) {
+        std::lock_guard<std::mutex> lg(mLock);
+        mBlocked.erase(stage);
+        mProgress++;
+    }
+
+    bool healthy() {
+        std::lock_guard<std::mutex> lg(mLock);
+        if (mReported) return false;
+        if (mBlocked.size() < mLive) {
+            mStalled = false;
+            return true;
+        }
+
+        std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+        if (!mStalled || (mProgress != mStallProgress)) {
+            mStalled = true;
+            mStallProgress = mProgress;
+            mStallStart = now;
+            return true;
+        }
+        if (std::chrono::duration_cast<std::chrono::milliseconds>(now - mStallStart).count() < (long long)mTimeoutMs) {
+            return true;
+        }
+
+        fprintf(stderr, "ERROR: Deadlock in dataflow region '%s', all %u live stages blocked for %u ms:\n",
+                mName.c_str(), (unsigned)mLive, mTimeoutMs);
+        for (std::map<std::string, Block>::iterator it = mBlocked.begin(); it != mBlocked.end(); ++it) {
+            fprintf(stderr, "  stage '%s' %s stream '%s' (depth %zu)\n", it->first.c_str(),
+                    it->second.writing ? "writing full" : "reading empty", it->second.stream.c_str(),
+                    it->second.depth);
+        }
+        mReported = true;
+        return false;
+    }
+
+   private:
+    struct Block {
+        std::string stream;
+        bool writing;
+        size_t depth;
+    };
+
+    std::string mName;
+    unsigned mTimeoutMs;
+    std::vector<std::thread> mThreads;
+
+    std::mutex mLock;
+    std::map<std::string, Block> mBlocked;
+    size_t mLive;
+    unsigned long long mProgress, mStallProgress;
+    bool mStalled, mReported;
+    std::chrono::steady_clock::time_point mStallStart;
+
+    DataflowRegion(const DataflowRegion&);
+    DataflowRegion& operator=(const DataflowRegion&);
+};
+
+} // namespace cv
+} // namespace xf
+
+#endif //_XF_SIM_DATAFLOW_H_
@@ -0,0 +1,417 @@
+/*
+ * Copyright 2021 Xilinx, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _XF_SIM_STREAM_H_
+#define _XF_SIM_STREAM_H_
+
+#ifndef __cplusplus
+#error C++ is needed to use this file!
+#endif
+
+#ifdef __SYNTHESIS__
+#error xf_sim_stream.hpp is a C-simulation only header!
+#endif
+
+//----------------------------------------------------------------------------------------------------//
+// Lock-free C-simulation model of hls::stream
+//
+// The vendor C-sim model is a std::deque, optionally behind a mutex, that allocates and frees as every
+// single word is pushed and popped. This header replaces it with a single-producer / single-consumer
+// ring buffer. Build C-sim with -DXF_SIM_SPSC_STREAM (xf_structs.hpp and medimg_config.h include this
+// header before hls_stream.h then), or include it first yourself. Synthesis is never affected.
+//
+// Sequential C-sim runs a producer to completion before its consumer starts, so a stream grows instead
+// of blocking when it fills up and, like the vendor model, warns and returns a default value when read
+// while empty. A bound can be set with setBound(); a bounded stream blocks the writer while full and the
+// reader while empty, for producers and consumers that run on different threads. Streams connecting
+// stages run by xf_sim_dataflow.hpp are bounded at their depth automatically.
+//----------------------------------------------------------------------------------------------------//
+
+#ifdef X_HLS_STREAM_SIM_H
+#error common/xf_sim_stream.hpp has to be included before hls_stream.h
+#endif
+// Keep the vendor simulation model out of this translation unit
+#define X_HLS_STREAM_SIM_H
+
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <typeinfo>
+#include <stdlib.h>
+
+#ifndef _MSC_VER
+#include <cxxabi.h>
+#endif
+
+// Lower bound on the depth of streams between concurrent dataflow stages. Raising it trades exact depth
+// checking for fewer thread handoffs, which matters when there are fewer cores than stages.
+#ifndef XF_SIM_DATAFLOW_MIN_DEPTH
+#define XF_SIM_DATAFLOW_MIN_DEPTH 0
+#endif
+
+namespace xf {
+namespace cv {
+
+//----------------------------------------------------------------------------------------------------//
+// Hooks for running DATAFLOW stages on separate threads (see xf_sim_dataflow.hpp)
+//
+// A stream accessed by a dataflow worker thread that did not create it connects two concurrent stages:
+// it behaves as a FIFO bounded at its depth (2 when unspecified, like hls::stream in hardware) and
+// blocks. Streams local to a stage keep growing. While blocked, a stream reports to the monitor of its
+// region, which aborts with a report once every live stage of the region has been blocked for too long.
+//----------------------------------------------------------------------------------------------------//
+class sim_dataflow_monitor {
+   public:
+    virtual ~sim_dataflow_monitor() {}
+    virtual void blocked(const char* stage, const std::string& stream, bool writing, size_t depth) = 0;
+    virtual void unblocked(const char* stage) = 0;
+    /* Returns false once the region is found deadlocked */
+    virtual bool healthy() = 0;
+};
+
+struct sim_dataflow_thread {
+    const char* stage;
+    sim_dataflow_monitor* monitor;
+
+    /* State of the calling thread, stage is NULL outside dataflow workers */
+    static sim_dataflow_thread& self() {
+        static thread_local sim_dataflow_thread t = {NULL, NULL};
+        return t;
+    }
+};
+
+template <typename T>
+class spsc_stream {
+   public:
+    static const size_t INITIAL_CAPACITY = 1024;
+    static const size_t DEFAULT_DEPTH = 2;
+
+    explicit spsc_stream(size_t bound = 0) : mName(defaultName()) { create(bound); }
+
+    spsc_stream(const std::string& name, size_t bound = 0) : mName(name) { create(bound); }
+
+    virtual ~spsc_stream() {
+        if (!empty()) {
+            std::cout << "WARNING: Hls::stream '" << mName << "' contains leftover data,"
+                      << " which may result in RTL simulation hanging." << std::endl;
+        }
+        delete[] mBuf;
+    }
+
+    const std::string& name() const { return mName; }
+
+    /* Maximum number of elements in flight, 0 for a growing stream. Only change it while the stream is idle */
+    void setBound(size_t bound) {
+        mBound = bound;
+        reserve(bound);
+        mLimit = 0;
+    }
+    size_t bound() const { return mBound; }
+
+    size_t size() const { return mTail.load(std::memory_order_acquire) - mHead.load(std::memory_order_acquire); }
+    bool empty() const { return size() == 0; }
+    bool full() const {
+        size_t b = concurrentBound();
+        return (b != 0) && (size() >= b);
+    }
+
+    /// Blocking write
+    void write(const T& tail) {
+        size_t t = mTail.load(std::memory_order_relaxed);
+        if (t - mHeadCache >= mLimit) {
+            waitForSpace(t, 1);
+        }
+        mBuf[t & mMask] = tail;
+        mTail.store(t + 1, std::memory_order_release);
+    }
+
+    /// Blocking read
+    T read() {
+        T elem;
+        read(elem);
+        return elem;
+    }
+
+    void read(T& head) {
+        size_t h = mHead.load(std::memory_order_relaxed);
+        if (mTailCache == h) {
+            if (!waitForData(h)) {
+                head = T();
+                return;
+            }
+        }
+        head = mBuf[h & mMask];
+        mHead.store(h + 1, std::memory_order_release);
+    }
+
+    /// Batched blocking write of n elements
+    void write(const T* src, size_t n) {
+        while (n > 0) {
+            size_t t = mTail.load(std::memory_order_relaxed);
+            if (t - mHeadCache >= mLimit) {
+                waitForSpace(t, 1);
+            }
+            size_t room = mLimit - (t - mHeadCache);
+            size_t cnt = (n < room) ? n : room;
+            for (size_t i = 0; i < cnt; i++) mBuf[(t + i) & mMask] = src[i];
+            mTail.store(t + cnt, std::memory_order_release);
+            src += cnt;
+            n -= cnt;
+        }
+    }
+
+    /// Batched blocking read of n elements
+    void read(T* dst, size_t n) {
+        while (n > 0) {
+            size_t h = mHead.load(std::memory_order_relaxed);
+            if (mTailCache == h) {
+                if (!waitForData(h)) {
+                    for (size_t i = 0; i < n; i++) dst[i] = T();
+                    return;
+                }
+            }
+            size_t avail = mTailCache - h;
+            size_t cnt = (n < avail) ? n : avail;
+            for (size_t i = 0; i < cnt; i++) dst[i] = mBuf[(h + i) & mMask];
+            mHead.store(h + cnt, std::memory_order_release);
+            dst += cnt;
+            n -= cnt;
+        }
+    }
+
+    /// Nonblocking read
+    bool read_nb(T& head) {
+        size_t h = mHead.load(std::memory_order_relaxed);
+        if (mTailCache == h) {
+            mTailCache = mTail.load(std::memory_order_acquire);
+            if (mTailCache == h) {
+                head = T();
+                return false;
+            }
+        }
+        head = mBuf[h & mMask];
+        mHead.store(h + 1, std::memory_order_release);
+        return true;
+    }
+
+    /// Nonblocking write
+    bool write_nb(const T& tail) {
+        if (full()) return false;
+        write(tail);
+        return true;
+    }
+
+    void operator>>(T& rdata) { read(rdata); }
+    void operator<<(const T& wdata) { write(wdata); }
+
+   protected:
+    std::string mName;
+    std::thread::id mCreator;
+    size_t mBound;
+    size_t mDepth;
+    size_t mCap;
+    size_t mMask;
+    T* mBuf;
+
+    // Producer and consumer indices on separate cache lines, each side caches the other one's index.
+    // mLimit is the producer's current bound, 0 until its first write resolved it.
+    alignas(64) std::atomic<size_t> mTail;
+    size_t mHeadCache;
+    size_t mLimit;
+    bool mGrowing;
+    alignas(64) std::atomic<size_t> mHead;
+    size_t mTailCache;
+
+    /* hls::stream<T, DEPTH> records its depth, used as bound between concurrent dataflow stages */
+    void setDepth(size_t depth) {
+        mDepth = depth;
+        reserve(atLeastMinDepth(depth));
+        mLimit = 0;
+    }
+
+   private:
+    spsc_stream(const spsc_stream&);
+    spsc_stream& operator=(const spsc_stream&);
+
+    static std::string defaultName() {
+        static std::atomic<unsigned> counter(1);
+        std::string name;
+#ifndef _MSC_VER
+        char* demangled = abi::__cxa_demangle(typeid(spsc_stream).name(), 0, 0, 0);
+        if (demangled) {
+            name = demangled;
+            free(demangled);
+        } else {
+            name = "hls_stream";
+        }
+#else
+        name = typeid(spsc_stream).name();
+#endif
+        std::stringstream ss;
+        ss << counter++;
+        return name + "." + ss.str();
+    }
+
+    void create(size_t bound) {
+        mCreator = std::this_thread::get_id();
+        mBound = bound;
+        mDepth = 0;
+        mCap = INITIAL_CAPACITY;
+        while (mCap < atLeastMinDepth(mBound)) mCap <<= 1;
+        mMask = mCap - 1;
+        mBuf = new T[mCap];
+        mTail.store(0);
+        mHead.store(0);
+        mHeadCache = 0;
+        mTailCache = 0;
+        mLimit = 0;
+        mGrowing = true;
+    }
+
+    /* Bound of the stream as seen from the calling thread, 0 when it may grow */
+    size_t concurrentBound() const {
+        if (mBound != 0) return mBound;
+        const sim_dataflow_thread& self = sim_dataflow_thread::self();
+        if ((self.stage == NULL) || (std::this_thread::get_id() == mCreator)) return 0;
+        size_t depth = (mDepth != 0) ? mDepth : DEFAULT_DEPTH;
+        return atLeastMinDepth(depth);
+    }
+
+    /* Compared the way round that stays meaningful when XF_SIM_DATAFLOW_MIN_DEPTH is 0, for -Wtype-limits */
+    static size_t atLeastMinDepth(size_t depth) {
+        return (depth > (size_t)XF_SIM_DATAFLOW_MIN_DEPTH) ? depth : (size_t)XF_SIM_DATAFLOW_MIN_DEPTH;
+    }
+
+    void reserve(size_t n) {
+        while (mCap < n) grow();
+    }
+
+    /* Only ever called on a stream that is not shared between concurrent threads */
+    void grow() {
+        size_t h = mHead.load(std::memory_order_acquire), t = mTail.load(std::memory_order_acquire);
+        size_t cap = mCap << 1;
+        T* buf = new T[cap];
+        for (size_t i = h; i != t; i++) buf[i & (cap - 1)] = mBuf[i & mMask];
+        delete[] mBuf;
+        mBuf = buf;
+        mCap = cap;
+        mMask = cap - 1;
+    }
+
+    void waitForSpace(size_t t, size_t n) {
+        if (mLimit == 0) {
+            size_t b = concurrentBound();
+            mGrowing = (b == 0);
+            mLimit = mGrowing ? mCap : b;
+        }
+        mHeadCache = mHead.load(std::memory_order_acquire);
+        if (mLimit - (t - mHeadCache) >= n) return;
+        if (mGrowing) {
+            while (mCap - (t - mHeadCache) < n) grow();
+            mLimit = mCap;
+            return;
+        }
+        Waiter w(mName, true, mLimit);
+        while (mLimit - (t - mHeadCache) < n) {
+            w.pause();
+            mHeadCache = mHead.load(std::memory_order_acquire);
+        }
+    }
+
+    bool waitForData(size_t h) {
+        mTailCache = mTail.load(std::memory_order_acquire);
+        if (mTailCache != h) return true;
+        size_t b = concurrentBound();
+        if (b == 0) {
+            std::cout << "WARNING: Hls::stream '" << mName << "' is read while empty,"
+                      << " which may result in RTL simulation hanging." << std::endl;
+            return false;
+        }
+        Waiter w(mName, false, b);
+        while (mTailCache == h) {
+            w.pause();
+            mTailCache = mTail.load(std::memory_order_acquire);
+        }
+        return true;
+    }
+
+    /* Backoff of a blocked access, reports to the dataflow monitor of the calling thread */
+    class Waiter {
+       public:
+        Waiter(const std::string& stream, bool writing, size_t depth)
+            : mStream(stream), mWriting(writing), mDepth(depth), mSpins(0), mReported(false) {}
+        ~Waiter() {
+            const sim_dataflow_thread& self = sim_dataflow_thread::self();
+            if (mReported && self.monitor != NULL) self.monitor->unblocked(self.stage);
+        }
+
+        void pause() {
+            mSpins++;
+            if (mSpins < 64) return;
+            if (mSpins < 4096) {
+                std::this_thread::yield();
+                return;
+            }
+            const sim_dataflow_thread& self = sim_dataflow_thread::self();
+            if (self.monitor != NULL) {
+                if (!mReported) {
+                    self.monitor->blocked(self.stage, mStream, mWriting, mDepth);
+                    mReported = true;
+                }
+                if (!self.monitor->healthy()) abort();
+            }
+            std::this_thread::sleep_for(std::chrono::microseconds(20));
+        }
+
+       private:
+        const std::string& mStream;
+        bool mWriting;
+        size_t mDepth;
+        unsigned long long mSpins;
+        bool mReported;
+    };
+};
+
+} // namespace cv
+} // namespace xf
+
+namespace hls {
+
+template <typename __STREAM_T__, int DEPTH = 0>
+class stream;
+
+template <typename __STREAM_T__>
+class stream<__STREAM_T__, 0> : public xf::cv::spsc_stream<__STREAM_T__> {
+   public:
+    stream() {}
+    stream(const char* name) : xf::cv::spsc_stream<__STREAM_T__>(std::string(name)) {}
+    stream(const std::string& name) : xf::cv::spsc_stream<__STREAM_T__>(name) {}
+};
+
+template <typename __STREAM_T__, int DEPTH>
+class stream : public stream<__STREAM_T__, 0> {
+   public:
+    stream() { this->setDepth(DEPTH); }
+    stream(const char* name) : stream<__STREAM_T__, 0>(name) { this->setDepth(DEPTH); }
+    stream(const std::string& name) : stream<__STREAM_T__, 0>(name) { this->setDepth(DEPTH); }
+};
+
+} // namespace hls
+
+#endif //_XF_SIM_STREAM_H_
@@ -18,8 +18,21 @@
 #define _XF_SW_UTILS_H_
 
 #include "xf_common.hpp"
-#include <iostream>
+#include <algorithm>
+#include <atomic>
 #include <cmath>
+#include <functional>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <stdint.h>
+#include <string>
+#include <thread>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 namespace xf {
 namespace cv {
@@ -40,147 +53,359 @@ xf::cv::Mat<_PTYPE, _ROWS, _COLS, _NPC> imread(char* img, int type) {
     return input;
 }
 
+/* OpenCV type of an xf pixel type */
+inline int cvType(int ptype) {
+    static const int list_ptype[] = {CV_8UC1,  CV_16UC1, CV_16SC1, CV_32SC1, CV_32FC1, CV_32SC1,
+                                     CV_16UC1, CV_32SC1, CV_8UC1,  CV_8UC3,  CV_16UC3, CV_16SC3};
+    return list_ptype[ptype];
+}
+
 template <int _PTYPE, int _ROWS, int _COLS, int _NPC>
 void imwrite(const char* str, xf::cv::Mat<_PTYPE, _ROWS, _COLS, _NPC>& output) {
-    int list_ptype[] = {CV_8UC1,  CV_16UC1, CV_16SC1, CV_32SC1, CV_32FC1, CV_32SC1,
-                        CV_16UC1, CV_32SC1, CV_8UC1,  CV_8UC3,  CV_16UC3, CV_16SC3};
-    int _PTYPE_CV = list_ptype[_PTYPE];
+    int _PTYPE_CV = cvType(_PTYPE);
 
     ::cv::Mat input(output.rows, output.cols, _PTYPE_CV);
-    input.data = output.copyFrom();
+    output.copyFrom(input.data);
     ::cv::imwrite(str, input);
 }
 
+//----------------------------------------------------------------------------------------------------//
+// Decoding straight into xf::cv::Mat and device buffers
+//
+// imread() above decodes into a temporary cv::Mat and packs that into a freshly allocated xf::cv::Mat.
+// imreadInto() maps the file and lets OpenCV decode into a cv::Mat header over the destination buffer,
+// so the pixels are written once, where the kernel reads them. That works for buffers in the OpenCV
+// layout (Mat::isMemcpyCompatible(), e.g. XF_8UC1 at any NPC) whose size matches the image; otherwise
+// the image is decoded once and packed with copyTo(). imreadBatch() decodes many files on a pool of
+// threads, each allocating from the MatPool of the calling thread.
+//----------------------------------------------------------------------------------------------------//
+
+/* Read only mapping of an encoded image file */
+class EncodedImageFile {
+   public:
+    explicit EncodedImageFile(const char* path) : mData(NULL), mSize(0) {
+        int fd = open(path, O_RDONLY);
+        if (fd < 0) return;
+        struct stat st;
+        if (fstat(fd, &st) == 0 && st.st_size > 0) {
+            void* ptr = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (ptr != MAP_FAILED) {
+                mData = ptr;
+                mSize = (size_t)st.st_size;
+            }
+        }
+        close(fd);
+    }
+    ~EncodedImageFile() {
+        if (mData != NULL) munmap(mData, mSize);
+    }
+
+    bool valid() const { return mData != NULL; }
+    ::cv::Mat mat() const { return ::cv::Mat(1, (int)mSize, CV_8UC1, mData); }
+
+   private:
+    void* mData;
+    size_t mSize;
+
+    EncodedImageFile(const EncodedImageFile&);
+    EncodedImageFile& operator=(const EncodedImageFile&);
+};
+
+/* Decodes into a rows x cols cv_type buffer with the given row step. Returns the decoded image, which
+ * shares data with the buffer when the image matched it and lives elsewhere otherwise, or an empty Mat. */
+inline ::cv::Mat imdecodeInto(
+    const char* path, const EncodedImageFile& file, int type, void* data, int rows, int cols, int cv_type, size_t step) {
+#if defined(CV_VERSION_MAJOR) && (CV_VERSION_MAJOR > 4 || (CV_VERSION_MAJOR == 4 && CV_VERSION_MINOR >= 3))
+    // imdecode leaves dst untouched when no decoder recognizes the data, which would pass for success
+    if (!::cv::haveImageReader(path)) return ::cv::Mat();
+#else
+    (void)path;
+#endif
+    ::cv::Mat decoded(rows, cols, cv_type, data, step);
+    ::cv::imdecode(file.mat(), type, &decoded);
+    return decoded;
+}
+
+/* Decodes into a caller supplied, e.g. device mapped, buffer. Fails unless the image is rows x cols cv_type. */
+inline bool imreadInto(const char* path, int type, void* data, int rows, int cols, int cv_type, size_t step = 0) {
+    EncodedImageFile file(path);
+    if (!file.valid()) {
+        fprintf(stderr, "\nError : Couldn't open the image at %s\n ", path);
+        return false;
+    }
+    ::cv::Mat decoded = imdecodeInto(path, file, type, data, rows, cols, cv_type, step);
+    if (decoded.data == NULL) {
+        fprintf(stderr, "\nError : Couldn't decode the image at %s\n ", path);
+        return false;
+    }
+    if (decoded.data != (unsigned char*)data) {
+        fprintf(stderr, "\nError : Image at %s does not match the %dx%d buffer of type %d\n ", path, cols, rows,
+                cv_type);
+        return false;
+    }
+    return true;
+}
+
+/* Decodes into dst. An owning dst of another size is reallocated, a non-owning one has to match. */
+template <int _PTYPE, int _ROWS, int _COLS, int _NPC>
+bool imreadInto(const char* path, xf::cv::Mat<_PTYPE, _ROWS, _COLS, _NPC>& dst, int type) {
+    typedef xf::cv::Mat<_PTYPE, _ROWS, _COLS, _NPC> XfMat;
+    const int cv_type = cvType(_PTYPE);
+
+    EncodedImageFile file(path);
+    if (!file.valid()) {
+        fprintf(stderr, "\nError : Couldn't open the image at %s\n ", path);
+        return false;
+    }
+
+    ::cv::Mat decoded;
+    if (XfMat::isMemcpyCompatible() && dst.data != NULL) {
+        size_t step = (size_t)((dst.cols + _NPC - 1) >> XF_BITSHIFT(_NPC)) * sizeof(typename XfMat::DATATYPE);
+        decoded = imdecodeInto(path, file, type, (void*)dst.data, dst.rows, dst.cols, cv_type, step);
+        if (decoded.data == (unsigned char*)dst.data) return true;
+    } else {
+        decoded = ::cv::imdecode(file.mat(), type);
+    }
+
+    if (decoded.data == NULL) {
+        fprintf(stderr, "\nError : Couldn't decode the image at %s\n ", path);
+        return false;
+    }
+    if (decoded.type() != cv_type || decoded.rows > _ROWS || decoded.cols > _COLS) {
+        fprintf(stderr, "\nError : Image at %s does not fit the xf::cv::Mat\n ", path);
+        return false;
+    }
+    if (decoded.rows != dst.rows || decoded.cols != dst.cols) {
+        if (dst.allocatedFlag != 1) {
+            fprintf(stderr, "\nError : Image at %s does not match the %dx%d buffer\n ", path, dst.cols, dst.rows);
+            return false;
+        }
+        dst = XfMat(decoded.rows, decoded.cols);
+    }
+    dst.copyTo(decoded.data);
+    return true;
+}
+
+/* Decodes paths[i] into dsts[i] on nthreads threads (0: one per core). Returns the number of images
+ * decoded, ok[i] tells which ones when given. */
+template <int _PTYPE, int _ROWS, int _COLS, int _NPC>
+int imreadBatch(const std::vector<std::string>& paths,
+                xf::cv::Mat<_PTYPE, _ROWS, _COLS, _NPC>* dsts,
+                int type,
+                int nthreads = 0,
+                std::vector<bool>* ok = NULL) {
+    const int n = (int)paths.size();
+    if (nthreads <= 0) nthreads = (int)std::thread::hardware_concurrency();
+    nthreads = std::max(1, std::min(nthreads, n));
+    if (ok != NULL) ok->assign(n, false);
+
+    std::vector<char> done(n, 0);
+    std::atomic<int> next(0), decoded(0);
+    MatPool* pool = MatPool::current();
+    auto worker = [&]() {
+        std::unique_ptr<MatPoolScope> scope(pool != NULL ? new MatPoolScope(*pool) : NULL);
+        for (int i = next++; i < n; i = next++) {
+            if (imreadInto(paths[i].c_str(), dsts[i], type)) {
+                done[i] = 1;
+                decoded++;
+            }
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (int t = 1; t < nthreads; t++) threads.push_back(std::thread(worker));
+    worker();
+    for (size_t t = 0; t < threads.size(); t++) threads[t].join();
+
+    if (ok != NULL) {
+        for (int i = 0; i < n; i++) (*ok)[i] = (done[i] != 0);
+    }
+    return decoded;
+}
+
 template <int _PTYPE, int _ROWS, int _COLS, int _NPC>
 void absDiff(::cv::Mat& cv_img, xf::cv::Mat<_PTYPE, _ROWS, _COLS, _NPC>& xf_img, ::cv::Mat& diff_img) {
+    typedef xf::cv::Mat<_PTYPE, _ROWS, _COLS, _NPC> XfMat;
+
     assert((cv_img.rows == xf_img.rows) && (cv_img.cols == xf_img.cols) && "Sizes of cv and xf images should be same");
     assert((xf_img.rows == diff_img.rows) && (xf_img.cols == diff_img.cols) &&
            "Sizes of xf and diff images should be same");
     assert(((_NPC == XF_NPPC8) || (_NPC == XF_NPPC4) || (_NPC == XF_NPPC2) || (_NPC == XF_NPPC1)) &&
            "Only XF_NPPC1, XF_NPPC2, XF_NPPC4, XF_NPPC8 are supported");
     assert((cv_img.channels() == XF_CHANNELS(_PTYPE, _NPC)) && "Number of channels of cv and xf images does not match");
+    assert(((size_t)(XF_PIXELWIDTH(_PTYPE, _NPC) / 8) == cv_img.elemSize()) &&
+           "Pixel sizes of cv and xf images should be same");
 
-    int cv_bitdepth = 8;
-    int num_chnls = cv_img.channels();
-    int cv_nbytes = 1;
-
-    if (cv_img.depth() == CV_8U) {
-        cv_bitdepth = 8;
-    } else if (cv_img.depth() == CV_16S || cv_img.depth() == CV_16U) {
-        cv_bitdepth = 16;
-    } else if (cv_img.depth() == CV_32S || cv_img.depth() == CV_32F) {
-        cv_bitdepth = 32;
-    } else {
+    int depth = cv_img.depth();
+    if (depth != CV_8U && depth != CV_16U && depth != CV_16S && depth != CV_32S && depth != CV_32F) {
         fprintf(stderr, "OpenCV image's depth not supported\n ");
         return;
     }
 
-    int cv_pixdepth = cv_bitdepth * num_chnls;
-    cv_nbytes = cv_bitdepth / 8;
-
-    int ch = 0;
-    int xf_npc_idx = 0;
-    int diff_ptr = 0;
-    int xf_ptr = 0;
-    int cv_ptr = 0;
-    XF_CTUNAME(_PTYPE, _NPC) cv_val = 0, xf_val = 0, diff_val = 0;
-    XF_TNAME(_PTYPE, _NPC) xf_val_total = 0;
-
-    for (int r = 0, xf_ptr = 0; r < cv_img.rows; ++r) {
-        for (int c = 0; c<cv_img.cols>> XF_BITSHIFT(_NPC); ++c) {
-#ifdef __SDSVHLS__
-            xf_val_total = xf_img.data[xf_ptr++];
-
-            for (int b = 0; b < _NPC; ++b) {
-                for (int c = 0; c < num_chnls; ++c) {
-                    for (int l = 0; l < cv_nbytes; ++l, ++xf_npc_idx) {
-                        cv_val.range(((l + 1) * 8) - 1, l * 8) = cv_img.data[cv_ptr++];
-                        xf_val.range(((l + 1) * 8) - 1, l * 8) =
-                            xf_val_total.range(((xf_npc_idx + 1) * 8) - 1, xf_npc_idx * 8);
-                    }
-                    diff_val = __ABS((int)cv_val - (int)xf_val);
-                    for (int l = 0; l < cv_nbytes; ++l) {
-                        diff_img.data[diff_ptr++] = diff_val.range(((l + 1) * 8) - 1, l * 8);
-                    }
-                }
-            }
-            xf_npc_idx = 0;
+    // Compare against the xf buffer in place when its layout is the OpenCV one (rows padded to whole
+    // words), otherwise unpack it once. cv::absdiff is vectorized and parallel either way.
+    if (XfMat::isMemcpyCompatible()) {
+        size_t step = (size_t)((xf_img.cols + _NPC - 1) >> XF_BITSHIFT(_NPC)) * sizeof(typename XfMat::DATATYPE);
+        ::cv::Mat xf_view(xf_img.rows, xf_img.cols, cv_img.type(), (void*)xf_img.data, step);
+        ::cv::absdiff(cv_img, xf_view, diff_img);
+    } else {
+        ::cv::Mat xf_copy(xf_img.rows, xf_img.cols, cv_img.type());
+        xf_img.copyFrom(xf_copy.data);
+        ::cv::absdiff(cv_img, xf_copy, diff_img);
+    }
+}
 
-#else
-            for (int xf_npc_idx = 0; xf_npc_idx < _NPC; ++xf_npc_idx) {
-                for (int ch = 0; ch < num_chnls; ++ch) {
-                    xf_val = xf_img.data[xf_ptr].chnl[xf_npc_idx][ch];
-
-                    for (int b = 0; b < cv_nbytes; ++b) {
-                        cv_val.range(((b + 1) * 8) - 1, b * 8) = cv_img.data[cv_ptr++];
-                    }
-                    diff_val = __ABS((int)cv_val - (int)xf_val);
-                    for (int b = 0; b < cv_nbytes; ++b) {
-                        diff_img.data[diff_ptr++] = diff_val.range(((b + 1) * 8) - 1, b * 8);
-                    }
-                }
-            }
-            ++xf_ptr;
-#endif
+//----------------------------------------------------------------------------------------------------//
+// Difference image statistics
+//
+// computeDiffStats() reduces a difference image (as produced by absDiff) on several threads without
+// printing or modifying it. The error of a pixel is its largest channel error.
+//----------------------------------------------------------------------------------------------------//
+struct DiffStats {
+    double minError;                 // smallest pixel error
+    double maxError;                 // largest pixel error
+    uint64_t pixels;                 // pixels compared
+    uint64_t aboveThreshold;         // pixels with an error above err_thresh
+    float errorPercent;              // aboveThreshold in percent of pixels
+    int firstMismatchRow;            // raster order first pixel above err_thresh, -1 if there is none
+    int firstMismatchCol;
+    std::vector<uint64_t> histogram; // pixels per integer error, the last bin also counts all larger errors
+};
+
+template <typename T, int CN>
+void diffStatsRows(const ::cv::Mat& diff_img, int r0, int r1, int err_thresh, DiffStats& st) {
+    typedef typename std::conditional<std::is_floating_point<T>::value, float, int>::type AccT;
+    const AccT thresh = (AccT)err_thresh;
+    const int cols = diff_img.cols;
+    const int last_bin = (int)st.histogram.size() - 1;
+    std::vector<AccT> err(cols);
+
+    for (int r = r0; r < r1; r++) {
+        const T* row = diff_img.ptr<T>(r);
+
+        // Branch free passes the compiler vectorizes
+        AccT row_min = std::numeric_limits<AccT>::max(), row_max = std::numeric_limits<AccT>::lowest();
+        for (int c = 0; c < cols; c++) {
+            AccT v = (AccT)row[c * CN];
+            for (int k = 1; k < CN; k++) v = std::max(v, (AccT)row[c * CN + k]);
+            err[c] = v;
+        }
+        int above = 0;
+        for (int c = 0; c < cols; c++) {
+            row_min = std::min(row_min, err[c]);
+            row_max = std::max(row_max, err[c]);
+            above += (err[c] > thresh);
+        }
+
+        st.minError = std::min(st.minError, (double)row_min);
+        st.maxError = std::max(st.maxError, (double)row_max);
+        st.aboveThreshold += above;
+        if (above != 0 && st.firstMismatchRow < 0) {
+            int c = 0;
+            while (!(err[c] > thresh)) c++;
+            st.firstMismatchRow = r;
+            st.firstMismatchCol = c;
+        }
+        for (int c = 0; c < cols; c++) {
+            int bin = (err[c] <= (AccT)0) ? 0 : ((err[c] >= (AccT)last_bin) ? last_bin : (int)err[c]);
+            st.histogram[bin]++;
         }
     }
 }
 
-void analyzeDiff(::cv::Mat& diff_img, int err_thresh, float& err_per) {
-    int cv_bitdepth;
-    if (diff_img.depth() == CV_8U) {
-        cv_bitdepth = 8;
-    } else if (diff_img.depth() == CV_16U || diff_img.depth() == CV_16S) {
-        cv_bitdepth = 16;
-    } else if (diff_img.depth() == CV_32S || diff_img.depth() == CV_32F) {
-        cv_bitdepth = 32;
-    } else {
+inline DiffStats computeDiffStats(const ::cv::Mat& diff_img, int err_thresh, int hist_bins = 256, int nthreads = 0) {
+    DiffStats st;
+    st.minError = std::numeric_limits<double>::max();
+    st.maxError = 0;
+    st.pixels = (uint64_t)diff_img.rows * diff_img.cols;
+    st.aboveThreshold = 0;
+    st.errorPercent = 0;
+    st.firstMismatchRow = -1;
+    st.firstMismatchCol = -1;
+    st.histogram.assign((hist_bins > 0) ? hist_bins : 1, 0);
+    if (st.pixels == 0) {
+        st.minError = 0;
+        return st;
+    }
+
+    void (*rows_fn)(const ::cv::Mat&, int, int, int, DiffStats&) = NULL;
+    int type = diff_img.type();
+    if (type == CV_8UC1) rows_fn = diffStatsRows<unsigned char, 1>;
+    else if (type == CV_8UC3) rows_fn = diffStatsRows<unsigned char, 3>;
+    else if (type == CV_8UC4) rows_fn = diffStatsRows<unsigned char, 4>;
+    else if (type == CV_16UC1) rows_fn = diffStatsRows<unsigned short, 1>;
+    else if (type == CV_16UC3) rows_fn = diffStatsRows<unsigned short, 3>;
+    else if (type == CV_16SC1) rows_fn = diffStatsRows<short, 1>;
+    else if (type == CV_16SC3) rows_fn = diffStatsRows<short, 3>;
+    else if (type == CV_32SC1) rows_fn = diffStatsRows<int, 1>;
+    else if (type == CV_32FC1) rows_fn = diffStatsRows<float, 1>;
+    else {
+        fprintf(stderr, "OpenCV image's type not supported for this function\n ");
+        return st;
+    }
+
+    // Bands of at least 64 rows, one per thread; partial results are merged in band order so the
+    // first mismatch is the raster order first one
+    if (nthreads <= 0) nthreads = (int)std::thread::hardware_concurrency();
+    nthreads = std::max(1, std::min(nthreads, (diff_img.rows + 63) / 64));
+
+    std::vector<DiffStats> parts(nthreads, st);
+    std::vector<std::thread> workers;
+    int band = (diff_img.rows + nthreads - 1) / nthreads;
+    for (int t = 0; t < nthreads; t++) {
+        int r0 = t * band, r1 = std::min(diff_img.rows, r0 + band);
+        if (t == nthreads - 1) {
+            rows_fn(diff_img, r0, r1, err_thresh, parts[t]);
+        } else {
+            workers.push_back(std::thread(rows_fn, std::cref(diff_img), r0, r1, err_thresh, std::ref(parts[t])));
+        }
+    }
+    for (size_t t = 0; t < workers.size(); t++) workers[t].join();
+
+    for (int t = 0; t < nthreads; t++) {
+        const DiffStats& p = parts[t];
+        st.minError = std::min(st.minError, p.minError);
+        st.maxError = std::max(st.maxError, p.maxError);
+        st.aboveThreshold += p.aboveThreshold;
+        if (st.firstMismatchRow < 0) {
+            st.firstMismatchRow = p.firstMismatchRow;
+            st.firstMismatchCol = p.firstMismatchCol;
+        }
+        for (size_t b = 0; b < st.histogram.size(); b++) st.histogram[b] += p.histogram[b];
+    }
+    st.errorPercent = 100.0f * (float)st.aboveThreshold / (float)st.pixels;
+    return st;
+}
+
+/* Prints the statistics and marks every pixel above err_thresh with the largest value of the image depth */
+inline void analyzeDiff(::cv::Mat& diff_img, int err_thresh, float& err_per) {
+    int depth = diff_img.depth();
+    if (depth != CV_8U && depth != CV_16U && depth != CV_16S && depth != CV_32S && depth != CV_32F) {
         fprintf(stderr, "OpenCV image's depth not supported for this function\n ");
         return;
     }
 
-    int cnt = 0;
-    double minval = std::pow(2.0, cv_bitdepth), maxval = 0;
-    int max_fix = (int)(std::pow(2.0, cv_bitdepth) - 1.0);
-    for (int i = 0; i < diff_img.rows; i++) {
-        for (int j = 0; j < diff_img.cols; j++) {
-            int v = 0;
-            for (int k = 0; k < diff_img.channels(); k++) {
-                int v_tmp = 0;
-                if (diff_img.channels() == 1) {
-                    if (cv_bitdepth == 8)
-                        v_tmp = (int)diff_img.at<unsigned char>(i, j);
-                    else if (cv_bitdepth == 16 && diff_img.depth() == CV_16U) // 16 bitdepth
-                        v_tmp = (int)diff_img.at<unsigned short>(i, j);
-                    else if (cv_bitdepth == 16 && diff_img.depth() == CV_16S) // 16 bitdepth
-                        v_tmp = (int)diff_img.at<short>(i, j);
-                    else if (cv_bitdepth == 32 && diff_img.depth() == CV_32S)
-                        v_tmp = (int)diff_img.at<int>(i, j);
-                } else // 3 channels
-                    v_tmp = (int)diff_img.at< ::cv::Vec3b>(i, j)[k];
-
-                if (v_tmp > v) v = v_tmp;
-            }
-            if (v > err_thresh) {
-                cnt++;
-                if (diff_img.depth() == CV_8U)
-                    diff_img.at<unsigned char>(i, j) = max_fix;
-                else if (diff_img.depth() == CV_16U)
-                    diff_img.at<unsigned short>(i, j) = max_fix;
-                else if (diff_img.depth() == CV_16S)
-                    diff_img.at<short>(i, j) = max_fix;
-                else if (diff_img.depth() == CV_32S)
-                    diff_img.at<int>(i, j) = max_fix;
-                else
-                    diff_img.at<float>(i, j) = (float)max_fix;
-            }
-            if (minval > v) minval = v;
-            if (maxval < v) maxval = v;
+    DiffStats st = computeDiffStats(diff_img, err_thresh);
+    err_per = st.errorPercent;
+
+    if (st.aboveThreshold != 0) {
+        int cv_bitdepth = (depth == CV_8U) ? 8 : ((depth == CV_16U || depth == CV_16S) ? 16 : 32);
+        double max_fix = std::pow(2.0, cv_bitdepth) - 1.0;
+        ::cv::Mat pixel_err;
+        if (diff_img.channels() == 1) {
+            pixel_err = diff_img;
+        } else {
+            // reshape() needs one continuous buffer, a ROI of a larger image is copied first
+            ::cv::Mat diff = diff_img.isContinuous() ? diff_img : diff_img.clone();
+            ::cv::reduce(diff.reshape(1, diff.rows * diff.cols), pixel_err, 1, ::cv::REDUCE_MAX);
+            pixel_err = pixel_err.reshape(1, diff_img.rows);
         }
+        ::cv::Mat mask = pixel_err > err_thresh;
+        diff_img.setTo(::cv::Scalar::all(max_fix), mask);
     }
-    err_per = 100.0 * (float)cnt / (diff_img.rows * diff_img.cols);
-    std::cout << "\tMinimum error in intensity = " << minval << std::endl;
-    std::cout << "\tMaximum error in intensity = " << maxval << std::endl;
+
+    std::cout << "\tMinimum error in intensity = " << st.minError << std::endl;
+    std::cout << "\tMaximum error in intensity = " << st.maxError << std::endl;
     std::cout << "\tPercentage of pixels above error threshold = " << err_per << std::endl;
 }
 } // namespace cv
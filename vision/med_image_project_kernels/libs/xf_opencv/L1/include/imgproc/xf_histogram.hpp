@@ -23,6 +23,9 @@
 
 #include "common/xf_common.hpp"
 #include "hls_stream.h"
+#ifndef __SYNTHESIS__
+#include <memory>
+#endif
 namespace xf {
 namespace cv {
 
@@ -154,6 +157,131 @@ void calcHist(xf::cv::Mat<SRC_T, ROWS, COLS, NPC>& _src, uint32_t* histogram) {
     }
 }
 
+/*
+ * Histogram of a single channel image with BINS bins (a power of two) over the IN_BITS significant
+ * bits of each pixel, for 12 and 16-bit data at up to XF_NPPC16. Every pixel lane counts into BANKS
+ * replicated bin banks in turn, so a bank is read and written back at most every BANKS clocks and the
+ * column loop runs at II=1; the banks are summed at the end of the frame. Counters are only as wide
+ * as the share of a frame one bank can see.
+ */
+template <int SRC_T, int ROWS, int COLS, int NPC, int BINS, int IN_BITS, int BANKS>
+void xFHistogramBinnedKernel(xf::cv::Mat<SRC_T, ROWS, COLS, NPC>& _src_mat,
+                             uint32_t* histogram,
+                             uint16_t imgheight,
+                             uint16_t imgwidth) {
+    constexpr int PIXEL_BITS = XF_DTPIXELDEPTH(SRC_T, NPC);
+    constexpr int LANES = XF_NPIXPERCYCLE(NPC);
+    constexpr int BIN_SHIFT = IN_BITS - xf::cv::log2<BINS>::fvalue;
+    constexpr int IN_MAX = (1 << IN_BITS) - 1;
+    constexpr int CNT_BITS = xf::cv::log2<(ROWS * (COLS / LANES)) / BANKS + 1>::cvalue + 1;
+    typedef ap_uint<CNT_BITS> count_t;
+
+#ifndef __SYNTHESIS__
+    // Up to BANKS x LANES x 65536 counters, too many for the stack of a C-simulation
+    std::unique_ptr<count_t[][LANES][BINS]> bank_hist(new count_t[BANKS][LANES][BINS]);
+#else
+    count_t bank_hist[BANKS][LANES][BINS];
+#endif
+// clang-format off
+#pragma HLS ARRAY_PARTITION variable=bank_hist complete dim=1
+#pragma HLS ARRAY_PARTITION variable=bank_hist complete dim=2
+#pragma HLS DEPENDENCE variable=bank_hist inter RAW distance=BANKS true
+    // clang-format on
+
+HIST_BINNED_INIT_LOOP:
+    for (int i = 0; i < BINS; i++) {
+// clang-format off
+#pragma HLS PIPELINE II=1
+        // clang-format on
+        for (int b = 0; b < BANKS; b++) {
+// clang-format off
+#pragma HLS UNROLL
+            // clang-format on
+            for (int p = 0; p < LANES; p++) {
+// clang-format off
+#pragma HLS UNROLL
+                // clang-format on
+                bank_hist[b][p][i] = 0;
+            }
+        }
+    }
+
+    int idx = 0;
+    int b = 0;
+HIST_BINNED_ROW_LOOP:
+    for (int row = 0; row < imgheight; row++) {
+// clang-format off
+#pragma HLS LOOP_TRIPCOUNT min=1 max=ROWS
+    // clang-format on
+    HIST_BINNED_COL_LOOP:
+        for (int col = 0; col < imgwidth; col++) {
+// clang-format off
+#pragma HLS LOOP_TRIPCOUNT min=1 max=COLS/LANES
+#pragma HLS PIPELINE II=1
+            // clang-format on
+            XF_TNAME(SRC_T, NPC) in_buf = _src_mat.read(idx++);
+
+        HIST_BINNED_LANE_LOOP:
+            for (int p = 0; p < LANES; p++) {
+// clang-format off
+#pragma HLS UNROLL
+                // clang-format on
+                ap_uint<PIXEL_BITS> val = in_buf.range(p * PIXEL_BITS + PIXEL_BITS - 1, p * PIXEL_BITS);
+                ap_uint<PIXEL_BITS> bin = ((val > IN_MAX) ? ap_uint<PIXEL_BITS>(IN_MAX) : val) >> BIN_SHIFT;
+                bank_hist[b][p][bin] = bank_hist[b][p][bin] + 1;
+            }
+            b = (b == BANKS - 1) ? 0 : (b + 1);
+        }
+    }
+
+HIST_BINNED_MERGE_LOOP:
+    for (int i = 0; i < BINS; i++) {
+// clang-format off
+#pragma HLS PIPELINE II=1
+        // clang-format on
+        uint32_t value = 0;
+        for (int bk = 0; bk < BANKS; bk++) {
+// clang-format off
+#pragma HLS UNROLL
+            // clang-format on
+            for (int p = 0; p < LANES; p++) {
+// clang-format off
+#pragma HLS UNROLL
+                // clang-format on
+                value += bank_hist[bk][p][i];
+            }
+        }
+        histogram[i] = value;
+    }
+}
+
+/*
+ * calcHist with a templated bin count: histogram[BINS] counts the pixels of _src by their top
+ * log2(BINS) of IN_BITS bits, values above (1 << IN_BITS) - 1 falling into the last bin. For 12-bit
+ * HU data in XF_16UC1, IN_BITS = 12 and BINS = 4096 gives one bin per value.
+ */
+template <int SRC_T, int ROWS, int COLS, int NPC, int BINS, int IN_BITS = XF_DTPIXELDEPTH(SRC_T, NPC), int BANKS = 2>
+void calcHistBinned(xf::cv::Mat<SRC_T, ROWS, COLS, NPC>& _src, uint32_t* histogram) {
+#ifndef __SYNTHESIS__
+    assert((XF_CHANNELS(SRC_T, NPC) == 1) && "Only single channel images are supported");
+    assert(((NPC == XF_NPPC1) || (NPC == XF_NPPC2) || (NPC == XF_NPPC4) || (NPC == XF_NPPC8) ||
+            (NPC == XF_NPPC16)) &&
+           "NPC must be XF_NPPC1, XF_NPPC2, XF_NPPC4, XF_NPPC8 or XF_NPPC16");
+    assert(((BINS & (BINS - 1)) == 0) && (BINS <= (1 << IN_BITS)) && "BINS must be a power of two up to 2^IN_BITS");
+    assert((IN_BITS <= XF_DTPIXELDEPTH(SRC_T, NPC)) && "IN_BITS must not exceed the pixel depth");
+    assert((BANKS >= 1) && "At least one bank is needed");
+    assert(((_src.rows <= ROWS) && (_src.cols <= COLS)) && "ROWS and COLS should be greater than input image");
+#endif
+// clang-format off
+#pragma HLS INLINE OFF
+    // clang-format on
+
+    uint16_t width = _src.cols >> (XF_BITSHIFT(NPC));
+    uint16_t height = _src.rows;
+
+    xFHistogramBinnedKernel<SRC_T, ROWS, COLS, NPC, BINS, IN_BITS, BANKS>(_src, histogram, height, width);
+}
+
 } // namespace cv
 } // namespace xf
 #endif // _XF_HISTOGRAM_HPP_
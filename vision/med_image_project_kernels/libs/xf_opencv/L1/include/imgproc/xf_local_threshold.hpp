@@ -0,0 +1,333 @@
+/*
+ * Copyright 2021 Xilinx, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __XF_LOCAL_THRESHOLD_HPP__
+#define __XF_LOCAL_THRESHOLD_HPP__
+
+#include "ap_int.h"
+#include "common/xf_common.hpp"
+#include "common/xf_structs.hpp"
+#include "common/xf_utility.hpp"
+
+#ifndef __SYNTHESIS__
+#include <memory>
+#endif
+
+//----------------------------------------------------------------------------------------------------//
+// Adaptive local threshold: every pixel p is compared against the mean m and standard deviation s of
+// the WIN x WIN window around it,
+//
+//   XF_LOCAL_THRESH_BRADLEY  p > m * (1 - k)
+//   XF_LOCAL_THRESH_NIBLACK  p > m + k * s
+//   XF_LOCAL_THRESH_SAUVOLA  p > m * (1 + k * (s / 128 - 1))
+//
+// with k in Q.8, and becomes maxval where it is above both its local threshold and the global thresh,
+// 0 elsewhere. Windows are clipped at the image borders.
+//
+// No integral image is built: every column keeps the sums of I and I^2 over the last WIN rows, updated
+// with the entering and the leaving row of a WIN + 1 row ring, and the window sums are running sums
+// along the row over those column sums. Output lags input by WIN / 2 rows and WIN / 2 columns. The
+// comparisons are made exactly in 64-bit integers, with n * s from an integer square root of
+// n * sum(I^2) - sum(I)^2, so that they match medimg::LocalThreshold bit for bit. XF_8UC1 at XF_NPPC1
+// and XF_NPPC8, one word per clock; WIN odd, 3 .. 63.
+//----------------------------------------------------------------------------------------------------//
+
+// Local threshold methods
+enum _local_thresh_method {
+    XF_LOCAL_THRESH_BRADLEY = 0,
+    XF_LOCAL_THRESH_NIBLACK = 1,
+    XF_LOCAL_THRESH_SAUVOLA = 2,
+};
+typedef _local_thresh_method XF_local_thresh_method_e;
+
+namespace xf {
+namespace cv {
+
+template <int METHOD, int SRC_T, int ROWS, int COLS, int NPC, int WIN>
+class LocalThreshold {
+   public:
+    static constexpr int H = WIN / 2;
+    static constexpr int L = XF_NPIXPERCYCLE(NPC);
+    static constexpr int WORDS = COLS / L;
+    static constexpr int LAG = (H + L - 1) / L; // output words behind the input
+    static constexpr int OFF = H + L - LAG * L; // lane 0 of the output in the last two words of sums
+    static constexpr int RING = WIN + 1;
+    static constexpr int RANGE = 128; // Sauvola's dynamic range of s
+    typedef XF_TNAME(SRC_T, NPC) word_t;
+    typedef ap_uint<8> pixel_t;
+    typedef ap_uint<14> col_s_t; // up to 63 * 255
+    typedef ap_uint<22> col_q_t; // up to 63 * 255^2
+    typedef ap_uint<20> win_s_t; // up to 63^2 * 255
+    typedef ap_uint<28> win_q_t; // up to 63^2 * 255^2
+    typedef ap_int<64> wide_t;
+
+    LocalThreshold() {
+// clang-format off
+#pragma HLS INLINE
+#pragma HLS ARRAY_PARTITION variable=_ring complete dim=1
+#pragma HLS ARRAY_PARTITION variable=_colS complete dim=1
+#pragma HLS ARRAY_PARTITION variable=_colQ complete dim=1
+        // clang-format on
+    }
+
+    template <int XFCVDEPTH_IN, int XFCVDEPTH_OUT>
+    void process(xf::cv::Mat<SRC_T, ROWS, COLS, NPC, XFCVDEPTH_IN>& _src,
+                 xf::cv::Mat<SRC_T, ROWS, COLS, NPC, XFCVDEPTH_OUT>& _dst,
+                 pixel_t thresh,
+                 pixel_t maxval,
+                 short k) {
+// clang-format off
+#pragma HLS INLINE OFF
+        // clang-format on
+        const int rows = _src.rows, cols = _src.cols;
+        const int words = cols >> XF_BITSHIFT(NPC);
+        int idx_in = 0, idx_out = 0;
+
+    COL_SUM_INIT_LOOP:
+        for (int w = 0; w < words; w++) {
+// clang-format off
+#pragma HLS LOOP_TRIPCOUNT min=1 max=WORDS
+#pragma HLS PIPELINE II=1
+            // clang-format on
+            for (int l = 0; l < L; l++) {
+// clang-format off
+#pragma HLS UNROLL
+                // clang-format on
+                _colS[l][w] = 0;
+                _colQ[l][w] = 0;
+            }
+        }
+
+    // Input row i completes the column sums of output row i - H
+    ROW_LOOP:
+        for (int i = 0; i < rows + H; i++) {
+// clang-format off
+#pragma HLS LOOP_TRIPCOUNT min=1 max=ROWS+WIN/2
+            // clang-format on
+            const int o = i - H;
+            const bool enter = (i < rows);
+            const bool leave = (i >= WIN) && (i - WIN < rows);
+            const int slot_in = i % RING, slot_out = (i + 1) % RING, slot_p = (o + RING) % RING;
+            const int top = (i - WIN + 1 > 0) ? (i - WIN + 1) : 0;
+            const int n_rows = ((i < rows - 1) ? i : (rows - 1)) - top + 1;
+
+            // Column sums of the last WIN words, trailing window sums of the last two words
+            col_s_t histS[WIN];
+            col_q_t histQ[WIN];
+            win_s_t sumS[2 * L];
+            win_q_t sumQ[2 * L];
+// clang-format off
+#pragma HLS ARRAY_PARTITION variable=histS complete dim=1
+#pragma HLS ARRAY_PARTITION variable=histQ complete dim=1
+#pragma HLS ARRAY_PARTITION variable=sumS complete dim=1
+#pragma HLS ARRAY_PARTITION variable=sumQ complete dim=1
+            // clang-format on
+            for (int j = 0; j < WIN; j++) {
+// clang-format off
+#pragma HLS UNROLL
+                // clang-format on
+                histS[j] = 0;
+                histQ[j] = 0;
+            }
+            for (int j = 0; j < 2 * L; j++) {
+// clang-format off
+#pragma HLS UNROLL
+                // clang-format on
+                sumS[j] = 0;
+                sumQ[j] = 0;
+            }
+
+        WORD_LOOP:
+            for (int w = 0; w < words + LAG; w++) {
+// clang-format off
+#pragma HLS LOOP_TRIPCOUNT min=1 max=WORDS+LAG
+#pragma HLS PIPELINE II=1
+#pragma HLS DEPENDENCE variable=_ring inter false
+#pragma HLS DEPENDENCE variable=_colS inter false
+#pragma HLS DEPENDENCE variable=_colQ inter false
+                // clang-format on
+                col_s_t cs[WIN + L];
+                col_q_t cq[WIN + L];
+// clang-format off
+#pragma HLS ARRAY_PARTITION variable=cs complete dim=1
+#pragma HLS ARRAY_PARTITION variable=cq complete dim=1
+                // clang-format on
+                for (int j = 0; j < WIN; j++) {
+// clang-format off
+#pragma HLS UNROLL
+                    // clang-format on
+                    cs[j] = histS[j];
+                    cq[j] = histQ[j];
+                }
+
+                // Column sums of this word, 0 beyond the last column
+                const bool in_row = (w < words);
+                word_t in_word = 0, out_word = 0;
+                if (in_row && enter) {
+                    in_word = _src.read(idx_in++);
+                    _ring[slot_in][w] = in_word;
+                }
+                if (in_row && leave) out_word = _ring[slot_out][w];
+                for (int l = 0; l < L; l++) {
+// clang-format off
+#pragma HLS UNROLL
+                    // clang-format on
+                    pixel_t a = in_word.range(l * 8 + 7, l * 8), b = out_word.range(l * 8 + 7, l * 8);
+                    col_s_t s = 0;
+                    col_q_t q = 0;
+                    if (in_row) {
+                        s = _colS[l][w] + a - b;
+                        q = _colQ[l][w] + a * a - b * b;
+                        _colS[l][w] = s;
+                        _colQ[l][w] = q;
+                    }
+                    cs[WIN + l] = s;
+                    cq[WIN + l] = q;
+                }
+
+                // T(x) = T(x - 1) + col(x) - col(x - WIN) over the lanes of this word
+                for (int l = 0; l < L; l++) {
+// clang-format off
+#pragma HLS UNROLL
+                    // clang-format on
+                    sumS[l] = sumS[L + l];
+                    sumQ[l] = sumQ[L + l];
+                }
+                win_s_t ts = sumS[L - 1];
+                win_q_t tq = sumQ[L - 1];
+                for (int l = 0; l < L; l++) {
+// clang-format off
+#pragma HLS UNROLL
+                    // clang-format on
+                    ts = ts + cs[WIN + l] - cs[l];
+                    tq = tq + cq[WIN + l] - cq[l];
+                    sumS[L + l] = ts;
+                    sumQ[L + l] = tq;
+                }
+                for (int j = 0; j < WIN; j++) {
+// clang-format off
+#pragma HLS UNROLL
+                    // clang-format on
+                    histS[j] = cs[L + j];
+                    histQ[j] = cq[L + j];
+                }
+
+                // Output word w - LAG of row o, centered LAG words back
+                const int ow = w - LAG;
+                if (o >= 0 && ow >= 0) {
+                    word_t p_word = _ring[slot_p][ow];
+                    word_t result = 0;
+                    for (int l = 0; l < L; l++) {
+// clang-format off
+#pragma HLS UNROLL
+                        // clang-format on
+                        const int c = ow * L + l;
+                        const int left = (c - H > 0) ? (c - H) : 0;
+                        const int right = (c + H < cols - 1) ? (c + H) : (cols - 1);
+                        const pixel_t p = p_word.range(l * 8 + 7, l * 8);
+                        const bool on = decide(p, n_rows * (right - left + 1), sumS[OFF + l], sumQ[OFF + l], k);
+                        result.range(l * 8 + 7, l * 8) = (on && p > thresh) ? maxval : pixel_t(0);
+                    }
+                    _dst.write(idx_out++, result);
+                }
+            }
+        }
+    }
+
+   private:
+    word_t _ring[RING][WORDS];
+    col_s_t _colS[L][WORDS];
+    col_q_t _colQ[L][WORDS];
+
+    bool decide(pixel_t p, int count, win_s_t win_s, win_q_t win_q, short k) {
+// clang-format off
+#pragma HLS INLINE
+        // clang-format on
+        const wide_t n = count, s = win_s, q = win_q, v = p, kk = k;
+        if (METHOD == XF_LOCAL_THRESH_BRADLEY) return 256 * n * v > (256 - kk) * s;
+        const wide_t sd = isqrt(n * q - s * s); // n times the standard deviation
+        if (METHOD == XF_LOCAL_THRESH_NIBLACK) return 256 * n * v > 256 * s + kk * sd;
+        return 256 * RANGE * n * n * v > 256 * RANGE * n * s + kk * s * (sd - RANGE * n);
+    }
+
+    /* floor(sqrt(v)) for v below 2^40, restoring, one result bit per unrolled step */
+    ap_uint<20> isqrt(ap_uint<40> v) {
+// clang-format off
+#pragma HLS INLINE
+        // clang-format on
+        ap_uint<20> root = 0;
+        ap_uint<42> rem = 0;
+        for (int b = 19; b >= 0; b--) {
+// clang-format off
+#pragma HLS UNROLL
+            // clang-format on
+            rem = (rem << 2) | v.range(2 * b + 1, 2 * b);
+            ap_uint<42> trial = (ap_uint<42>(root) << 2) | 1;
+            root = root << 1;
+            if (rem >= trial) {
+                rem -= trial;
+                root |= 1;
+            }
+        }
+        return root;
+    }
+};
+
+// ======================================================================================
+
+template <int METHOD,
+          int SRC_T,
+          int ROWS,
+          int COLS,
+          int NPC = 1,
+          int WIN = 31,
+          int XFCVDEPTH_IN = _XFCVDEPTH_DEFAULT,
+          int XFCVDEPTH_OUT = _XFCVDEPTH_DEFAULT>
+void localThreshold(xf::cv::Mat<SRC_T, ROWS, COLS, NPC, XFCVDEPTH_IN>& _src,
+                    xf::cv::Mat<SRC_T, ROWS, COLS, NPC, XFCVDEPTH_OUT>& _dst,
+                    unsigned char thresh,
+                    unsigned char maxval,
+                    short k) {
+// clang-format off
+#pragma HLS INLINE OFF
+    // clang-format on
+#ifndef __SYNTHESIS__
+    assert(((_src.rows <= ROWS) && (_src.cols <= COLS)) && "ROWS and COLS should be greater than input image");
+    assert(((_dst.rows == _src.rows) && (_dst.cols == _src.cols)) && "Input and output image sizes must match");
+    assert((SRC_T == XF_8UC1) && "SRC_T must be XF_8UC1");
+    assert(((NPC == XF_NPPC1) || (NPC == XF_NPPC8)) && "NPC must be XF_NPPC1 or XF_NPPC8");
+    assert(((WIN & 1) == 1) && (WIN >= 3) && (WIN <= 63) && "WIN must be odd, 3 .. 63");
+    assert(((METHOD == XF_LOCAL_THRESH_BRADLEY) || (METHOD == XF_LOCAL_THRESH_NIBLACK) ||
+            (METHOD == XF_LOCAL_THRESH_SAUVOLA)) &&
+           "METHOD must be XF_LOCAL_THRESH_BRADLEY, XF_LOCAL_THRESH_NIBLACK or XF_LOCAL_THRESH_SAUVOLA");
+    assert(((METHOD == XF_LOCAL_THRESH_NIBLACK) ? (k >= -255 && k <= 255) : (k >= 0 && k <= 255)) &&
+           "k out of range");
+#endif
+    typedef LocalThreshold<METHOD, SRC_T, ROWS, COLS, NPC, WIN> binarize_t;
+#ifndef __SYNTHESIS__
+    // WIN + 1 frame wide rows and the column sums, heap allocated per call in C-simulation
+    std::unique_ptr<binarize_t> binarize_mem(new binarize_t);
+    binarize_t& binarize = *binarize_mem;
+#else
+    binarize_t binarize;
+#endif
+    binarize.process(_src, _dst, thresh, maxval, k);
+}
+
+} // namespace cv
+} // namespace xf
+
+#endif //__XF_LOCAL_THRESHOLD_HPP__
@@ -0,0 +1,298 @@
+/*
+ * Copyright 2021 Xilinx, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __XF_MEDIAN_BLUR_HIST_HPP__
+#define __XF_MEDIAN_BLUR_HIST_HPP__
+
+#include "ap_int.h"
+#include "common/xf_common.hpp"
+#include "common/xf_structs.hpp"
+#include "common/xf_utility.hpp"
+#ifndef __SYNTHESIS__
+#include <memory>
+#endif
+
+//----------------------------------------------------------------------------------------------------//
+// Sliding histogram median filter (Perreault and Hebert, "Median Filtering in Constant Time").
+//
+// Every column keeps the histogram of its FILTER_SIZE pixels around the current row; moving down a row
+// adds the entering pixel and removes the leaving one, and moving right adds the histogram of the
+// entering column to the kernel histogram and subtracts the leaving one. The median is the first bin
+// whose cumulative count passes half the window. Per pixel that is two single bin updates and one
+// BINS wide vector add, whatever FILTER_SIZE is: resources grow with the number of bins, not with the
+// square of the window as in xFMedianNxN.
+//
+// The histograms count the top BIN_BITS of IN_BITS significant bits, values above (1 << IN_BITS) - 1
+// counting as the maximum. The median is exact when BIN_BITS == IN_BITS; otherwise the center of the
+// median bin is returned. BIN_BITS is at most 8, as every bin is a register of the kernel histogram
+// and a memory of each column histogram copy; it defaults to 8, or the pixel depth when that is less. XF_BORDER_REPLICATE and XF_BORDER_CONSTANT (border_value) are supported.
+// Column histograms are held twice in BRAM, FILTER_SIZE bits deep, so each copy sees one read and one
+// write per clock; input rows are kept in a FILTER_SIZE row ring to remove the leaving pixel.
+//----------------------------------------------------------------------------------------------------//
+
+namespace xf {
+namespace cv {
+
+template <int FILTER_SIZE, int BORDER_TYPE, int TYPE, int ROWS, int COLS, int BIN_BITS, int IN_BITS>
+class MedianBlurHist {
+   public:
+    static constexpr int K = FILTER_SIZE;
+    static constexpr int R = FILTER_SIZE / 2;
+    static constexpr int BINS = 1 << BIN_BITS;
+    static constexpr int PIXEL_BITS = XF_DTPIXELDEPTH(TYPE, XF_NPPC1);
+    static constexpr int SHIFT = IN_BITS - BIN_BITS;
+    static constexpr int IN_MAX = (1 << IN_BITS) - 1;
+    static constexpr int COL_BITS = xf::cv::log2<K>::fvalue + 1;
+    static constexpr int KER_BITS = xf::cv::log2<K * K>::fvalue + 1;
+    typedef ap_uint<PIXEL_BITS> pixel_t;
+    typedef ap_uint<BIN_BITS> bin_t;
+    typedef ap_uint<COL_BITS> col_count_t;
+    typedef ap_uint<KER_BITS> ker_count_t;
+
+    static_assert((BIN_BITS >= 1) && (BIN_BITS <= 8), "BIN_BITS must be in 1..8, 256 bins at most");
+
+    MedianBlurHist() {
+// clang-format off
+#pragma HLS INLINE
+#pragma HLS ARRAY_PARTITION variable=_col complete dim=1
+#pragma HLS ARRAY_PARTITION variable=_col complete dim=2
+#pragma HLS ARRAY_PARTITION variable=_ring complete dim=1
+        // clang-format on
+    }
+
+    void process(xf::cv::Mat<TYPE, ROWS, COLS, XF_NPPC1>& _src,
+                 xf::cv::Mat<TYPE, ROWS, COLS, XF_NPPC1>& _dst,
+                 unsigned short border_value) {
+// clang-format off
+#pragma HLS INLINE OFF
+        // clang-format on
+        int rows = _src.rows, cols = _src.cols;
+        int idx_in = 0, idx_out = 0;
+        const pixel_t border = border_value;
+        const bin_t border_bin = bin(border);
+
+        ker_count_t hist[BINS];
+// clang-format off
+#pragma HLS ARRAY_PARTITION variable=hist complete dim=1
+        // clang-format on
+
+    COL_HIST_INIT_LOOP:
+        for (int c = 0; c < cols; c++) {
+// clang-format off
+#pragma HLS LOOP_TRIPCOUNT min=1 max=COLS
+#pragma HLS PIPELINE II=1
+            // clang-format on
+            for (int b = 0; b < BINS; b++) {
+// clang-format off
+#pragma HLS UNROLL
+                // clang-format on
+                _col[0][b][c] = 0;
+                _col[1][b][c] = 0;
+            }
+        }
+
+        // Virtual rows -R .. rows - 1 + R; the window of output row v - R is complete from v = R on
+        int slot = 0;
+    ROW_LOOP:
+        for (int v = -R; v < rows + R; v++) {
+// clang-format off
+#pragma HLS LOOP_TRIPCOUNT min=1 max=ROWS+2*R
+            // clang-format on
+            bool remove = (v - K >= -R);
+            bool emit = (v >= R);
+
+        HIST_CLEAR_LOOP:
+            for (int b = 0; b < BINS; b++) {
+// clang-format off
+#pragma HLS UNROLL
+                // clang-format on
+                hist[b] = 0;
+            }
+
+        // Step s brings virtual column w = s - R into the kernel histogram. Physical column c is
+        // updated to row v at w = c, column 0 already at w = -R for the replicated left border.
+        COL_LOOP:
+            for (int s = 0; s < cols + 2 * R; s++) {
+// clang-format off
+#pragma HLS LOOP_TRIPCOUNT min=1 max=COLS+2*R
+#pragma HLS PIPELINE II=1
+#pragma HLS DEPENDENCE variable=_col inter false
+#pragma HLS DEPENDENCE variable=_ring inter false
+                // clang-format on
+                int w = s - R;
+                int c = (w < 0) ? 0 : w;
+                bool update = (w == -R) || (w >= 1 && w < cols);
+                col_count_t in_vec[BINS], out_vec[BINS];
+// clang-format off
+#pragma HLS ARRAY_PARTITION variable=in_vec complete dim=1
+#pragma HLS ARRAY_PARTITION variable=out_vec complete dim=1
+                // clang-format on
+
+                // Column histogram entering the window, updated first when this step owns it
+                int c_in = (w >= cols) ? (cols - 1) : c;
+                for (int b = 0; b < BINS; b++) {
+// clang-format off
+#pragma HLS UNROLL
+                    // clang-format on
+                    in_vec[b] = _col[0][b][c_in];
+                }
+                if (update) {
+                    pixel_t p = nextPixel(_src, idx_in, v, c, rows, border);
+                    pixel_t old = _ring[slot][c];
+                    _ring[slot][c] = p;
+                    bin_t bp = bin(p), bo = bin(old);
+                    in_vec[bp] = in_vec[bp] + 1;
+                    if (remove) in_vec[bo] = in_vec[bo] - 1;
+                    for (int b = 0; b < BINS; b++) {
+// clang-format off
+#pragma HLS UNROLL
+                        // clang-format on
+                        _col[0][b][c] = in_vec[b];
+                        _col[1][b][c] = in_vec[b];
+                    }
+                }
+                bool in_border = (BORDER_TYPE == XF_BORDER_CONSTANT) && (w < 0 || w >= cols);
+
+                // Column histogram leaving the window
+                int w_out = w - K;
+                bool leave = (w_out >= -R);
+                bool out_border = (BORDER_TYPE == XF_BORDER_CONSTANT) && (w_out < 0);
+                int c_out = (w_out < 0) ? 0 : w_out;
+                for (int b = 0; b < BINS; b++) {
+// clang-format off
+#pragma HLS UNROLL
+                    // clang-format on
+                    out_vec[b] = _col[1][b][c_out];
+                }
+
+                for (int b = 0; b < BINS; b++) {
+// clang-format off
+#pragma HLS UNROLL
+                    // clang-format on
+                    ker_count_t add = in_border ? ker_count_t((b == border_bin) ? K : 0) : ker_count_t(in_vec[b]);
+                    ker_count_t sub = !leave ? ker_count_t(0)
+                                             : out_border ? ker_count_t((b == border_bin) ? K : 0)
+                                                          : ker_count_t(out_vec[b]);
+                    hist[b] = hist[b] + add - sub;
+                }
+
+                if (emit && s >= K - 1) _dst.write(idx_out++, median(hist));
+            }
+            slot = (slot == K - 1) ? 0 : (slot + 1);
+        }
+    }
+
+   private:
+    col_count_t _col[2][BINS][COLS];
+    pixel_t _ring[K][COLS];
+    pixel_t _first[COLS], _last[COLS];
+
+    bin_t bin(pixel_t p) {
+// clang-format off
+#pragma HLS INLINE
+        // clang-format on
+        return ((p > IN_MAX) ? pixel_t(IN_MAX) : p) >> SHIFT;
+    }
+
+    /* Pixel of virtual row v in column c, reading the source once per real pixel */
+    pixel_t nextPixel(
+        xf::cv::Mat<TYPE, ROWS, COLS, XF_NPPC1>& _src, int& idx_in, int v, int c, int rows, pixel_t border) {
+// clang-format off
+#pragma HLS INLINE
+        // clang-format on
+        pixel_t p;
+        if (BORDER_TYPE == XF_BORDER_CONSTANT) {
+            p = (v < 0 || v >= rows) ? border : pixel_t(_src.read(idx_in++));
+        } else if (v == -R) {
+            p = _src.read(idx_in++); // row 0, replicated up to row -R
+            _first[c] = p;
+        } else if (v <= 0) {
+            p = _first[c];
+        } else if (v < rows) {
+            p = _src.read(idx_in++);
+        } else {
+            p = _last[c];
+        }
+        _last[c] = p;
+        return p;
+    }
+
+    pixel_t median(ker_count_t hist[BINS]) {
+// clang-format off
+#pragma HLS INLINE
+        // clang-format on
+        const int rank = (K * K) / 2;
+        ker_count_t sum = 0;
+        bin_t m = BINS - 1;
+        bool found = false;
+        for (int b = 0; b < BINS; b++) {
+// clang-format off
+#pragma HLS UNROLL
+            // clang-format on
+            sum += hist[b];
+            if (!found && sum > rank) {
+                m = b;
+                found = true;
+            }
+        }
+        pixel_t out = pixel_t(m) << SHIFT;
+        if (SHIFT > 0) out |= pixel_t(1) << (SHIFT > 0 ? SHIFT - 1 : 0);
+        return out;
+    }
+};
+
+// ======================================================================================
+
+template <int FILTER_SIZE,
+          int BORDER_TYPE,
+          int TYPE,
+          int ROWS,
+          int COLS,
+          int NPC = 1,
+          int BIN_BITS = (XF_DTPIXELDEPTH(TYPE, NPC) < 8) ? XF_DTPIXELDEPTH(TYPE, NPC) : 8,
+          int IN_BITS = XF_DTPIXELDEPTH(TYPE, NPC)>
+void medianBlurHist(xf::cv::Mat<TYPE, ROWS, COLS, NPC>& _src,
+                    xf::cv::Mat<TYPE, ROWS, COLS, NPC>& _dst,
+                    unsigned short border_value = 0) {
+// clang-format off
+#pragma HLS INLINE OFF
+    // clang-format on
+#ifndef __SYNTHESIS__
+    assert(((_src.rows <= ROWS) && (_src.cols <= COLS)) && "ROWS and COLS should be greater than input image");
+    assert(((_dst.rows == _src.rows) && (_dst.cols == _src.cols)) && "Input and output image sizes must match");
+    assert((NPC == XF_NPPC1) && "NPC must be XF_NPPC1");
+    assert(((TYPE == XF_8UC1) || (TYPE == XF_16UC1)) && "TYPE must be XF_8UC1 or XF_16UC1");
+    assert(((BORDER_TYPE == XF_BORDER_REPLICATE) || (BORDER_TYPE == XF_BORDER_CONSTANT)) &&
+           "BORDER_TYPE must be XF_BORDER_REPLICATE or XF_BORDER_CONSTANT");
+    assert(((FILTER_SIZE & 1) == 1) && (FILTER_SIZE >= 3) && "FILTER_SIZE must be odd and at least 3");
+    assert((BIN_BITS <= IN_BITS) && (IN_BITS <= XF_DTPIXELDEPTH(TYPE, NPC)) &&
+           "BIN_BITS <= IN_BITS <= pixel depth is required");
+#endif
+    typedef MedianBlurHist<FILTER_SIZE, BORDER_TYPE, TYPE, ROWS, COLS, BIN_BITS, IN_BITS> median_t;
+#ifndef __SYNTHESIS__
+    // C-simulation allocates the column histograms per call, BINS x COLS of them overflow the stack
+    std::unique_ptr<median_t> median_mem(new median_t);
+    median_t& median = *median_mem;
+#else
+    median_t median;
+#endif
+    median.process(_src, _dst, border_value);
+}
+
+} // namespace cv
+} // namespace xf
+
+#endif //__XF_MEDIAN_BLUR_HIST_HPP__
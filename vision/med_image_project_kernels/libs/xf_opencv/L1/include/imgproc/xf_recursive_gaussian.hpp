@@ -0,0 +1,457 @@
+/*
+ * Copyright 2021 Xilinx, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __XF_RECURSIVE_GAUSSIAN_HPP__
+#define __XF_RECURSIVE_GAUSSIAN_HPP__
+
+#include "ap_int.h"
+#include "common/xf_common.hpp"
+#include "common/xf_structs.hpp"
+#include "common/xf_utility.hpp"
+#include "hls_math.h"
+#include "hls_stream.h"
+
+#ifndef __SYNTHESIS__
+#include <memory>
+#endif
+
+//----------------------------------------------------------------------------------------------------//
+// Recursive Gaussian blur for sigma from 0.5 to HALO / 8, where xf::cv::GaussianBlur stops at 7x7.
+//
+// Young and van Vliet's third order recursive approximation of the Gaussian: a causal and an
+// anti-causal pass w[n] = b * x[n] + a1 * w[n - 1] + a2 * w[n - 2] + a3 * w[n - 3] along the rows and
+// then along the columns, seven multiply-adds per pixel and pass whatever sigma is. Borders are
+// replicated: the causal passes start from the steady state of the first sample and the anti-causal
+// passes from Triggs and Sdika's exact continuation of the last one. Two stages under DATAFLOW:
+//
+//   rgRowPass  ROW_LANES rows at a time with the rows interleaved, so that the recursion only needs
+//              its previous result ROW_LANES clocks later: the causal pass over a group of rows while
+//              the next group arrives and the anti-causal pass of the previous group runs backwards
+//   rgColPass  the causal pass down the columns as the rows arrive, then the anti-causal pass up over
+//              strip k and its HALO rows while the rows of strip k + 1 arrive and strip k - 1 leaves,
+//              as in xf::cv::distanceTransformStrip
+//
+// A strip whose halo ends above the bottom starts its anti-causal pass from the steady state of the
+// last halo row; its effect decays by the filter's pole, ~exp(-HALO / sigma), so HALO has to be at
+// least 8 * sigma to keep the result within one grey level of filtering whole columns: sigma up to 8 at
+// the default HALO of 64. Only frames of at most STRIP + HALO rows, where every halo reaches the bottom
+// border, take sigma up to 64. The pipeline runs at STRIP / (STRIP + HALO) pixels per clock.
+//
+// Fixed point throughout: coefficients Q.26, the border matrix Q.30, recursion states Q.18 and the
+// values between the passes Q.8, rounded to nearest; the CPU medimg::RecursiveGaussian does the same
+// and gives identical results. On chip: 3 x ROW_LANES x COLS input pixels, states and row pass results,
+// a (2 * STRIP + HALO) x COLS ring of column pass results and 2 x STRIP x COLS output pixels.
+// XF_8UC1 and XF_16UC1 at XF_NPPC1.
+//----------------------------------------------------------------------------------------------------//
+
+namespace xf {
+namespace cv {
+
+// Young and van Vliet's coefficients and Triggs and Sdika's border matrix for one sigma
+struct rg_coeffs {
+    ap_int<32> b, a1, a2, a3; // Q.COEF_FRAC, b + a1 + a2 + a3 exactly 1 << COEF_FRAC
+    ap_int<48> m[3][3];       // Q.BORDER_FRAC
+};
+
+template <int IN_BITS>
+struct rg_traits {
+    static constexpr int COEF_FRAC = 26;
+    static constexpr int BORDER_FRAC = 30;
+    static constexpr int STATE_FRAC = 18;
+    static constexpr int INTER_FRAC = 8;
+    typedef ap_int<IN_BITS + STATE_FRAC + 2> state_t;
+    typedef ap_int<IN_BITS + INTER_FRAC + 2> inter_t;
+};
+
+static ap_int<48> rgRound(double v) {
+// clang-format off
+#pragma HLS INLINE
+    // clang-format on
+    return (long long)hls::floor(v + 0.5);
+}
+
+/* Once per frame, in double precision: the same arithmetic as medimg::RecursiveGaussian::coeffs() */
+static rg_coeffs recursiveGaussianCoeffs(float sigma) {
+    const double s = sigma;
+    const double q = (s >= 2.5) ? (0.98711 * s - 0.96330) : (3.97156 - 4.14554 * hls::sqrt(1.0 - 0.26891 * s));
+    const double b0 = 1.57825 + 2.44413 * q + 1.4281 * q * q + 0.422205 * q * q * q;
+    const double one = (double)(1 << rg_traits<8>::COEF_FRAC), border = (double)(1ll << rg_traits<8>::BORDER_FRAC);
+    rg_coeffs coef;
+    coef.a1 = rgRound((2.44413 * q + 2.85619 * q * q + 1.26661 * q * q * q) / b0 * one);
+    coef.a2 = rgRound(-(1.4281 * q * q + 1.26661 * q * q * q) / b0 * one);
+    coef.a3 = rgRound((0.422205 * q * q * q) / b0 * one);
+    coef.b = (1 << rg_traits<8>::COEF_FRAC) - coef.a1 - coef.a2 - coef.a3;
+
+    // From the rounded coefficients, the entries grow with sigma and are sensitive to them
+    const double a1 = coef.a1.to_double() / one, a2 = coef.a2.to_double() / one, a3 = coef.a3.to_double() / one;
+    const double b = coef.b.to_double() / one;
+    const double scale = b / ((1.0 + a1 - a2 + a3) * (1.0 - a1 - a2 - a3) * (1.0 + a2 + (a1 - a3) * a3));
+    const double m[3][3] = {{-a3 * a1 + 1.0 - a3 * a3 - a2, (a3 + a1) * (a2 + a3 * a1), a3 * (a1 + a3 * a2)},
+                            {a1 + a3 * a2, -(a2 - 1.0) * (a2 + a3 * a1), -a3 * (a3 * a1 + a3 * a3 + a2 - 1.0)},
+                            {a3 * a1 + a2 + a1 * a1 - a2 * a2,
+                             a1 * a2 + a3 * a2 * a2 - a1 * a3 * a3 - a3 * a3 * a3 - a3 * a2 + a3, a3 * (a1 + a3 * a2)}};
+    for (int i = 0; i < 3; i++)
+        for (int j = 0; j < 3; j++) coef.m[i][j] = rgRound(m[i][j] * scale * border);
+    return coef;
+}
+
+template <int IN_BITS>
+typename rg_traits<IN_BITS>::state_t rgStep(const rg_coeffs& coef,
+                                            typename rg_traits<IN_BITS>::state_t x,
+                                            typename rg_traits<IN_BITS>::state_t w1,
+                                            typename rg_traits<IN_BITS>::state_t w2,
+                                            typename rg_traits<IN_BITS>::state_t w3) {
+// clang-format off
+#pragma HLS INLINE
+    // clang-format on
+    const int CF = rg_traits<IN_BITS>::COEF_FRAC;
+    ap_int<64> acc = coef.b * x + coef.a1 * w1 + coef.a2 * w2 + coef.a3 * w3 + (ap_int<64>)(1 << (CF - 1));
+    return acc >> CF;
+}
+
+/* Triggs and Sdika: anti-causal states v[n - 1], v[n], v[n + 1] of n samples ending in x_end from the
+ * last causal states u[n - 1], u[n - 2], u[n - 3] */
+template <int IN_BITS>
+void rgTriggs(const rg_coeffs& coef,
+              typename rg_traits<IN_BITS>::state_t x_end,
+              typename rg_traits<IN_BITS>::state_t u1,
+              typename rg_traits<IN_BITS>::state_t u2,
+              typename rg_traits<IN_BITS>::state_t u3,
+              typename rg_traits<IN_BITS>::state_t v[3]) {
+// clang-format off
+#pragma HLS INLINE
+    // clang-format on
+    const int BF = rg_traits<IN_BITS>::BORDER_FRAC;
+    typedef ap_int<IN_BITS + rg_traits<IN_BITS>::STATE_FRAC + 3> dev_t;
+    const dev_t d1 = u1 - x_end, d2 = u2 - x_end, d3 = u3 - x_end;
+TRIGGS_LOOP:
+    for (int i = 0; i < 3; i++) {
+// clang-format off
+#pragma HLS UNROLL
+        // clang-format on
+        ap_int<96> acc = (ap_int<96>)coef.m[i][0] * d1 + (ap_int<96>)coef.m[i][1] * d2 + (ap_int<96>)coef.m[i][2] * d3 +
+                         ((ap_int<96>)1 << (BF - 1));
+        v[i] = x_end + (typename rg_traits<IN_BITS>::state_t)(acc >> BF);
+    }
+}
+
+template <int IN_BITS>
+typename rg_traits<IN_BITS>::inter_t rgToInter(typename rg_traits<IN_BITS>::state_t v) {
+// clang-format off
+#pragma HLS INLINE
+    // clang-format on
+    const int SHIFT = rg_traits<IN_BITS>::STATE_FRAC - rg_traits<IN_BITS>::INTER_FRAC;
+    return (v + (typename rg_traits<IN_BITS>::state_t)(1 << (SHIFT - 1))) >> SHIFT;
+}
+
+template <int SRC_T, int ROWS, int COLS, int ROW_LANES, int USE_URAM>
+void rgRowPass(xf::cv::Mat<SRC_T, ROWS, COLS, XF_NPPC1>& _src,
+               hls::stream<typename rg_traits<XF_DTPIXELDEPTH(SRC_T, XF_NPPC1)>::inter_t>& _h,
+               const rg_coeffs& coef,
+               int rows,
+               int cols) {
+// clang-format off
+#pragma HLS INLINE OFF
+    // clang-format on
+    constexpr int IN_BITS = XF_DTPIXELDEPTH(SRC_T, XF_NPPC1);
+    constexpr int SF = rg_traits<IN_BITS>::STATE_FRAC;
+    typedef typename rg_traits<IN_BITS>::state_t state_t;
+    typedef typename rg_traits<IN_BITS>::inter_t inter_t;
+    constexpr int L = ROW_LANES;
+
+    typedef XF_TNAME(SRC_T, XF_NPPC1) pixel_t;
+
+#ifndef __SYNTHESIS__
+    // Row groups of up to COLS pixels and states each, allocated per call in C-simulation
+    std::unique_ptr<pixel_t[][L][COLS]> in(new pixel_t[2][L][COLS]);
+    std::unique_ptr<state_t[][L][COLS]> causal(new state_t[2][L][COLS]);
+    std::unique_ptr<inter_t[][L][COLS]> out(new inter_t[2][L][COLS]);
+#else
+    pixel_t in[2][L][COLS];
+    state_t causal[2][L][COLS];
+    inter_t out[2][L][COLS];
+#endif
+    // Per lane: first sample, last sample and last three causal states of a group, Triggs start
+    state_t first[L], last[2][L], tail[2][L][3], start[L][3];
+    // Results of the last 3 * L steps, the previous three of a lane are L, 2 * L and 3 * L steps back
+    state_t cu[3 * L], cv[3 * L];
+// clang-format off
+#pragma HLS ARRAY_PARTITION variable=in complete dim=1
+#pragma HLS ARRAY_PARTITION variable=causal complete dim=1
+#pragma HLS ARRAY_PARTITION variable=out complete dim=1
+#pragma HLS ARRAY_PARTITION variable=first complete dim=0
+#pragma HLS ARRAY_PARTITION variable=last complete dim=0
+#pragma HLS ARRAY_PARTITION variable=tail complete dim=0
+#pragma HLS ARRAY_PARTITION variable=start complete dim=0
+#pragma HLS ARRAY_PARTITION variable=cu complete dim=1
+#pragma HLS ARRAY_PARTITION variable=cv complete dim=1
+#pragma HLS DEPENDENCE variable=in inter false
+#pragma HLS DEPENDENCE variable=causal inter false
+#pragma HLS DEPENDENCE variable=out inter false
+    // clang-format on
+    if (USE_URAM) {
+// clang-format off
+#pragma HLS RESOURCE variable=causal core=RAM_S2P_URAM
+        // clang-format on
+    }
+
+    const int groups = (rows + L - 1) / L;
+    int idx = 0;
+
+// Group g: load group g, causal pass over group g - 1, anti-causal pass over group g - 2 and emit
+// group g - 3, the last three iterations drain
+GROUP_LOOP:
+    for (int g = 0; g < groups + 3; g++) {
+// clang-format off
+#pragma HLS LOOP_TRIPCOUNT min=1 max=ROWS/ROW_LANES+3
+        // clang-format on
+        const bool ca = (g >= 1) && (g - 1 < groups), ac = (g >= 2) && (g - 2 < groups);
+        const int ld_rows = (g < groups) ? ((rows - g * L < L) ? (rows - g * L) : L) : 0;
+        const int em_rows = (g >= 3) ? ((rows - (g - 3) * L < L) ? (rows - (g - 3) * L) : L) : 0;
+        const int ld_p = g & 1, ca_p = (g - 1) & 1, ac_p = (g - 2) & 1, em_p = (g - 3) & 1;
+        int ld_l = 0, ld_c = 0, em_l = 0, em_c = 0, ca_l = 0, ca_c = 0;
+
+    STEP_LOOP:
+        for (int t = 0; t < L * cols; t++) {
+// clang-format off
+#pragma HLS LOOP_TRIPCOUNT min=1 max=ROW_LANES*COLS
+#pragma HLS PIPELINE II=1
+            // clang-format on
+            if (ld_l < ld_rows) in[ld_p][ld_l][ld_c] = _src.read(idx++);
+
+            // Lanes interleaved: column ca_c of lane ca_l, forwards for causal and backwards for anti-causal
+            if (ca) {
+                const state_t x = (state_t)in[ca_p][ca_l][ca_c] << SF;
+                if (ca_c == 0) {
+                    first[ca_l] = x;
+                    tail[ca_p][ca_l][1] = x;
+                    tail[ca_p][ca_l][2] = x;
+                }
+                const state_t x0 = (ca_c == 0) ? x : first[ca_l];
+                const state_t w1 = (ca_c >= 1) ? cu[L - 1] : x0;
+                const state_t w2 = (ca_c >= 2) ? cu[2 * L - 1] : x0;
+                const state_t w3 = (ca_c >= 3) ? cu[3 * L - 1] : x0;
+                const state_t u = rgStep<IN_BITS>(coef, x, w1, w2, w3);
+                causal[ca_p][ca_l][ca_c] = u;
+                if (ca_c >= cols - 3) tail[ca_p][ca_l][cols - 1 - ca_c] = u;
+                if (ca_c == cols - 1) last[ca_p][ca_l] = x;
+            CU_SHIFT_LOOP:
+                for (int i = 3 * L - 1; i > 0; i--) {
+// clang-format off
+#pragma HLS UNROLL
+                    // clang-format on
+                    cu[i] = cu[i - 1];
+                }
+                cu[0] = u;
+            }
+            if (ac) {
+                const int c = cols - 1 - ca_c;
+                state_t v;
+                if (ca_c == 0) {
+                    rgTriggs<IN_BITS>(coef, last[ac_p][ca_l], tail[ac_p][ca_l][0], tail[ac_p][ca_l][1],
+                                      tail[ac_p][ca_l][2], start[ca_l]);
+                    v = start[ca_l][0];
+                } else {
+                    const state_t w2 = (ca_c >= 2) ? cv[2 * L - 1] : start[ca_l][1];
+                    const state_t w3 = (ca_c >= 3) ? cv[3 * L - 1] : start[ca_l][3 - ca_c];
+                    v = rgStep<IN_BITS>(coef, causal[ac_p][ca_l][c], cv[L - 1], w2, w3);
+                }
+                out[ac_p][ca_l][c] = rgToInter<IN_BITS>(v);
+            CV_SHIFT_LOOP:
+                for (int i = 3 * L - 1; i > 0; i--) {
+// clang-format off
+#pragma HLS UNROLL
+                    // clang-format on
+                    cv[i] = cv[i - 1];
+                }
+                cv[0] = v;
+            }
+
+            if (em_l < em_rows) _h.write(out[em_p][em_l][em_c]);
+
+            if (++ld_c == cols) ld_c = 0, ld_l++;
+            if (++em_c == cols) em_c = 0, em_l++;
+            if (++ca_l == L) ca_l = 0, ca_c++;
+        }
+    }
+}
+
+template <int DST_T, int ROWS, int COLS, int STRIP, int HALO, int USE_URAM>
+void rgColPass(hls::stream<typename rg_traits<XF_DTPIXELDEPTH(DST_T, XF_NPPC1)>::inter_t>& _h,
+               xf::cv::Mat<DST_T, ROWS, COLS, XF_NPPC1>& _dst,
+               const rg_coeffs& coef,
+               int rows,
+               int cols) {
+// clang-format off
+#pragma HLS INLINE OFF
+    // clang-format on
+    constexpr int IN_BITS = XF_DTPIXELDEPTH(DST_T, XF_NPPC1);
+    constexpr int SF = rg_traits<IN_BITS>::STATE_FRAC;
+    constexpr int SHIFT = SF - rg_traits<IN_BITS>::INTER_FRAC;
+    constexpr int RING = 2 * STRIP + HALO;
+    constexpr int OUT_MAX = (1 << IN_BITS) - 1;
+    typedef typename rg_traits<IN_BITS>::state_t state_t;
+    typedef typename rg_traits<IN_BITS>::inter_t inter_t;
+    typedef XF_TNAME(DST_T, XF_NPPC1) pixel_t;
+
+#ifndef __SYNTHESIS__
+    // The ring alone holds 2 * STRIP + HALO frame wide rows, C-simulation keeps it and vout on the heap
+    std::unique_ptr<inter_t[][COLS]> ring(new inter_t[RING][COLS]);
+    std::unique_ptr<pixel_t[][STRIP][COLS]> vout(new pixel_t[2][STRIP][COLS]);
+#else
+    inter_t ring[RING][COLS];
+    pixel_t vout[2][STRIP][COLS];
+#endif
+    // Last three causal and anti-causal states and the last input of every column
+    state_t cu1[COLS], cu2[COLS], cu3[COLS], cv1[COLS], cv2[COLS], cv3[COLS];
+    inter_t xlast[COLS];
+// clang-format off
+#pragma HLS ARRAY_PARTITION variable=vout complete dim=1
+#pragma HLS DEPENDENCE variable=ring inter false
+#pragma HLS DEPENDENCE variable=vout inter false
+    // clang-format on
+    if (USE_URAM) {
+// clang-format off
+#pragma HLS RESOURCE variable=ring core=RAM_S2P_URAM
+        // clang-format on
+    }
+
+    const int strips = (rows + STRIP - 1) / STRIP;
+    int loaded = 0, ld_slot = 0, idx = 0;
+
+// Strip k: load the rows strip k + 1 still needs, causal pass included, run the anti-causal pass over
+// strip k and its halo and emit strip k - 1. The first iteration primes the ring with strip 0 and its
+// halo, the last one drains.
+STRIP_LOOP:
+    for (int k = -1; k <= strips; k++) {
+// clang-format off
+#pragma HLS LOOP_TRIPCOUNT min=2 max=ROWS/STRIP+2
+        // clang-format on
+        const int s0 = k * STRIP;
+        const int s1 = (s0 + STRIP < rows) ? (s0 + STRIP) : rows;
+        const int h1 = (s1 + HALO < rows) ? (s1 + HALO) : rows;
+        const int ld_end = (k < 0) ? ((STRIP + HALO < rows) ? (STRIP + HALO) : rows)
+                                   : ((s1 + STRIP + HALO < rows) ? (s1 + STRIP + HALO) : rows);
+        const int ld_rows = ld_end - loaded;
+        const int ac_rows = (k >= 0 && k < strips) ? (h1 - s0) : 0;
+        int em_rows = 0;
+        if (k > 0) em_rows = (rows - (k - 1) * STRIP < STRIP) ? (rows - (k - 1) * STRIP) : STRIP;
+        int steps = (ac_rows > ld_rows) ? ac_rows : ld_rows;
+        if (em_rows > steps) steps = em_rows;
+        // The bottom border is reached once the causal pass is complete
+        const bool bottom = (h1 == rows);
+        int ac_slot = (h1 - 1) % RING;
+
+    STEP_LOOP:
+        for (int t = 0; t < steps; t++) {
+// clang-format off
+#pragma HLS LOOP_TRIPCOUNT min=1 max=STRIP+HALO
+            // clang-format on
+            const int r = h1 - 1 - t;
+            const bool ld = (t < ld_rows), ac = (t < ac_rows), em = (t < em_rows);
+            const int lr = loaded + t;
+
+        STEP_COL_LOOP:
+            for (int c = 0; c < cols; c++) {
+// clang-format off
+#pragma HLS LOOP_TRIPCOUNT min=1 max=COLS
+#pragma HLS PIPELINE II=1
+                // clang-format on
+                const state_t u1 = cu1[c], u2 = cu2[c], u3 = cu3[c];
+                if (ld) {
+                    const inter_t h = _h.read();
+                    const state_t x = (state_t)h << SHIFT;
+                    const state_t w1 = (lr == 0) ? x : u1;
+                    const state_t w2 = (lr == 0) ? x : u2;
+                    const state_t w3 = (lr == 0) ? x : u3;
+                    const state_t u = rgStep<IN_BITS>(coef, x, w1, w2, w3);
+                    ring[ld_slot][c] = rgToInter<IN_BITS>(u);
+                    cu1[c] = u;
+                    cu2[c] = w1;
+                    cu3[c] = w2;
+                    xlast[c] = h;
+                }
+                if (ac) {
+                    const state_t x = (state_t)ring[ac_slot][c] << SHIFT;
+                    state_t v, v2, v3;
+                    if (t > 0) {
+                        v = rgStep<IN_BITS>(coef, x, cv1[c], cv2[c], cv3[c]);
+                        v2 = cv1[c];
+                        v3 = cv2[c];
+                    } else if (bottom) {
+                        state_t start[3];
+                        rgTriggs<IN_BITS>(coef, (state_t)xlast[c] << SHIFT, u1, u2, u3, start);
+                        v = start[0];
+                        v2 = start[1];
+                        v3 = start[2];
+                    } else {
+                        v = v2 = v3 = x;
+                    }
+                    cv1[c] = v;
+                    cv2[c] = v2;
+                    cv3[c] = v3;
+                    if (r < s1) {
+                        const state_t p = (v + (state_t)(1 << (SF - 1))) >> SF;
+                        vout[k & 1][r - s0][c] = (p < 0) ? pixel_t(0) : ((p > OUT_MAX) ? pixel_t(OUT_MAX) : pixel_t(p));
+                    }
+                }
+                if (em) _dst.write(idx++, vout[(k - 1) & 1][t][c]);
+            }
+
+            if (ld) ld_slot = (ld_slot == RING - 1) ? 0 : (ld_slot + 1);
+            ac_slot = (ac_slot == 0) ? (RING - 1) : (ac_slot - 1);
+        }
+        loaded = ld_end;
+    }
+}
+
+// ======================================================================================
+
+template <int TYPE, int ROWS, int COLS, int NPC = XF_NPPC1, int STRIP = 16, int HALO = 64, int ROW_LANES = 4,
+          int USE_URAM = 0>
+void recursiveGaussian(xf::cv::Mat<TYPE, ROWS, COLS, NPC>& _src,
+                       xf::cv::Mat<TYPE, ROWS, COLS, NPC>& _dst,
+                       float sigma) {
+// clang-format off
+#pragma HLS INLINE OFF
+    // clang-format on
+#ifndef __SYNTHESIS__
+    assert(((_src.rows <= ROWS) && (_src.cols <= COLS)) && "ROWS and COLS should be greater than input image");
+    assert(((_dst.rows == _src.rows) && (_dst.cols == _src.cols)) && "Input and output image sizes must match");
+    assert(((TYPE == XF_8UC1) || (TYPE == XF_16UC1)) && "TYPE must be XF_8UC1 or XF_16UC1");
+    assert((NPC == XF_NPPC1) && "Only XF_NPPC1 is supported");
+    assert((sigma >= 0.5f) && (sigma <= 64.0f) && "sigma must be within 0.5 .. 64");
+    assert((STRIP >= 1) && (HALO >= 0) && (ROW_LANES >= 1) && "STRIP and ROW_LANES must be at least 1");
+    assert(((8.0f * sigma <= HALO) || (STRIP + HALO >= _src.rows)) && "HALO must be at least 8 * sigma");
+#endif
+    typedef typename rg_traits<XF_DTPIXELDEPTH(TYPE, NPC)>::inter_t inter_t;
+    int rows = _src.rows, cols = _src.cols;
+    const rg_coeffs coef = recursiveGaussianCoeffs(sigma);
+
+    hls::stream<inter_t> horizontal;
+// clang-format off
+#pragma HLS STREAM variable=horizontal depth=2
+#pragma HLS DATAFLOW
+    // clang-format on
+
+    rgRowPass<TYPE, ROWS, COLS, ROW_LANES, USE_URAM>(_src, horizontal, coef, rows, cols);
+    rgColPass<TYPE, ROWS, COLS, STRIP, HALO, USE_URAM>(horizontal, _dst, coef, rows, cols);
+}
+
+} // namespace cv
+} // namespace xf
+
+#endif //__XF_RECURSIVE_GAUSSIAN_HPP__
@@ -30,4 +30,21 @@
 
 #define ITERATIONS 1
 
+/* Bilateral grid denoise ahead of equalization and thresholding, cells of 2^DENOISE_SPACE_SHIFT pixels and
+ * 2^DENOISE_RANGE_SHIFT grey levels (sigma of about 0.87 times each); XF_NPPC1 (NO) only */
+#define DENOISE 0
+#define DENOISE_SPACE_SHIFT 4
+#define DENOISE_RANGE_SHIFT 4
+
+/* Equalize each slice with the histogram of the previous one ahead of thresholding, adds the hist argument */
+#define EQUALIZE 0
+
+/* Threshold every pixel against the mean and spread of the LOCAL_THRESH_WIN square window around it instead
+ * of thresh alone, which stays a global floor: XF_LOCAL_THRESH_BRADLEY, XF_LOCAL_THRESH_NIBLACK or
+ * XF_LOCAL_THRESH_SAUVOLA with k = LOCAL_THRESH_K / 256 */
+#define LOCAL_THRESH 0
+#define LOCAL_THRESH_METHOD XF_LOCAL_THRESH_SAUVOLA
+#define LOCAL_THRESH_WIN 31
+#define LOCAL_THRESH_K 64
+
 
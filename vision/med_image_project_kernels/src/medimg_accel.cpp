@@ -23,10 +23,17 @@ void medimg_accel(ap_uint<INPUT_PTR_WIDTH>* img_inp,
 		int rows,
 		int cols,
 		unsigned char thresh,
-		unsigned char maxval) {
+		unsigned char maxval
+#if EQUALIZE
+		, unsigned int* hist // Histogram of the previous slice in, of this slice out; zeroed per series
+#endif
+		) {
     #pragma HLS INTERFACE m_axi     port=img_inp  offset=slave bundle=gmem0
 	#pragma HLS INTERFACE m_axi     port=process_shape offset=slave  bundle=gmem1
     #pragma HLS INTERFACE m_axi     port=img_out  offset=slave bundle=gmem2
+#if EQUALIZE
+    #pragma HLS INTERFACE m_axi     port=hist     offset=slave bundle=gmem3 depth=256
+#endif
 
     #pragma HLS INTERFACE s_axilite port=rows
     #pragma HLS INTERFACE s_axilite port=cols
@@ -48,28 +55,72 @@ void medimg_accel(ap_uint<INPUT_PTR_WIDTH>* img_inp,
 
     //xf::cv::Mat<TYPE, HEIGHT, WIDTH, NPC1> thresholdOut(height, width);
 
-    xf::cv::Mat<XF_8UC1, HEIGHT, WIDTH, NPIX> in_mat(rows, cols);
+    xf::cv::Mat<XF_8UC1, HEIGHT, WIDTH, NPIX, STAGE_DEPTH> in_mat(rows, cols);
     #pragma HLS stream variable=in_mat.data depth=2
 
-    xf::cv::Mat<XF_8UC1, HEIGHT, WIDTH, NPIX> out_mat(rows, cols);
+    xf::cv::Mat<XF_8UC1, HEIGHT, WIDTH, NPIX, STAGE_DEPTH> out_mat(rows, cols);
     #pragma HLS stream variable=out_mat.data depth=2
 
-    xf::cv::Mat<XF_8UC1, HEIGHT, WIDTH, NPIX> threshold_out(rows, cols);
+    xf::cv::Mat<XF_8UC1, HEIGHT, WIDTH, NPIX, STAGE_DEPTH> threshold_out(rows, cols);
 	#pragma HLS stream variable=threshold_out.data depth=2
 
-    xf::cv::Mat<XF_8UC1, HEIGHT, WIDTH, NPIX> morph_out(rows, cols);
+#if DENOISE
+    xf::cv::Mat<XF_8UC1, HEIGHT, WIDTH, NPIX, STAGE_DEPTH> denoise_out(rows, cols);
+	#pragma HLS stream variable=denoise_out.data depth=2
+#define EQUALIZE_IN denoise_out
+#else
+#define EQUALIZE_IN in_mat
+#endif
+
+#if EQUALIZE
+    xf::cv::Mat<XF_8UC1, HEIGHT, WIDTH, NPIX, STAGE_DEPTH> equalize_out(rows, cols);
+	#pragma HLS stream variable=equalize_out.data depth=2
+#define THRESHOLD_IN equalize_out
+#else
+#define THRESHOLD_IN EQUALIZE_IN
+#endif
+
+    xf::cv::Mat<XF_8UC1, HEIGHT, WIDTH, NPIX, STAGE_DEPTH> morph_out(rows, cols);
 	#pragma HLS stream variable=morph_out.data depth=2
 
     #pragma HLS DATAFLOW
 
-    xf::cv::Array2xfMat<INPUT_PTR_WIDTH, XF_8UC1, HEIGHT, WIDTH, NPIX>(img_inp, in_mat);
+    // Every dataflow function written once: a stage on its own thread in threaded C-sim, a call otherwise
+#if defined(XF_SIM_DATAFLOW_THREADS) && !defined(__SYNTHESIS__)
+    // C-sim only: every dataflow function on its own thread, connected by the depth 2 Mat streams
+    xf::cv::DataflowRegion region("medimg_accel");
+#define MEDIMG_STAGE(name, ...) region.stage(name, [&] { __VA_ARGS__; })
+#else
+#define MEDIMG_STAGE(name, ...) __VA_ARGS__
+#endif
 
-    xf::cv::Threshold<THRESH_TYPE, XF_8UC1, HEIGHT, WIDTH, NPIX>(in_mat, threshold_out, thresh, maxval);
+    MEDIMG_STAGE("Array2xfMat", xf::cv::Array2xfMat<INPUT_PTR_WIDTH, XF_8UC1, HEIGHT, WIDTH, NPIX>(img_inp, in_mat));
 
-    xf::cv::dilate<XF_BORDER_CONSTANT, TYPE, HEIGHT, WIDTH, KERNEL_SHAPE, FILTER_SIZE, FILTER_SIZE, ITERATIONS, NPC1>(threshold_out, morph_out, _kernel_dilate);
+#if DENOISE
+    MEDIMG_STAGE("bilateralGrid", xf::cv::bilateralGrid<XF_8UC1, HEIGHT, WIDTH, NPIX, DENOISE_SPACE_SHIFT, DENOISE_RANGE_SHIFT>(in_mat, denoise_out));
+#endif
 
-    xf::cv::erode<XF_BORDER_CONSTANT, TYPE, HEIGHT, WIDTH, KERNEL_SHAPE, FILTER_SIZE, FILTER_SIZE, ITERATIONS, NPC1>(morph_out, out_mat, _kernel_erode);
+#if EQUALIZE
+    MEDIMG_STAGE("equalizeHistTemporal", xf::cv::equalizeHistTemporal<XF_8UC1, HEIGHT, WIDTH, NPIX>(EQUALIZE_IN, equalize_out, hist));
+#endif
 
-    xf::cv::xfMat2Array<OUTPUT_PTR_WIDTH, XF_8UC1, HEIGHT, WIDTH, NPIX>(out_mat, img_out);
+#if LOCAL_THRESH
+    MEDIMG_STAGE("localThreshold", xf::cv::localThreshold<LOCAL_THRESH_METHOD, XF_8UC1, HEIGHT, WIDTH, NPIX, LOCAL_THRESH_WIN>(THRESHOLD_IN, threshold_out, thresh, maxval, LOCAL_THRESH_K));
+#else
+    MEDIMG_STAGE("Threshold", xf::cv::Threshold<THRESH_TYPE, XF_8UC1, HEIGHT, WIDTH, NPIX>(THRESHOLD_IN, threshold_out, thresh, maxval));
+#endif
+
+    MEDIMG_STAGE("dilate", xf::cv::dilate<XF_BORDER_CONSTANT, TYPE, HEIGHT, WIDTH, KERNEL_SHAPE, FILTER_SIZE, FILTER_SIZE, ITERATIONS, NPC1>(threshold_out, morph_out, _kernel_dilate));
+
+    MEDIMG_STAGE("erode", xf::cv::erode<XF_BORDER_CONSTANT, TYPE, HEIGHT, WIDTH, KERNEL_SHAPE, FILTER_SIZE, FILTER_SIZE, ITERATIONS, NPC1>(morph_out, out_mat, _kernel_erode));
+
+    MEDIMG_STAGE("xfMat2Array", xf::cv::xfMat2Array<OUTPUT_PTR_WIDTH, XF_8UC1, HEIGHT, WIDTH, NPIX>(out_mat, img_out));
+
+#if defined(XF_SIM_DATAFLOW_THREADS) && !defined(__SYNTHESIS__)
+    region.join();
+#endif
+#undef MEDIMG_STAGE
+#undef THRESHOLD_IN
+#undef EQUALIZE_IN
 }
 }
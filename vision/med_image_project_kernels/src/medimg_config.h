@@ -17,6 +17,11 @@
 #ifndef _XF_THRESHOLD_CONFIG_H_
 #define _XF_THRESHOLD_CONFIG_H_
 
+#if defined(XF_SIM_DATAFLOW_THREADS) && !defined(__SYNTHESIS__)
+#include "common/xf_sim_dataflow.hpp"
+#elif defined(XF_SIM_SPSC_STREAM) && !defined(__SYNTHESIS__)
+#include "common/xf_sim_stream.hpp"
+#endif
 #include "hls_stream.h"
 #include "ap_int.h"
 
@@ -26,11 +31,22 @@
 #include "imgproc/xf_threshold.hpp"
 #include "imgproc/xf_erosion.hpp"
 #include "imgproc/xf_dilation.hpp"
+#include "imgproc/xf_hist_equalize.hpp"
+#include "imgproc/xf_bilateral_grid.hpp"
+#include "imgproc/xf_local_threshold.hpp"
 #include "xf_config_params.h"
 
 typedef ap_uint<8> ap_uint8_t;
 typedef ap_uint<64> ap_uint64_t;
 
+/* Depth of the Mats between the dataflow stages. Threaded C-sim needs them to be streams as in
+ * synthesis; only these, the default depth of every other Mat is left alone. */
+#if defined(XF_SIM_DATAFLOW_THREADS) && !defined(__SYNTHESIS__)
+#define STAGE_DEPTH 2
+#else
+#define STAGE_DEPTH xf::cv::_XFCVDEPTH_DEFAULT
+#endif
+
 /*  set the height and weight  */
 #define HEIGHT 2160
 #define WIDTH 3840
@@ -41,6 +57,9 @@ typedef ap_uint<64> ap_uint64_t;
 #if NO
 #define NPIX XF_NPPC1
 #endif
+#if DENOISE && !NO
+#error "DENOISE needs the XF_NPPC1 pipeline (NO)"
+#endif
 
 // Resolve optimization type:
 #if NO
@@ -70,9 +89,18 @@ typedef ap_uint<64> ap_uint64_t;
 #define WIDTH 3840
 #define HEIGHT 2160
 
-/*void medimg_accel(xf::cv::Mat<XF_8UC1, HEIGHT, WIDTH, NPIX>& _src,
-                     xf::cv::Mat<XF_8UC1, HEIGHT, WIDTH, NPIX>& _dst,
-                     unsigned char thresh,
-                     unsigned char maxval);*/
+/* The kernel, for everything that calls it in C-sim: with EQUALIZE, hist carries the histogram of the
+ * previous slice in and of this slice out, and has to be zeroed at the start of every series */
+extern "C" void medimg_accel(ap_uint<INPUT_PTR_WIDTH>* img_inp,
+                             unsigned char* process_shape,
+                             ap_uint<OUTPUT_PTR_WIDTH>* img_out,
+                             int rows,
+                             int cols,
+                             unsigned char thresh,
+                             unsigned char maxval
+#if EQUALIZE
+                             , unsigned int* hist
+#endif
+                             );
 
 #endif // end of _XF_THRESHOLD_CONFIG_H_